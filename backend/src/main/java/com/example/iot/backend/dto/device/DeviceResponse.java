@@ -11,7 +11,8 @@ public record DeviceResponse(
         String name,
         String status,
         LocalDateTime updatedAt,
-        Long locationId) {
+        Long locationId,
+        Long telemetryLost) {
     public static DeviceResponse toDeviceResponse(Device device) {
         return DeviceResponse.builder()
                 .id(device.getId())
@@ -19,6 +20,7 @@ public record DeviceResponse(
                 .status(device.getStatus().name())
                 .updatedAt(device.getUpdatedAt())
                 .locationId(device.getLocation().getId())
+                .telemetryLost(device.getTelemetryLost() != null ? device.getTelemetryLost() : 0L)
                 .build();
     }
 }
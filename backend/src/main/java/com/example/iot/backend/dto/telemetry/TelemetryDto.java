@@ -1,15 +1,22 @@
 package com.example.iot.backend.dto.telemetry;
 
 import com.example.iot.backend.model.Telemetry;
+import com.fasterxml.jackson.annotation.JsonIgnoreProperties;
 import lombok.Builder;
 
 @Builder
+@JsonIgnoreProperties(ignoreUnknown = true)
 public record TelemetryDto(
         Long timestamp,
         Double temperature,
         Double humidity,
         Double pressure,
-        Integer personCount
+        Integer personCount,
+        Long seq,
+        // Batch header, sent with the first record only; dropped is recorded
+        // per device by TelemetryService.recordBatchHeader()
+        Long bootSeq,
+        Long dropped
 ) {
     public static TelemetryDto toTelemetryDto(Telemetry telemetry) {
         return TelemetryDto.builder()
@@ -55,6 +55,12 @@ public class Device {
     @Column(nullable = false)
     private String hardwareId;
 
+    // Telemetry loss reported in batch headers: the device's eviction
+    // counter for its current boot, and the total over all boots
+    private Long telemetryBootSeq;
+    private Long telemetryDropped;
+    private Long telemetryLost;
+
     @UpdateTimestamp
     @Column(nullable = false)
     private LocalDateTime updatedAt;
@@ -7,6 +7,7 @@ import jakarta.persistence.Id;
 import jakarta.persistence.JoinColumn;
 import jakarta.persistence.ManyToOne;
 import jakarta.persistence.Table;
+import jakarta.persistence.UniqueConstraint;
 import lombok.AllArgsConstructor;
 import lombok.Builder;
 import lombok.Getter;
@@ -19,7 +20,8 @@ import static jakarta.persistence.FetchType.LAZY;
 import static jakarta.persistence.GenerationType.IDENTITY;
 
 @Entity
-@Table(name = "telemetry")
+@Table(name = "telemetry",
+        uniqueConstraints = @UniqueConstraint(name = "uk_telemetry_device_seq", columnNames = { "device_id", "seq" }))
 @Builder
 @Getter
 @NoArgsConstructor
@@ -37,6 +39,10 @@ public class Telemetry {
     private Double pressure;
     private Integer personCount;
 
+    // Device-side sequence number, unique per device across reboots; null
+    // for rows from older firmware
+    private Long seq;
+
     @ManyToOne(fetch = LAZY)
     @JoinColumn(name = "device_id", nullable = false)
     private Device device;
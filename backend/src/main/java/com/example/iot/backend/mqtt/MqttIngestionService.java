@@ -10,6 +10,7 @@ import com.fasterxml.jackson.databind.JsonNode;
 import com.fasterxml.jackson.databind.ObjectMapper;
 import lombok.RequiredArgsConstructor;
 import lombok.extern.slf4j.Slf4j;
+import org.springframework.dao.DataIntegrityViolationException;
 import org.springframework.integration.annotation.ServiceActivator;
 import org.springframework.messaging.handler.annotation.Header;
 import org.springframework.messaging.handler.annotation.Payload;
@@ -58,9 +59,25 @@ public class MqttIngestionService {
 
             log.info("Processing telemetry for MAC: {}", parsedTopic.getMacAddress());
 
+            if (!telemetryDtos.isEmpty()) {
+                TelemetryDto header = telemetryDtos.get(0);
+                try {
+                    telemetryService.recordBatchHeader(parsedTopic.getMacAddress(), header.bootSeq(),
+                            header.dropped());
+                } catch (Exception e) {
+                    log.error("Error recording telemetry loss for MAC {}: {}", parsedTopic.getMacAddress(),
+                            e.getMessage());
+                }
+            }
+
+            // QoS 1 and device-side retries deliver records at least once;
+            // the (device, seq) unique key rejects those already stored
             telemetryDtos.forEach(telemetryDto -> {
                 try {
                     telemetryService.saveTelemetry(telemetryDto, parsedTopic.getMacAddress());
+                } catch (DataIntegrityViolationException e) {
+                    log.info("Skipping duplicate telemetry seq {} for MAC {}", telemetryDto.seq(),
+                            parsedTopic.getMacAddress());
                 } catch (Exception e) {
                     log.error("Error saving telemetry for MAC {}: {}", parsedTopic.getMacAddress(), e.getMessage());
                 }
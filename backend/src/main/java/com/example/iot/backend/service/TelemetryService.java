@@ -61,6 +61,10 @@ public class TelemetryService {
                 .orElse(null);
     }
 
+    // Delivery is at least once (lost PUBACKs, spool replay after a reboot).
+    // A record already stored under the same (device, seq) fails the unique
+    // key with DataIntegrityViolationException, which the caller treats as a
+    // duplicate.
     @Transactional
     public void saveTelemetry(TelemetryDto dto, String macAddress) {
         log.info("Saving telemetry for MAC: '{}'", macAddress);
@@ -80,12 +84,46 @@ public class TelemetryService {
                 .humidity(dto.humidity())
                 .pressure(dto.pressure())
                 .personCount(dto.personCount())
+                .seq(dto.seq())
                 .build();
 
         var saved = telemetryRepository.saveAndFlush(telemetry);
         log.info("Telemetry saved. Database ID: {}", saved.getId());
     }
 
+    // The batch header carries the device's eviction counter since boot.
+    // Its growth since the last header is telemetry lost before publishing;
+    // a header from an earlier boot or an older one redelivered is ignored.
+    @Transactional
+    public void recordBatchHeader(String macAddress, Long bootSeq, Long dropped) {
+        if (bootSeq == null || dropped == null) {
+            return;
+        }
+        var device = deviceRepository.findByMacAddressIgnoreCase(macAddress)
+                .orElseThrow(() -> resourceNotFound(Device.class));
+
+        Long lastBootSeq = device.getTelemetryBootSeq();
+        long lastDropped = device.getTelemetryDropped() != null ? device.getTelemetryDropped() : 0;
+        long lost;
+        if (lastBootSeq == null || bootSeq > lastBootSeq) {
+            lost = dropped;
+        } else if (bootSeq.equals(lastBootSeq) && dropped > lastDropped) {
+            lost = dropped - lastDropped;
+        } else {
+            return;
+        }
+
+        long total = (device.getTelemetryLost() != null ? device.getTelemetryLost() : 0) + lost;
+        device.setTelemetryBootSeq(bootSeq);
+        device.setTelemetryDropped(dropped);
+        device.setTelemetryLost(total);
+        deviceRepository.save(device);
+        if (lost > 0) {
+            log.warn("Device {} evicted {} telemetry records before publishing ({} lost in total)",
+                    macAddress, lost, total);
+        }
+    }
+
     private boolean isValidTimestamp(Long timestamp) {
         // Check if timestamp is after Jan 1, 2020
         return timestamp != null && timestamp > 1577836800000L;
@@ -0,0 +1,8 @@
+-- Device-side sequence number of each telemetry record. Delivery is at
+-- least once, so a redelivered record must fail the unique key instead of
+-- being stored twice. Rows from older firmware keep seq NULL, which the key
+-- does not compare.
+ALTER TABLE telemetry ADD COLUMN seq BIGINT;
+
+ALTER TABLE telemetry
+    ADD CONSTRAINT uk_telemetry_device_seq UNIQUE (device_id, seq);
@@ -0,0 +1,4 @@
+-- Telemetry lost on the device, from the eviction counter in batch headers
+ALTER TABLE devices ADD COLUMN telemetry_boot_seq BIGINT;
+ALTER TABLE devices ADD COLUMN telemetry_dropped BIGINT;
+ALTER TABLE devices ADD COLUMN telemetry_lost BIGINT;
@@ -0,0 +1,151 @@
+package com.example.iot.backend.mqtt;
+
+import com.example.iot.backend.model.Device;
+import com.example.iot.backend.model.Telemetry;
+import com.example.iot.backend.repository.DeviceRepository;
+import com.example.iot.backend.repository.TelemetryRepository;
+import com.example.iot.backend.service.DeviceService;
+import com.example.iot.backend.service.TelemetryService;
+import com.fasterxml.jackson.databind.ObjectMapper;
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+import org.springframework.beans.factory.annotation.Autowired;
+import org.springframework.boot.data.jpa.test.autoconfigure.DataJpaTest;
+import org.springframework.context.annotation.Import;
+import org.springframework.transaction.annotation.Propagation;
+import org.springframework.transaction.annotation.Transactional;
+
+import java.util.List;
+import java.util.Objects;
+
+import static org.assertj.core.api.Assertions.assertThat;
+import static org.mockito.Mockito.mock;
+
+// Each record is saved in its own transaction, as in production, so a
+// duplicate rolls back only itself
+@DataJpaTest
+@Import(TelemetryService.class)
+@Transactional(propagation = Propagation.NOT_SUPPORTED)
+class MqttIngestionServiceTest {
+
+    private static final String MAC = "AA:BB:CC:DD:EE:FF";
+    private static final String TOPIC = "smart-led/device/" + MAC + "/telemetry";
+
+    @Autowired
+    private TelemetryService telemetryService;
+
+    @Autowired
+    private TelemetryRepository telemetryRepository;
+
+    @Autowired
+    private DeviceRepository deviceRepository;
+
+    private MqttIngestionService ingestionService;
+
+    @BeforeEach
+    void setUp() {
+        telemetryRepository.deleteAll();
+        deviceRepository.deleteAll();
+        deviceRepository.save(Device.builder()
+                .macAddress(MAC)
+                .proofOfPossession("pop")
+                .name("test")
+                .hardwareId("hw")
+                .build());
+        ingestionService = new MqttIngestionService(telemetryService, mock(DeviceService.class),
+                new ObjectMapper(), new MqttTopicParser());
+    }
+
+    @Test
+    void redeliveredBatchIsSkipped() {
+        String batch = """
+                [{"timestamp":1700000000000,"temperature":21.5,"seq":10,"bootSeq":0,"dropped":0},
+                 {"timestamp":1700000030000,"temperature":21.6,"seq":11}]""";
+
+        ingestionService.handleMessage(batch, TOPIC);
+        ingestionService.handleMessage(batch, TOPIC);
+
+        assertThat(telemetryRepository.count()).isEqualTo(2);
+        assertThat(storedSeqs()).containsExactly(10L, 11L);
+    }
+
+    @Test
+    void overlappingBatchStoresOnlyNewRecords() {
+        ingestionService.handleMessage("""
+                [{"timestamp":1700000000000,"seq":10,"bootSeq":0,"dropped":0},
+                 {"timestamp":1700000030000,"seq":11}]""", TOPIC);
+        ingestionService.handleMessage("""
+                [{"timestamp":1700000030000,"seq":11,"bootSeq":0,"dropped":0},
+                 {"timestamp":1700000060000,"seq":12}]""", TOPIC);
+
+        assertThat(storedSeqs()).containsExactly(10L, 11L, 12L);
+    }
+
+    // The device reserves numbers ahead in NVS, so a record spooled before a
+    // reboot keeps its seq and still matches its first delivery
+    @Test
+    void recordReplayedAfterRebootIsSkipped() {
+        ingestionService.handleMessage("""
+                [{"timestamp":1700000000000,"seq":12,"bootSeq":0,"dropped":0}]""", TOPIC);
+        ingestionService.handleMessage("""
+                [{"timestamp":1700000000000,"seq":12,"bootSeq":256,"dropped":0},
+                 {"timestamp":1700000090000,"seq":256}]""", TOPIC);
+
+        assertThat(storedSeqs()).containsExactly(12L, 256L);
+    }
+
+    @Test
+    void recordsWithoutSeqAreAlwaysStored() {
+        String batch = """
+                [{"timestamp":1700000000000,"temperature":21.5}]""";
+
+        ingestionService.handleMessage(batch, TOPIC);
+        ingestionService.handleMessage(batch, TOPIC);
+
+        assertThat(telemetryRepository.count()).isEqualTo(2);
+    }
+
+    // dropped counts evictions since boot: its growth is what was lost
+    @Test
+    void droppedCounterIsRecordedAsLoss() {
+        ingestionService.handleMessage(batch(0, 0, 10), TOPIC);
+        assertThat(lost()).isZero();
+
+        ingestionService.handleMessage(batch(0, 5, 20), TOPIC);
+        assertThat(lost()).isEqualTo(5);
+
+        // Redelivered batch, and an older header arriving late
+        ingestionService.handleMessage(batch(0, 5, 20), TOPIC);
+        ingestionService.handleMessage(batch(0, 3, 15), TOPIC);
+        assertThat(lost()).isEqualTo(5);
+
+        // New boot: its counter starts over
+        ingestionService.handleMessage(batch(256, 2, 256), TOPIC);
+        assertThat(lost()).isEqualTo(7);
+        ingestionService.handleMessage(batch(0, 9, 21), TOPIC);
+        assertThat(lost()).isEqualTo(7);
+        assertThat(device().getTelemetryDropped()).isEqualTo(2);
+    }
+
+    private static String batch(long bootSeq, long dropped, long seq) {
+        return "[{\"timestamp\":1700000000000,\"seq\":" + seq + ",\"bootSeq\":" + bootSeq
+                + ",\"dropped\":" + dropped + "}]";
+    }
+
+    private Device device() {
+        return deviceRepository.findByMacAddressIgnoreCase(MAC).orElseThrow();
+    }
+
+    private long lost() {
+        Long lost = device().getTelemetryLost();
+        return lost != null ? lost : 0;
+    }
+
+    private List<Long> storedSeqs() {
+        return telemetryRepository.findAll().stream()
+                .map(Telemetry::getSeq)
+                .filter(Objects::nonNull)
+                .sorted()
+                .toList();
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef HOST_ALLOC_COUNT_H
+#define HOST_ALLOC_COUNT_H
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/**
+ * @brief Counts heap allocations made through operator new
+ *
+ * Replaces the global operator new/delete, so include it from exactly one
+ * translation unit per test executable.
+ */
+
+inline std::atomic<uint64_t> g_alloc_count{0};
+
+inline uint64_t alloc_count() {
+    return g_alloc_count.load(std::memory_order_relaxed);
+}
+
+void* operator new(std::size_t size) {
+    g_alloc_count.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+#endif // HOST_ALLOC_COUNT_H
@@ -0,0 +1,261 @@
+// telemetry_cbor: decodes the encoder's output with an independent CBOR
+// reader and checks every field against the source records, checks
+// measure() == write() and the size bound, and compares size and CPU time
+// with the JSON writer.
+
+#include "telemetry_cbor.h"
+#include "telemetry_json.h"
+#include "telemetry_samples.h"
+#include "test_util.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Just enough of RFC 8949 for the telemetry map: integers, text, arrays, maps
+struct CborItem {
+    enum Kind { Int, Text, Array, Map } kind = Int;
+    int64_t value = 0;
+    std::string text;
+    std::vector<CborItem> items;
+    std::map<std::string, CborItem> fields;
+};
+
+class CborReader {
+public:
+    CborReader(const uint8_t* data, size_t len) : data_(data), len_(len) {}
+
+    bool read(CborItem& item) {
+        uint8_t major;
+        uint64_t arg;
+        if (!head(major, arg)) {
+            return false;
+        }
+        switch (major) {
+        case 0:
+            item.kind = CborItem::Int;
+            item.value = (int64_t)arg;
+            return arg <= INT64_MAX;
+        case 1:
+            item.kind = CborItem::Int;
+            item.value = -1 - (int64_t)arg;
+            return arg <= INT64_MAX;
+        case 3:
+            if (arg > len_ - pos_) {
+                return false;
+            }
+            item.kind = CborItem::Text;
+            item.text.assign((const char*)data_ + pos_, arg);
+            pos_ += arg;
+            return true;
+        case 4:
+            item.kind = CborItem::Array;
+            item.items.resize(arg);
+            for (CborItem& element : item.items) {
+                if (!read(element)) {
+                    return false;
+                }
+            }
+            return true;
+        case 5:
+            item.kind = CborItem::Map;
+            for (uint64_t i = 0; i < arg; i++) {
+                CborItem key;
+                if (!read(key) || key.kind != CborItem::Text || item.fields.count(key.text)) {
+                    return false;
+                }
+                if (!read(item.fields[key.text])) {
+                    return false;
+                }
+            }
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    size_t position() const { return pos_; }
+
+private:
+    bool head(uint8_t& major, uint64_t& arg) {
+        if (pos_ >= len_) {
+            return false;
+        }
+        uint8_t initial = data_[pos_++];
+        major = initial >> 5;
+        uint8_t info = initial & 0x1F;
+        if (info < 24) {
+            arg = info;
+            return true;
+        }
+        if (info > 27) {
+            return false;
+        }
+        size_t n = (size_t)1 << (info - 24);
+        if (n > len_ - pos_) {
+            return false;
+        }
+        arg = 0;
+        for (size_t i = 0; i < n; i++) {
+            arg = (arg << 8) | data_[pos_++];
+        }
+        // Preferred (shortest) serialisation, as RFC 8949 deterministic encoding
+        return arg >= (n == 1 ? 24u : (uint64_t)1 << (4 * n));
+    }
+
+    const uint8_t* data_;
+    size_t len_;
+    size_t pos_ = 0;
+};
+
+const CborItem* column(const CborItem& root, const char* key, size_t count) {
+    auto it = root.fields.find(key);
+    if (it == root.fields.end() || it->second.kind != CborItem::Array ||
+        it->second.items.size() != count) {
+        std::fprintf(stderr, "column \"%s\" missing or wrong length\n", key);
+        return nullptr;
+    }
+    return &it->second;
+}
+
+int64_t scalar(const CborItem& root, const char* key) {
+    auto it = root.fields.find(key);
+    if (it == root.fields.end() || it->second.kind != CborItem::Int) {
+        std::fprintf(stderr, "scalar \"%s\" missing\n", key);
+        g_check_failures++;
+        return 0;
+    }
+    return it->second.value;
+}
+
+// Decodes a batch and compares every value with the records it came from
+bool round_trip(const Telemetry* records, size_t count, const TelemetryBatchInfo& info) {
+    std::vector<uint8_t> out(telemetry_cbor_max_len(count));
+    size_t n = telemetry_cbor_write(out.data(), out.size(), records, count, info);
+    if (n == 0 || n != telemetry_cbor_measure(records, count, info)) {
+        return false;
+    }
+
+    CborReader reader(out.data(), n);
+    CborItem root;
+    if (!reader.read(root) || reader.position() != n || root.kind != CborItem::Map ||
+        root.fields.size() != 18 || (out[0] & 0xE0) != 0xA0) {
+        return false;
+    }
+
+    bool ok = scalar(root, "v") == TELEMETRY_CBOR_VERSION &&
+              scalar(root, "bs") == info.boot_seq && scalar(root, "ev") == info.dropped;
+    int64_t time = scalar(root, "t0");
+    uint32_t seq = (uint32_t)scalar(root, "s0");
+
+    static const char* const kColumns[] = {"ds", "dt", "t", "h", "p", "c", "en",
+                                           "ex", "oc", "ua", "ul", "ra", "rl"};
+    const CborItem* cols[13];
+    for (int c = 0; c < 13; c++) {
+        cols[c] = column(root, kColumns[c], count);
+        if (cols[c] == nullptr) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const Telemetry& r = records[i];
+        seq += (uint32_t)cols[0]->items[i].value;
+        time += cols[1]->items[i].value;
+        int64_t expected[13] = {0,
+                                0,
+                                r.temperatureCenti(),
+                                r.humidityCenti(),
+                                r.pressureDeciPa(),
+                                r.personCount(),
+                                r.entries(),
+                                r.exits(),
+                                r.occupancy(),
+                                r.ultrasonicAccuracy(),
+                                r.ultrasonicLatencyMs(),
+                                r.radarAccuracy(),
+                                r.radarLatencyMs()};
+        ok = ok && seq == r.seq && time == r.timestamp();
+        for (int c = 2; c < 13; c++) {
+            ok = ok && cols[c]->items[i].value == expected[c];
+        }
+    }
+    return ok;
+}
+
+void test_round_trip() {
+    std::vector<Telemetry> trace = sample_trace(50);
+    for (size_t count = 0; count <= 50; count++) {
+        CHECK(round_trip(trace.data(), count, {trace[0].seq, 0}));
+    }
+
+    // Field extremes, sequence wraps and timestamps far apart
+    for (uint32_t seed = 1; seed <= 200; seed++) {
+        std::vector<Telemetry> records = random_records(50, seed);
+        TelemetryBatchInfo info = {records[0].seq, seed % 3 ? seed : UINT32_MAX};
+        for (size_t count = 1; count <= 50; count += 7) {
+            CHECK(round_trip(records.data(), count, info));
+        }
+    }
+}
+
+void test_capacity() {
+    std::vector<Telemetry> records = random_records(50, 7);
+    TelemetryBatchInfo info = {0, 0};
+    std::vector<uint8_t> out(telemetry_cbor_max_len(50) + 1);
+    for (size_t count = 1; count <= 50; count++) {
+        size_t expected = telemetry_cbor_measure(records.data(), count, info);
+        CHECK(expected <= telemetry_cbor_max_len(count));
+        out.assign(out.size(), 0x5A);
+        CHECK_EQ(telemetry_cbor_write(out.data(), expected - 1, records.data(), count, info), 0);
+        CHECK(out[0] == 0x5A);
+        CHECK_EQ(telemetry_cbor_write(out.data(), expected, records.data(), count, info),
+                 expected);
+        CHECK(out[expected] == 0x5A);
+    }
+}
+
+void bench_against_json() {
+    std::vector<Telemetry> records = sample_trace(50);
+    TelemetryBatchInfo info = {records[0].seq, 0};
+    static char json[telemetry_json_max_len(50)];
+    static uint8_t cbor[telemetry_cbor_max_len(50)];
+    const size_t sizes[] = {1, 10, 50};
+
+    std::printf("bench: batch  JSON B/record  us/batch   CBOR B/record  us/batch\n");
+    for (size_t count : sizes) {
+        const int kBatches = 200000 / (int)count;
+        size_t json_len = 0;
+        double start = now_us();
+        for (int i = 0; i < kBatches; i++) {
+            json_len = telemetry_json_write(json, sizeof(json), records.data(), count, info);
+            keep(json);
+        }
+        double json_us = (now_us() - start) / kBatches;
+
+        size_t cbor_len = 0;
+        start = now_us();
+        for (int i = 0; i < kBatches; i++) {
+            cbor_len = telemetry_cbor_write(cbor, sizeof(cbor), records.data(), count, info);
+            keep(cbor);
+        }
+        double cbor_us = (now_us() - start) / kBatches;
+
+        std::printf("bench: %5zu  %13.1f  %8.2f   %13.1f  %8.2f\n", count,
+                    (double)json_len / count, json_us, (double)cbor_len / count, cbor_us);
+        if (count == 50) {
+            CHECK(cbor_len * 3 < json_len);
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_round_trip();
+    test_capacity();
+    bench_against_json();
+    return test_result("cbor_test");
+}
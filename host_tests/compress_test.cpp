@@ -0,0 +1,211 @@
+// telemetry_compress: every output is expanded by an independent LZ4 block
+// decoder that also enforces the format's end-of-block rules, on JSON and
+// CBOR batches and on edge-case inputs; plus ratio and speed on a trace.
+
+#include "telemetry_cbor.h"
+#include "telemetry_compress.h"
+#include "telemetry_json.h"
+#include "telemetry_samples.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Reference LZ4 block decoder (lz4_Block_format.md). Rejects anything a
+// stock decoder could misread: bad offsets, overruns, a match in the last
+// 5 bytes or one starting within 12 bytes of the end.
+bool lz4_decode(const uint8_t* src, size_t len, std::vector<uint8_t>& out, size_t expected) {
+    out.clear();
+    size_t ip = 0;
+    auto length = [&](size_t base, size_t& value) {
+        value = base;
+        if (base != 15) {
+            return true;
+        }
+        while (ip < len) {
+            uint8_t b = src[ip++];
+            value += b;
+            if (b != 255) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    while (ip < len) {
+        uint8_t token = src[ip++];
+        size_t literals;
+        if (!length(token >> 4, literals) || literals > len - ip) {
+            return false;
+        }
+        out.insert(out.end(), src + ip, src + ip + literals);
+        ip += literals;
+        if (ip == len) {
+            break;  // Last sequence: literals only
+        }
+
+        if (len - ip < 2) {
+            return false;
+        }
+        size_t offset = src[ip] | (src[ip + 1] << 8);
+        ip += 2;
+        size_t match;
+        if (offset == 0 || offset > out.size() || !length(token & 0x0F, match)) {
+            return false;
+        }
+        match += 4;
+        if (out.size() + 12 > expected || out.size() + match + 5 > expected) {
+            return false;
+        }
+        for (size_t i = 0; i < match; i++) {
+            out.push_back(out[out.size() - offset]);
+        }
+    }
+    return out.size() == expected;
+}
+
+// Compresses input and checks the header and the decoded bytes
+bool round_trip(const uint8_t* input, size_t len, size_t* compressed_len = nullptr) {
+    std::vector<uint8_t> dst(telemetry_compress_bound(len));
+    size_t n = telemetry_compress(input, len, dst.data(), dst.size());
+    if (compressed_len) {
+        *compressed_len = n;
+    }
+    if (n == 0) {
+        return true;  // Sent uncompressed
+    }
+    if (n >= len || dst[0] != TELEMETRY_COMPRESS_MARKER ||
+        dst[1] != TELEMETRY_COMPRESS_CODEC_LZ4) {
+        return false;
+    }
+    uint32_t stored = dst[2] | (dst[3] << 8) | (dst[4] << 16) | ((uint32_t)dst[5] << 24);
+    std::vector<uint8_t> decoded;
+    return stored == len &&
+           lz4_decode(dst.data() + TELEMETRY_COMPRESS_HEADER_LEN, n - TELEMETRY_COMPRESS_HEADER_LEN,
+                      decoded, len) &&
+           std::memcmp(decoded.data(), input, len) == 0;
+}
+
+std::vector<uint8_t> json_batch(const std::vector<Telemetry>& records, size_t count) {
+    std::vector<uint8_t> out(telemetry_json_max_len(count));
+    TelemetryBatchInfo info = {records[0].seq, 0};
+    out.resize(telemetry_json_write((char*)out.data(), out.size(), records.data(), count, info));
+    return out;
+}
+
+std::vector<uint8_t> cbor_batch(const std::vector<Telemetry>& records, size_t count) {
+    std::vector<uint8_t> out(telemetry_cbor_max_len(count));
+    TelemetryBatchInfo info = {records[0].seq, 0};
+    out.resize(telemetry_cbor_write(out.data(), out.size(), records.data(), count, info));
+    return out;
+}
+
+void test_telemetry_round_trip() {
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        std::vector<Telemetry> trace = sample_trace(50, seed);
+        for (size_t count = 1; count <= 50; count++) {
+            std::vector<uint8_t> json = json_batch(trace, count);
+            size_t n;
+            CHECK(round_trip(json.data(), json.size(), &n));
+            if (count >= 10) {
+                CHECK(n > 0);  // A real batch always shrinks
+            }
+            std::vector<uint8_t> cbor = cbor_batch(trace, count);
+            CHECK(round_trip(cbor.data(), cbor.size()));
+        }
+    }
+
+    // Largest input the 16-bit positions allow
+    std::vector<Telemetry> trace = sample_trace(500);
+    std::vector<uint8_t> json = json_batch(trace, 500);
+    json.resize(TELEMETRY_COMPRESS_MAX_INPUT);
+    CHECK(round_trip(json.data(), json.size()));
+}
+
+void test_edge_cases() {
+    std::vector<uint8_t> dst(telemetry_compress_bound(0x20000));
+    std::vector<uint8_t> input(0x10000, 'a');
+
+    CHECK_EQ(telemetry_compress(input.data(), 0, dst.data(), dst.size()), 0);
+    CHECK_EQ(telemetry_compress(input.data(), input.size(), dst.data(), dst.size()), 0);
+
+    // Short and long runs, lengths around the 15 and 255 length-byte steps
+    const size_t lengths[] = {1, 4, 5, 12, 13, 17, 18, 19, 20, 33, 270, 271, 4000, 0xFFFF};
+    for (size_t len : lengths) {
+        CHECK(round_trip(input.data(), len));
+    }
+
+    // Incompressible: refused rather than grown
+    SampleRandom rnd(42);
+    for (uint8_t& b : input) {
+        b = (uint8_t)rnd.next();
+    }
+    CHECK_EQ(telemetry_compress(input.data(), 4096, dst.data(), dst.size()), 0);
+
+    // Random data with repeats at every distance
+    for (uint32_t seed = 1; seed <= 100; seed++) {
+        SampleRandom mix(seed);
+        size_t len = 16 + mix.next() % 8000;
+        for (size_t i = 0; i < len; i++) {
+            input[i] = i > 64 && mix.next() % 3 ? input[i - 1 - mix.next() % 64]
+                                                : (uint8_t)(mix.next() % 4);
+        }
+        CHECK(round_trip(input.data(), len));
+    }
+
+    // Output capacity is respected, and too small means uncompressed
+    std::vector<Telemetry> trace = sample_trace(50);
+    std::vector<uint8_t> json = json_batch(trace, 50);
+    size_t full = telemetry_compress(json.data(), json.size(), dst.data(), dst.size());
+    CHECK(full > 0);
+    dst.assign(dst.size(), 0x5A);
+    CHECK_EQ(telemetry_compress(json.data(), json.size(), dst.data(), full - 1), 0);
+    CHECK(dst[full - 1] == 0x5A);
+}
+
+void bench_trace() {
+    std::vector<Telemetry> trace = sample_trace(1000);
+    std::vector<uint8_t> dst(telemetry_compress_bound(TELEMETRY_COMPRESS_MAX_INPUT));
+    const size_t sizes[] = {10, 50};
+
+    std::printf("bench: format batch  bytes  compressed  ratio  us/batch\n");
+    for (int format = 0; format < 2; format++) {
+        for (size_t count : sizes) {
+            size_t total_in = 0;
+            size_t total_out = 0;
+            int batches = 0;
+            double elapsed = 0;
+            for (size_t first = 0; first + count <= trace.size(); first += count) {
+                std::vector<Telemetry> slice(trace.begin() + first, trace.begin() + first + count);
+                std::vector<uint8_t> input =
+                    format == 0 ? json_batch(slice, count) : cbor_batch(slice, count);
+                double start = now_us();
+                size_t n = 0;
+                for (int rep = 0; rep < 20; rep++) {
+                    n = telemetry_compress(input.data(), input.size(), dst.data(), dst.size());
+                    keep(dst);
+                }
+                elapsed += (now_us() - start) / 20;
+                total_in += input.size();
+                total_out += n ? n : input.size();
+                batches++;
+            }
+            std::printf("bench: %-6s %5zu  %5zu  %10zu  %5.2f  %8.2f\n",
+                        format == 0 ? "json" : "cbor", count, total_in / batches,
+                        total_out / batches, (double)total_in / total_out, elapsed / batches);
+        }
+    }
+    std::printf("bench: RAM: 4 KB static hash table, output buffer of "
+                "telemetry_compress_bound(len) bytes\n");
+}
+
+}  // namespace
+
+int main() {
+    test_telemetry_round_trip();
+    test_edge_cases();
+    bench_trace();
+    return test_result("compress_test");
+}
@@ -0,0 +1,154 @@
+// Mutation fuzzing of led_config_json_decode, built with AddressSanitizer
+// and UBSan: every input sits in an exactly sized heap buffer, so a read
+// past len is reported. Whatever the input, a decode either leaves the
+// config alone or yields one that is in range and survives re-encoding.
+
+#include "led_config_json.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+LEDConfig base_config() {
+    LEDConfig c;
+    std::memset(&c, 0, sizeof(c));
+    const float thresholds[4] = {0.0f, 30.0f, 70.0f, 100.0f};
+    std::memcpy(c.humidity_thresholds, thresholds, sizeof(thresholds));
+    c.colors[0] = {255, 0, 0};
+    c.manual_brightness_pct = 80;
+    c.num_leds_active = 5;
+    c.no_motion_timeout_ms = 15000;
+    c.max_on_duration_ms = 300000;
+    c.distance_threshold_cm = 50.0f;
+    c.telemetry_max_latency_s = 120;
+    return c;
+}
+
+bool in_range(const LEDConfig& c) {
+    for (float t : c.humidity_thresholds) {
+        if (!(t >= 0 && t <= 100)) {
+            return false;
+        }
+    }
+    uint8_t auto_byte;
+    std::memcpy(&auto_byte, &c.auto_brightness, 1);
+    return c.manual_brightness_pct <= 100 && auto_byte <= 1 && c.num_leds_active >= 1 &&
+           c.num_leds_active <= 5 && c.no_motion_timeout_ms >= 1000 &&
+           c.no_motion_timeout_ms <= 300000 && c.max_on_duration_ms >= 1000 &&
+           c.max_on_duration_ms <= 600000 && c.distance_threshold_cm >= 1 &&
+           c.distance_threshold_cm <= 400 && c.telemetry_format <= TELEMETRY_FORMAT_CBOR &&
+           c.telemetry_compression <= TELEMETRY_COMPRESSION_LZ4 &&
+           c.telemetry_max_latency_s >= TELEMETRY_MAX_LATENCY_MIN_S &&
+           c.telemetry_max_latency_s <= TELEMETRY_MAX_LATENCY_MAX_S;
+}
+
+const char* kSeeds[] = {
+    "{\"humidityThresholds\":[30.0,50.0,70.0,90.0],\"colors\":[\"FF0000\",\"00FF00\","
+    "\"0000FF\"],\"brightnessPct\":80,\"autobrightness\":true,\"numLeds\":5,"
+    "\"noMotionTimeoutSec\":15,\"maxOnDurationSec\":300,\"distanceThresholdCm\":50.0,"
+    "\"telemetryFormat\":\"json\",\"telemetryCompression\":\"none\","
+    "\"telemetryMaxLatencySec\":120}",
+    "{\"numLeds\":3,\"x\":{\"y\":[1,2,{\"z\":\"\\\"}\"}]},\"autobrightness\":false}",
+    "{\"telemetryFormat\":\"cbor\",\"distanceThresholdCm\":-1.5e2,\"brightnessPct\":1e2}",
+};
+
+// Tokens that steer mutations towards the grammar's edges
+const char* kTokens[] = {"{", "}", "[", "]", ",", ":", "\"", "\\", "-", ".", "e",
+                         "1e309", "true", "null", "\"numLeds\"", "\"colors\"", " ", "0"};
+
+std::string mutate(std::string s, std::mt19937& rng) {
+    int edits = 1 + (int)(rng() % 4);
+    for (int i = 0; i < edits; i++) {
+        size_t pos = s.empty() ? 0 : rng() % (s.size() + 1);
+        switch (rng() % 5) {
+        case 0:
+            if (pos < s.size()) {
+                s[pos] = (char)(rng() & 0xFF);
+            }
+            break;
+        case 1:
+            if (pos < s.size()) {
+                s.erase(pos, 1 + rng() % 8);
+            }
+            break;
+        case 2:
+            s.insert(pos, kTokens[rng() % (sizeof(kTokens) / sizeof(kTokens[0]))]);
+            break;
+        case 3: {
+            // Duplicate a slice, e.g. a member or an array element
+            if (pos < s.size()) {
+                size_t len = 1 + rng() % 24;
+                s.insert(rng() % (s.size() + 1), s.substr(pos, len));
+            }
+            break;
+        }
+        case 4:
+            s.resize(pos);
+            break;
+        }
+    }
+    return s;
+}
+
+void test_mutations() {
+    std::mt19937 rng(12345);
+    const int kIterations = 200000;
+    int accepted = 0;
+    for (int i = 0; i < kIterations; i++) {
+        std::string text = mutate(kSeeds[i % 3], rng);
+        std::vector<char> input(text.begin(), text.end());
+
+        LEDConfig config = base_config();
+        LEDConfig before = config;
+        LEDConfigDecodeResult res = led_config_json_decode(input.data(), input.size(), config);
+        if (!res.ok) {
+            CHECK(std::memcmp(&config, &before, sizeof(config)) == 0);
+            CHECK_EQ(res.applied + res.rejected, 0);
+            continue;
+        }
+        accepted++;
+        CHECK(in_range(config));
+
+        // An accepted config re-encodes and decodes to itself
+        char json[LED_CONFIG_JSON_MAX_LEN];
+        size_t len = led_config_json_encode(json, sizeof(json), config);
+        CHECK(len > 0);
+        LEDConfig again = base_config();
+        CHECK(led_config_json_decode(json, len, again).ok);
+        char json2[LED_CONFIG_JSON_MAX_LEN];
+        size_t len2 = led_config_json_encode(json2, sizeof(json2), again);
+        CHECK(len == len2 && std::memcmp(json, json2, len) == 0);
+    }
+    // Enough inputs stay well-formed to exercise the field decoders
+    CHECK(accepted > kIterations / 20);
+    std::printf("fuzz: %d inputs, %d accepted\n", kIterations, accepted);
+}
+
+// Random bytes, mostly rejected at the first character
+void test_random_bytes() {
+    std::mt19937 rng(54321);
+    for (int i = 0; i < 50000; i++) {
+        std::vector<char> input(rng() % 64);
+        for (char& c : input) {
+            c = (char)(rng() & 0xFF);
+        }
+        if (!input.empty() && (rng() & 1)) {
+            input[0] = '{';
+        }
+        LEDConfig config = base_config();
+        led_config_json_decode(input.data(), input.size(), config);
+        CHECK(in_range(config));
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_mutations();
+    test_random_bytes();
+    return test_result("config_json_fuzz_test");
+}
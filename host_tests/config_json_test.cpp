@@ -0,0 +1,292 @@
+// led_config_json: range limits of every field, type mismatches, all-or-
+// nothing arrays, malformed text, encode/decode round trip and capacity,
+// and decode/encode cost.
+
+#include "alloc_count.h"
+#include "led_config_json.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <string>
+
+namespace {
+
+LEDConfig defaults() {
+    LEDConfig c;
+    std::memset(&c, 0, sizeof(c));
+    const float thresholds[4] = {0.0f, 30.0f, 70.0f, 100.0f};
+    std::memcpy(c.humidity_thresholds, thresholds, sizeof(thresholds));
+    c.colors[0] = {255, 0, 0};
+    c.colors[1] = {0, 0, 255};
+    c.colors[2] = {0, 255, 0};
+    c.manual_brightness_pct = 80;
+    c.auto_brightness = true;
+    c.num_leds_active = 5;
+    c.no_motion_timeout_ms = 15000;
+    c.max_on_duration_ms = 300000;
+    c.distance_threshold_cm = 50.0f;
+    c.telemetry_format = TELEMETRY_FORMAT_JSON;
+    c.telemetry_compression = TELEMETRY_COMPRESSION_NONE;
+    c.telemetry_max_latency_s = 120;
+    c.version = LED_CONFIG_VERSION;
+    return c;
+}
+
+bool same(const LEDConfig& a, const LEDConfig& b) {
+    return std::memcmp(a.humidity_thresholds, b.humidity_thresholds,
+                       sizeof(a.humidity_thresholds)) == 0 &&
+           std::memcmp(a.colors, b.colors, sizeof(a.colors)) == 0 &&
+           a.manual_brightness_pct == b.manual_brightness_pct &&
+           a.auto_brightness == b.auto_brightness && a.num_leds_active == b.num_leds_active &&
+           a.no_motion_timeout_ms == b.no_motion_timeout_ms &&
+           a.max_on_duration_ms == b.max_on_duration_ms &&
+           a.distance_threshold_cm == b.distance_threshold_cm &&
+           a.telemetry_format == b.telemetry_format &&
+           a.telemetry_compression == b.telemetry_compression &&
+           a.telemetry_max_latency_s == b.telemetry_max_latency_s;
+}
+
+LEDConfigDecodeResult decode(const std::string& json, LEDConfig& config) {
+    return led_config_json_decode(json.data(), json.size(), config);
+}
+
+// One numeric field: both limits are accepted, just past them is rejected
+// and leaves the field unchanged
+struct Range {
+    const char* name;
+    double min;
+    double max;
+    double step;  // Smallest value past a limit that must be rejected
+};
+
+void test_numeric_ranges() {
+    const Range ranges[] = {
+        {"brightnessPct", 0, 100, 1},
+        {"numLeds", 1, 5, 1},
+        {"noMotionTimeoutSec", 1, 300, 1},
+        {"maxOnDurationSec", 1, 600, 1},
+        {"distanceThresholdCm", 1, 400, 0.1},
+        {"telemetryMaxLatencySec", TELEMETRY_MAX_LATENCY_MIN_S, TELEMETRY_MAX_LATENCY_MAX_S, 1},
+    };
+    for (const Range& r : ranges) {
+        for (double value : {r.min, r.max, r.min - r.step, r.max + r.step, -1e30, 1e30}) {
+            LEDConfig config = defaults();
+            char json[96];
+            std::snprintf(json, sizeof(json), "{\"%s\":%.17g}", r.name, value);
+            LEDConfigDecodeResult res = decode(json, config);
+            bool in_range = value >= r.min && value <= r.max;
+            CHECK(res.ok);
+            CHECK_EQ(res.applied, in_range ? 1 : 0);
+            CHECK_EQ(res.rejected, in_range ? 0 : 1);
+            if (!in_range) {
+                CHECK(same(config, defaults()));
+            }
+        }
+    }
+
+    // Seconds on the wire, milliseconds stored
+    LEDConfig config = defaults();
+    CHECK(decode("{\"noMotionTimeoutSec\":300,\"maxOnDurationSec\":600}", config).ok);
+    CHECK_EQ(config.no_motion_timeout_ms, 300000);
+    CHECK_EQ(config.max_on_duration_ms, 600000);
+
+    // Fractions truncate
+    CHECK(decode("{\"numLeds\":2.9}", config).ok);
+    CHECK_EQ(config.num_leds_active, 2);
+}
+
+void test_wrong_types() {
+    const char* cases[] = {
+        "{\"brightnessPct\":\"50\"}",
+        "{\"numLeds\":true}",
+        "{\"autobrightness\":1}",
+        "{\"autobrightness\":null}",
+        "{\"telemetryFormat\":1}",
+        "{\"telemetryFormat\":\"xml\"}",
+        "{\"telemetryCompression\":\"LZ4\"}",
+        "{\"colors\":\"FF0000\"}",
+        "{\"colors\":[\"FF0000\",\"00FF00\",\"0000F\"]}",
+        "{\"colors\":[\"FF0000\",\"00FF00\",\"0000FG\"]}",
+        "{\"humidityThresholds\":{\"a\":1}}",
+        "{\"distanceThresholdCm\":[50]}",
+    };
+    for (const char* json : cases) {
+        LEDConfig config = defaults();
+        LEDConfigDecodeResult res = decode(json, config);
+        CHECK(res.ok);
+        CHECK_EQ(res.applied, 0);
+        CHECK_EQ(res.rejected, 1);
+        CHECK(same(config, defaults()));
+    }
+}
+
+// A bad element or wrong length leaves the whole array unchanged
+void test_arrays_all_or_nothing() {
+    const char* rejected[] = {
+        "{\"humidityThresholds\":[10,20,30]}",
+        "{\"humidityThresholds\":[10,20,30,40,50]}",
+        "{\"humidityThresholds\":[10,20,30,101]}",
+        "{\"humidityThresholds\":[10,\"20\",30,40]}",
+        "{\"humidityThresholds\":[]}",
+        "{\"colors\":[\"FF0000\",\"00FF00\"]}",
+    };
+    for (const char* json : rejected) {
+        LEDConfig config = defaults();
+        LEDConfigDecodeResult res = decode(json, config);
+        CHECK(res.ok);
+        CHECK_EQ(res.rejected, 1);
+        CHECK(same(config, defaults()));
+    }
+
+    LEDConfig config = defaults();
+    LEDConfigDecodeResult res =
+        decode("{\"humidityThresholds\":[5,25.5,60,95],\"colors\":[\"0a0B0c\",\"FFFFFF\",\"000000\"]}",
+               config);
+    CHECK_EQ(res.applied, 2);
+    CHECK_EQ(config.humidity_thresholds[1], 25.5f);
+    CHECK_EQ(config.colors[0].r, 0x0A);
+    CHECK_EQ(config.colors[0].b, 0x0C);
+    CHECK_EQ(config.colors[1].g, 0xFF);
+}
+
+void test_malformed_leaves_config() {
+    const char* cases[] = {
+        "",
+        "[]",
+        "{",
+        "{\"numLeds\":3",
+        "{\"numLeds\":3,}",
+        "{\"numLeds\" 3}",
+        "{\"numLeds\":3}}",
+        "{\"numLeds\":3} x",
+        "{numLeds:3}",
+        "{\"numLeds\":03}",
+        "{\"numLeds\":-}",
+        "{\"numLeds\":tru}",
+        "{\"colors\":[\"FF0000\",\"00FF00\",\"0000FF\"}",
+        "{\"a\":[[[[[[[[[[[[[[[[[[[[1]]]]]]]]]]]]]]]]]]]}",
+    };
+    for (const char* json : cases) {
+        LEDConfig config = defaults();
+        LEDConfigDecodeResult res = decode(json, config);
+        CHECK(!res.ok);
+        CHECK_EQ(res.applied, 0);
+        CHECK(same(config, defaults()));
+    }
+
+    // Every proper prefix of a valid document is malformed
+    char full[LED_CONFIG_JSON_MAX_LEN];
+    size_t len = led_config_json_encode(full, sizeof(full), defaults());
+    for (size_t n = 0; n < len; n++) {
+        LEDConfig config = defaults();
+        config.num_leds_active = 2;
+        LEDConfigDecodeResult res = led_config_json_decode(full, n, config);
+        CHECK(!res.ok);
+        CHECK_EQ(config.num_leds_active, 2);
+    }
+
+    // Unknown members, nested or not, are skipped
+    LEDConfig config = defaults();
+    LEDConfigDecodeResult res =
+        decode("{\"x\":{\"numLeds\":1},\"numLeds\":2,\"y\":[null,\"}\"]}", config);
+    CHECK(res.ok);
+    CHECK_EQ(res.applied, 1);
+    CHECK_EQ(config.num_leds_active, 2);
+}
+
+void test_round_trip() {
+    LEDConfig source = defaults();
+    const float thresholds[4] = {12.5f, 33.3f, 66.7f, 99.9f};
+    std::memcpy(source.humidity_thresholds, thresholds, sizeof(thresholds));
+    source.colors[1] = {0x12, 0xAB, 0xEF};
+    source.manual_brightness_pct = 0;
+    source.auto_brightness = false;
+    source.num_leds_active = 1;
+    source.no_motion_timeout_ms = 1000;
+    source.max_on_duration_ms = 600000;
+    source.distance_threshold_cm = 399.9f;
+    source.telemetry_format = TELEMETRY_FORMAT_CBOR;
+    source.telemetry_compression = TELEMETRY_COMPRESSION_LZ4;
+    source.telemetry_max_latency_s = 3600;
+
+    char json[LED_CONFIG_JSON_MAX_LEN];
+    size_t len = led_config_json_encode(json, sizeof(json), source);
+    CHECK(len > 0);
+    LEDConfig decoded = defaults();
+    LEDConfigDecodeResult res = led_config_json_decode(json, len, decoded);
+    CHECK(res.ok);
+    CHECK_EQ(res.applied, 11);
+    CHECK_EQ(res.rejected, 0);
+    CHECK(same(decoded, source));
+
+    // Exactly enough room, then one byte short
+    char exact[LED_CONFIG_JSON_MAX_LEN];
+    CHECK_EQ(led_config_json_encode(exact, len, source), len);
+    CHECK_EQ(led_config_json_encode(exact, len - 1, source), 0);
+
+    // Delta: nothing, then just the changed fields
+    CHECK_EQ(led_config_json_encode_delta(json, sizeof(json), source, source), 2);
+    CHECK(std::memcmp(json, "{}", 2) == 0);
+    LEDConfig changed = source;
+    changed.num_leds_active = 4;
+    changed.colors[2] = {1, 2, 3};
+    len = led_config_json_encode_delta(json, sizeof(json), changed, source);
+    CHECK(std::string(json, len) ==
+          "{\"colors\":[\"FF0000\",\"12ABEF\",\"010203\"],\"numLeds\":4}");
+}
+
+// Stored values no valid decode can produce still fit LED_CONFIG_JSON_MAX_LEN
+void test_worst_case_length() {
+    LEDConfig worst;
+    std::memset(&worst, 0xFF, sizeof(worst));
+    for (float& t : worst.humidity_thresholds) {
+        t = -3.4e38f;
+    }
+    worst.distance_threshold_cm = -3.4e38f;
+    worst.auto_brightness = false;
+    char json[LED_CONFIG_JSON_MAX_LEN];
+    size_t len = led_config_json_encode(json, sizeof(json), worst);
+    CHECK(len > 0);
+    LEDConfig decoded = defaults();
+    CHECK(led_config_json_decode(json, len, decoded).ok);
+}
+
+void bench_decode_encode() {
+    char json[LED_CONFIG_JSON_MAX_LEN];
+    const size_t len = led_config_json_encode(json, sizeof(json), defaults());
+    const int kRounds = 200000;
+
+    LEDConfig config = defaults();
+    uint64_t allocs = alloc_count();
+    double start = now_us();
+    for (int i = 0; i < kRounds; i++) {
+        keep(led_config_json_decode(json, len, config));
+    }
+    double decode_us = now_us() - start;
+
+    char out[LED_CONFIG_JSON_MAX_LEN];
+    start = now_us();
+    for (int i = 0; i < kRounds; i++) {
+        keep(led_config_json_encode(out, sizeof(out), config));
+        keep(out);
+    }
+    double encode_us = now_us() - start;
+    CHECK_EQ(alloc_count() - allocs, 0);
+
+    std::printf("bench: %zu-byte config, 11 fields: decode %.2f us, encode %.2f us, "
+                "0 allocations\n",
+                len, decode_us / kRounds, encode_us / kRounds);
+}
+
+}  // namespace
+
+int main() {
+    test_numeric_ranges();
+    test_wrong_types();
+    test_arrays_all_or_nothing();
+    test_malformed_leaves_config();
+    test_round_trip();
+    test_worst_case_length();
+    bench_decode_encode();
+    return test_result("config_json_test");
+}
@@ -0,0 +1,131 @@
+// LEDConfigManager loading NVS blobs saved by older firmware: shorter
+// prefixes, and the version-less 44-byte struct whose later telemetry
+// fields sat in tail padding.
+
+#include "led_config.h"
+#include "nvs.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+const LEDConfig& load(const std::vector<uint8_t>& blob, bool* ok) {
+    nvs_handle_t handle;
+    nvs_open("led_config", NVS_READWRITE, &handle);
+    nvs_set_blob(handle, "config", blob.data(), blob.size());
+    nvs_close(handle);
+    *ok = LEDConfigManager::getInstance().loadFromNVS();
+    return LEDConfigManager::getInstance().getConfig();
+}
+
+size_t stored_size() {
+    nvs_handle_t handle;
+    nvs_open("led_config", NVS_READONLY, &handle);
+    size_t size = 0;
+    nvs_get_blob(handle, "config", nullptr, &size);
+    nvs_close(handle);
+    return size;
+}
+
+// The first size bytes of config, the rest of a 44-byte struct filled
+// with padding as an older firmware would have saved it
+std::vector<uint8_t> legacy_blob(const LEDConfig& config, size_t size, uint8_t padding) {
+    std::vector<uint8_t> blob(size, padding);
+    std::memcpy(blob.data(), &config, size < 41 ? size : 41);
+    return blob;
+}
+
+LEDConfig customised() {
+    LEDConfig c;
+    std::memset(&c, 0, sizeof(c));
+    c.humidity_thresholds[1] = 40.0f;
+    c.colors[2] = {1, 2, 3};
+    c.num_leds_active = 3;
+    c.no_motion_timeout_ms = 20000;
+    c.distance_threshold_cm = 75.0f;
+    c.telemetry_format = TELEMETRY_FORMAT_CBOR;
+    c.telemetry_compression = TELEMETRY_COMPRESSION_LZ4;
+    c.telemetry_max_latency_s = 600;
+    c.version = LED_CONFIG_VERSION;
+    return c;
+}
+
+void test_prefix_before_telemetry_fields() {
+    bool ok;
+    const LEDConfig& c = load(legacy_blob(customised(), 40, 0), &ok);
+    CHECK(ok);
+    CHECK_EQ(c.num_leds_active, 3);
+    CHECK_EQ(c.no_motion_timeout_ms, 20000);
+    CHECK_EQ(c.telemetry_format, TELEMETRY_FORMAT_JSON);
+    CHECK_EQ(c.telemetry_compression, TELEMETRY_COMPRESSION_NONE);
+    CHECK_EQ(c.telemetry_max_latency_s, 120);
+    CHECK_EQ(c.version, LED_CONFIG_VERSION);
+    CHECK_EQ(stored_size(), sizeof(LEDConfig));
+}
+
+// 44 bytes with only telemetry_format set: the rest is tail padding
+void test_tail_padding_as_fields() {
+    for (uint8_t padding : {0x00, 0xA5, 0xFF}) {
+        bool ok;
+        const LEDConfig& c = load(legacy_blob(customised(), 44, padding), &ok);
+        CHECK(ok);
+        CHECK_EQ(c.distance_threshold_cm, 75.0f);
+        CHECK_EQ(c.telemetry_format, TELEMETRY_FORMAT_CBOR);
+        CHECK(c.telemetry_compression <= TELEMETRY_COMPRESSION_LZ4);
+        CHECK_EQ(c.telemetry_max_latency_s, 120);
+        CHECK_EQ(c.version, LED_CONFIG_VERSION);
+    }
+}
+
+// 44 bytes from the firmware that had all three telemetry fields
+void test_version_less_full_struct() {
+    LEDConfig saved = customised();
+    std::vector<uint8_t> blob(44);
+    std::memcpy(blob.data(), &saved, 44);
+    bool ok;
+    const LEDConfig& c = load(blob, &ok);
+    CHECK(ok);
+    CHECK_EQ(c.telemetry_compression, TELEMETRY_COMPRESSION_LZ4);
+    CHECK_EQ(c.telemetry_max_latency_s, 600);
+    CHECK_EQ(c.version, LED_CONFIG_VERSION);
+}
+
+void test_current_blob() {
+    LEDConfig saved = customised();
+    saved.telemetry_max_latency_s = 30;
+    std::vector<uint8_t> blob(sizeof(LEDConfig));
+    std::memcpy(blob.data(), &saved, sizeof(LEDConfig));
+    bool ok;
+    const LEDConfig& c = load(blob, &ok);
+    CHECK(ok);
+    CHECK_EQ(c.telemetry_max_latency_s, 30);
+    CHECK_EQ(c.humidity_thresholds[1], 40.0f);
+    CHECK_EQ(c.colors[2].b, 3);
+}
+
+void test_longer_blob_rejected() {
+    LEDConfig before = LEDConfigManager::getInstance().getConfig();
+    bool ok;
+    const LEDConfig& c = load(std::vector<uint8_t>(sizeof(LEDConfig) + 4, 0), &ok);
+    CHECK(!ok);
+    CHECK(std::memcmp(&c, &before, sizeof(LEDConfig)) == 0);
+}
+
+}  // namespace
+
+int main() {
+    // First use saves the defaults
+    const LEDConfig& defaults = LEDConfigManager::getInstance().getConfig();
+    CHECK_EQ(defaults.telemetry_max_latency_s, 120);
+    CHECK_EQ(defaults.version, LED_CONFIG_VERSION);
+    CHECK_EQ(stored_size(), sizeof(LEDConfig));
+
+    test_prefix_before_telemetry_fields();
+    test_tail_padding_as_fields();
+    test_version_less_full_struct();
+    test_current_blob();
+    test_longer_blob_rejected();
+    return test_result("config_test");
+}
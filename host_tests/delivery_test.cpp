@@ -0,0 +1,141 @@
+// SensorManager + PublishWindow as mqtt_publishing_task drives them: taken
+// batches stay queued (RAM and flash spool) until acked, are released in
+// order even when acks arrive out of order, and an unacked spool batch is
+// still on flash for the next boot.
+
+#include "fake_flash.h"
+#include "nvs.h"
+#include "publish_window.h"
+#include "sensor_manager.h"
+#include "telemetry_spool.h"
+#include "test_util.h"
+
+#include <vector>
+
+namespace {
+
+// Pending records a reboot would find on flash
+uint32_t spool_pending_after_reboot() {
+    TelemetrySpool spool;
+    return spool.mount("spool") ? spool.pendingCount() : 0;
+}
+
+// The ack path of handle_publish_event()
+void on_ack(PublishWindow& window, int msg_id) {
+    CHECK(window.onAck(msg_id, 0) > 0);
+    uint32_t oldest_seq;
+    if (window.oldestUnacked(&oldest_seq)) {
+        SensorManager::getInstance().commitBefore(oldest_seq);
+    } else {
+        SensorManager::getInstance().commitAll();
+    }
+}
+
+// The window-filling loop of mqtt_publishing_task(); returns the slots sent
+std::vector<PublishWindow::Slot*> fill(PublishWindow& window, int& msg_id,
+                                       size_t max_slots = PublishWindow::kMaxSlots) {
+    std::vector<PublishWindow::Slot*> sent;
+    SensorManager& manager = SensorManager::getInstance();
+    PublishWindow::Slot* slot;
+    while (sent.size() < max_slots && (slot = window.acquire()) != nullptr) {
+        slot->count = manager.peekBatch(slot->records, PublishWindow::kBatchSize);
+        if (slot->count == 0 || !manager.takeBatch()) {
+            window.cancel(slot);
+            break;
+        }
+        window.markSent(slot, msg_id++, 0);
+        sent.push_back(slot);
+    }
+    return sent;
+}
+
+void test_commit_on_ack() {
+    fake_flash::reset(0x30000);
+    fake_nvs_reset();
+    SensorManager& manager = SensorManager::getInstance();
+    CHECK(manager.initSpool());
+    CHECK(manager.initSequence());
+
+    // Past the high-water mark the rest goes to flash
+    const uint32_t kRecords = 1000;
+    for (uint32_t i = 0; i < kRecords; i++) {
+        manager.enqueue(Telemetry::make(1717000000 + i * 30, 2150, 4020, 1013250, 0));
+    }
+    const uint32_t kSpooled = kRecords - SensorManager::SPOOL_HIGH_WATER;
+    CHECK_EQ(manager.spooledCount(), kSpooled);
+    CHECK_EQ(spool_pending_after_reboot(), kSpooled);
+
+    // Grow the window to its full size with quick acks
+    PublishWindow window;
+    int msg_id = 1;
+    std::vector<uint32_t> delivered;
+    while (window.windowSize() < PublishWindow::kMaxSlots) {
+        std::vector<PublishWindow::Slot*> sent = fill(window, msg_id, 1);
+        for (PublishWindow::Slot* slot : sent) {
+            for (size_t i = 0; i < slot->count; i++) {
+                delivered.push_back(slot->records[i].seq);
+            }
+            on_ack(window, slot->msg_id);
+        }
+    }
+
+    // Drain RAM, one batch at a time so none comes from the spool yet
+    while (manager.size() > kSpooled) {
+        std::vector<PublishWindow::Slot*> sent = fill(window, msg_id, 1);
+        CHECK_EQ(sent.size(), 1);
+        for (PublishWindow::Slot* slot : sent) {
+            for (size_t i = 0; i < slot->count; i++) {
+                delivered.push_back(slot->records[i].seq);
+            }
+            on_ack(window, slot->msg_id);
+        }
+    }
+    CHECK_EQ(manager.size(), kSpooled);
+
+    // Four spool batches in flight: nothing is released before its ack
+    std::vector<PublishWindow::Slot*> sent = fill(window, msg_id);
+    CHECK_EQ(sent.size(), PublishWindow::kMaxSlots);
+    if (sent.size() != PublishWindow::kMaxSlots) {
+        return;
+    }
+    CHECK_EQ(manager.size(), kSpooled);
+    CHECK_EQ(spool_pending_after_reboot(), kSpooled);
+
+    // Acks for the newer batches first: still nothing may leave the spool
+    for (PublishWindow::Slot* slot : sent) {
+        for (size_t i = 0; i < slot->count; i++) {
+            delivered.push_back(slot->records[i].seq);
+        }
+    }
+    int oldest_msg = sent[0]->msg_id;
+    int second_msg = sent[1]->msg_id;
+    on_ack(window, sent[3]->msg_id);
+    on_ack(window, sent[2]->msg_id);
+    CHECK_EQ(manager.size(), kSpooled);
+    CHECK_EQ(spool_pending_after_reboot(), kSpooled);
+
+    // The oldest ack releases its batch only; the second is still unacked
+    on_ack(window, oldest_msg);
+    CHECK_EQ(manager.size(), kSpooled - PublishWindow::kBatchSize);
+    CHECK_EQ(spool_pending_after_reboot(), kSpooled - PublishWindow::kBatchSize);
+
+    // Its ack releases the rest in one go
+    on_ack(window, second_msg);
+    CHECK_EQ(manager.size(), 0);
+    CHECK_EQ(spool_pending_after_reboot(), 0);
+
+    // Every record went out exactly once, in order
+    CHECK_EQ(delivered.size(), kRecords);
+    bool in_order = true;
+    for (size_t i = 1; i < delivered.size(); i++) {
+        in_order = in_order && delivered[i] == delivered[i - 1] + 1;
+    }
+    CHECK(in_order);
+}
+
+}  // namespace
+
+int main() {
+    test_commit_on_ack();
+    return test_result("delivery_test");
+}
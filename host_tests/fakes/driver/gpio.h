@@ -0,0 +1,17 @@
+#ifndef FAKE_DRIVER_GPIO_H
+#define FAKE_DRIVER_GPIO_H
+
+// Host stand-in for driver/gpio.h: only the pin numbers config.h names
+
+typedef enum {
+    GPIO_NUM_0 = 0,
+    GPIO_NUM_2 = 2,
+    GPIO_NUM_4 = 4,
+    GPIO_NUM_5 = 5,
+    GPIO_NUM_16 = 16,
+    GPIO_NUM_17 = 17,
+    GPIO_NUM_18 = 18,
+    GPIO_NUM_34 = 34,
+} gpio_num_t;
+
+#endif // FAKE_DRIVER_GPIO_H
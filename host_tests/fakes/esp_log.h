@@ -0,0 +1,24 @@
+#ifndef FAKE_ESP_LOG_H
+#define FAKE_ESP_LOG_H
+
+#include "esp_err.h"
+#include <cstdio>
+
+// Host stand-in for the ESP-IDF header of the same name. Logging is
+// compiled (so formats are still checked) but silent.
+
+#define FAKE_ESP_LOG(tag, ...)              \
+    do {                                    \
+        if (0) {                            \
+            std::printf(__VA_ARGS__);       \
+            (void)(tag);                    \
+        }                                   \
+    } while (0)
+
+#define ESP_LOGE(tag, ...) FAKE_ESP_LOG(tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) FAKE_ESP_LOG(tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) FAKE_ESP_LOG(tag, __VA_ARGS__)
+#define ESP_LOGD(tag, ...) FAKE_ESP_LOG(tag, __VA_ARGS__)
+#define ESP_LOGV(tag, ...) FAKE_ESP_LOG(tag, __VA_ARGS__)
+
+#endif // FAKE_ESP_LOG_H
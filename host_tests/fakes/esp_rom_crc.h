@@ -0,0 +1,20 @@
+#ifndef FAKE_ESP_ROM_CRC_H
+#define FAKE_ESP_ROM_CRC_H
+
+#include <cstdint>
+
+// Host stand-in for the ROM CRC: CRC-32 (IEEE 802.3), same results as the
+// ESP32 ROM for the same inputs
+
+inline uint32_t esp_rom_crc32_le(uint32_t crc, const uint8_t* buf, uint32_t len) {
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+#endif // FAKE_ESP_ROM_CRC_H
@@ -0,0 +1,16 @@
+#ifndef FAKE_ESP_TIMER_H
+#define FAKE_ESP_TIMER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Host stand-in for the ESP-IDF header of the same name: microseconds on
+// the host's monotonic clock
+
+inline int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+#endif // FAKE_ESP_TIMER_H
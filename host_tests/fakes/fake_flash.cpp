@@ -0,0 +1,120 @@
+#include "fake_flash.h"
+#include "esp_partition.h"
+
+#include <cstring>
+
+namespace {
+    std::vector<uint8_t> g_flash;
+    std::vector<uint32_t> g_erases;
+    esp_partition_t g_partition;
+    bool g_power_cut_armed = false;
+    size_t g_power_budget = 0;
+    bool g_powered = true;
+    uint64_t g_bytes_written = 0;
+
+    bool in_range(size_t offset, size_t size) {
+        return offset <= g_flash.size() && size <= g_flash.size() - offset;
+    }
+}
+
+namespace fake_flash {
+
+void reset(size_t size) {
+    g_flash.assign(size, 0xFF);
+    g_erases.assign(size / kSectorSize, 0);
+    g_partition = {};
+    g_partition.type = ESP_PARTITION_TYPE_DATA;
+    g_partition.subtype = (esp_partition_subtype_t)0x40;
+    g_partition.size = (uint32_t)size;
+    g_partition.erase_size = kSectorSize;
+    std::strcpy(g_partition.label, "spool");
+    g_power_cut_armed = false;
+    g_powered = true;
+    g_bytes_written = 0;
+}
+
+std::vector<uint8_t>& contents() {
+    return g_flash;
+}
+
+void cutPowerAfter(size_t bytes) {
+    g_power_cut_armed = true;
+    g_power_budget = bytes;
+}
+
+void restorePower() {
+    g_power_cut_armed = false;
+    g_powered = true;
+}
+
+bool powered() {
+    return g_powered;
+}
+
+uint64_t bytesWritten() {
+    return g_bytes_written;
+}
+
+uint32_t eraseCount(size_t sector) {
+    return sector < g_erases.size() ? g_erases[sector] : 0;
+}
+
+}  // namespace fake_flash
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t, esp_partition_subtype_t,
+                                                const char*) {
+    return g_flash.empty() ? nullptr : &g_partition;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t*, size_t src_offset, void* dst, size_t size) {
+    if (!in_range(src_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    std::memcpy(dst, &g_flash[src_offset], size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t*, size_t dst_offset, const void* src,
+                              size_t size) {
+    if (!in_range(dst_offset, size)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!g_powered) {
+        return ESP_FAIL;
+    }
+
+    size_t count = size;
+    if (g_power_cut_armed && g_power_budget < size) {
+        count = g_power_budget;
+        g_powered = false;
+    }
+    if (g_power_cut_armed) {
+        g_power_budget -= count;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(src);
+    for (size_t i = 0; i < count; i++) {
+        g_flash[dst_offset + i] &= bytes[i];
+    }
+    g_bytes_written += count;
+    return g_powered ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t*, size_t offset, size_t size) {
+    if (!in_range(offset, size) || offset % fake_flash::kSectorSize != 0 ||
+        size % fake_flash::kSectorSize != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!g_powered) {
+        return ESP_FAIL;
+    }
+    if (g_power_cut_armed && g_power_budget == 0) {
+        g_powered = false;
+        return ESP_FAIL;
+    }
+    std::memset(&g_flash[offset], 0xFF, size);
+    for (size_t s = offset / fake_flash::kSectorSize; s < (offset + size) / fake_flash::kSectorSize; s++) {
+        g_erases[s]++;
+    }
+    return ESP_OK;
+}
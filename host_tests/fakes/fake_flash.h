@@ -0,0 +1,38 @@
+#ifndef FAKE_FLASH_H
+#define FAKE_FLASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief In-memory NOR flash behind the fake esp_partition API
+ *
+ * One partition (any label matches). Behaves like the ESP32's SPI flash
+ * where it matters for log-structured code:
+ * - erase sets whole 4 KB sectors to 0xFF; offsets and sizes must be aligned
+ * - write can only clear bits (new = old & data), never set them
+ *
+ * Power cuts: cutPowerAfter(n) lets n more bytes reach the flash. The write
+ * that runs out lands partially, then every write and erase fails until
+ * restorePower(). Erases are all or nothing.
+ */
+namespace fake_flash {
+
+constexpr size_t kSectorSize = 4096;
+
+// Fresh, fully erased partition of size bytes; clears counters and power cuts
+void reset(size_t size);
+
+std::vector<uint8_t>& contents();
+
+void cutPowerAfter(size_t bytes);
+void restorePower();
+bool powered();
+
+uint64_t bytesWritten();
+uint32_t eraseCount(size_t sector);
+
+}  // namespace fake_flash
+
+#endif // FAKE_FLASH_H
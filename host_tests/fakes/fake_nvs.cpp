@@ -0,0 +1,72 @@
+#include "nvs.h"
+
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+    std::vector<std::string> g_namespaces;
+    std::map<std::string, std::vector<uint8_t>> g_values;  // "namespace/key"
+
+    std::string path(nvs_handle_t handle, const char* key) {
+        return g_namespaces[handle] + "/" + key;
+    }
+
+    esp_err_t get(nvs_handle_t handle, const char* key, void* out, size_t* length) {
+        auto it = g_values.find(path(handle, key));
+        if (it == g_values.end()) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        if (out == nullptr) {
+            *length = it->second.size();
+            return ESP_OK;
+        }
+        if (*length < it->second.size()) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        std::memcpy(out, it->second.data(), it->second.size());
+        *length = it->second.size();
+        return ESP_OK;
+    }
+
+    esp_err_t set(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(value);
+        g_values[path(handle, key)].assign(bytes, bytes + length);
+        return ESP_OK;
+    }
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t, nvs_handle_t* out_handle) {
+    g_namespaces.push_back(name);
+    *out_handle = (nvs_handle_t)(g_namespaces.size() - 1);
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {
+}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value) {
+    size_t length = sizeof(*out_value);
+    return get(handle, key, out_value, &length);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return set(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char* key, void* out_value, size_t* length) {
+    return get(handle, key, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char* key, const void* value, size_t length) {
+    return set(handle, key, value, length);
+}
+
+void fake_nvs_reset() {
+    g_values.clear();
+}
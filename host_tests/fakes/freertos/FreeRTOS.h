@@ -0,0 +1,15 @@
+#ifndef FAKE_FREERTOS_H
+#define FAKE_FREERTOS_H
+
+#include <cstdint>
+
+// Host stand-in for the FreeRTOS types the portable firmware code uses
+
+typedef int BaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFFu
+
+#endif // FAKE_FREERTOS_H
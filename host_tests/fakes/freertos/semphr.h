@@ -0,0 +1,29 @@
+#ifndef FAKE_FREERTOS_SEMPHR_H
+#define FAKE_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+#include <mutex>
+
+// Host stand-in for FreeRTOS mutexes, backed by std::recursive_mutex
+
+typedef std::recursive_mutex* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new std::recursive_mutex();
+}
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t) {
+    sem->lock();
+    return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    sem->unlock();
+    return pdTRUE;
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t sem) {
+    delete sem;
+}
+
+#endif // FAKE_FREERTOS_SEMPHR_H
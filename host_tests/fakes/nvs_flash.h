@@ -0,0 +1,6 @@
+#ifndef FAKE_NVS_FLASH_H
+#define FAKE_NVS_FLASH_H
+
+#include "nvs.h"
+
+#endif // FAKE_NVS_FLASH_H
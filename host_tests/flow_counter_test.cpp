@@ -0,0 +1,263 @@
+// FlowCounter: direction from one sensor's distance profile and from the
+// order of two sensors, pair window expiry and restarts, the occupancy
+// floor, and a synthetic hallway recorded with TraceRecorder, dumped and
+// replayed. The dump is also written to flow_counter.trace, which the
+// trace_replay_test in CMakeLists.txt runs the trace_replay tool on.
+
+#include "config.h"
+#include "flow_counter.h"
+#include "presence_pipeline.h"
+#include "test_util.h"
+#include "trace_recorder.h"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr int64_t kPeriodMs = 50;  // Active sampling rate
+
+FlowCounterConfig one_sensor() {
+    return {1, FLOW_MIN_TRAVEL_CM, true, FLOW_PAIR_WINDOW_MS};
+}
+
+FlowCounterConfig two_sensors() {
+    return {2, FLOW_MIN_TRAVEL_CM, true, FLOW_PAIR_WINDOW_MS};
+}
+
+MotionEvent enter_at(int64_t time_ms) {
+    return {MotionEvent::Enter, time_ms, 40, 0, 0};
+}
+
+MotionEvent exit_at(int64_t time_ms, float travel_cm) {
+    return {MotionEvent::Exit, time_ms, 70, 2000, travel_cm};
+}
+
+void test_profile_direction() {
+    FlowCounter counter(one_sensor());
+
+    // Enter carries no travel yet: the direction comes with Exit
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(0)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(2000, -30)) == FlowDirection::Entry);
+    CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(4000, 30)) == FlowDirection::Exit);
+
+    // Inside +-min_travel_cm: stopped in front, or crossed the beam
+    const float small[] = {0, 10, -10, 14.9f, -14.9f};
+    for (float travel : small) {
+        CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(6000, travel)) == FlowDirection::None);
+    }
+    CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(8000, 15)) == FlowDirection::Exit);
+    CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(9000, -15)) == FlowDirection::Entry);
+    CHECK_EQ(counter.entries(), 2);
+    CHECK_EQ(counter.exits(), 2);
+
+    // Sensor facing the room from the door: approaching means leaving
+    FlowCounterConfig config = one_sensor();
+    config.approach_is_entry = false;
+    FlowCounter reversed(config);
+    CHECK(reversed.onMotion(FlowCounter::kOuter, exit_at(2000, -30)) == FlowDirection::Exit);
+    CHECK(reversed.onMotion(FlowCounter::kOuter, exit_at(4000, 30)) == FlowDirection::Entry);
+}
+
+void test_sensor_order() {
+    FlowCounter counter(two_sensors());
+    const uint32_t window = FLOW_PAIR_WINDOW_MS;
+
+    // Outside first: in. Inside first: out. Exit events play no part
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(1000)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(1400, -30)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(1800)) == FlowDirection::Entry);
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(5000)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(5000 + window)) == FlowDirection::Exit);
+    CHECK_EQ(counter.entries(), 1);
+    CHECK_EQ(counter.exits(), 1);
+
+    // A pair completes once: a third trigger starts a new pass
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(6600)) == FlowDirection::None);
+
+    // Too late for the pair: someone turned back at the door
+    counter.reset();
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(10000)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(10000 + window + 1)) == FlowDirection::None);
+    CHECK_EQ(counter.entries(), 0);
+    CHECK_EQ(counter.exits(), 0);
+    // ...and the late trigger now waits for its own pair
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(12000)) == FlowDirection::Exit);
+}
+
+void test_repeat_restarts_window() {
+    FlowCounter counter(two_sensors());
+    const uint32_t window = FLOW_PAIR_WINDOW_MS;
+
+    // Lingering outside: the second outer trigger is the one that pairs
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(0)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(1000)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(1000 + window)) == FlowDirection::Entry);
+
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(5000)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kInner, enter_at(5000 + window)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kOuter, enter_at(5000 + 2 * window)) == FlowDirection::Exit);
+    CHECK_EQ(counter.entries(), 1);
+    CHECK_EQ(counter.exits(), 1);
+}
+
+void test_occupancy_floor() {
+    FlowCounter counter(one_sensor());
+
+    // Leaving an empty room: a missed entry, counted but not below 0
+    CHECK(counter.onMotion(FlowCounter::kOuter, exit_at(1000, 30)) == FlowDirection::Exit);
+    CHECK_EQ(counter.exits(), 1);
+    CHECK_EQ(counter.occupancy(), 0);
+
+    counter.onMotion(FlowCounter::kOuter, exit_at(2000, -30));
+    counter.onMotion(FlowCounter::kOuter, exit_at(3000, -30));
+    CHECK_EQ(counter.occupancy(), 2);
+    for (int i = 0; i < 3; i++) {
+        counter.onMotion(FlowCounter::kOuter, exit_at(4000 + i * 1000, 30));
+    }
+    CHECK_EQ(counter.entries(), 2);
+    CHECK_EQ(counter.exits(), 4);
+    CHECK_EQ(counter.occupancy(), 0);
+
+    counter.setOccupancy(5);
+    counter.onMotion(FlowCounter::kOuter, exit_at(8000, 30));
+    CHECK_EQ(counter.occupancy(), 4);
+    counter.reset();
+    CHECK(counter.entries() == 0 && counter.exits() == 0 && counter.occupancy() == 0);
+}
+
+void test_channel_checks() {
+    // One sensor: an inner channel does not exist, whatever it reports
+    FlowCounter counter(one_sensor());
+    CHECK(counter.onMotion(FlowCounter::kInner, exit_at(1000, -30)) == FlowDirection::None);
+    CHECK(counter.onMotion(FlowCounter::kInner, exit_at(2000, 30)) == FlowDirection::None);
+    CHECK(counter.onMotion(2, exit_at(3000, -30)) == FlowDirection::None);
+    CHECK_EQ(counter.entries(), 0);
+    CHECK_EQ(counter.exits(), 0);
+
+    FlowCounter pair(two_sensors());
+    CHECK(pair.onMotion(FlowCounter::kOuter, enter_at(0)) == FlowDirection::None);
+    CHECK(pair.onMotion(2, enter_at(100)) == FlowDirection::None);
+    CHECK(pair.onMotion(FlowCounter::kInner, enter_at(200)) == FlowDirection::Entry);
+}
+
+// The device's configuration with only the HC-SR04 fitted
+PresencePipelineConfig hallway_config() {
+    PresencePipelineConfig config = {};
+    config.motion = {50.0f, MOTION_EXIT_MARGIN_CM, MOTION_MEDIAN_WINDOW, MOTION_ENTER_DEBOUNCE_MS,
+                     MOTION_EXIT_DEBOUNCE_MS, MOTION_MIN_DWELL_MS};
+    config.flow = one_sensor();
+    config.fusion.sources[PRESENCE_SOURCE_ULTRASONIC] = {
+        FUSION_ULTRASONIC_WEIGHT, FUSION_ULTRASONIC_HIT, FUSION_ULTRASONIC_FALSE,
+        FUSION_ULTRASONIC_SMOOTH_MS, FUSION_ULTRASONIC_STALE_MS};
+    config.fusion.sources[PRESENCE_SOURCE_RADAR] = {0.0f, FUSION_RADAR_HIT, FUSION_RADAR_FALSE,
+                                                    FUSION_RADAR_SMOOTH_MS, FUSION_RADAR_STALE_MS};
+    config.fusion.sources[PRESENCE_SOURCE_LIGHT] = {0.0f, 0.5f, 0.5f, 0, 0};
+    config.fusion.sources[PRESENCE_SOURCE_BLE_RSSI] = {0.0f, 0.5f, 0.5f, 0, 0};
+    config.fusion.prior = FUSION_PRIOR;
+    config.fusion.enter_p = FUSION_ENTER_P;
+    config.fusion.exit_p = FUSION_EXIT_P;
+    config.led = {LED_NO_MOTION_TIMEOUT_MS, 300000};
+    return config;
+}
+
+// Distances of one visit: from `from` to `to` over 3 s, then gone
+void add_visit(std::vector<float>* distances, float from, float to) {
+    for (int i = 0; i < 60; i++) {
+        distances->push_back(from + (to - from) * i / 59.0f);
+    }
+    distances->insert(distances->end(), 60, 200.0f);
+}
+
+bool append(const void* data, size_t len, void* arg) {
+    std::vector<uint8_t>* out = static_cast<std::vector<uint8_t>*>(arg);
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    out->insert(out->end(), bytes, bytes + len);
+    return true;
+}
+
+// Two people come in, one stops at the sensor and turns back, one leaves,
+// a third comes in
+void test_trace_replay() {
+    std::vector<float> distances(40, 200.0f);
+    add_visit(&distances, 48, 12);
+    add_visit(&distances, 45, 10);
+    add_visit(&distances, 30, 31);
+    add_visit(&distances, 12, 48);
+    add_visit(&distances, 47, 15);
+    // Failed readings while the room stays empty
+    distances.insert(distances.end(), 20, -1.0f);
+
+    const PresencePipelineConfig config = hallway_config();
+    PresencePipeline live(config);
+    TraceRecorder::init();
+    TraceRecorder::set_config(config);
+    std::vector<FlowDirection> live_flow;
+    int64_t now = 100000;
+    for (float d : distances) {
+        PresenceSample sample = {};
+        sample.time_ms = now;
+        sample.distance_cm = d;
+        const PresenceStep& step = live.step(sample);
+        TraceRecorder::record(sample, step);
+        live_flow.push_back(step.flow);
+        now += kPeriodMs;
+    }
+    CHECK_EQ(live.flow().entries(), 3);
+    CHECK_EQ(live.flow().exits(), 1);
+    CHECK_EQ(live.flow().occupancy(), 2);
+
+    std::vector<uint8_t> dump;
+    CHECK(TraceRecorder::dump(append, &dump));
+    CHECK_EQ(dump.size(), sizeof(TraceHeader) + distances.size() * sizeof(TraceRecord));
+    if (dump.size() < sizeof(TraceHeader)) {
+        return;
+    }
+    TraceHeader header;
+    std::memcpy(&header, dump.data(), sizeof(header));
+    CHECK_EQ(header.magic, TraceHeader::MAGIC);
+    CHECK_EQ(header.count, distances.size());
+    CHECK_EQ(header.dropped, 0);
+    CHECK_EQ(header.start_ms, 100000);
+    CHECK(std::memcmp(&header.config, &config, sizeof(config)) == 0);
+
+    FILE* f = std::fopen("flow_counter.trace", "wb");
+    CHECK(f != nullptr);
+    if (f != nullptr) {
+        CHECK_EQ(std::fwrite(dump.data(), 1, dump.size(), f), dump.size());
+        std::fclose(f);
+    }
+
+    // What trace_replay does: the recorded readings through a fresh
+    // pipeline reproduce every decision, pass for pass
+    PresencePipeline replayed(header.config);
+    int64_t t = header.start_ms;
+    int flow_mismatches = 0;
+    int presence_mismatches = 0;
+    for (uint32_t i = 0; i < header.count && i < live_flow.size(); i++) {
+        TraceRecord rec;
+        std::memcpy(&rec, dump.data() + header.header_size + i * sizeof(TraceRecord), sizeof(rec));
+        if (i > 0) {
+            t += rec.dt_ms;
+        }
+        const PresenceStep& step = replayed.step(rec.sample(t));
+        flow_mismatches += step.flow != live_flow[i];
+        presence_mismatches += step.presence.present != rec.present();
+    }
+    CHECK_EQ(flow_mismatches, 0);
+    CHECK_EQ(presence_mismatches, 0);
+    CHECK_EQ(replayed.flow().entries(), 3);
+    CHECK_EQ(replayed.flow().exits(), 1);
+}
+
+}  // namespace
+
+int main() {
+    test_profile_direction();
+    test_sensor_order();
+    test_repeat_restarts_window();
+    test_occupancy_floor();
+    test_channel_checks();
+    test_trace_replay();
+    return test_result("flow_counter_test");
+}
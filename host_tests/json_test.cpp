@@ -0,0 +1,161 @@
+// telemetry_json: exact output for known records, measure() == write() for
+// every batch size, no writes past capacity, and throughput/allocations
+// against the snprintf + std::string code it replaced.
+
+#include "alloc_count.h"
+#include "telemetry_json.h"
+#include "telemetry_samples.h"
+#include "test_util.h"
+
+#include <cinttypes>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+void test_known_batch() {
+    Telemetry records[2] = {
+        Telemetry::make(1760000000, -325, 5555, 1013250, 7, 3, 1, 2,
+                        (Telemetry::fusionQuality(91, 240) << 16) |
+                            Telemetry::fusionQuality(-1, -1)),
+        Telemetry::make(1760000030, 2150, 4020, 1013249, 0),
+    };
+    records[0].seq = 1200;
+    records[1].seq = 1201;
+    TelemetryBatchInfo info = {1024, 3};
+
+    const char* expected =
+        "[{\"timestamp\":1760000000,\"temperature\":-3.3,\"humidity\":55.6,\"pressure\":1013.3,"
+        "\"personCount\":7,\"entries\":3,\"exits\":1,\"occupancy\":2,\"ultrasonicAccuracy\":91,"
+        "\"ultrasonicLatencyMs\":240,\"seq\":1200,\"bootSeq\":1024,\"dropped\":3},"
+        "{\"timestamp\":1760000030,\"temperature\":21.5,\"humidity\":40.2,\"pressure\":1013.2,"
+        "\"personCount\":0,\"entries\":0,\"exits\":0,\"occupancy\":0,\"seq\":1201}]";
+
+    char out[telemetry_json_max_len(2)];
+    size_t n = telemetry_json_write(out, sizeof(out), records, 2, info);
+    CHECK_EQ(n, std::strlen(expected));
+    CHECK(std::string(out, n) == expected);
+    CHECK_EQ(telemetry_json_measure(records, 2, info), n);
+}
+
+// One decimal, half away from zero, for any fixed-point value
+void test_rounding() {
+    struct Case {
+        int32_t centi;
+        const char* text;
+    } cases[] = {
+        {0, "\"temperature\":0.0"},      {4, "\"temperature\":0.0"},
+        {5, "\"temperature\":0.1"},      {-4, "\"temperature\":0.0"},
+        {-5, "\"temperature\":-0.1"},    {-95, "\"temperature\":-1.0"},
+        {INT16_MIN, "\"temperature\":-327.7"}, {INT16_MAX, "\"temperature\":327.7"},
+    };
+    TelemetryBatchInfo info = {0, 0};
+    for (const Case& c : cases) {
+        Telemetry t = Telemetry::make(1760000000, c.centi, 0, 0, 0);
+        char out[telemetry_json_max_len(1)];
+        size_t n = telemetry_json_write(out, sizeof(out), &t, 1, info);
+        std::string json(out, n);
+        if (json.find(std::string(c.text) + ",") == std::string::npos) {
+            std::fprintf(stderr, "temperature %d: %s\n", c.centi, json.c_str());
+            CHECK(false);
+        }
+    }
+}
+
+void test_measure_matches_write() {
+    std::vector<char> out(telemetry_json_max_len(50));
+    for (uint32_t seed = 1; seed <= 200; seed++) {
+        std::vector<Telemetry> records = random_records(50, seed);
+        TelemetryBatchInfo info = {records[0].seq, seed % 3 ? 0 : UINT32_MAX};
+        for (size_t count = 1; count <= 50; count++) {
+            size_t expected = telemetry_json_measure(records.data(), count, info);
+            CHECK(expected <= telemetry_json_max_len(count));
+
+            // Exact fit works, one byte less is refused without overrunning
+            std::memset(out.data(), 0x5A, out.size());
+            CHECK_EQ(telemetry_json_write(out.data(), expected, records.data(), count, info),
+                     expected);
+            CHECK(out[expected] == 0x5A);
+            std::memset(out.data(), 0x5A, out.size());
+            CHECK_EQ(telemetry_json_write(out.data(), expected - 1, records.data(), count, info),
+                     0);
+            CHECK(out[expected - 1] == 0x5A);
+        }
+    }
+}
+
+// What mqtt_publishing_task did before: snprintf per record into a
+// std::string, fields converted to double
+std::string legacy_batch(const Telemetry* records, size_t count) {
+    std::string payload = "[";
+    payload.reserve(count * 180);
+    char buf[256];
+    for (size_t i = 0; i < count; ++i) {
+        const Telemetry& item = records[i];
+        std::snprintf(buf, sizeof(buf),
+                      "{\"timestamp\":%" PRIi64
+                      ",\"temperature\":%.1f,\"humidity\":%.1f,\"pressure\":%.1f,"
+                      "\"personCount\":%d}",
+                      item.timestamp(), item.temperatureCenti() / 100.0,
+                      item.humidityCenti() / 100.0, item.pressureDeciPa() / 1000.0,
+                      (int)item.personCount());
+        payload += buf;
+        if (i < count - 1) {
+            payload += ",";
+        }
+    }
+    payload += "]";
+    return payload;
+}
+
+void bench_against_snprintf() {
+    std::vector<Telemetry> records = sample_trace(50);
+    TelemetryBatchInfo info = {records[0].seq, 0};
+    static char out[telemetry_json_max_len(50)];
+    const size_t sizes[] = {1, 10, 50};
+
+    std::printf("bench: batch  snprintf: records/s  B/record  allocs/batch"
+                "   writer: records/s  B/record  allocs/batch\n");
+    for (size_t count : sizes) {
+        const int kBatches = 200000 / (int)count;
+
+        uint64_t allocs = alloc_count();
+        size_t legacy_bytes = 0;
+        double start = now_us();
+        for (int i = 0; i < kBatches; i++) {
+            std::string payload = legacy_batch(records.data(), count);
+            legacy_bytes = payload.size();
+            keep(payload);
+        }
+        double legacy_us = now_us() - start;
+        double legacy_allocs = (double)(alloc_count() - allocs) / kBatches;
+
+        allocs = alloc_count();
+        size_t bytes = 0;
+        start = now_us();
+        for (int i = 0; i < kBatches; i++) {
+            bytes = telemetry_json_write(out, sizeof(out), records.data(), count, info);
+            keep(out);
+        }
+        double writer_us = now_us() - start;
+        double writer_allocs = (double)(alloc_count() - allocs) / kBatches;
+        CHECK_EQ(writer_allocs, 0);
+
+        double total = (double)kBatches * count;
+        std::printf("bench: %5zu  %12.2fM  %8.1f  %12.1f   %10.2fM  %8.1f  %12.1f\n", count,
+                    total / legacy_us, (double)legacy_bytes / count, legacy_allocs,
+                    total / writer_us, (double)bytes / count, writer_allocs);
+    }
+    std::printf("bench: the writer also carries entries/exits/occupancy, fusion and seq\n");
+}
+
+}  // namespace
+
+int main() {
+    test_known_batch();
+    test_rounding();
+    test_measure_matches_write();
+    bench_against_snprintf();
+    return test_result("json_test");
+}
@@ -0,0 +1,172 @@
+// LedColorPipeline: gamma table against pow(), brightness and white
+// balance scaling, apply() against applyTo(), and the per-pixel cost into
+// a LedFrameBuffer. Built at -Og, the firmware's optimisation level (see
+// CMakeLists.txt), so the figures reflect its code generation.
+
+#include "led_color.h"
+#include "led_frame_buffer.h"
+#include "test_util.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+void test_gamma_table() {
+    const LedLut<uint8_t>& gamma = LedColorPipeline::kGamma;
+    int worst = 0;
+    for (int i = 0; i < 256; i++) {
+        int expected = (int)std::lround(255 * std::pow(i / 255.0, 2.2));
+        if (i > 0 && expected < 1) {
+            expected = 1;  // Non-zero stays lit
+        }
+        worst = std::max(worst, std::abs(gamma.v[i] - expected));
+        if (i > 0) {
+            CHECK(gamma.v[i] >= gamma.v[i - 1]);
+        }
+    }
+    CHECK_EQ(worst, 0);
+    CHECK_EQ(gamma.v[0], 0);
+    CHECK_EQ(gamma.v[255], 255);
+}
+
+// Before gamma, each channel is v * brightness * gain / 255^2 to within 1
+void test_scaling() {
+    // Inverse of the gamma table, enough to recover the scaled input
+    int inverse_lo[256];
+    int inverse_hi[256];
+    for (int d = 0; d < 256; d++) {
+        inverse_lo[d] = 256;
+        inverse_hi[d] = -1;
+    }
+    for (int i = 0; i < 256; i++) {
+        int d = LedColorPipeline::kGamma.v[i];
+        inverse_lo[d] = std::min(inverse_lo[d], i);
+        inverse_hi[d] = std::max(inverse_hi[d], i);
+    }
+
+    const uint8_t gains[] = {255, 200, 128, 1};
+    int failures = 0;
+    for (uint8_t gain : gains) {
+        LedColorPipeline color;
+        color.setWhiteBalance({gain, 255, 255});
+        for (int v = 0; v < 256; v++) {
+            for (int b = 0; b < 256; b++) {
+                LedPixel p = color.apply((uint8_t)v, (uint8_t)v, 0, (uint8_t)b);
+                double exact = v * (b / 255.0) * (gain / 255.0);
+                double exact_g = v * (b / 255.0);
+                failures += exact < inverse_lo[p.red] - 1 || exact > inverse_hi[p.red] + 1;
+                failures += exact_g < inverse_lo[p.green] - 1 || exact_g > inverse_hi[p.green] + 1;
+                failures += p.blue != 0;
+            }
+        }
+    }
+    CHECK_EQ(failures, 0);
+
+    LedColorPipeline color;
+    LedPixel full = color.apply(255, 255, 255, 255);
+    CHECK(full.red == 255 && full.green == 255 && full.blue == 255);
+    LedPixel off = color.apply(255, 255, 255, 0);
+    CHECK(off.red == 0 && off.green == 0 && off.blue == 0);
+    LedPixel dim = color.apply(1, 1, 1, 255);
+    CHECK(dim.red == 1 && dim.green == 1 && dim.blue == 1);
+}
+
+void test_apply_to_frame() {
+    LedColorPipeline color;
+    color.setWhiteBalance({255, 180, 90});
+    LedFrameBuffer frame(4);
+    for (int v = 0; v < 256; v += 5) {
+        for (int b = 0; b < 256; b += 3) {
+            LedPixel p = color.apply((uint8_t)v, (uint8_t)(255 - v), (uint8_t)(v / 2), (uint8_t)b);
+            uint8_t* px = frame.backPixel(2);
+            color.applyTo((uint8_t)v, (uint8_t)(255 - v), (uint8_t)(v / 2), (uint8_t)b,
+                          &px[LedFrameBuffer::kRed], &px[LedFrameBuffer::kGreen],
+                          &px[LedFrameBuffer::kBlue]);
+            LedFrameBuffer expected(4);
+            expected.setPixel(2, p.red, p.green, p.blue);
+            frame.commit();
+            expected.commit();
+            CHECK(std::memcmp(frame.front(), expected.front(), frame.bytes()) == 0);
+        }
+    }
+    CHECK(frame.backPixel(4) == nullptr);
+}
+
+struct Input {
+    uint8_t red, green, blue, brightness;
+};
+
+// set_pixel_brightness() before the pipeline: linear, no gamma or balance
+__attribute__((noinline)) void legacy_path(LedFrameBuffer& frame, const Input* in, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        frame.setPixel(i, in[i].red * in[i].brightness / 255, in[i].green * in[i].brightness / 255,
+                       in[i].blue * in[i].brightness / 255);
+    }
+}
+
+__attribute__((noinline)) void apply_path(LedFrameBuffer& frame, const LedColorPipeline& color,
+                                          const Input* in, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        LedPixel p = color.apply(in[i].red, in[i].green, in[i].blue, in[i].brightness);
+        frame.setPixel(i, p.red, p.green, p.blue);
+    }
+}
+
+// What WS2812BController::write_pixel() does
+__attribute__((noinline)) void apply_to_path(LedFrameBuffer& frame, const LedColorPipeline& color,
+                                             const Input* in, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t* px = frame.backPixel(i);
+        color.applyTo(in[i].red, in[i].green, in[i].blue, in[i].brightness,
+                      &px[LedFrameBuffer::kRed], &px[LedFrameBuffer::kGreen],
+                      &px[LedFrameBuffer::kBlue]);
+    }
+}
+
+void bench_pixel_paths() {
+    std::printf("bench: LEDs   legacy (no gamma)   apply+setPixel   applyTo   ns/frame\n");
+    for (size_t n : {5, 60, 300}) {
+        std::vector<Input> in(n);
+        for (size_t i = 0; i < n; i++) {
+            in[i] = {(uint8_t)(i * 7), (uint8_t)(i * 13), (uint8_t)(i * 29), (uint8_t)(i * 3 + 1)};
+        }
+        LedFrameBuffer frame(n);
+        LedColorPipeline color;
+        const int kFrames = (int)(10000000 / n);
+
+        double best[3] = {1e30, 1e30, 1e30};
+        for (int round = 0; round < 3; round++) {
+            double start = now_us();
+            for (int f = 0; f < kFrames; f++) {
+                legacy_path(frame, in.data(), n);
+            }
+            best[0] = std::min(best[0], now_us() - start);
+            start = now_us();
+            for (int f = 0; f < kFrames; f++) {
+                apply_path(frame, color, in.data(), n);
+            }
+            best[1] = std::min(best[1], now_us() - start);
+            start = now_us();
+            for (int f = 0; f < kFrames; f++) {
+                apply_to_path(frame, color, in.data(), n);
+            }
+            best[2] = std::min(best[2], now_us() - start);
+        }
+        keep(frame.backPixel(0));
+        std::printf("bench: %4zu  %17.1f  %15.1f  %8.1f\n", n, best[0] * 1000 / kFrames,
+                    best[1] * 1000 / kFrames, best[2] * 1000 / kFrames);
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_gamma_table();
+    test_scaling();
+    test_apply_to_frame();
+    bench_pixel_paths();
+    return test_result("led_color_test");
+}
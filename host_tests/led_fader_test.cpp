@@ -0,0 +1,235 @@
+// LedFader driving LedColorPipeline into a LedFrameBuffer, the way
+// WS2812BController's flush task does: render() on each frame tick with
+// write_pixel() as the sink, then commit(). Checks the committed frames
+// (GRB bytes) over time, not just the fader's own state.
+
+#include "led_color.h"
+#include "led_fader.h"
+#include "led_frame_buffer.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct Strip {
+    explicit Strip(size_t num_leds) : fader(num_leds), frame(num_leds) {}
+
+    // WS2812BController::write_pixel()
+    static void sink(size_t index, const LedState& state, void* arg) {
+        Strip* self = static_cast<Strip*>(arg);
+        uint8_t* pixel = self->frame.backPixel(index);
+        if (pixel != nullptr) {
+            self->color.applyTo(state.red, state.green, state.blue, state.brightness,
+                                &pixel[LedFrameBuffer::kRed], &pixel[LedFrameBuffer::kGreen],
+                                &pixel[LedFrameBuffer::kBlue]);
+        }
+        self->writes++;
+    }
+
+    void set(size_t index, const LedState& state) {
+        fader.set(index, state);
+        sink(index, state, this);
+    }
+
+    // One frame tick: advance, then promote; true if a frame would be sent
+    bool tick(int64_t now_ms) {
+        running = fader.render(now_ms, sink, this);
+        return frame.commit();
+    }
+
+    const uint8_t* sent(size_t index) const {
+        return frame.front() + index * LedFrameBuffer::kBytesPerPixel;
+    }
+
+    LedFader fader;
+    LedColorPipeline color;
+    LedFrameBuffer frame;
+    int writes = 0;
+    bool running = false;
+};
+
+// The pixel on the wire is what the pipeline makes of the expected state
+bool sent_as(const Strip& strip, size_t index, const LedState& state) {
+    LedPixel p = strip.color.apply(state.red, state.green, state.blue, state.brightness);
+    const uint8_t* px = strip.sent(index);
+    return px[LedFrameBuffer::kRed] == p.red && px[LedFrameBuffer::kGreen] == p.green &&
+           px[LedFrameBuffer::kBlue] == p.blue;
+}
+
+bool dark(const Strip& strip, size_t index) {
+    const uint8_t* px = strip.sent(index);
+    return px[0] == 0 && px[1] == 0 && px[2] == 0;
+}
+
+void test_easing() {
+    const LedEasing curves[] = {LedEasing::Linear, LedEasing::EaseIn, LedEasing::EaseOut,
+                                LedEasing::EaseInOut};
+    for (LedEasing easing : curves) {
+        CHECK_EQ(LedFader::ease(easing, 0), 0);
+        CHECK_EQ(LedFader::ease(easing, 65536), 65536);
+        CHECK_EQ(LedFader::ease(easing, 100000), 65536);  // Clamped
+        uint32_t prev = 0;
+        bool monotonic = true;
+        for (uint32_t p = 0; p <= 65536; p += 16) {
+            uint32_t v = LedFader::ease(easing, p);
+            monotonic &= v >= prev && v <= 65536;
+            prev = v;
+        }
+        CHECK(monotonic);
+    }
+    CHECK_EQ(LedFader::ease(LedEasing::Linear, 16384), 16384);
+    CHECK(LedFader::ease(LedEasing::EaseIn, 16384) < 16384);
+    CHECK(LedFader::ease(LedEasing::EaseOut, 16384) > 16384);
+    CHECK(LedFader::ease(LedEasing::EaseInOut, 16384) < 16384);
+    CHECK(LedFader::ease(LedEasing::EaseInOut, 49152) > 49152);
+    CHECK_EQ(LedFader::ease(LedEasing::EaseInOut, 32768), 32768);
+}
+
+void test_wire_order() {
+    Strip strip(3);
+    strip.set(0, {255, 0, 0, 255});
+    strip.set(1, {0, 255, 0, 255});
+    strip.set(2, {0, 0, 255, 255});
+    CHECK(strip.tick(0));
+    const uint8_t expected[] = {0, 255, 0, 255, 0, 0, 0, 0, 255};
+    CHECK(std::memcmp(strip.frame.front(), expected, sizeof(expected)) == 0);
+
+    // Out of range is ignored, and nothing else changes
+    strip.set(3, {255, 255, 255, 255});
+    strip.fader.fadeTo(3, {255, 255, 255, 255}, 100, LedEasing::Linear, 0);
+    CHECK(!strip.tick(50));
+    CHECK(!strip.running);
+}
+
+void test_fade_in_frames() {
+    Strip strip(2);
+    CHECK(!strip.tick(900));  // Starts dark, nothing to send
+    strip.fader.fadeTo(0, {255, 128, 0, 200}, 400, LedEasing::Linear, 1000);
+
+    // Off to lit moves brightness only: the colour is there from the start
+    const uint8_t brightness[] = {0, 50, 100, 150, 200};
+    for (int step = 0; step < 5; step++) {
+        bool changed = strip.tick(1000 + step * 100);
+        CHECK(changed == (step > 0));
+        CHECK(sent_as(strip, 0, {255, 128, 0, brightness[step]}));
+        CHECK(dark(strip, 1));
+        CHECK(strip.running == (step < 4));
+    }
+    const uint8_t* px = strip.sent(0);
+    CHECK(px[LedFrameBuffer::kRed] > px[LedFrameBuffer::kGreen]);
+    CHECK_EQ(px[LedFrameBuffer::kBlue], 0);
+
+    // Finished: further ticks neither write nor send
+    int writes = strip.writes;
+    CHECK(!strip.tick(1500));
+    CHECK(!strip.tick(5000));
+    CHECK_EQ(strip.writes, writes);
+    CHECK(!strip.fader.active());
+}
+
+void test_fade_out_keeps_colour() {
+    Strip strip(1);
+    strip.set(0, {0, 200, 100, 255});
+    strip.tick(0);
+    strip.fader.fadeTo(0, {0, 0, 0, 0}, 300, LedEasing::EaseIn, 0);
+
+    uint8_t prev_green = 255;
+    for (int64_t t = 30; t < 300; t += 30) {
+        CHECK(strip.tick(t));
+        LedState s = strip.fader.state(0);
+        CHECK(s.red == 0 && s.green == 200 && s.blue == 100);
+        CHECK(sent_as(strip, 0, s));
+        const uint8_t* px = strip.sent(0);
+        CHECK(px[LedFrameBuffer::kGreen] <= prev_green);
+        CHECK(px[LedFrameBuffer::kGreen] >= px[LedFrameBuffer::kBlue]);
+        prev_green = px[LedFrameBuffer::kGreen];
+    }
+    CHECK(strip.tick(300));
+    CHECK(dark(strip, 0));
+    CHECK(!strip.running);
+}
+
+void test_pulse() {
+    Strip strip(2);
+    strip.set(1, {10, 20, 30, 40});
+    strip.tick(0);
+    strip.fader.fadeTo(0, {0, 0, 255, 200}, 300, LedEasing::EaseInOut, 1000, true);
+
+    // The way home mirrors the way out, frame for frame
+    uint8_t out[3][3];
+    for (int i = 0; i < 3; i++) {
+        strip.tick(1000 + 100 * (i + 1));
+        std::memcpy(out[i], strip.sent(0), 3);
+    }
+    CHECK(sent_as(strip, 0, {0, 0, 255, 200}));
+    for (int i = 0; i < 2; i++) {
+        strip.tick(1400 + 100 * i);
+        CHECK(std::memcmp(strip.sent(0), out[1 - i], 3) == 0);
+    }
+    CHECK(strip.running);
+    CHECK(strip.tick(1600));
+    CHECK(!strip.running);
+    CHECK(dark(strip, 0));
+    CHECK(sent_as(strip, 1, {10, 20, 30, 40}));  // Bystander untouched
+}
+
+void test_retarget_does_not_jump() {
+    Strip strip(1);
+    strip.fader.fadeTo(0, {255, 0, 0, 100}, 1000, LedEasing::Linear, 0);
+    strip.tick(0);  // From off: red at brightness 0 straight away
+    int max_step = 0;
+    LedState prev = strip.fader.state(0);
+    for (int64_t t = 20; t <= 1600; t += 20) {
+        if (t == 500) {
+            strip.fader.fadeTo(0, {0, 0, 255, 255}, 1000, LedEasing::EaseInOut, t);
+        }
+        strip.tick(t);
+        LedState s = strip.fader.state(0);
+        CHECK(sent_as(strip, 0, s));
+        max_step = std::max(max_step, std::abs(s.red - prev.red));
+        max_step = std::max(max_step, std::abs(s.blue - prev.blue));
+        max_step = std::max(max_step, std::abs(s.brightness - prev.brightness));
+        prev = s;
+    }
+    // Steepest: smoothstep's 1.5x slope over 255 in 50 ticks
+    CHECK(max_step <= 8);
+    CHECK(sent_as(strip, 0, {0, 0, 255, 255}));
+}
+
+// A slow fade changes the pixel on few ticks: only those write and send
+void test_unchanged_frames_not_sent() {
+    Strip strip(2);
+    strip.set(1, {255, 255, 255, 255});
+    CHECK(strip.tick(0));
+    strip.fader.fadeTo(0, {255, 255, 255, 4}, 1000, LedEasing::Linear, 0);
+
+    int sent = 0;
+    int writes = strip.writes;
+    for (int64_t t = 10; t <= 1000; t += 10) {
+        sent += strip.tick(t);
+    }
+    // The first tick takes on the target colour at brightness 0, which is
+    // a write but still a dark frame; then brightness 1..4 at 125, 375,
+    // 625 and 875 ms, of which gamma may turn the lowest into the same duty
+    CHECK_EQ(strip.writes - writes, 5);
+    CHECK(sent <= 4);
+    CHECK(sent >= 1);
+    CHECK(sent_as(strip, 0, {255, 255, 255, 4}));
+    CHECK(sent_as(strip, 1, {255, 255, 255, 255}));
+}
+
+}  // namespace
+
+int main() {
+    test_easing();
+    test_wire_order();
+    test_fade_in_frames();
+    test_fade_out_keeps_colour();
+    test_pulse();
+    test_retarget_does_not_jump();
+    test_unchanged_frames_not_sent();
+    return test_result("led_fader_test");
+}
@@ -0,0 +1,271 @@
+// MotionDetector: median filter against spurious echoes and dropouts,
+// hysteresis, debounce and dwell timing, window rounding, travel along the
+// beam, and the cost per sample.
+
+#include "motion_detector.h"
+#include "test_util.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int64_t kPeriodMs = 50;  // Active sampling rate
+
+MotionDetectorConfig default_config() {
+    // config.h defaults, enter distance from LEDConfig
+    return {50.0f, 10.0f, 5, 100, 1000, 500};
+}
+
+struct Recorder {
+    std::vector<MotionEvent> events;
+
+    static void callback(const MotionEvent& event, void* arg) {
+        static_cast<Recorder*>(arg)->events.push_back(event);
+    }
+
+    size_t count(MotionEvent::Type type) const {
+        size_t n = 0;
+        for (const MotionEvent& e : events) {
+            n += e.type == type;
+        }
+        return n;
+    }
+};
+
+// Feeds distances at kPeriodMs, continuing from *now_ms
+void feed(MotionDetector& detector, const std::vector<float>& distances, int64_t* now_ms) {
+    for (float d : distances) {
+        detector.update(d, *now_ms);
+        *now_ms += kPeriodMs;
+    }
+}
+
+std::vector<float> repeat(float distance, size_t count) {
+    return std::vector<float>(count, distance);
+}
+
+void test_spurious_echoes_ignored() {
+    MotionDetector detector(default_config());
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+    int64_t now = 1000;
+
+    // One and two near echoes in a row never reach the median of five
+    feed(detector, repeat(200, 10), &now);
+    feed(detector, {20}, &now);
+    feed(detector, repeat(200, 10), &now);
+    feed(detector, {20, 25}, &now);
+    feed(detector, repeat(200, 10), &now);
+    CHECK_EQ(rec.events.size(), 0);
+    CHECK(!detector.present());
+
+    // Three in a row are a majority for three samples, 100 ms: the filter's
+    // limit, after which a short visit is indistinguishable
+    feed(detector, {20, 25, 22}, &now);
+    feed(detector, repeat(200, 10), &now);
+    CHECK_EQ(rec.count(MotionEvent::Enter), 1);
+}
+
+void test_dropouts_keep_presence() {
+    MotionDetector detector(default_config());
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+    int64_t now = 1000;
+
+    feed(detector, repeat(30, 20), &now);
+    CHECK_EQ(rec.count(MotionEvent::Enter), 1);
+    CHECK(detector.present());
+
+    // Failed readings (0, negative) and a far echo, never three in a row
+    for (int i = 0; i < 20; i++) {
+        feed(detector, {0, 30, -1, 30, 900, 30, 30}, &now);
+    }
+    CHECK_EQ(rec.count(MotionEvent::Exit), 0);
+    CHECK(detector.present());
+}
+
+// Distances between enter_cm and enter_cm + margin change nothing
+void test_hysteresis_band() {
+    MotionDetector detector(default_config());
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+    int64_t now = 1000;
+
+    feed(detector, repeat(55, 40), &now);
+    CHECK_EQ(rec.events.size(), 0);
+
+    feed(detector, repeat(45, 10), &now);
+    CHECK_EQ(rec.count(MotionEvent::Enter), 1);
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> jitter(45.0f, 59.9f);
+    for (int i = 0; i < 400; i++) {
+        feed(detector, {jitter(rng)}, &now);
+    }
+    CHECK_EQ(rec.count(MotionEvent::Exit), 0);
+    CHECK(detector.present());
+}
+
+void test_debounce_timing() {
+    MotionDetectorConfig config = default_config();
+    config.median_window = 1;
+    MotionDetector detector(config);
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+
+    // Near for 50 ms (two samples): below the 100 ms enter debounce
+    int64_t now = 1000;
+    feed(detector, {30, 30, 200}, &now);
+    CHECK_EQ(rec.events.size(), 0);
+
+    // Confirmed on the first sample 100 ms after it came near
+    int64_t near_since = now;
+    feed(detector, {30, 30, 30}, &now);
+    CHECK_EQ(rec.events.size(), 1);
+    CHECK_EQ(rec.events[0].type, MotionEvent::Enter);
+    CHECK_EQ(rec.events[0].time_ms, near_since + 100);
+
+    // Away for less than the exit debounce, then back: still present
+    feed(detector, repeat(200, 19), &now);
+    feed(detector, {30}, &now);
+    CHECK_EQ(rec.events.size(), 1);
+
+    // Away for the full second
+    int64_t away_since = now;
+    feed(detector, repeat(200, 21), &now);
+    CHECK_EQ(rec.events.size(), 2);
+    CHECK_EQ(rec.events[1].type, MotionEvent::Exit);
+    CHECK_EQ(rec.events[1].time_ms, away_since + 1000);
+    CHECK_EQ(rec.events[1].duration_ms, away_since - near_since);
+    CHECK(!detector.present());
+}
+
+// A brief pass is held until min_dwell_ms, and a zero debounce enters on
+// the first near sample
+void test_min_dwell_and_zero_debounce() {
+    MotionDetectorConfig config = default_config();
+    config.median_window = 1;
+    config.enter_debounce_ms = 0;
+    config.exit_debounce_ms = 0;
+    config.min_dwell_ms = 2000;
+    MotionDetector detector(config);
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+
+    int64_t now = 1000;
+    feed(detector, {30}, &now);
+    CHECK_EQ(rec.count(MotionEvent::Enter), 1);
+    CHECK_EQ(rec.events[0].time_ms, 1000);
+
+    feed(detector, repeat(200, 39), &now);
+    CHECK_EQ(rec.count(MotionEvent::Exit), 0);
+    feed(detector, {200}, &now);
+    CHECK_EQ(rec.count(MotionEvent::Exit), 1);
+    CHECK_EQ(rec.events[1].time_ms, 3000);
+    CHECK_EQ(rec.events[1].duration_ms, 50);
+}
+
+void test_window_rounding() {
+    MotionDetectorConfig config = default_config();
+    config.median_window = 4;
+    MotionDetector even(config);
+    CHECK_EQ(even.config().median_window, 3);
+    config.median_window = 0;
+    MotionDetector zero(config);
+    CHECK_EQ(zero.config().median_window, 1);
+    config.median_window = 200;
+    MotionDetector large(config);
+    CHECK_EQ(large.config().median_window, MotionDetector::kMaxWindow);
+
+    // Window 3: two near echoes in a row now pass the filter
+    Recorder rec;
+    even.setCallback(Recorder::callback, &rec);
+    int64_t now = 1000;
+    feed(even, repeat(200, 5), &now);
+    feed(even, {20, 20}, &now);
+    CHECK(even.filteredCm() < 50);
+}
+
+// Net travel: the sign of the regression slope, robust to a stray sample
+// at either end of the visit
+void test_travel_direction() {
+    for (bool approaching : {true, false}) {
+        MotionDetector detector(default_config());
+        Recorder rec;
+        detector.setCallback(Recorder::callback, &rec);
+        int64_t now = 1000;
+
+        std::vector<float> walk;
+        walk.push_back(approaching ? 15 : 48);  // Stray sample against the walk
+        for (int i = 0; i < 60; i++) {
+            float f = i / 59.0f;
+            walk.push_back(approaching ? 48 - 38 * f : 10 + 38 * f);
+        }
+        walk.push_back(approaching ? 48 : 12);
+        feed(detector, repeat(200, 10), &now);
+        feed(detector, walk, &now);
+        feed(detector, repeat(200, 30), &now);
+
+        CHECK_EQ(rec.count(MotionEvent::Exit), 1);
+        float travel = rec.events.back().travel_cm;
+        CHECK(approaching ? travel < -25 : travel > 25);
+        CHECK(std::fabs(travel) < 45);
+    }
+}
+
+void test_reset() {
+    MotionDetector detector(default_config());
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+    int64_t now = 1000;
+    feed(detector, repeat(30, 20), &now);
+    CHECK(detector.present());
+    detector.reset();
+    CHECK(!detector.present());
+    CHECK_EQ(detector.filteredCm(), MotionDetector::kNoEchoCm);
+    CHECK_EQ(rec.count(MotionEvent::Exit), 0);
+    CHECK(!detector.active());
+}
+
+void bench_update() {
+    MotionDetector detector(default_config());
+    Recorder rec;
+    detector.setCallback(Recorder::callback, &rec);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> noise(-3.0f, 3.0f);
+
+    // Visits every 10 s with noise and the odd dropout
+    const int kSamples = 2000000;
+    std::vector<float> trace(kSamples);
+    for (int i = 0; i < kSamples; i++) {
+        int phase = i % 200;
+        float d = phase < 60 ? 30 + phase * 0.3f : 220;
+        trace[i] = (rng() % 50 == 0) ? 0 : d + noise(rng);
+    }
+
+    double start = now_us();
+    for (int i = 0; i < kSamples; i++) {
+        detector.update(trace[i], (int64_t)i * kPeriodMs);
+    }
+    double elapsed = now_us() - start;
+    CHECK_EQ(rec.count(MotionEvent::Enter), kSamples / 200);
+    std::printf("bench: update %.1f ns/sample (window %u), %zu visits\n",
+                elapsed * 1000.0 / kSamples, detector.config().median_window,
+                rec.count(MotionEvent::Enter));
+}
+
+}  // namespace
+
+int main() {
+    test_spurious_echoes_ignored();
+    test_dropouts_keep_presence();
+    test_hysteresis_band();
+    test_debounce_timing();
+    test_min_dwell_and_zero_debounce();
+    test_window_rounding();
+    test_travel_direction();
+    test_reset();
+    bench_update();
+    return test_result("motion_test");
+}
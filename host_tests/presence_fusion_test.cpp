@@ -0,0 +1,184 @@
+// PresenceFusion: the log-odds combination against hand-computed values,
+// a radar-only false trigger held below enter_p, evidence fading out over
+// stale_ms, onset lag measured from the start of the episode, and the
+// estimate with no source enabled.
+
+#include "config.h"
+#include "presence_fusion.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int64_t kRadarPeriodMs = 100;  // Rd-01 report rate
+
+// main.cpp's make_fusion_config() with the HC-SR04 and the radar fitted
+PresenceFusionConfig device_config() {
+    PresenceFusionConfig config = {};
+    config.sources[PRESENCE_SOURCE_ULTRASONIC] = {
+        FUSION_ULTRASONIC_WEIGHT, FUSION_ULTRASONIC_HIT, FUSION_ULTRASONIC_FALSE,
+        FUSION_ULTRASONIC_SMOOTH_MS, FUSION_ULTRASONIC_STALE_MS};
+    config.sources[PRESENCE_SOURCE_RADAR] = {FUSION_RADAR_WEIGHT, FUSION_RADAR_HIT,
+                                             FUSION_RADAR_FALSE, FUSION_RADAR_SMOOTH_MS,
+                                             FUSION_RADAR_STALE_MS};
+    config.sources[PRESENCE_SOURCE_LIGHT] = {0.0f, FUSION_LIGHT_HIT, FUSION_LIGHT_FALSE,
+                                             FUSION_LIGHT_SMOOTH_MS, FUSION_LIGHT_STALE_MS};
+    config.sources[PRESENCE_SOURCE_BLE_RSSI] = {0.0f, 0.5f, 0.5f, 0, 0};
+    config.prior = FUSION_PRIOR;
+    config.enter_p = FUSION_ENTER_P;
+    config.exit_p = FUSION_EXIT_P;
+    return config;
+}
+
+float logit(float p) {
+    return std::log(p / (1.0f - p));
+}
+
+float sigmoid(float x) {
+    return 1.0f / (1.0f + std::exp(-x));
+}
+
+bool near(float a, float b) {
+    return std::fabs(a - b) < 1e-4f;
+}
+
+// A fan in front of the radar while the HC-SR04 sees nobody: between the
+// two thresholds, so it neither starts presence nor would end it
+void test_radar_false_trigger() {
+    PresenceFusion fusion(device_config());
+    float max_p = 0;
+    for (int64_t t = 1000; t <= 5000; t += kRadarPeriodMs) {
+        fusion.observe(PRESENCE_SOURCE_RADAR, true, t);
+        fusion.observe(PRESENCE_SOURCE_ULTRASONIC, false, t);
+        const PresenceEstimate& e = fusion.update(t);
+        CHECK(!e.present);
+        max_p = std::max(max_p, e.probability);
+    }
+    // Radar rate fully converged (first reading sets it to 1): exact LLRs
+    const float expected = sigmoid(
+        logit(FUSION_PRIOR) + std::log(FUSION_RADAR_HIT / FUSION_RADAR_FALSE) +
+        std::log((1 - FUSION_ULTRASONIC_HIT) / (1 - FUSION_ULTRASONIC_FALSE)));
+    CHECK(near(fusion.estimate().probability, expected));
+    CHECK(near(max_p, expected));
+    CHECK(expected > FUSION_EXIT_P && expected < FUSION_ENTER_P);
+    // Half the enabled weight agrees with "absent": the ultrasonic one
+    CHECK(near(fusion.estimate().confidence, 0.5f));
+
+    // Once the HC-SR04 agrees, it is presence. The radar reading is 100 ms
+    // old by then (freshness 0.9)
+    fusion.observe(PRESENCE_SOURCE_ULTRASONIC, true, 5100);
+    CHECK(fusion.update(5100).present);
+    CHECK(near(fusion.estimate().confidence, (1.0f + 0.9f) / 2));
+}
+
+// Evidence fades linearly to nothing at stale_ms: a radar that stopped
+// reporting leaves the estimate at the prior, not at its last reading
+void test_stale_source() {
+    PresenceFusionConfig config = device_config();
+    config.sources[PRESENCE_SOURCE_ULTRASONIC].weight = 0;
+    PresenceFusion fusion(config);
+
+    for (int64_t t = 0; t <= 1000; t += kRadarPeriodMs) {
+        fusion.observe(PRESENCE_SOURCE_RADAR, true, t);
+        fusion.update(t);
+    }
+    const float llr = std::log(FUSION_RADAR_HIT / FUSION_RADAR_FALSE);
+    CHECK(fusion.estimate().present);
+    CHECK(near(fusion.estimate().probability, sigmoid(logit(FUSION_PRIOR) + llr)));
+
+    const int64_t last = 1000;
+    const int64_t stale = FUSION_RADAR_STALE_MS;
+    CHECK(near(fusion.update(last + stale / 2).probability,
+               sigmoid(logit(FUSION_PRIOR) + 0.5f * llr)));
+    CHECK(fusion.update(last + stale - 1).probability > FUSION_PRIOR + 1e-4f);
+    CHECK(near(fusion.update(last + stale).probability, FUSION_PRIOR));
+    CHECK(near(fusion.update(last + 10 * stale).probability, FUSION_PRIOR));
+    CHECK_EQ(fusion.estimate().confidence, 0);
+
+    // With a lower prior, the faded evidence alone ends presence
+    config.prior = 0.2f;
+    PresenceFusion low(config);
+    low.observe(PRESENCE_SOURCE_RADAR, true, 0);
+    CHECK(low.update(0).present);
+    CHECK(low.update(stale / 2).present);
+    CHECK(!low.update(stale).present);
+}
+
+// The episode starts when the earliest source still detecting first saw
+// it; every source's lag is measured from there
+void test_onset_lag() {
+    PresenceFusion fusion(device_config());
+
+    // Radar from 1000 ms, HC-SR04 joins at 1300 ms and tips it over
+    for (int64_t t = 1000; t <= 1300; t += kRadarPeriodMs) {
+        fusion.observe(PRESENCE_SOURCE_RADAR, true, t);
+        fusion.observe(PRESENCE_SOURCE_ULTRASONIC, t >= 1300, t);
+        fusion.update(t);
+    }
+    CHECK(fusion.estimate().present);
+    CHECK_EQ(fusion.presentSinceMs(), 1000);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_RADAR).onsets, 1);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_RADAR).onset_lag_ms, 0);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_ULTRASONIC).onsets, 1);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_ULTRASONIC).onset_lag_ms, 300);
+
+    // Both quiet until presence ends
+    int64_t t = 1400;
+    for (; fusion.estimate().present; t += kRadarPeriodMs) {
+        fusion.observe(PRESENCE_SOURCE_RADAR, false, t);
+        fusion.observe(PRESENCE_SOURCE_ULTRASONIC, false, t);
+        fusion.update(t);
+        CHECK(t < 10000);
+        if (t >= 10000) {
+            return;
+        }
+    }
+
+    // Second episode, radar silent (stale) meanwhile: HC-SR04 alone starts
+    // it, the radar catches up 500 ms later, counted from the new episode's
+    // start, not the first one's
+    const int64_t start = t + 2000;
+    fusion.observe(PRESENCE_SOURCE_ULTRASONIC, true, start);
+    CHECK(fusion.update(start).present);
+    CHECK_EQ(fusion.presentSinceMs(), start);
+    fusion.observe(PRESENCE_SOURCE_ULTRASONIC, true, start + 500);
+    fusion.observe(PRESENCE_SOURCE_RADAR, true, start + 500);
+    fusion.update(start + 500);
+    fusion.observe(PRESENCE_SOURCE_RADAR, true, start + 600);
+    fusion.update(start + 600);
+
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_ULTRASONIC).onsets, 2);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_ULTRASONIC).onset_lag_ms, 300);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_RADAR).onsets, 2);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_RADAR).onset_lag_ms, 500);
+}
+
+void test_no_source_enabled() {
+    PresenceFusionConfig config = device_config();
+    for (PresenceSourceModel& model : config.sources) {
+        model.weight = 0;
+    }
+    PresenceFusion fusion(config);
+    for (int64_t t = 0; t < 2000; t += kRadarPeriodMs) {
+        fusion.observe(PRESENCE_SOURCE_RADAR, true, t);
+        fusion.observe(PRESENCE_SOURCE_ULTRASONIC, true, t);
+        const PresenceEstimate& e = fusion.update(t);
+        CHECK_EQ(e.confidence, 0);
+        CHECK(near(e.probability, FUSION_PRIOR));
+        CHECK(!e.present);
+    }
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_RADAR).observations, 0);
+    CHECK_EQ(fusion.stats(PRESENCE_SOURCE_ULTRASONIC).observations, 0);
+}
+
+}  // namespace
+
+int main() {
+    test_radar_false_trigger();
+    test_stale_source();
+    test_onset_lag();
+    test_no_source_enabled();
+    return test_result("presence_fusion_test");
+}
@@ -0,0 +1,289 @@
+// Rd01Parser on synthetic UART streams: exact decoding, ACK frames,
+// corrupted, truncated and noise-wrapped frames, arbitrary chunking, and
+// ns per byte.
+
+#include "rd01_parser.h"
+#include "test_util.h"
+
+#include <random>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+void put_u16(Bytes& out, uint16_t v) {
+    out.push_back((uint8_t)v);
+    out.push_back((uint8_t)(v >> 8));
+}
+
+Rd01Report make_report(std::mt19937& rng) {
+    Rd01Report r = {};
+    r.state = (uint8_t)(rng() % 4);
+    r.engineering = rng() % 4 == 0;
+    r.moving_cm = (uint16_t)(rng() % 900);
+    r.moving_energy = (uint8_t)(rng() % 101);
+    r.static_cm = (uint16_t)(rng() % 900);
+    r.static_energy = (uint8_t)(rng() % 101);
+    r.detection_cm = (uint16_t)(rng() % 900);
+    return r;
+}
+
+// Engineering frames carry per-gate energies after the basic fields
+Bytes report_frame(const Rd01Report& r) {
+    Bytes body = {(uint8_t)(r.engineering ? 0x01 : 0x02), 0xAA, r.state};
+    put_u16(body, r.moving_cm);
+    body.push_back(r.moving_energy);
+    put_u16(body, r.static_cm);
+    body.push_back(r.static_energy);
+    put_u16(body, r.detection_cm);
+    if (r.engineering) {
+        for (int gate = 0; gate < 18; gate++) {
+            body.push_back((uint8_t)(gate * 5));
+        }
+    }
+    body.push_back(0x55);
+    body.push_back(0x00);
+
+    Bytes frame = {0xF4, 0xF3, 0xF2, 0xF1};
+    put_u16(frame, (uint16_t)body.size());
+    frame.insert(frame.end(), body.begin(), body.end());
+    frame.insert(frame.end(), {0xF8, 0xF7, 0xF6, 0xF5});
+    return frame;
+}
+
+Bytes ack_frame() {
+    return {0xFD, 0xFC, 0xFB, 0xFA, 0x04, 0x00, 0xFF, 0x01, 0x00, 0x00, 0x04, 0x03, 0x02, 0x01};
+}
+
+bool same(const Rd01Report& a, const Rd01Report& b) {
+    return a.state == b.state && a.engineering == b.engineering && a.moving_cm == b.moving_cm &&
+           a.moving_energy == b.moving_energy && a.static_cm == b.static_cm &&
+           a.static_energy == b.static_energy && a.detection_cm == b.detection_cm;
+}
+
+struct Collector {
+    std::vector<Rd01Report> reports;
+
+    static void callback(const Rd01Report& report, void* arg) {
+        static_cast<Collector*>(arg)->reports.push_back(report);
+    }
+};
+
+// Feeds stream in chunks of 1..max_chunk bytes (0: all at once)
+std::vector<Rd01Report> parse(const Bytes& stream, size_t max_chunk, uint32_t seed,
+                              Rd01ParserStats* stats = nullptr) {
+    Rd01Parser parser;
+    Collector out;
+    parser.setCallback(Collector::callback, &out);
+    std::mt19937 rng(seed);
+    size_t pos = 0;
+    while (pos < stream.size()) {
+        size_t n = max_chunk == 0 ? stream.size() : 1 + rng() % max_chunk;
+        n = std::min(n, stream.size() - pos);
+        parser.feed(stream.data() + pos, n);
+        pos += n;
+    }
+    if (stats) {
+        *stats = parser.stats();
+    }
+    return out.reports;
+}
+
+void test_decode_fields() {
+    Rd01Report basic = {Rd01Report::Moving, false, 123, 45, 678, 90, 321};
+    Rd01Report eng = {Rd01Report::Both, true, 0, 100, 600, 0, 1};
+    Bytes stream = report_frame(basic);
+    Bytes second = report_frame(eng);
+    stream.insert(stream.end(), second.begin(), second.end());
+
+    Rd01ParserStats stats;
+    std::vector<Rd01Report> got = parse(stream, 0, 1, &stats);
+    CHECK_EQ(got.size(), 2);
+    if (got.size() == 2) {
+        CHECK(same(got[0], basic));
+        CHECK(same(got[1], eng));
+        CHECK_EQ(got[0].distance_cm(), 123);
+        CHECK_EQ(got[1].distance_cm(), 0);
+    }
+    CHECK_EQ(stats.reports, 2);
+    CHECK_EQ(stats.bad_frames, 0);
+    CHECK_EQ(stats.skipped_bytes, 0);
+
+    Rd01Report stationary = {Rd01Report::Static, false, 10, 0, 250, 60, 250};
+    CHECK_EQ(stationary.distance_cm(), 250);
+    CHECK(!Rd01Report{}.present());
+}
+
+void test_ack_frames_skipped() {
+    std::mt19937 rng(2);
+    Rd01Report r = make_report(rng);
+    Bytes stream = ack_frame();
+    Bytes frame = report_frame(r);
+    stream.insert(stream.end(), frame.begin(), frame.end());
+    Bytes ack = ack_frame();
+    stream.insert(stream.end(), ack.begin(), ack.end());
+
+    for (size_t chunk : {0, 1, 3}) {
+        Rd01ParserStats stats;
+        std::vector<Rd01Report> got = parse(stream, chunk, 3, &stats);
+        CHECK_EQ(got.size(), 1);
+        CHECK_EQ(stats.acks, 2);
+        CHECK_EQ(stats.skipped_bytes, 0);
+    }
+}
+
+// Each way a frame can be damaged on the wire; none may take the next
+// frame down with it
+enum class Damage { None, Truncate, Footer, Energy, Length, Marker, Header, Noise };
+
+Bytes damage(Bytes frame, Damage d, std::mt19937& rng) {
+    switch (d) {
+    case Damage::None:
+        break;
+    case Damage::Truncate:
+        frame.resize(1 + rng() % (frame.size() - 1));
+        break;
+    case Damage::Footer:
+        frame[frame.size() - 1 - rng() % 4] ^= 0x10;
+        break;
+    case Damage::Energy:
+        frame[6 + 5] = (uint8_t)(101 + rng() % 100);
+        break;
+    case Damage::Length:
+        frame[4] = (uint8_t)(rng() % 2 ? 3 : 65);
+        break;
+    case Damage::Marker:
+        frame[6 + 1] = 0xAB;
+        break;
+    case Damage::Header:
+        frame[rng() % 4] = 0x00;
+        break;
+    case Damage::Noise: {
+        Bytes noise(rng() % 40);
+        for (uint8_t& b : noise) {
+            b = (uint8_t)rng();
+        }
+        frame.insert(frame.begin(), noise.begin(), noise.end());
+        break;
+    }
+    }
+    return frame;
+}
+
+void test_resync_after_damage() {
+    std::mt19937 rng(4);
+    Bytes stream;
+    std::vector<Rd01Report> intact;
+    for (int i = 0; i < 20000; i++) {
+        Rd01Report r = make_report(rng);
+        Damage d = rng() % 3 == 0 ? (Damage)(1 + rng() % 7) : Damage::None;
+        Bytes frame = damage(report_frame(r), d, rng);
+        if (d == Damage::None || d == Damage::Noise) {
+            intact.push_back(r);
+        }
+        if (rng() % 20 == 0) {
+            Bytes ack = ack_frame();
+            frame.insert(frame.end(), ack.begin(), ack.end());
+        }
+        stream.insert(stream.end(), frame.begin(), frame.end());
+    }
+
+    Rd01ParserStats stats;
+    std::vector<Rd01Report> whole = parse(stream, 0, 5, &stats);
+    CHECK_EQ(whole.size(), intact.size());
+    bool all_same = whole.size() == intact.size();
+    for (size_t i = 0; all_same && i < whole.size(); i++) {
+        all_same = same(whole[i], intact[i]);
+    }
+    CHECK(all_same);
+    CHECK(stats.bad_frames > 0);
+    CHECK(stats.skipped_bytes > 0);
+
+    // Any chunking gives the same reports
+    for (size_t chunk : {1, 7, 64, 300}) {
+        std::vector<Rd01Report> chunked = parse(stream, chunk, 6 + (uint32_t)chunk);
+        bool equal = chunked.size() == whole.size();
+        for (size_t i = 0; equal && i < chunked.size(); i++) {
+            equal = same(chunked[i], whole[i]);
+        }
+        CHECK(equal);
+    }
+}
+
+// A frame cut off by a UART overflow is dropped by reset(), not merged
+// with what follows
+void test_reset_drops_partial() {
+    std::mt19937 rng(8);
+    Rd01Report first = make_report(rng);
+    Rd01Report second = make_report(rng);
+    Bytes a = report_frame(first);
+    Bytes b = report_frame(second);
+
+    Rd01Parser parser;
+    Collector out;
+    parser.setCallback(Collector::callback, &out);
+    parser.feed(a.data(), a.size() - 5);
+    parser.reset();
+    parser.feed(b.data(), b.size());
+    CHECK_EQ(out.reports.size(), 1);
+    if (!out.reports.empty()) {
+        CHECK(same(out.reports[0], second));
+    }
+}
+
+// No checksum: a flipped distance bit inside a well-formed frame passes
+void test_payload_corruption_undetected() {
+    Rd01Report r = {Rd01Report::Moving, false, 100, 50, 0, 0, 100};
+    Bytes frame = report_frame(r);
+    frame[6 + 3] ^= 0x04;
+    std::vector<Rd01Report> got = parse(frame, 0, 9);
+    CHECK_EQ(got.size(), 1);
+    if (!got.empty()) {
+        CHECK_EQ(got[0].moving_cm, 100 ^ 0x04);
+    }
+}
+
+void bench_parse() {
+    std::mt19937 rng(10);
+    Bytes clean;
+    Bytes noisy;
+    for (int i = 0; i < 100000; i++) {
+        Rd01Report r = make_report(rng);
+        r.engineering = false;
+        Bytes frame = report_frame(r);
+        clean.insert(clean.end(), frame.begin(), frame.end());
+        Damage d = rng() % 3 == 0 ? (Damage)(1 + rng() % 7) : Damage::None;
+        frame = damage(frame, d, rng);
+        noisy.insert(noisy.end(), frame.begin(), frame.end());
+    }
+
+    const size_t kChunk = 256;  // Rd01Radar's read size
+    for (const Bytes* stream : {&clean, &noisy}) {
+        Rd01Parser parser;
+        Collector out;
+        out.reports.reserve(100000);
+        parser.setCallback(Collector::callback, &out);
+        double start = now_us();
+        for (size_t pos = 0; pos < stream->size(); pos += kChunk) {
+            parser.feed(stream->data() + pos, std::min(kChunk, stream->size() - pos));
+        }
+        double elapsed = now_us() - start;
+        std::printf("bench: %s stream, %zu bytes: %.2f ns/byte, %.1f ns/report\n",
+                    stream == &clean ? "clean" : "damaged", stream->size(),
+                    elapsed * 1000.0 / stream->size(),
+                    elapsed * 1000.0 / parser.stats().reports);
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_decode_fields();
+    test_ack_frames_skipped();
+    test_resync_after_damage();
+    test_reset_drops_partial();
+    test_payload_corruption_undetected();
+    bench_parse();
+    return test_result("rd01_parser_test");
+}
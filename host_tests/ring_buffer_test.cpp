@@ -0,0 +1,237 @@
+// RingBuffer: eviction semantics, the peek/consume race against a producer
+// that keeps evicting, and a throughput/allocation comparison with the
+// std::deque + std::mutex queue SensorManager used before.
+
+#include "alloc_count.h"
+#include "ring_buffer.h"
+#include "telemetry_record.h"
+#include "test_util.h"
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Item {
+    uint32_t id;
+    uint32_t check;  // Derived from id, catches torn or overwritten copies
+};
+
+Item make_item(uint32_t id) {
+    return {id, id * 2654435761u};
+}
+
+void test_fifo_and_eviction() {
+    RingBuffer<Item, 8> rb;
+    CHECK(rb.empty());
+    for (uint32_t i = 0; i < 5; i++) {
+        CHECK(!rb.push(make_item(i)));
+    }
+    CHECK_EQ(rb.size(), 5);
+
+    // Full: each push evicts the oldest element
+    for (uint32_t i = 5; i < 12; i++) {
+        rb.push(make_item(i));
+    }
+    CHECK_EQ(rb.size(), 8);
+    CHECK_EQ(rb.dropped(), 4);
+
+    Item out[8];
+    size_t n = rb.pop(out, 8);
+    CHECK_EQ(n, 8);
+    for (size_t i = 0; i < n; i++) {
+        CHECK_EQ(out[i].id, 4 + i);
+    }
+    CHECK(rb.empty());
+}
+
+void test_peek_then_evict_then_consume() {
+    RingBuffer<Item, 8> rb;
+    for (uint32_t i = 0; i < 8; i++) {
+        rb.push(make_item(i));
+    }
+
+    Item out[8];
+    CHECK_EQ(rb.peek(out, 4), 4);
+    CHECK_EQ(out[0].id, 0);
+
+    // The producer evicts past what the consumer is still holding
+    for (uint32_t i = 8; i < 14; i++) {
+        rb.push(make_item(i));
+    }
+    CHECK_EQ(rb.dropped(), 6);
+
+    // consume() must not move the tail backwards onto evicted slots
+    rb.consume(4);
+    size_t n = rb.peek(out, 8);
+    CHECK_EQ(n, 8);
+    CHECK_EQ(out[0].id, 6);
+    CHECK_EQ(out[n - 1].id, 13);
+
+    // peek() without consume() returns the same records again
+    Item again[8];
+    CHECK_EQ(rb.peek(again, 8), 8);
+    CHECK_EQ(again[0].id, 6);
+}
+
+// Reading ahead of unreleased elements, as the publisher does with several
+// batches awaiting their acks
+void test_read_ahead() {
+    RingBuffer<Item, 8> rb;
+    for (uint32_t i = 0; i < 6; i++) {
+        rb.push(make_item(i));
+    }
+
+    Item out[8];
+    uint32_t pos = 0;
+    CHECK_EQ(rb.peekFrom(&pos, out, 4), 4);
+    CHECK_EQ(pos, 0);
+    pos += 4;
+    CHECK_EQ(rb.peekFrom(&pos, out, 4), 2);
+    CHECK_EQ(pos, 4);
+    CHECK_EQ(out[0].id, 4);
+    CHECK_EQ(rb.size(), 6);
+
+    // Releasing the first batch leaves the second queued
+    rb.consumeTo(4);
+    CHECK_EQ(rb.size(), 2);
+    CHECK_EQ(rb.peek(out, 8), 2);
+    CHECK_EQ(out[0].id, 4);
+
+    // Evictions past the read-ahead position are skipped
+    for (uint32_t i = 6; i < 20; i++) {
+        rb.push(make_item(i));
+    }
+    pos = 6;
+    CHECK_EQ(rb.peekFrom(&pos, out, 8), 8);
+    CHECK_EQ(pos, 12);
+    CHECK_EQ(out[0].id, 12);
+
+    // Releasing below the tail never moves it back
+    rb.consumeTo(5);
+    CHECK_EQ(rb.size(), 8);
+}
+
+// Producer pushes far faster than the consumer drains, so evictions race
+// with every peek(); nothing may come back torn, reordered or twice
+void test_eviction_race() {
+    static RingBuffer<Item, 1000> rb;
+    const uint32_t kCount = 2000000;
+
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < kCount; i++) {
+            rb.push(make_item(i));
+        }
+    });
+
+    Item out[50];
+    uint64_t received = 0;
+    uint32_t torn = 0;
+    uint32_t out_of_order = 0;
+    int64_t last = -1;
+    while (last != (int64_t)kCount - 1) {
+        size_t n = rb.peek(out, 50);
+        for (size_t i = 0; i < n; i++) {
+            if (out[i].check != out[i].id * 2654435761u) {
+                torn++;
+            }
+            if ((int64_t)out[i].id <= last) {
+                out_of_order++;
+            }
+            last = out[i].id;
+        }
+        rb.consume(n);
+        received += n;
+    }
+    producer.join();
+
+    CHECK_EQ(torn, 0);
+    CHECK_EQ(out_of_order, 0);
+    CHECK_EQ(received + rb.dropped(), kCount);
+    CHECK(rb.empty());
+    std::printf("race: %u pushed, %llu received, %u evicted\n", kCount,
+                (unsigned long long)received, rb.dropped());
+}
+
+// The queue SensorManager had before the ring buffer
+class DequeQueue {
+public:
+    void enqueue(const Telemetry& data) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.size() >= 1000) {
+            queue_.pop_front();
+        }
+        queue_.push_back(data);
+    }
+
+    std::vector<Telemetry> popBatch(size_t max_count) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::vector<Telemetry> batch;
+        batch.reserve(max_count);
+        while (!queue_.empty() && batch.size() < max_count) {
+            batch.push_back(queue_.front());
+            queue_.pop_front();
+        }
+        return batch;
+    }
+
+private:
+    std::deque<Telemetry> queue_;
+    std::mutex mutex_;
+};
+
+// Enqueue 1000 records, drain them in batches of 50, many times over
+void bench_against_deque() {
+    const int kRounds = 2000;
+    Telemetry record = Telemetry::make(1717000000, 2150, 4020, 1013250, 2);
+
+    DequeQueue deque_queue;
+    uint64_t allocs = alloc_count();
+    double start = now_us();
+    for (int round = 0; round < kRounds; round++) {
+        for (int i = 0; i < 1000; i++) {
+            deque_queue.enqueue(record);
+        }
+        for (int i = 0; i < 20; i++) {
+            std::vector<Telemetry> batch = deque_queue.popBatch(50);
+            keep(batch);
+        }
+    }
+    double deque_us = now_us() - start;
+    uint64_t deque_allocs = alloc_count() - allocs;
+
+    static RingBuffer<Telemetry, 1000> rb;
+    Telemetry batch[50];
+    allocs = alloc_count();
+    start = now_us();
+    for (int round = 0; round < kRounds; round++) {
+        for (int i = 0; i < 1000; i++) {
+            rb.push(record);
+        }
+        for (int i = 0; i < 20; i++) {
+            keep(rb.pop(batch, 50));
+        }
+    }
+    double ring_us = now_us() - start;
+    uint64_t ring_allocs = alloc_count() - allocs;
+
+    double records = (double)kRounds * 1000;
+    std::printf("bench: deque+mutex %.1f M records/s, %.3f allocations/record\n",
+                records / deque_us, deque_allocs / records);
+    std::printf("bench: RingBuffer  %.1f M records/s, %.3f allocations/record\n",
+                records / ring_us, ring_allocs / records);
+    CHECK_EQ(ring_allocs, 0);
+}
+
+}  // namespace
+
+int main() {
+    test_fifo_and_eviction();
+    test_peek_then_evict_then_consume();
+    test_read_ahead();
+    test_eviction_race();
+    bench_against_deque();
+    return test_result("ring_buffer_test");
+}
@@ -0,0 +1,222 @@
+// SamplingScheduler: the latency cap on the slow rate, first detection
+// after a long idle within max_latency_ms for every arrival phase, the
+// interval against probability, LED state, recency and hour history, and
+// the statistics (percentile bins, saturation, samples/hour, energy and
+// power) against hand-computed values.
+
+#include "config.h"
+#include "sampling_scheduler.h"
+#include "test_util.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int64_t kHourMs = 3600 * 1000;
+
+// main.cpp's configuration with the HC-SR04 fitted
+SamplingSchedulerConfig device_config() {
+    return {SAMPLING_MIN_INTERVAL_MS,
+            SAMPLING_MAX_INTERVAL_MS,
+            SAMPLING_MAX_LATENCY_MS,
+            SAMPLING_ATTACK_MS,
+            FUSION_EXIT_P,
+            FUSION_ENTER_P,
+            SAMPLING_RECENCY_MS,
+            SAMPLING_LED_URGENCY,
+            SAMPLING_HISTORY_GAIN,
+            SAMPLING_HISTORY_ALPHA,
+            SAMPLING_PING_ENERGY_UJ + SAMPLING_WAKE_ENERGY_UJ};
+}
+
+SamplingInput quiet(int64_t now_ms, int hour = -1) {
+    return {now_ms, 0.0f, false, false, false, hour};
+}
+
+SamplingInput present(int64_t now_ms, int hour = -1) {
+    return {now_ms, 1.0f, true, false, false, hour};
+}
+
+// The slow rate leaves attack_ms of the latency budget for confirmation
+void test_latency_cap() {
+    SamplingScheduler scheduler(device_config());
+    const uint32_t cap = SAMPLING_MAX_LATENCY_MS - SAMPLING_ATTACK_MS;
+    CHECK_EQ(scheduler.config().max_interval_ms, cap);
+    CHECK_EQ(scheduler.next(quiet(0)), cap);
+
+    // A budget below the attack time leaves only the fastest rate
+    SamplingSchedulerConfig tight = device_config();
+    tight.max_latency_ms = 200;
+    SamplingScheduler fast(tight);
+    CHECK_EQ(fast.config().max_interval_ms, SAMPLING_MIN_INTERVAL_MS);
+    CHECK_EQ(fast.next(quiet(0)), SAMPLING_MIN_INTERVAL_MS);
+
+    // A slow rate already inside the budget is kept
+    SamplingSchedulerConfig relaxed = device_config();
+    relaxed.max_interval_ms = 400;
+    CHECK_EQ(SamplingScheduler(relaxed).config().max_interval_ms, 400);
+}
+
+// Someone arrives at any phase of the slow rate after an hour of nothing.
+// Every sample from the arrival on hints; the detector confirms after
+// attack_ms of hints (median + enter debounce at the fast rate)
+void test_first_detection_after_idle() {
+    uint32_t worst_ms = 0;
+    for (int64_t phase = 0; phase < 700; phase += 7) {
+        SamplingScheduler scheduler(device_config());
+        int64_t now = 0;
+        while (now < kHourMs) {
+            now += scheduler.next(quiet(now));
+        }
+        const int64_t arrival = now - 700 + phase;
+        int64_t first_hint = -1;
+        while (true) {
+            SamplingInput in = quiet(now);
+            if (now >= arrival) {
+                if (first_hint < 0) {
+                    first_hint = now;
+                }
+                in.hint = true;
+                in.present = now - first_hint >= SAMPLING_ATTACK_MS;
+                in.probability = in.present ? 1.0f : 0.5f;
+            }
+            uint32_t interval = scheduler.next(in);
+            if (in.present) {
+                break;
+            }
+            now += interval;
+        }
+        worst_ms = std::max(worst_ms, (uint32_t)(now - arrival));
+        SamplingStats stats = scheduler.stats(now);
+        CHECK_EQ(stats.detections, 1);
+        CHECK(stats.latency_max_ms <= SAMPLING_MAX_LATENCY_MS);
+        CHECK(stats.latency_max_ms >= now - arrival);
+    }
+    CHECK(worst_ms <= SAMPLING_MAX_LATENCY_MS);
+    CHECK(worst_ms > SAMPLING_MAX_LATENCY_MS - 100);  // The budget is used, not wasted
+}
+
+// interval = 700 * (50 / 700)^u, u from each input as documented
+void test_urgency_curve() {
+    SamplingScheduler scheduler(device_config());
+    int64_t now = 0;
+    CHECK_EQ(scheduler.next(quiet(now)), 700);
+
+    // Probability between quiet_p (0.3) and alert_p (0.7)
+    const float probabilities[] = {0.2f, 0.3f, 0.4f, 0.5f, 0.6f, 0.7f, 0.9f};
+    const uint32_t expected[] = {700, 700, 362, 187, 97, 50, 50};
+    for (int i = 0; i < 7; i++) {
+        SamplingInput in = quiet(now += 700);
+        in.probability = probabilities[i];
+        CHECK_EQ(scheduler.next(in), expected[i]);
+    }
+
+    // LEDs on: urgency 0.5 at least
+    SamplingInput leds = quiet(now += 700);
+    leds.leds_on = true;
+    CHECK_EQ(scheduler.next(leds), 187);
+    leds.probability = 0.6f;
+    CHECK_EQ(scheduler.next(leds), 97);
+
+    // Present, then fading over recency_ms: e^-1 at 5 s
+    CHECK_EQ(scheduler.next(present(now += 700)), 50);
+    const int64_t left = now;
+    CHECK_EQ(scheduler.next(quiet(left + 50)), 51);  // e^-0.01: 50 * 14^0.01
+    CHECK_EQ(scheduler.next(quiet(left + SAMPLING_RECENCY_MS)), 265);
+    CHECK_EQ(scheduler.next(quiet(left + 10 * SAMPLING_RECENCY_MS)), 700);
+}
+
+// An hour that was occupied raises that hour's rate on later days
+void test_hour_history() {
+    SamplingScheduler scheduler(device_config());
+    int64_t now = 0;
+
+    // Hour 8 occupied throughout, then hour 9 begins
+    for (; now < kHourMs; now += 1000) {
+        scheduler.next(present(now, 8));
+    }
+    scheduler.next(quiet(now, 9));
+    CHECK(scheduler.history(8) > 0.29f && scheduler.history(8) <= 0.3f);
+    CHECK_EQ(scheduler.history(9), 0);
+
+    // Next day, same hour: urgency 2 * 0.3 = 0.6
+    now += 23 * kHourMs;
+    CHECK_EQ(scheduler.next(quiet(now, 8)), 144);
+    CHECK_EQ(scheduler.next(quiet(now + 700, 10)), 700);
+
+    // An hour seen for less than half of it teaches nothing
+    SamplingScheduler brief(device_config());
+    for (now = 0; now < 20 * 60 * 1000; now += 1000) {
+        brief.next(present(now, 8));
+    }
+    brief.next(quiet(now, 9));
+    CHECK_EQ(brief.history(8), 0);
+}
+
+// Onset latency: from the last quiet sample to presence
+void detect(SamplingScheduler& scheduler, int64_t* now, uint32_t latency_ms) {
+    scheduler.next(quiet(*now));
+    *now += latency_ms;
+    scheduler.next(present(*now));
+    *now += 1000;
+}
+
+void test_stats() {
+    SamplingScheduler scheduler(device_config());
+    CHECK_EQ(scheduler.stats(0).latency_p50_ms, 0);
+
+    // Bins are 20 ms wide and report their upper edge; everything from
+    // 2540 ms on is in the last bin, which reports the maximum
+    int64_t now = 0;
+    const uint32_t latencies[] = {15, 25, 45, 45, 45, 60, 61, 100, 500, 3000};
+    for (uint32_t latency : latencies) {
+        detect(scheduler, &now, latency);
+    }
+    SamplingStats s = scheduler.stats(now);
+    CHECK_EQ(s.detections, 10);
+    CHECK_EQ(s.latency_p50_ms, 60);   // 5th of 10: a 45 ms one, bin 40..60
+    CHECK_EQ(s.latency_p90_ms, 520);  // 9th: 500 ms, bin 500..520
+    CHECK_EQ(s.latency_p99_ms, 3000); // 10th: last bin
+    CHECK_EQ(s.latency_max_ms, 3000);
+
+    // 100 samples over 100 s: rates and energy
+    SamplingScheduler counted(device_config());
+    for (int i = 0; i < 100; i++) {
+        counted.next(quiet(i * 1000));
+    }
+    s = counted.stats(100000);
+    CHECK_EQ(s.samples, 100);
+    CHECK_EQ(s.samples_per_hour, 3600);
+    CHECK_EQ(s.energy_mj, 175);       // 100 x 1750 uJ
+    CHECK_EQ(s.avg_power_uw, 1750);   // 175 mJ / 100 s
+    CHECK_EQ(s.interval_ms, 700);
+    CHECK_EQ(counted.stats(3700000).samples_per_hour, 97);
+    CHECK_EQ(counted.stats(3700000).avg_power_uw, 47);
+}
+
+// A bin about to overflow halves every bin instead of wrapping to 0
+void test_bin_saturation() {
+    SamplingScheduler scheduler(device_config());
+    int64_t now = 0;
+    detect(scheduler, &now, 500);
+    for (int i = 0; i < 65535 + 10; i++) {
+        detect(scheduler, &now, 10);
+    }
+    SamplingStats s = scheduler.stats(now);
+    CHECK_EQ(s.detections, 65546);
+    CHECK_EQ(s.latency_p50_ms, 20);
+    CHECK_EQ(s.latency_p99_ms, 20);
+    CHECK_EQ(s.latency_max_ms, 500);
+}
+
+}  // namespace
+
+int main() {
+    test_latency_cap();
+    test_first_detection_after_idle();
+    test_urgency_curve();
+    test_hour_history();
+    test_stats();
+    test_bin_saturation();
+    return test_result("sampling_scheduler_test");
+}
@@ -0,0 +1,386 @@
+// TelemetrySpool on the fake NOR flash: ordering across remounts, sector
+// rollover and eviction, torn frames and sector headers, a power-cut sweep
+// over a whole workload, and sustained append/replay rates.
+
+#include "fake_flash.h"
+#include "telemetry_record.h"
+#include "telemetry_spool.h"
+#include "test_util.h"
+
+#include <vector>
+
+namespace {
+
+constexpr size_t kPartitionSize = 0x30000;  // As in partitions.csv
+constexpr size_t kSmallPartition = 4 * fake_flash::kSectorSize;
+
+Telemetry record(uint32_t seq) {
+    Telemetry t = Telemetry::make(1717000000 + seq * 30, 2150, 4020, 1013250, seq & 0xFFF);
+    t.seq = seq;
+    return t;
+}
+
+bool append(TelemetrySpool& spool, uint32_t seq) {
+    Telemetry t = record(seq);
+    return spool.append(&t, sizeof(t));
+}
+
+// Peek/commit everything; returns the sequence numbers in order
+std::vector<uint32_t> drain(TelemetrySpool& spool) {
+    std::vector<uint32_t> seqs;
+    Telemetry batch[50];
+    while (true) {
+        size_t n = spool.peek(batch, sizeof(Telemetry), 50);
+        if (n == 0) {
+            break;
+        }
+        for (size_t i = 0; i < n; i++) {
+            seqs.push_back(batch[i].seq);
+        }
+        spool.commit();
+    }
+    return seqs;
+}
+
+bool contiguous(const std::vector<uint32_t>& seqs) {
+    for (size_t i = 1; i < seqs.size(); i++) {
+        if (seqs[i] != seqs[i - 1] + 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_replay_after_commit() {
+    fake_flash::reset(kPartitionSize);
+    {
+        TelemetrySpool spool;
+        CHECK(spool.mount("spool"));
+        CHECK(spool.empty());
+        for (uint32_t i = 0; i < 1000; i++) {
+            CHECK(append(spool, i));
+        }
+        CHECK_EQ(spool.pendingCount(), 1000);
+
+        Telemetry batch[50];
+        CHECK_EQ(spool.peek(batch, sizeof(Telemetry), 50), 50);
+        CHECK_EQ(batch[0].seq, 0);
+        spool.commit();
+
+        // Peeked but never committed: must come back after the reboot
+        CHECK_EQ(spool.peek(batch, sizeof(Telemetry), 50), 50);
+        CHECK_EQ(batch[0].seq, 50);
+    }
+
+    TelemetrySpool spool;
+    CHECK(spool.mount("spool"));
+    CHECK_EQ(spool.pendingCount(), 950);
+    std::vector<uint32_t> seqs = drain(spool);
+    CHECK_EQ(seqs.size(), 950);
+    CHECK_EQ(seqs.front(), 50);
+    CHECK(contiguous(seqs));
+
+    TelemetrySpool again;
+    CHECK(again.mount("spool"));
+    CHECK(again.empty());
+}
+
+// Several batches out at once, committed in order as their acks arrive
+void test_batches_in_flight() {
+    fake_flash::reset(kPartitionSize);
+    TelemetrySpool spool;
+    CHECK(spool.mount("spool"));
+    for (uint32_t i = 0; i < 300; i++) {
+        CHECK(append(spool, i));
+    }
+
+    Telemetry batch[50];
+    TelemetrySpool::Mark marks[3];
+    TelemetrySpool::Mark cursor = {};
+    for (int b = 0; b < 3; b++) {
+        CHECK_EQ(spool.peekAfter(&cursor, batch, sizeof(Telemetry), 50), 50);
+        CHECK_EQ(batch[0].seq, 50 * b);
+        marks[b] = cursor;
+    }
+    CHECK_EQ(spool.pendingCount(), 300);
+
+    // Only the first batch is delivered before the reboot
+    spool.commitTo(marks[0]);
+    CHECK_EQ(spool.pendingCount(), 250);
+    {
+        TelemetrySpool rebooted;
+        CHECK(rebooted.mount("spool"));
+        CHECK_EQ(rebooted.pendingCount(), 250);
+        CHECK_EQ(rebooted.peek(batch, sizeof(Telemetry), 1), 1);
+        CHECK_EQ(batch[0].seq, 50);
+    }
+
+    // Committing the third covers the second; an older mark is a no-op
+    spool.commitTo(marks[2]);
+    CHECK_EQ(spool.pendingCount(), 150);
+    spool.commitTo(marks[1]);
+    CHECK_EQ(spool.pendingCount(), 150);
+    CHECK_EQ(spool.peekAfter(&cursor, batch, sizeof(Telemetry), 50), 50);
+    CHECK_EQ(batch[0].seq, 150);
+
+    // A mark into a sector the writer recycled refers to records that are gone
+    TelemetrySpool::Mark stale = cursor;
+    for (uint32_t i = 300; i < 8000; i++) {
+        append(spool, i);
+    }
+    CHECK(spool.droppedCount() > 0);
+    uint32_t pending = spool.pendingCount();
+    spool.commitTo(stale);
+    CHECK_EQ(spool.pendingCount(), pending);
+    CHECK_EQ(spool.peekAfter(&stale, batch, sizeof(Telemetry), 1), 1);
+    CHECK_EQ(spool.peek(&batch[1], sizeof(Telemetry), 1), 1);
+    CHECK_EQ(batch[0].seq, batch[1].seq);
+}
+
+void test_foreign_record_size() {
+    fake_flash::reset(kPartitionSize);
+    TelemetrySpool spool;
+    CHECK(spool.mount("spool"));
+    uint8_t old_format[20] = {};
+    CHECK(spool.append(old_format, sizeof(old_format)));
+    CHECK(append(spool, 7));
+
+    // The record of another size is skipped and consumed with the batch
+    std::vector<uint32_t> seqs = drain(spool);
+    CHECK_EQ(seqs.size(), 1);
+    CHECK_EQ(seqs.empty() ? 0 : seqs[0], 7);
+    CHECK(spool.empty());
+}
+
+// Several laps around the ring: the oldest sector is evicted when the
+// writer catches up, and erases spread evenly over the sectors
+void test_wraparound() {
+    fake_flash::reset(kPartitionSize);
+    const uint32_t kCount = 20000;  // About three laps of 48 sectors
+    uint32_t seq = 0;
+    {
+        TelemetrySpool spool;
+        CHECK(spool.mount("spool"));
+        for (; seq < kCount; seq++) {
+            CHECK(append(spool, seq));
+        }
+        CHECK(spool.droppedCount() > 0);
+        CHECK_EQ(spool.pendingCount() + spool.droppedCount(), kCount);
+    }
+
+    TelemetrySpool spool;
+    CHECK(spool.mount("spool"));
+    uint32_t pending = spool.pendingCount();
+    std::vector<uint32_t> seqs = drain(spool);
+    CHECK_EQ(seqs.size(), pending);
+    CHECK(contiguous(seqs));
+    CHECK_EQ(seqs.empty() ? 0 : seqs.back(), kCount - 1);
+
+    uint32_t min_erases = UINT32_MAX;
+    uint32_t max_erases = 0;
+    for (size_t s = 0; s < kPartitionSize / fake_flash::kSectorSize; s++) {
+        uint32_t erases = fake_flash::eraseCount(s);
+        min_erases = erases < min_erases ? erases : min_erases;
+        max_erases = erases > max_erases ? erases : max_erases;
+    }
+    CHECK(max_erases - min_erases <= 1);
+
+    // Keeps working after the laps, across another remount
+    for (uint32_t i = 0; i < 300; i++) {
+        CHECK(append(spool, seq++));
+    }
+    TelemetrySpool remounted;
+    CHECK(remounted.mount("spool"));
+    seqs = drain(remounted);
+    CHECK_EQ(seqs.size(), 300);
+    CHECK_EQ(seqs.empty() ? 0 : seqs.front(), kCount);
+}
+
+// Power dies halfway through a record: everything appended before it
+// survives, the torn frame is skipped, and the sector is sealed
+void test_torn_frame() {
+    fake_flash::reset(kPartitionSize);
+    {
+        TelemetrySpool spool;
+        CHECK(spool.mount("spool"));
+        for (uint32_t i = 0; i < 100; i++) {
+            CHECK(append(spool, i));
+        }
+        fake_flash::cutPowerAfter(sizeof(Telemetry) / 2);
+        CHECK(!append(spool, 100));
+        CHECK(!fake_flash::powered());
+    }
+    fake_flash::restorePower();
+
+    TelemetrySpool spool;
+    CHECK(spool.mount("spool"));
+    CHECK_EQ(spool.pendingCount(), 100);
+    for (uint32_t i = 100; i < 400; i++) {
+        CHECK(append(spool, i));
+    }
+
+    TelemetrySpool remounted;
+    CHECK(remounted.mount("spool"));
+    std::vector<uint32_t> seqs = drain(remounted);
+    CHECK_EQ(seqs.size(), 400);
+    CHECK(contiguous(seqs));
+}
+
+// Power dies while a new sector's header is written. The spool must still
+// find the right head after hundreds more sector sequence numbers.
+void test_torn_sector_header() {
+    const size_t kHeaderSize = 8;
+    const size_t kFrameSize = 4 + sizeof(Telemetry) + 4;  // Header, payload, CRC
+    const uint32_t kPerSector = (fake_flash::kSectorSize - kHeaderSize) / kFrameSize;
+    for (size_t cut = 0; cut <= kHeaderSize; cut++) {
+        fake_flash::reset(kSmallPartition);
+        {
+            TelemetrySpool spool;
+            CHECK(spool.mount("spool"));
+            for (uint32_t i = 0; i < kPerSector; i++) {
+                CHECK(append(spool, i));
+            }
+            // Sector 0 is full: this append erases sector 1 and writes its header
+            fake_flash::cutPowerAfter(cut);
+            CHECK(!append(spool, kPerSector));
+        }
+        fake_flash::restorePower();
+
+        TelemetrySpool spool;
+        CHECK(spool.mount("spool"));
+        std::vector<uint32_t> seqs = drain(spool);
+        CHECK_EQ(seqs.size(), kPerSector);
+
+        // Every remount on the way must find the newest sector as the head
+        const uint32_t kFirst = 1000;
+        const uint32_t kCount = 300 * kPerSector;
+        for (uint32_t i = 0; i < kCount; i++) {
+            CHECK(append(spool, kFirst + i));
+            if (i % kPerSector == 0) {
+                TelemetrySpool probe;
+                CHECK(probe.mount("spool"));
+                CHECK_EQ(probe.pendingCount(), spool.pendingCount());
+                Telemetry expected;
+                Telemetry found;
+                CHECK_EQ(spool.peek(&expected, sizeof(Telemetry), 1), 1);
+                CHECK_EQ(probe.peek(&found, sizeof(Telemetry), 1), 1);
+                CHECK_EQ(found.seq, expected.seq);
+            }
+        }
+
+        TelemetrySpool remounted;
+        CHECK(remounted.mount("spool"));
+        seqs = drain(remounted);
+        CHECK(!seqs.empty());
+        CHECK(contiguous(seqs));
+        CHECK_EQ(seqs.empty() ? 0 : seqs.back(), kFirst + kCount - 1);
+    }
+}
+
+// Producer/consumer workload on a small partition (rollovers, evictions,
+// commits), cut off after every possible number of flash bytes. After a
+// remount nothing acknowledged may be lost, reordered or duplicated, and
+// only the batch whose commit was interrupted may be replayed. The record
+// being written when power died may survive: if the bytes still missing
+// already read as erased, the frame is complete.
+void test_power_cut_sweep() {
+    const uint32_t kAppends = 1500;
+    uint32_t runs = 0;
+    bool finished = false;
+    for (size_t budget = 0; !finished; budget += budget < 5000 ? 1 : 37) {
+        fake_flash::reset(kSmallPartition);
+        int64_t last_acked = -1;
+        int64_t in_flight = -1;
+        int64_t lowest = 0;  // Oldest seq allowed to come back
+        uint32_t dropped = 0;
+        {
+            TelemetrySpool spool;
+            fake_flash::cutPowerAfter(budget);
+            spool.mount("spool");
+            Telemetry batch[5];
+            for (uint32_t seq = 0; seq < kAppends && fake_flash::powered(); seq++) {
+                if (append(spool, seq)) {
+                    last_acked = seq;
+                } else if (!fake_flash::powered()) {
+                    in_flight = seq;
+                }
+                if (seq % 10 != 9 || !fake_flash::powered()) {
+                    continue;
+                }
+                size_t n = spool.peek(batch, sizeof(Telemetry), 5);
+                if (n > 0) {
+                    spool.commit();
+                    lowest = fake_flash::powered() ? batch[n - 1].seq + 1 : batch[0].seq;
+                }
+            }
+            dropped = spool.droppedCount();
+        }
+        finished = fake_flash::powered();
+        fake_flash::restorePower();
+        runs++;
+
+        TelemetrySpool spool;
+        CHECK(spool.mount("spool"));
+        std::vector<uint32_t> seqs = drain(spool);
+        if (!seqs.empty() && seqs.back() == in_flight) {
+            seqs.pop_back();
+        }
+        bool ok = contiguous(seqs);
+        if (last_acked < lowest) {
+            ok = ok && seqs.empty();
+        } else {
+            ok = ok && !seqs.empty() && seqs.back() == last_acked && seqs.front() >= lowest &&
+                 seqs.front() <= lowest + dropped;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "power cut after %zu bytes: %zu records %u..%u, "
+                         "expected %lld..%lld\n", budget, seqs.size(),
+                         seqs.empty() ? 0 : seqs.front(), seqs.empty() ? 0 : seqs.back(),
+                         (long long)lowest, (long long)last_acked);
+        }
+        CHECK(ok);
+
+        // Committed for good: a second remount finds nothing
+        TelemetrySpool again;
+        CHECK(again.mount("spool"));
+        CHECK(again.empty());
+    }
+    std::printf("power cut sweep: %u runs\n", runs);
+}
+
+void bench_append_replay() {
+    fake_flash::reset(kPartitionSize);
+    TelemetrySpool spool;
+    CHECK(spool.mount("spool"));
+
+    const uint32_t kCount = 5000;  // Fits without eviction
+    double start = now_us();
+    for (uint32_t i = 0; i < kCount; i++) {
+        append(spool, i);
+    }
+    double append_us = now_us() - start;
+    uint64_t written = fake_flash::bytesWritten();
+
+    start = now_us();
+    std::vector<uint32_t> seqs = drain(spool);
+    double replay_us = now_us() - start;
+    CHECK_EQ(seqs.size(), kCount);
+
+    std::printf("bench: append %.2f M records/s, replay %.2f M records/s, "
+                "%.1f flash bytes per record\n",
+                kCount / append_us, kCount / replay_us, (double)written / kCount);
+}
+
+}  // namespace
+
+int main() {
+    test_replay_after_commit();
+    test_batches_in_flight();
+    test_foreign_record_size();
+    test_wraparound();
+    test_torn_frame();
+    test_torn_sector_header();
+    test_power_cut_sweep();
+    bench_append_replay();
+    return test_result("spool_test");
+}
@@ -0,0 +1,106 @@
+#ifndef HOST_TELEMETRY_SAMPLES_H
+#define HOST_TELEMETRY_SAMPLES_H
+
+#include "telemetry_record.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Deterministic telemetry for the encoder tests and benchmarks
+ */
+
+// Small xorshift generator, same sequence on every host
+class SampleRandom {
+public:
+    explicit SampleRandom(uint32_t seed) : state_(seed ? seed : 1) {}
+
+    uint32_t next() {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 17;
+        state_ ^= state_ << 5;
+        return state_;
+    }
+
+    // Uniform in [lo, hi]
+    int32_t range(int32_t lo, int32_t hi) {
+        return lo + (int32_t)(next() % (uint32_t)(hi - lo + 1));
+    }
+
+private:
+    uint32_t state_;
+};
+
+// A hallway sensor every 30 s: slowly drifting climate, sparse traffic,
+// fusion figures only while someone passed
+inline std::vector<Telemetry> sample_trace(size_t count, uint32_t seed = 1) {
+    SampleRandom rnd(seed);
+    std::vector<Telemetry> records;
+    records.reserve(count);
+    int32_t temperature = 2150;
+    int32_t humidity = 4020;
+    int32_t pressure = 1013250;
+    uint32_t occupancy = 0;
+    for (size_t i = 0; i < count; i++) {
+        temperature += rnd.range(-3, 3);
+        humidity += rnd.range(-5, 5);
+        pressure += rnd.range(-20, 20);
+        uint32_t entries = rnd.next() % 8 == 0 ? rnd.range(1, 3) : 0;
+        uint32_t exits = occupancy > 0 && rnd.next() % 6 == 0 ? 1 : 0;
+        occupancy = occupancy + entries - exits;
+        uint32_t fusion = Telemetry::FUSION_NONE;
+        if (entries > 0) {
+            fusion = (Telemetry::fusionQuality(rnd.range(80, 100), rnd.range(100, 400)) << 16) |
+                     Telemetry::fusionQuality(rnd.range(90, 100), rnd.range(0, 200));
+        }
+        Telemetry t = Telemetry::make(1717000000 + (int64_t)i * 30, temperature, humidity,
+                                      pressure, entries, entries, exits, occupancy, fusion);
+        t.seq = 5000 + (uint32_t)i;
+        records.push_back(t);
+    }
+    return records;
+}
+
+// Every field anywhere in its range, including the limits
+inline std::vector<Telemetry> random_records(size_t count, uint32_t seed) {
+    SampleRandom rnd(seed);
+    std::vector<Telemetry> records;
+    records.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        Telemetry t;
+        t.time_delta_s = (int32_t)rnd.next();
+        t.temperature_cc = (int16_t)rnd.next();
+        t.humidity_cpct = (uint16_t)rnd.next();
+        t.pressure_count = rnd.next();
+        t.flow = rnd.next();
+        t.fusion = rnd.next() % 4 == 0 ? Telemetry::FUSION_NONE : rnd.next();
+        t.seq = rnd.next();
+        switch (rnd.next() % 8) {
+        case 0:
+            t.temperature_cc = INT16_MIN;
+            t.humidity_cpct = UINT16_MAX;
+            t.pressure_count = UINT32_MAX;
+            t.flow = UINT32_MAX;
+            break;
+        case 1:
+            t.time_delta_s = INT32_MIN;
+            t.temperature_cc = INT16_MAX;
+            t.seq = UINT32_MAX;
+            break;
+        case 2:
+            t.time_delta_s = 0;
+            t.temperature_cc = 0;
+            t.humidity_cpct = 0;
+            t.pressure_count = 0;
+            t.flow = 0;
+            t.fusion = 0;
+            break;
+        default:
+            break;
+        }
+        records.push_back(t);
+    }
+    return records;
+}
+
+#endif // HOST_TELEMETRY_SAMPLES_H
@@ -0,0 +1,58 @@
+#ifndef HOST_TEST_UTIL_H
+#define HOST_TEST_UTIL_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+/**
+ * @brief Minimal check macros and timing for the host tests
+ *
+ * CHECK keeps going after a failure so one run reports every broken case.
+ * Tests build in Release, so assert() would compile away; use CHECK.
+ */
+
+inline int g_check_failures = 0;
+
+#define CHECK(cond)                                                              \
+    do {                                                                         \
+        if (!(cond)) {                                                           \
+            std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, \
+                         #cond);                                                 \
+            g_check_failures++;                                                  \
+        }                                                                        \
+    } while (0)
+
+#define CHECK_EQ(a, b)                                                           \
+    do {                                                                         \
+        long long check_a_ = (long long)(a);                                     \
+        long long check_b_ = (long long)(b);                                     \
+        if (check_a_ != check_b_) {                                              \
+            std::fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+                         __FILE__, __LINE__, #a, #b, check_a_, check_b_);        \
+            g_check_failures++;                                                  \
+        }                                                                        \
+    } while (0)
+
+// Exit code for main(): prints a summary line
+inline int test_result(const char* name) {
+    if (g_check_failures > 0) {
+        std::printf("%s: %d check(s) failed\n", name, g_check_failures);
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+inline double now_us() {
+    using namespace std::chrono;
+    return duration<double, std::micro>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Keeps the optimiser from dropping benchmark results
+template <typename T>
+inline void keep(const T& value) {
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+#endif // HOST_TEST_UTIL_H
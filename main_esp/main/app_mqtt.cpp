@@ -3,18 +3,31 @@
 #include "config.h"
 #include "wifi_config.h"
 #include "esp_mac.h"
+#include "device_shadow.h"
+#include "json_reader.h"
 #include "led_config.h"
+#include "led_config_json.h"
+#include "publish_window.h"
+#include "request_id_cache.h"
 #include "sensor_manager.h"
+#include "telemetry_cbor.h"
+#include "telemetry_compress.h"
+#include "telemetry_json.h"
+#include "trace_recorder.h"
 
 #include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <string>
+#include <sys/time.h>
+#include <time.h>
 
-#include "cJSON.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/task.h"
 #include "mqtt_client.h"
 
@@ -22,8 +35,20 @@
 #define MQTT_PASSWORD ""
 
 #define SEND_INTERVAL_MS                                                       \
-  (30 * 1000) // Check and send every 30 seconds (matches telemetry generation)
-#define BATCH_SIZE 50
+  (30 * 1000) // Idle poll interval (matches telemetry generation)
+
+#define CMD_MAX_LEN 2048 // Largest accepted command, after reassembly
+#define CMD_POOL_SIZE 4  // Commands buffered while the worker is busy
+
+#define RPC_MAX_ID_LEN 64 // Longer ids are rejected as malformed
+#define RPC_RESPONSE_MAX_LEN                                                   \
+  (LED_CONFIG_JSON_MAX_LEN + 2 * RPC_MAX_ID_LEN + 128) // Envelope + result
+
+// Link quality thresholds for the publish scheduler
+#define LINK_RSSI_FAIR_DBM (-67)
+#define LINK_RSSI_POOR_DBM (-77)
+#define LINK_RTT_FAIR_US (500 * 1000)
+#define LINK_RTT_POOR_US (2000 * 1000)
 
 static const char *TAG = "app_mqtt";
 
@@ -33,7 +58,45 @@ static esp_mqtt_client_handle_t mqtt_client = NULL;
 static std::string topic_telemetry;
 static std::string topic_status;
 static std::string topic_cmd;
+static std::string topic_resp;
+static std::string topic_attributes;
 static std::string topic_config;
+static std::string topic_trace;
+
+// MQTT events forwarded from the MQTT task to the publisher
+enum PublishEventType : uint8_t {
+  PUBLISH_EVENT_CONNECTED,
+  PUBLISH_EVENT_DISCONNECTED,
+  PUBLISH_EVENT_ACK,
+  PUBLISH_EVENT_SHADOW, // Reported state changed
+};
+
+struct PublishEvent {
+  PublishEventType type;
+  int msg_id;
+  int64_t time_us; // When the event was received, for ack latency
+};
+
+static QueueHandle_t s_publish_events = NULL;
+
+// Telemetry batches awaiting PUBACK (owned by the mqtt_pub task)
+static PublishWindow s_window;
+static_assert(SensorManager::MAX_BATCHES_TAKEN >= PublishWindow::kMaxSlots,
+              "Every window slot must be able to take a batch");
+
+enum LinkQuality : uint8_t { LINK_GOOD, LINK_FAIR, LINK_POOR };
+
+// Written by the mqtt_pub task only, read field by field for diagnostics
+static app_mqtt_publish_stats_t s_stats;
+
+// Connection setup cost, written by the MQTT task only
+static app_mqtt_connect_stats_t s_connect_stats;
+static uint64_t s_connect_total_ms = 0;
+static int64_t s_connect_start_us = 0;  // Last MQTT_EVENT_BEFORE_CONNECT
+static int64_t s_disconnected_us = 0;   // Last MQTT_EVENT_DISCONNECTED
+
+static bool s_started = false;
+static TaskHandle_t s_publishing_task = NULL;
 
 // Embed certificates
 extern const uint8_t root_ca_pem_start[] asm("_binary_AmazonRootCA1_pem_start");
@@ -45,6 +108,510 @@ extern const uint8_t private_key_pem_end[] asm("_binary_private_pem_key_end");
 
 extern "C" {
 
+static const char *telemetry_format_name(uint8_t format) {
+  return format == TELEMETRY_FORMAT_CBOR ? "cbor" : "json";
+}
+
+static const char *telemetry_compression_name(uint8_t compression) {
+  return compression == TELEMETRY_COMPRESSION_LZ4 ? "lz4" : "none";
+}
+
+// Retained online status; also tells consumers how telemetry is encoded
+static void publish_online_status(esp_mqtt_client_handle_t client) {
+  const LEDConfig &cfg = LEDConfigManager::getInstance().getConfig();
+  char status[96];
+  snprintf(status, sizeof(status),
+           "{\"state\":\"online\",\"telemetryFormat\":\"%s\","
+           "\"telemetryCompression\":\"%s\"}",
+           telemetry_format_name(cfg.telemetry_format),
+           telemetry_compression_name(cfg.telemetry_compression));
+  esp_mqtt_client_publish(client, topic_status.c_str(), status, 0, 1, 1);
+}
+
+static void post_publish_event(PublishEventType type, int msg_id) {
+  PublishEvent ev = {type, msg_id, esp_timer_get_time()};
+  // A lost ack only costs a retransmit, so never block the MQTT task
+  if (s_publish_events &&
+      xQueueSend(s_publish_events, &ev, 0) != pdTRUE) {
+    ESP_LOGW(TAG, "Publish event queue full, dropping event %d", (int)type);
+  }
+}
+
+// RPC outcome, reported as "status" on the response topic
+enum CommandStatus : uint8_t {
+  CMD_STATUS_OK,
+  CMD_STATUS_INVALID,   // Handler rejected the payload
+  CMD_STATUS_MALFORMED, // Not a well-formed command
+  CMD_STATUS_EXPIRED,   // Deadline passed before it could run
+  CMD_STATUS_DUPLICATE, // Request id already handled
+  CMD_STATUS_UNKNOWN,   // No handler for the type
+  CMD_STATUS_FAILED,    // Handler could not complete
+};
+
+static const char *command_status_name(CommandStatus status) {
+  switch (status) {
+  case CMD_STATUS_OK:
+    return "ok";
+  case CMD_STATUS_INVALID:
+    return "invalid";
+  case CMD_STATUS_MALFORMED:
+    return "malformed";
+  case CMD_STATUS_EXPIRED:
+    return "expired";
+  case CMD_STATUS_DUPLICATE:
+    return "duplicate";
+  case CMD_STATUS_FAILED:
+    return "failed";
+  default:
+    return "unknown";
+  }
+}
+
+// JSON value a handler returns as "result"; nothing written means null
+struct CommandReply {
+  char *data;
+  size_t capacity;
+  size_t len;
+};
+
+// Shared by SET_CONFIG and app_mqtt_apply_config_json
+static bool apply_config_json(const char *json, size_t len,
+                              LEDConfigDecodeResult *out) {
+  const LEDConfig &current = LEDConfigManager::getInstance().getConfig();
+  LEDConfig new_config = current;
+  LEDConfigDecodeResult result = led_config_json_decode(json, len, new_config);
+  *out = result;
+  if (!result.ok) {
+    ESP_LOGW(TAG, "Config update is not a JSON object");
+    return false;
+  }
+  if (result.rejected > 0) {
+    ESP_LOGW(TAG, "Config update: %u invalid field(s) ignored",
+             result.rejected);
+  }
+
+  bool format_changed =
+      new_config.telemetry_format != current.telemetry_format ||
+      new_config.telemetry_compression != current.telemetry_compression;
+
+  LEDConfigManager::getInstance().setConfig(new_config);
+  DeviceShadow::setConfig(new_config);
+  ESP_LOGI(TAG, "Configuration updated (%u field(s))", result.applied);
+
+  if (format_changed && mqtt_client) {
+    // Re-advertise so consumers decode the next batch correctly
+    publish_online_status(mqtt_client);
+  }
+  return true;
+}
+
+// Command handlers run on the command worker task. payload is the raw
+// text of the command's "payload" member, or NULL when absent.
+
+static CommandStatus handle_set_config(const char *payload, size_t len,
+                                       CommandReply *reply) {
+  if (!payload) {
+    ESP_LOGW(TAG, "SET_CONFIG without payload");
+    return CMD_STATUS_INVALID;
+  }
+  LEDConfigDecodeResult result;
+  if (!apply_config_json(payload, len, &result)) {
+    return CMD_STATUS_INVALID;
+  }
+  int n = snprintf(reply->data, reply->capacity,
+                   "{\"applied\":%u,\"rejected\":%u}", result.applied,
+                   result.rejected);
+  reply->len = (n > 0 && (size_t)n < reply->capacity) ? (size_t)n : 0;
+  return CMD_STATUS_OK;
+}
+
+static CommandStatus handle_get_config(const char *payload, size_t len,
+                                       CommandReply *reply) {
+  reply->len = led_config_json_encode(
+      reply->data, reply->capacity,
+      LEDConfigManager::getInstance().getConfig());
+  return reply->len > 0 ? CMD_STATUS_OK : CMD_STATUS_INVALID;
+}
+
+static CommandStatus handle_get_attributes(const char *payload, size_t len,
+                                           CommandReply *reply) {
+  // The snapshot itself goes out on the attributes topic
+  DeviceShadow::requestFull();
+  return CMD_STATUS_OK;
+}
+
+// DUMP_TRACE: the presence trace goes out on the /trace topic at QoS 1,
+// split into messages of a 4-byte little-endian byte offset followed by up
+// to TRACE_MQTT_CHUNK_BYTES of the dump (see trace_record.h)
+struct TraceUpload {
+  uint8_t data[4 + TRACE_MQTT_CHUNK_BYTES];
+  size_t fill; // Dump bytes in data, after the offset
+  uint32_t offset;
+  uint32_t messages;
+};
+
+static bool flush_trace_upload(TraceUpload *upload) {
+  uint32_t offset = upload->offset;
+  memcpy(upload->data, &offset, sizeof(offset));
+  int msg_id = esp_mqtt_client_publish(mqtt_client, topic_trace.c_str(),
+                                       (const char *)upload->data,
+                                       (int)(4 + upload->fill), 1, 0);
+  if (msg_id == -1) {
+    ESP_LOGW(TAG, "Failed to publish trace at offset %lu",
+             (unsigned long)offset);
+    return false;
+  }
+  upload->offset += upload->fill;
+  upload->fill = 0;
+  upload->messages++;
+  return true;
+}
+
+static bool write_trace_upload(const void *data, size_t len, void *arg) {
+  TraceUpload *upload = static_cast<TraceUpload *>(arg);
+  const uint8_t *bytes = static_cast<const uint8_t *>(data);
+  while (len > 0) {
+    size_t n = TRACE_MQTT_CHUNK_BYTES - upload->fill;
+    if (n > len)
+      n = len;
+    memcpy(upload->data + 4 + upload->fill, bytes, n);
+    upload->fill += n;
+    bytes += n;
+    len -= n;
+    if (upload->fill == TRACE_MQTT_CHUNK_BYTES && !flush_trace_upload(upload))
+      return false;
+  }
+  return true;
+}
+
+static CommandStatus handle_dump_trace(const char *payload, size_t len,
+                                       CommandReply *reply) {
+  // Worker task only; keeps it off the stack
+  static TraceUpload upload;
+  upload.fill = 0;
+  upload.offset = 0;
+  upload.messages = 0;
+  bool ok = TraceRecorder::dump(write_trace_upload, &upload) &&
+            (upload.fill == 0 || flush_trace_upload(&upload));
+  int n = snprintf(reply->data, reply->capacity,
+                   "{\"bytes\":%lu,\"messages\":%lu}",
+                   (unsigned long)(upload.offset + upload.fill),
+                   (unsigned long)upload.messages);
+  reply->len = (n > 0 && (size_t)n < reply->capacity) ? (size_t)n : 0;
+  return ok ? CMD_STATUS_OK : CMD_STATUS_FAILED;
+}
+
+typedef CommandStatus (*command_handler_t)(const char *payload, size_t len,
+                                           CommandReply *reply);
+
+struct CommandEntry {
+  const char *type;
+  command_handler_t handler;
+  bool legacy_reply; // Without an id, the result goes to the /config topic
+  // Latency metrics, written by the worker only
+  uint32_t count;
+  uint32_t max_wait_us; // Received on the MQTT task -> dispatched
+  uint32_t max_exec_us; // Parse + handler
+  uint64_t total_exec_us;
+};
+
+static CommandEntry s_commands[] = {
+    {"SET_CONFIG", handle_set_config, false, 0, 0, 0, 0},
+    {"GET_CONFIG", handle_get_config, true, 0, 0, 0, 0},
+    {"GET_ATTRIBUTES", handle_get_attributes, false, 0, 0, 0, 0},
+    {"DUMP_TRACE", handle_dump_trace, false, 0, 0, 0, 0},
+};
+
+static_assert(sizeof(s_commands) / sizeof(s_commands[0]) <=
+                  APP_MQTT_MAX_COMMAND_TYPES,
+              "Raise APP_MQTT_MAX_COMMAND_TYPES");
+
+// Command arena: a fixed pool of buffers carved out of one static block.
+// Indices circulate between two queues, so the MQTT task never allocates,
+// memory use is bounded and the worker gets the filled buffer without a
+// copy. A message is reassembled in place from its fragments.
+struct CommandBuffer {
+  int64_t received_us;
+  uint16_t len;
+  char data[CMD_MAX_LEN];
+};
+
+static CommandBuffer s_cmd_pool[CMD_POOL_SIZE];
+static QueueHandle_t s_cmd_free = NULL;    // Indices of free buffers
+static QueueHandle_t s_cmd_pending = NULL; // Indices awaiting the worker
+
+// Message being reassembled (MQTT task only)
+struct CommandAssembly {
+  int index;         // Buffer being filled, -1 when idle
+  uint16_t total;    // total_data_len of the message
+  uint16_t received; // Bytes copied so far
+};
+
+static CommandAssembly s_assembly = {-1, 0, 0};
+
+static uint32_t s_cmd_oversize = 0;  // Larger than CMD_MAX_LEN
+static uint32_t s_cmd_busy = 0;      // All buffers in use
+static uint32_t s_cmd_abandoned = 0; // Fragments stopped arriving
+static uint32_t s_cmd_unknown = 0;
+static uint32_t s_cmd_expired = 0;
+static uint32_t s_cmd_duplicate = 0;
+
+// Ids of recently accepted requests (worker task only)
+static RequestIdCache s_recent_ids;
+
+// Drop a partially received message and return its buffer
+static void abandon_command_assembly(void) {
+  if (s_assembly.index < 0) {
+    return;
+  }
+  uint8_t index = (uint8_t)s_assembly.index;
+  s_cmd_abandoned++;
+  ESP_LOGW(TAG, "Command abandoned after %u of %u bytes",
+           s_assembly.received, s_assembly.total);
+  xQueueSend(s_cmd_free, &index, 0);
+  s_assembly.index = -1;
+}
+
+// Called on the MQTT task for every MQTT_EVENT_DATA. The client delivers
+// messages larger than its buffer as several events; only the first one
+// carries the topic, all carry total_data_len and current_data_offset.
+static void on_command_data(esp_mqtt_event_handle_t event) {
+  if (event->current_data_offset == 0) {
+    // A new message starts, so any previous one is not coming back
+    abandon_command_assembly();
+
+    bool is_cmd = event->topic_len == (int)topic_cmd.size() &&
+                  strncmp(event->topic, topic_cmd.c_str(),
+                          event->topic_len) == 0;
+    if (!is_cmd || event->total_data_len <= 0) {
+      return;
+    }
+    if (event->total_data_len > CMD_MAX_LEN) {
+      s_cmd_oversize++;
+      ESP_LOGW(TAG, "Command of %d bytes rejected (max %d)",
+               event->total_data_len, CMD_MAX_LEN);
+      return;
+    }
+
+    uint8_t index;
+    if (xQueueReceive(s_cmd_free, &index, 0) != pdTRUE) {
+      s_cmd_busy++;
+      ESP_LOGW(TAG, "Command worker busy, command dropped");
+      return;
+    }
+    s_cmd_pool[index].received_us = esp_timer_get_time();
+    s_assembly.index = index;
+    s_assembly.total = (uint16_t)event->total_data_len;
+    s_assembly.received = 0;
+  } else if (s_assembly.index < 0) {
+    // Continuation of a message we are not keeping
+    return;
+  }
+
+  if (event->current_data_offset != s_assembly.received ||
+      event->data_len > s_assembly.total - s_assembly.received) {
+    abandon_command_assembly();
+    return;
+  }
+
+  CommandBuffer &buf = s_cmd_pool[s_assembly.index];
+  memcpy(buf.data + s_assembly.received, event->data, event->data_len);
+  s_assembly.received += (uint16_t)event->data_len;
+
+  if (s_assembly.received == s_assembly.total) {
+    uint8_t index = (uint8_t)s_assembly.index;
+    buf.len = s_assembly.total;
+    s_assembly.index = -1;
+    xQueueSend(s_cmd_pending, &index, 0);
+  }
+}
+
+// Envelope of a command, as spans of the command buffer
+struct CommandRequest {
+  JsonSpan id;          // Correlation id; data is NULL when absent
+  JsonSpan type;
+  JsonSpan payload;
+  int64_t deadline_ms;  // Unix time in ms, 0 when absent
+  uint32_t ttl_ms;      // Relative to arrival on the device, 0 when absent
+};
+
+// Commands look like
+//   {"id":"42","type":"SET_CONFIG","deadline":1700000000000,"payload":{...}}
+// where id, deadline (or ttlMs) and payload are optional. The buffer is read
+// in place; handlers get the payload as a span of it.
+static bool parse_command(const char *json, size_t len, CommandRequest *req) {
+  JsonReader reader(json, len);
+  JsonSpan key;
+  double number;
+  memset(req, 0, sizeof(*req));
+
+  if (reader.beginObject()) {
+    while (reader.nextMember(&key)) {
+      if (key.equals("id") && reader.peekType() == '"') {
+        reader.readString(&req->id);
+      } else if (key.equals("type") && reader.peekType() == '"') {
+        reader.readString(&req->type);
+      } else if (key.equals("payload")) {
+        reader.readRaw(&req->payload);
+      } else if (key.equals("deadline") && reader.peekType() == '0') {
+        if (reader.readNumber(&number) && number > 0)
+          req->deadline_ms = (int64_t)number;
+      } else if (key.equals("ttlMs") && reader.peekType() == '0') {
+        if (reader.readNumber(&number) && number > 0)
+          req->ttl_ms = number < UINT32_MAX ? (uint32_t)number : UINT32_MAX;
+      } else {
+        reader.skipValue();
+      }
+    }
+  }
+  if (req->id.len > RPC_MAX_ID_LEN) {
+    // Too long to echo back, so the response could not be correlated
+    req->id.data = NULL;
+    return false;
+  }
+  return reader.ok() && reader.atEnd() && req->type.data;
+}
+
+static bool command_expired(const CommandRequest &req, int64_t received_us,
+                            int64_t now_us) {
+  if (req.ttl_ms && now_us - received_us > (int64_t)req.ttl_ms * 1000) {
+    return true;
+  }
+  // Absolute deadlines need a synced clock; before that they are not enforced
+  if (req.deadline_ms &&
+      (xEventGroupGetBits(s_app_event_group) & TIME_SYNCED_BIT)) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    int64_t now_ms = (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    return now_ms > req.deadline_ms;
+  }
+  return false;
+}
+
+static CommandEntry *find_command(const JsonSpan &type) {
+  for (CommandEntry &entry : s_commands) {
+    if (type.equals(entry.type)) {
+      return &entry;
+    }
+  }
+  return NULL;
+}
+
+// {"id":..,"type":..,"status":..,"execUs":..,"result":..} on /resp, QoS 1.
+// The id is echoed verbatim: it was a valid JSON string in the request.
+static void publish_response(const CommandRequest &req, CommandStatus status,
+                             const CommandReply &reply, uint32_t exec_us) {
+  // Worker task only; keeps it off the stack
+  static char response[RPC_RESPONSE_MAX_LEN];
+  int n = snprintf(response, sizeof(response),
+                   "{\"id\":\"%.*s\",\"type\":\"%.*s\",\"status\":\"%s\","
+                   "\"execUs\":%lu,\"result\":",
+                   (int)req.id.len, req.id.data, (int)req.type.len,
+                   req.type.data ? req.type.data : "",
+                   command_status_name(status), (unsigned long)exec_us);
+  if (n <= 0 || (size_t)n >= sizeof(response)) {
+    ESP_LOGE(TAG, "RPC response header does not fit");
+    return;
+  }
+  size_t len = (size_t)n;
+  const char *result = reply.len ? reply.data : "null";
+  size_t result_len = reply.len ? reply.len : 4;
+  if (len + result_len + 1 > sizeof(response)) {
+    ESP_LOGE(TAG, "RPC result of %d bytes does not fit", (int)result_len);
+    return;
+  }
+  memcpy(response + len, result, result_len);
+  len += result_len;
+  response[len++] = '}';
+
+  esp_mqtt_client_publish(mqtt_client, topic_resp.c_str(), response, (int)len,
+                          1, 0);
+}
+
+static void command_worker_task(void *pvParameters) {
+  static char result[LED_CONFIG_JSON_MAX_LEN];
+  uint8_t index;
+  while (1) {
+    if (xQueueReceive(s_cmd_pending, &index, portMAX_DELAY) != pdTRUE)
+      continue;
+
+    CommandBuffer &buf = s_cmd_pool[index];
+    int64_t start_us = esp_timer_get_time();
+    int64_t wait_us = start_us - buf.received_us;
+
+    // Cheap rejections first, so a stale or repeated request never
+    // reaches its handler
+    CommandRequest req;
+    CommandReply reply = {result, sizeof(result), 0};
+    CommandEntry *entry = NULL;
+    CommandStatus status;
+    if (!parse_command(buf.data, buf.len, &req)) {
+      ESP_LOGW(TAG, "Malformed command");
+      status = CMD_STATUS_MALFORMED;
+    } else if (command_expired(req, buf.received_us, start_us)) {
+      s_cmd_expired++;
+      ESP_LOGW(TAG, "Command %.*s expired", (int)req.id.len, req.id.data);
+      status = CMD_STATUS_EXPIRED;
+    } else if (req.id.data &&
+               s_recent_ids.checkAndInsert(req.id.data, req.id.len)) {
+      s_cmd_duplicate++;
+      ESP_LOGW(TAG, "Duplicate command %.*s", (int)req.id.len, req.id.data);
+      status = CMD_STATUS_DUPLICATE;
+    } else if ((entry = find_command(req.type)) == NULL) {
+      s_cmd_unknown++;
+      ESP_LOGW(TAG, "Unknown command type: %.*s", (int)req.type.len,
+               req.type.data);
+      status = CMD_STATUS_UNKNOWN;
+    } else {
+      status = entry->handler(req.payload.data, req.payload.len, &reply);
+    }
+    uint32_t exec_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    // Spans point into the buffer, so respond before releasing it
+    if (req.id.data) {
+      publish_response(req, status, reply, exec_us);
+    } else if (entry && entry->legacy_reply && reply.len > 0) {
+      esp_mqtt_client_publish(mqtt_client, topic_config.c_str(), reply.data,
+                              (int)reply.len, 1, 0);
+    }
+    xQueueSend(s_cmd_free, &index, 0);
+
+    if (entry) {
+      entry->count++;
+      entry->total_exec_us += exec_us;
+      if (exec_us > entry->max_exec_us)
+        entry->max_exec_us = exec_us;
+      if ((uint32_t)wait_us > entry->max_wait_us)
+        entry->max_wait_us = (uint32_t)wait_us;
+      ESP_LOGI(TAG, "%s %s in %lu us (queued %lu us)", entry->type,
+               command_status_name(status), (unsigned long)exec_us,
+               (unsigned long)wait_us);
+    }
+  }
+}
+
+// Time from the start of the attempt (TCP connect, TLS handshake, MQTT
+// CONNECT) to CONNACK, and from the last disconnect to being back online
+static void record_connect(bool session_present) {
+  int64_t now_us = esp_timer_get_time();
+  app_mqtt_connect_stats_t &st = s_connect_stats;
+  uint32_t connect_ms =
+      s_connect_start_us ? (uint32_t)((now_us - s_connect_start_us) / 1000) : 0;
+
+  st.connects++;
+  if (session_present)
+    st.sessions_resumed++;
+  st.last_connect_ms = connect_ms;
+  if (st.connects == 1 || connect_ms < st.min_connect_ms)
+    st.min_connect_ms = connect_ms;
+  if (connect_ms > st.max_connect_ms)
+    st.max_connect_ms = connect_ms;
+  s_connect_total_ms += connect_ms;
+  st.avg_connect_ms = (uint32_t)(s_connect_total_ms / st.connects);
+  st.last_offline_ms =
+      s_disconnected_us ? (uint32_t)((now_us - s_disconnected_us) / 1000) : 0;
+}
+
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
                                int32_t event_id, void *event_data) {
   ESP_LOGD(TAG,
@@ -54,179 +621,48 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
   esp_mqtt_client_handle_t client = event->client;
 
   switch ((esp_mqtt_event_id_t)event_id) {
-  case MQTT_EVENT_CONNECTED:
-    ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED");
+  case MQTT_EVENT_BEFORE_CONNECT:
+    s_connect_start_us = esp_timer_get_time();
+    s_connect_stats.attempts++;
+    break;
+
+  case MQTT_EVENT_CONNECTED: {
+    record_connect(event->session_present != 0);
+    ESP_LOGI(TAG, "MQTT_EVENT_CONNECTED in %lu ms (session %s)",
+             (unsigned long)s_connect_stats.last_connect_ms,
+             event->session_present ? "resumed" : "new");
     // Publish online status (Retained)
-    esp_mqtt_client_publish(client, topic_status.c_str(),
-                            "{\"state\":\"online\"}", 0, 1, 1);
+    publish_online_status(client);
 
-    // Subscribe to commands
-    esp_mqtt_client_subscribe(client, topic_cmd.c_str(), 1);
+    // A resumed session still holds the /cmd subscription, and the broker
+    // has queued any QoS 1 commands sent while we were away
+    if (!event->session_present) {
+      esp_mqtt_client_subscribe(client, topic_cmd.c_str(), 1);
+    }
+    post_publish_event(PUBLISH_EVENT_CONNECTED, -1);
     break;
+  }
 
   case MQTT_EVENT_DISCONNECTED:
     ESP_LOGI(TAG, "MQTT_EVENT_DISCONNECTED");
+    s_disconnected_us = esp_timer_get_time();
+    abandon_command_assembly();
+    post_publish_event(PUBLISH_EVENT_DISCONNECTED, -1);
     break;
 
   case MQTT_EVENT_PUBLISHED:
-    ESP_LOGI(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+    ESP_LOGD(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+    post_publish_event(PUBLISH_EVENT_ACK, event->msg_id);
     break;
 
   case MQTT_EVENT_DATA:
-    ESP_LOGI(TAG, "MQTT_EVENT_DATA");
-    // Log basic info
-    ESP_LOGI(TAG, "TOPIC=%.*s", event->topic_len, event->topic);
-    ESP_LOGI(TAG, "DATA=%.*s", event->data_len, event->data);
-
-    // Check if it is a command
-    if (event->topic_len > 0 &&
-        strncmp(event->topic, topic_cmd.c_str(), event->topic_len) == 0) {
-      ESP_LOGI(TAG, "Received command on CMD topic");
-
-      // Parse JSON command
-      char *json_str = (char *)malloc(event->data_len + 1);
-      if (json_str) {
-        memcpy(json_str, event->data, event->data_len);
-        json_str[event->data_len] = '\0';
-
-        cJSON *root = cJSON_Parse(json_str);
-        if (root) {
-          cJSON *type = cJSON_GetObjectItem(root, "type");
-
-          if (type && cJSON_IsString(type)) {
-            if (strcmp(type->valuestring, "SET_CONFIG") == 0) {
-              // Handle SET_CONFIG command
-              cJSON *payload = cJSON_GetObjectItem(root, "payload");
-              if (payload) {
-                LEDConfig new_config =
-                    LEDConfigManager::getInstance().getConfig();
-
-                // Parse humidity thresholds
-                cJSON *thresholds =
-                    cJSON_GetObjectItem(payload, "humidityThresholds");
-                if (thresholds && cJSON_IsArray(thresholds) &&
-                    cJSON_GetArraySize(thresholds) == 4) {
-                  for (int i = 0; i < 4; i++) {
-                    cJSON *item = cJSON_GetArrayItem(thresholds, i);
-                    if (cJSON_IsNumber(item)) {
-                      new_config.humidity_thresholds[i] =
-                          (float)item->valuedouble;
-                    }
-                  }
-                }
-
-                // Parse colors (hex strings like "FF0000")
-                cJSON *colors = cJSON_GetObjectItem(payload, "colors");
-                if (colors && cJSON_IsArray(colors) &&
-                    cJSON_GetArraySize(colors) == 3) {
-                  for (int i = 0; i < 3; i++) {
-                    cJSON *color_str = cJSON_GetArrayItem(colors, i);
-                    if (cJSON_IsString(color_str)) {
-                      unsigned int r, g, b;
-                      if (sscanf(color_str->valuestring, "%02X%02X%02X", &r, &g,
-                                 &b) == 3) {
-                        new_config.colors[i].r = (uint8_t)r;
-                        new_config.colors[i].g = (uint8_t)g;
-                        new_config.colors[i].b = (uint8_t)b;
-                      }
-                    }
-                  }
-                }
-
-                // Parse brightness settings
-                cJSON *brightness_pct =
-                    cJSON_GetObjectItem(payload, "brightnessPct");
-                if (brightness_pct && cJSON_IsNumber(brightness_pct)) {
-                  new_config.manual_brightness_pct =
-                      (uint8_t)brightness_pct->valueint;
-                }
-
-                cJSON *auto_brightness =
-                    cJSON_GetObjectItem(payload, "autobrightness");
-                if (auto_brightness && cJSON_IsBool(auto_brightness)) {
-                  new_config.auto_brightness = cJSON_IsTrue(auto_brightness);
-                }
-
-                // Parse number of LEDs to activate
-                cJSON *num_leds = cJSON_GetObjectItem(payload, "numLeds");
-                if (num_leds && cJSON_IsNumber(num_leds)) {
-                  uint8_t leds = (uint8_t)num_leds->valueint;
-                  // Clamp to valid range 1-WS2812B_NUM_LEDS
-                  if (leds >= 1 && leds <= WS2812B_NUM_LEDS) {
-                    new_config.num_leds_active = leds;
-                  }
-                }
-
-                // Parse LED timeout settings (in seconds, convert to ms)
-                cJSON *no_motion_timeout =
-                    cJSON_GetObjectItem(payload, "noMotionTimeoutSec");
-                if (no_motion_timeout && cJSON_IsNumber(no_motion_timeout)) {
-                  uint32_t timeout_sec = (uint32_t)no_motion_timeout->valueint;
-                  if (timeout_sec > 0 && timeout_sec <= 300) { // Max 5 minutes
-                    new_config.no_motion_timeout_ms = timeout_sec * 1000;
-                  }
-                }
-
-                cJSON *max_on_duration =
-                    cJSON_GetObjectItem(payload, "maxOnDurationSec");
-                if (max_on_duration && cJSON_IsNumber(max_on_duration)) {
-                  uint32_t duration_sec = (uint32_t)max_on_duration->valueint;
-                  if (duration_sec > 0 &&
-                      duration_sec <= 600) { // Max 10 minutes
-                    new_config.max_on_duration_ms = duration_sec * 1000;
-                  }
-                }
-
-                // Parse distance threshold (in cm)
-                cJSON *distance_threshold =
-                    cJSON_GetObjectItem(payload, "distanceThresholdCm");
-                if (distance_threshold && cJSON_IsNumber(distance_threshold)) {
-                  float threshold = (float)distance_threshold->valuedouble;
-                  if (threshold > 0.0f && threshold <= 400.0f) { // Max 4 meters
-                    new_config.distance_threshold_cm = threshold;
-                  }
-                }
-
-                // Apply configuration
-                LEDConfigManager::getInstance().setConfig(new_config);
-                ESP_LOGI(TAG, "LED configuration updated via MQTT");
-              }
-            } else if (strcmp(type->valuestring, "GET_CONFIG") == 0) {
-              // Handle GET_CONFIG command - publish current config
-              const LEDConfig &cfg =
-                  LEDConfigManager::getInstance().getConfig();
-
-              char response[512];
-              snprintf(
-                  response, sizeof(response),
-                  "{\"humidityThresholds\":[%.1f,%.1f,%.1f,%.1f],"
-                  "\"colors\":[\"%02X%02X%02X\",\"%02X%02X%02X\",\"%02X%02X%"
-                  "02X\"],"
-                  "\"brightnessPct\":%d,\"autobrightness\":%s,\"numLeds\":%d,"
-                  "\"noMotionTimeoutSec\":%lu,\"maxOnDurationSec\":%lu,"
-                  "\"distanceThresholdCm\":%.1f}",
-                  cfg.humidity_thresholds[0], cfg.humidity_thresholds[1],
-                  cfg.humidity_thresholds[2], cfg.humidity_thresholds[3],
-                  cfg.colors[0].r, cfg.colors[0].g, cfg.colors[0].b,
-                  cfg.colors[1].r, cfg.colors[1].g, cfg.colors[1].b,
-                  cfg.colors[2].r, cfg.colors[2].g, cfg.colors[2].b,
-                  cfg.manual_brightness_pct,
-                  cfg.auto_brightness ? "true" : "false", cfg.num_leds_active,
-                  (unsigned long)(cfg.no_motion_timeout_ms / 1000),
-                  (unsigned long)(cfg.max_on_duration_ms / 1000),
-                  cfg.distance_threshold_cm);
-
-              esp_mqtt_client_publish(client, topic_config.c_str(), response, 0,
-                                      1, 0);
-              ESP_LOGI(TAG, "Published current configuration");
-            }
-          }
-
-          cJSON_Delete(root);
-        }
-        free(json_str);
-      }
-    }
+    ESP_LOGD(TAG, "MQTT_EVENT_DATA, topic=%.*s, %d/%d bytes at %d",
+             event->topic_len, event->topic, event->data_len,
+             event->total_data_len, event->current_data_offset);
+
+    // Commands are handled on the worker task so NVS writes and JSON
+    // parsing never stall this one (keepalives, acks, inbound traffic)
+    on_command_data(event);
     break;
 
   case MQTT_EVENT_ERROR:
@@ -240,59 +676,262 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base,
   }
 }
 
+// Encode (and optionally compress) a window slot and publish it at QoS 1
+static bool publish_slot(PublishWindow::Slot *slot) {
+  // Sized for the worst case of either encoding, so it never needs to grow
+  static uint8_t payload[telemetry_json_max_len(PublishWindow::kBatchSize) >
+                                 telemetry_cbor_max_len(PublishWindow::kBatchSize)
+                             ? telemetry_json_max_len(PublishWindow::kBatchSize)
+                             : telemetry_cbor_max_len(PublishWindow::kBatchSize)];
+  static uint8_t compressed[telemetry_compress_bound(sizeof(payload))];
+
+  const LEDConfig &cfg = LEDConfigManager::getInstance().getConfig();
+  const TelemetryBatchInfo info = SensorManager::getInstance().batchInfo();
+  uint8_t format = cfg.telemetry_format;
+  size_t payload_len =
+      (format == TELEMETRY_FORMAT_CBOR)
+          ? telemetry_cbor_write(payload, sizeof(payload), slot->records,
+                                 slot->count, info)
+          : telemetry_json_write((char *)payload, sizeof(payload),
+                                 slot->records, slot->count, info);
+
+  const uint8_t *out = payload;
+  size_t out_len = payload_len;
+  if (cfg.telemetry_compression == TELEMETRY_COMPRESSION_LZ4) {
+    int64_t start_us = esp_timer_get_time();
+    size_t compressed_len =
+        telemetry_compress(payload, payload_len, compressed, sizeof(compressed));
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    // Sent uncompressed (no header) when it would not get smaller
+    if (compressed_len > 0) {
+      out = compressed;
+      out_len = compressed_len;
+    }
+    ESP_LOGI(TAG, "LZ4: %d -> %d bytes in %lld us", (int)payload_len,
+             (int)out_len, (long long)elapsed_us);
+  }
+
+  int msg_id = esp_mqtt_client_publish(mqtt_client, topic_telemetry.c_str(),
+                                       (const char *)out, (int)out_len, 1, 0);
+  if (msg_id == -1) {
+    ESP_LOGE(TAG, "Failed to publish message, keeping batch for retry");
+    s_window.markFailed(slot);
+    return false;
+  }
+
+  ESP_LOGI(TAG, "Published %s batch of %d items, length: %d, msg_id=%d%s",
+           telemetry_format_name(format), (int)slot->count, (int)out_len,
+           msg_id, slot->msg_id != -1 ? " (retransmit)" : "");
+  s_window.markSent(slot, msg_id, esp_timer_get_time());
+  return true;
+}
+
+static void handle_publish_event(const PublishEvent &ev, bool &mqtt_connected) {
+  switch (ev.type) {
+  case PUBLISH_EVENT_CONNECTED:
+    mqtt_connected = true;
+    // The broker keeps no shadow state, so start readers from a snapshot
+    DeviceShadow::requestFull();
+    break;
+
+  case PUBLISH_EVENT_DISCONNECTED:
+    mqtt_connected = false;
+    if (s_window.inFlight() > 0) {
+      ESP_LOGW(TAG, "Disconnected with %d batch(es) unacked, will resend",
+               (int)s_window.inFlight());
+    }
+    s_window.onDisconnect();
+    break;
+
+  case PUBLISH_EVENT_ACK: {
+    size_t released = s_window.onAck(ev.msg_id, ev.time_us);
+    if (released > 0) {
+      // Delivered records leave the queue (and the flash spool) in order,
+      // up to the oldest batch still waiting for its ack
+      uint32_t oldest_seq;
+      if (s_window.oldestUnacked(&oldest_seq)) {
+        SensorManager::getInstance().commitBefore(oldest_seq);
+      } else {
+        SensorManager::getInstance().commitAll();
+      }
+      ESP_LOGI(TAG,
+               "Batch acked, msg_id=%d, %d items, srtt %lld ms, window %d",
+               ev.msg_id, (int)released,
+               (long long)(s_window.smoothedRttUs() / 1000),
+               (int)s_window.windowSize());
+    }
+    break;
+  }
+
+  case PUBLISH_EVENT_SHADOW:
+    // Only wakes the task; the loop publishes once the window has passed
+    break;
+  }
+}
+
+static void on_shadow_dirty(void) {
+  post_publish_event(PUBLISH_EVENT_SHADOW, -1);
+}
+
+// Publish the changed shadow fields at QoS 1, not retained: a retained
+// delta would be meaningless to a late subscriber
+static void publish_shadow(void) {
+  static char shadow[DeviceShadow::MAX_JSON_LEN];
+  size_t len = DeviceShadow::encode(shadow, sizeof(shadow));
+  if (len == 0) {
+    return;
+  }
+  int msg_id = esp_mqtt_client_publish(
+      mqtt_client, topic_attributes.c_str(), shadow, (int)len, 1, 0);
+  if (msg_id == -1) {
+    // The delta is gone, so catch readers up with a snapshot instead
+    ESP_LOGW(TAG, "Failed to publish attributes, will send a snapshot");
+    DeviceShadow::requestFull();
+    return;
+  }
+  ESP_LOGD(TAG, "Attributes published: %.*s", (int)len, shadow);
+}
+
+static LinkQuality sample_link_quality(void) {
+  wifi_ap_record_t ap;
+  s_stats.rssi = esp_wifi_sta_get_ap_info(&ap) == ESP_OK ? ap.rssi : 0;
+
+  int64_t srtt_us = s_window.smoothedRttUs();
+  bool rssi_known = s_stats.rssi != 0;
+  if ((rssi_known && s_stats.rssi < LINK_RSSI_POOR_DBM) ||
+      srtt_us > LINK_RTT_POOR_US) {
+    return LINK_POOR;
+  }
+  if ((rssi_known && s_stats.rssi < LINK_RSSI_FAIR_DBM) ||
+      srtt_us > LINK_RTT_FAIR_US) {
+    return LINK_FAIR;
+  }
+  return LINK_GOOD;
+}
+
+// How long a partial batch may wait for more records. Every publish wakes
+// the radio and pays MQTT/TLS framing, so records are held to share one;
+// the worse the link, the more each publish costs and the longer they are
+// held. Twice the ack latency is reserved so delivery still fits the bound.
+static uint32_t publish_hold_s(LinkQuality link, uint32_t max_latency_s) {
+  uint32_t hold_s = link == LINK_GOOD   ? max_latency_s / 4
+                    : link == LINK_FAIR ? max_latency_s / 2
+                                        : max_latency_s;
+  uint32_t reserve_s = (uint32_t)(2 * s_window.smoothedRttUs() / 1000000) + 1;
+  return hold_s > reserve_s ? hold_s - reserve_s : 0;
+}
+
 static void mqtt_publishing_task(void *pvParameters) {
+  bool mqtt_connected = false;
+
   while (1) {
-    // Check connection (Time sync is optional)
-    EventBits_t bits = xEventGroupWaitBits(
-        s_app_event_group, WIFI_CONNECTED_BIT, pdFALSE,
-        pdTRUE, pdMS_TO_TICKS(1000));
-
-    if (bits & WIFI_CONNECTED_BIT) {
-      // Connected, drain the queue
-      while (!SensorManager::getInstance().empty()) {
-        std::vector<Telemetry> batch =
-            SensorManager::getInstance().popBatch(BATCH_SIZE);
-        if (batch.empty())
+    LinkQuality link = LINK_GOOD;
+    if (xEventGroupGetBits(s_app_event_group) & WIFI_CONNECTED_BIT) {
+      link = sample_link_quality();
+    }
+    uint32_t hold_s = publish_hold_s(
+        link,
+        LEDConfigManager::getInstance().getConfig().telemetry_max_latency_s);
+    // Even when idle, wake often enough to notice a record before it is due
+    int64_t next_flush_us = (int64_t)SEND_INTERVAL_MS * 1000;
+    if (hold_s < SEND_INTERVAL_MS / 1000) {
+      next_flush_us = (int64_t)(hold_s > 0 ? hold_s : 1) * 1000000;
+    }
+
+    size_t expired = s_window.checkTimeouts(esp_timer_get_time());
+    if (expired > 0) {
+      ESP_LOGW(TAG, "%d batch(es) not acked within %lld ms, window now %d",
+               (int)expired, (long long)(s_window.timeoutUs() / 1000),
+               (int)s_window.windowSize());
+    }
+
+    EventBits_t bits = xEventGroupGetBits(s_app_event_group);
+    if (mqtt_connected && (bits & WIFI_CONNECTED_BIT)) {
+      // Retransmissions go first, in their original order
+      bool ok = true;
+      while (PublishWindow::Slot *slot = s_window.nextPending()) {
+        if (!(ok = publish_slot(slot)))
           break;
+      }
 
-        // Create JSON array manually
-        std::string payload = "[";
-        // Reserve memory approx 180 bytes per item
-        payload.reserve(batch.size() * 180);
-
-        char buf[256];
-        for (size_t i = 0; i < batch.size(); ++i) {
-          const auto &item = batch[i];
-          snprintf(buf, sizeof(buf),
-                   "{\"timestamp\":%" PRIi64
-                   ",\"temperature\":%.1f,\"humidity\":%.1f,\"pressure\":%.1f,"
-                   "\"personCount\":%d}",
-                   item.timestamp, item.temperature, item.humidity,
-                   item.pressure, item.person_count);
-
-          payload += buf;
-          if (i < batch.size() - 1) {
-            payload += ",";
-          }
+      // Then fill the window with new batches: full ones (a backlog drains
+      // at window speed) or partial ones whose oldest record is due.
+      // A batch stays queued until the broker acks it; the slot keeps a
+      // copy to retransmit from.
+      while (ok && !SensorManager::getInstance().empty()) {
+        PublishWindow::Slot *slot = s_window.acquire();
+        if (!slot)
+          break;
+        slot->count = SensorManager::getInstance().peekBatch(
+            slot->records, PublishWindow::kBatchSize);
+        if (slot->count == 0) {
+          s_window.cancel(slot);
+          break;
         }
-        payload += "]";
 
-        ESP_LOGI(TAG, "Publishing batch of %d items, length: %d",
-                 (int)batch.size(), (int)payload.length());
+        int64_t age_s = (int64_t)time(NULL) - slot->records[0].timestamp();
+        if (age_s < 0)
+          age_s = 0;
+        bool full = slot->count == PublishWindow::kBatchSize;
+        if (!full && age_s < (int64_t)hold_s) {
+          // Only peeked, so the records stay queued until full or due
+          s_window.cancel(slot);
+          next_flush_us = ((int64_t)hold_s - age_s) * 1000000;
+          break;
+        }
 
-        int msg_id = esp_mqtt_client_publish(
-            mqtt_client, topic_telemetry.c_str(), payload.c_str(), 0, 1, 0);
-        if (msg_id == -1) {
-          ESP_LOGE(TAG, "Failed to publish message, requeueing batch");
-          SensorManager::getInstance().requeueBatch(batch);
+        if (!SensorManager::getInstance().takeBatch()) {
+          s_window.cancel(slot);
           break;
         }
+        if (full) {
+          s_stats.flushes_full++;
+        } else {
+          s_stats.flushes_due++;
+        }
+        s_stats.batches_sent++;
+        s_stats.records_sent += slot->count;
+        s_stats.last_age_s = (uint32_t)age_s;
+        if (s_stats.last_age_s > s_stats.max_age_s) {
+          s_stats.max_age_s = s_stats.last_age_s;
+        }
+        ok = publish_slot(slot);
+      }
+    }
 
-        vTaskDelay(pdMS_TO_TICKS(100));
+    s_stats.queued = (uint32_t)SensorManager::getInstance().size();
+    s_stats.link_quality = link;
+    s_stats.window_size = (uint8_t)s_window.windowSize();
+    s_stats.in_flight = (uint8_t)s_window.inFlight();
+    s_stats.ack_latency_ms = (uint32_t)(s_window.smoothedRttUs() / 1000);
+    s_stats.hold_s = hold_s;
+    s_stats.retransmits = s_window.retransmitCount();
+    DeviceShadow::setLink(s_stats.rssi, s_stats.queued);
+
+    // Coalesce shadow changes over a short window into one message
+    int64_t shadow_since_us = DeviceShadow::dirtySinceUs();
+    if (mqtt_connected && shadow_since_us != 0) {
+      int64_t shadow_due_us =
+          shadow_since_us + DeviceShadow::COALESCE_US - esp_timer_get_time();
+      if (shadow_due_us <= 0) {
+        publish_shadow();
+      } else if (shadow_due_us < next_flush_us) {
+        next_flush_us = shadow_due_us;
       }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(SEND_INTERVAL_MS));
+    // Sleep until an MQTT event, the next ack timeout or the next flush
+    // (telemetry or shadow)
+    int64_t wait_us = s_window.timeUntilNextTimeout(esp_timer_get_time());
+    if (wait_us < 0 || wait_us > next_flush_us)
+      wait_us = next_flush_us;
+    TickType_t wait = pdMS_TO_TICKS(wait_us / 1000) + 1;
+    PublishEvent ev;
+    if (xQueueReceive(s_publish_events, &ev, wait) == pdTRUE) {
+      do {
+        handle_publish_event(ev, mqtt_connected);
+      } while (xQueueReceive(s_publish_events, &ev, 0) == pdTRUE);
+    }
   }
 }
 
@@ -314,12 +953,18 @@ void app_mqtt_init(void) {
   topic_telemetry = base_topic + MQTT_TOPIC_SUFFIX_TELEMETRY;
   topic_status = base_topic + MQTT_TOPIC_SUFFIX_STATUS;
   topic_cmd = base_topic + MQTT_TOPIC_SUFFIX_CMD;
+  topic_resp = base_topic + MQTT_TOPIC_SUFFIX_RESP;
+  topic_attributes = base_topic + MQTT_TOPIC_SUFFIX_ATTRIBUTES;
   topic_config = base_topic + "/config";
+  topic_trace = base_topic + MQTT_TOPIC_SUFFIX_TRACE;
 
   ESP_LOGI(TAG, "Telemetry Topic: %s", topic_telemetry.c_str());
   ESP_LOGI(TAG, "Status Topic: %s", topic_status.c_str());
   ESP_LOGI(TAG, "Command Topic: %s", topic_cmd.c_str());
+  ESP_LOGI(TAG, "Response Topic: %s", topic_resp.c_str());
+  ESP_LOGI(TAG, "Attributes Topic: %s", topic_attributes.c_str());
   ESP_LOGI(TAG, "Config Topic: %s", topic_config.c_str());
+  ESP_LOGI(TAG, "Trace Topic: %s", topic_trace.c_str());
 
   esp_mqtt_client_config_t mqtt_cfg = {};
 
@@ -346,11 +991,28 @@ void app_mqtt_init(void) {
   // Fix: Set Client ID (Static string)
   mqtt_cfg.credentials.client_id = mac_str;
 
+  // Persistent session: the broker keeps our subscription and queues QoS 1
+  // commands across reconnects (keyed by the fixed client id above), so a
+  // reconnect needs no SUBSCRIBE round trip and loses no commands
+  mqtt_cfg.session.disable_clean_session = true;
+
   // Debug: Validate Certs
   ESP_LOGI(TAG, "Root CA len: %d", strlen((const char *)root_ca_pem_start));
   ESP_LOGI(TAG, "Client Cert len: %d", strlen((const char *)client_cert_pem_start));
   ESP_LOGI(TAG, "Private Key len: %d", strlen((const char *)private_key_pem_start));
 
+  s_publish_events = xQueueCreate(16, sizeof(PublishEvent));
+
+  DeviceShadow::init(on_shadow_dirty);
+  DeviceShadow::setConfig(LEDConfigManager::getInstance().getConfig());
+
+  s_cmd_free = xQueueCreate(CMD_POOL_SIZE, sizeof(uint8_t));
+  s_cmd_pending = xQueueCreate(CMD_POOL_SIZE, sizeof(uint8_t));
+  for (uint8_t i = 0; i < CMD_POOL_SIZE; i++) {
+    xQueueSend(s_cmd_free, &i, 0);
+  }
+  xTaskCreate(command_worker_task, "mqtt_cmd", 4096, NULL, 5, NULL);
+
   mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
   esp_mqtt_client_register_event(mqtt_client,
                                  (esp_mqtt_event_id_t)ESP_EVENT_ANY_ID,
@@ -358,24 +1020,74 @@ void app_mqtt_init(void) {
 }
 
 void app_mqtt_start(void) {
-  if (mqtt_client) {
+  // Once started, the client reconnects by itself (reusing its session),
+  // so a WiFi drop must not start it again
+  if (mqtt_client && !s_started) {
     // Wait for Time Sync before connecting (crucial for AWS TLS)
     ESP_LOGI(TAG, "Waiting for Time Sync...");
     xEventGroupWaitBits(s_app_event_group, TIME_SYNCED_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(20000));
     ESP_LOGI(TAG, "Time Synced (or timeout), starting MQTT...");
 
-    esp_mqtt_client_start(mqtt_client);
+    if (esp_mqtt_client_start(mqtt_client) == ESP_OK) {
+      s_started = true;
+    }
   }
 }
 
 void app_mqtt_stop(void) {
-  if (mqtt_client) {
+  if (mqtt_client && s_started) {
     esp_mqtt_client_stop(mqtt_client);
+    s_started = false;
+    // Stopping does not emit MQTT_EVENT_DISCONNECTED
+    post_publish_event(PUBLISH_EVENT_DISCONNECTED, -1);
   }
 }
 
 void app_mqtt_start_publishing_task(void) {
-  xTaskCreate(mqtt_publishing_task, "mqtt_pub", 4096, NULL, 5, NULL);
+  // Runs for the life of the firmware; it idles while disconnected
+  if (s_publishing_task == NULL) {
+    xTaskCreate(mqtt_publishing_task, "mqtt_pub", 4096, NULL, 5,
+                &s_publishing_task);
+  }
+}
+
+bool app_mqtt_apply_config_json(const char *json, size_t len) {
+  LEDConfigDecodeResult result;
+  return apply_config_json(json, len, &result);
+}
+
+void app_mqtt_get_publish_stats(app_mqtt_publish_stats_t *stats) {
+  if (stats) {
+    memcpy(stats, &s_stats, sizeof(*stats));
+  }
+}
+
+void app_mqtt_get_connect_stats(app_mqtt_connect_stats_t *stats) {
+  if (stats) {
+    memcpy(stats, &s_connect_stats, sizeof(*stats));
+  }
+}
+
+void app_mqtt_get_command_stats(app_mqtt_command_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+  stats->oversize = s_cmd_oversize;
+  stats->busy = s_cmd_busy;
+  stats->abandoned = s_cmd_abandoned;
+  stats->unknown = s_cmd_unknown;
+  stats->expired = s_cmd_expired;
+  stats->duplicate = s_cmd_duplicate;
+  stats->num_types = 0;
+  for (const CommandEntry &entry : s_commands) {
+    app_mqtt_command_latency_t &out = stats->types[stats->num_types++];
+    out.type = entry.type;
+    out.count = entry.count;
+    out.max_wait_us = entry.max_wait_us;
+    out.max_exec_us = entry.max_exec_us;
+    out.avg_exec_us =
+        entry.count ? (uint32_t)(entry.total_exec_us / entry.count) : 0;
+  }
 }
 
 } // extern "C"
@@ -1,10 +1,66 @@
 #ifndef APP_MQTT_H
 #define APP_MQTT_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Publish scheduler state and decisions, for diagnostics
+typedef struct {
+  uint32_t queued;           // Records waiting on the device (RAM + spool)
+  int8_t rssi;               // Last sampled WiFi RSSI in dBm, 0 if unknown
+  uint8_t link_quality;      // 0 good, 1 fair, 2 poor
+  uint8_t window_size;       // Batches allowed in flight
+  uint8_t in_flight;         // Batches awaiting PUBACK
+  uint32_t ack_latency_ms;   // Smoothed PUBACK latency
+  uint32_t hold_s;           // How long a partial batch may currently wait
+  uint32_t batches_sent;     // New batches (retransmits not included)
+  uint32_t records_sent;
+  uint32_t flushes_full;     // Batches sent because they were full
+  uint32_t flushes_due;      // Partial batches sent because their hold expired
+  uint32_t retransmits;
+  uint32_t last_age_s;       // Age of the oldest record in the last batch
+  uint32_t max_age_s;        // Largest last_age_s since boot
+} app_mqtt_publish_stats_t;
+
+// Cost of (re)connecting to the broker, for diagnostics
+typedef struct {
+  uint32_t attempts;          // Connection attempts started
+  uint32_t connects;          // Successful ones
+  uint32_t sessions_resumed;  // Broker still had our session
+  uint32_t last_connect_ms;   // TCP + TLS handshake + MQTT CONNECT
+  uint32_t min_connect_ms;
+  uint32_t max_connect_ms;
+  uint32_t avg_connect_ms;
+  uint32_t last_offline_ms;   // Last disconnect -> connected again
+} app_mqtt_connect_stats_t;
+
+#define APP_MQTT_MAX_COMMAND_TYPES 8
+
+// Per command type latency, from arrival on the MQTT task to completion
+typedef struct {
+  const char *type;
+  uint32_t count;
+  uint32_t max_wait_us;  // Queued before the worker picked it up
+  uint32_t max_exec_us;  // Parse + handler
+  uint32_t avg_exec_us;
+} app_mqtt_command_latency_t;
+
+typedef struct {
+  uint32_t oversize;   // Dropped: larger than the reassembly buffer
+  uint32_t busy;       // Dropped: all buffers in use
+  uint32_t abandoned;  // Dropped: fragments stopped arriving
+  uint32_t unknown;    // Parsed but no handler for the type
+  uint32_t expired;    // Rejected: deadline or ttlMs already passed
+  uint32_t duplicate;  // Rejected: request id seen recently
+  size_t num_types;
+  app_mqtt_command_latency_t types[APP_MQTT_MAX_COMMAND_TYPES];
+} app_mqtt_command_stats_t;
+
 void app_mqtt_init(void);
 
 void app_mqtt_start(void);
@@ -13,6 +69,22 @@ void app_mqtt_stop(void);
 
 void app_mqtt_start_publishing_task(void);
 
+/**
+ * @brief Decode a JSON config object (see led_config_json.h) and apply it
+ *
+ * Shared by MQTT SET_CONFIG and the HTTP API. Re-advertises the telemetry
+ * encoding on the status topic when it changes.
+ *
+ * @return false if the text is not a well-formed JSON object
+ */
+bool app_mqtt_apply_config_json(const char *json, size_t len);
+
+void app_mqtt_get_publish_stats(app_mqtt_publish_stats_t *stats);
+
+void app_mqtt_get_connect_stats(app_mqtt_connect_stats_t *stats);
+
+void app_mqtt_get_command_stats(app_mqtt_command_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,11 +13,32 @@
 // Konfiguracja WS2812B (NeoPixel)
 #define WS2812B_GPIO GPIO_NUM_4 // D4 pin
 #define WS2812B_NUM_LEDS 5
+#define WS2812B_MAX_FPS 50 // Refreshes beyond this are merged into one frame
+// White balance: per-channel gain before gamma, 255 = unchanged
+#define WS2812B_WHITE_BALANCE_R 255
+#define WS2812B_WHITE_BALANCE_G 255
+#define WS2812B_WHITE_BALANCE_B 255
+// Transitions, rendered by the LED flush task (callers do not wait)
+#define WS2812B_FADE_IN_MS 400   // Motion: off -> on
+#define WS2812B_FADE_OUT_MS 1500 // End of the LED session: on -> off
+#define WS2812B_FADE_MS 500      // Colour and brightness changes
 
 // Konfiguracja HC-SR04 Ultrasonic Distance Sensor
 #define HC_SR04_TRIG_GPIO GPIO_NUM_5  // D5 pin (Trigger)
 #define HC_SR04_ECHO_GPIO GPIO_NUM_18 // GPIO18 (Echo)
 
+// Presence sensors fitted (at least one). MotionDetector and FlowCounter run
+// on the HC-SR04 if fitted, else on the radar; both feed PresenceFusion
+#define PRESENCE_USE_HC_SR04 1
+#define PRESENCE_USE_RD01 0
+
+// Rd-01 radar on UART2 (radar TX -> GPIO16, radar RX <- GPIO17)
+#define RD01_UART_PORT UART_NUM_2
+#define RD01_TX_GPIO GPIO_NUM_17
+#define RD01_RX_GPIO GPIO_NUM_16
+#define RD01_BAUD_RATE 256000 // Factory default
+#define RD01_REPORT_WAIT_MS 250 // Radar as the only sensor: paces the loop
+
 // Konfiguracja przycisku do wejścia w tryb provisioning, BOOT button
 #define CONFIG_BUTTON_GPIO GPIO_NUM_0
 #define CONFIG_BUTTON_LONG_PRESS_MS 3000 // 3 sekundy naciśnięcia
@@ -34,6 +55,7 @@
 #define MQTT_TOPIC_SUFFIX_CMD "/cmd"
 #define MQTT_TOPIC_SUFFIX_RESP "/resp"
 #define MQTT_TOPIC_SUFFIX_ATTRIBUTES "/attributes"
+#define MQTT_TOPIC_SUFFIX_TRACE "/trace"
 
 // Sensor Configuration
 #define USE_REAL_PHOTORESISTOR 1         // Use real photoresistor on GPIO34
@@ -43,6 +65,64 @@
 #define LED_NO_MOTION_TIMEOUT_MS 15000 // Turn off after 15 seconds of no motion
 #define LED_MAX_DURATION_MS 300000     // Maximum 5 minutes on time
 
+// Presence detection (MotionDetector); the enter distance comes from LEDConfig
+#define MOTION_MEDIAN_WINDOW 5        // Samples; rejects up to 2 spurious echoes
+#define MOTION_EXIT_MARGIN_CM 10.0f   // Hysteresis above the enter distance
+#define MOTION_ENTER_DEBOUNCE_MS 100  // ~2 samples at the active rate
+#define MOTION_EXIT_DEBOUNCE_MS 1000
+#define MOTION_MIN_DWELL_MS 500
+
+// Entry/exit counting (FlowCounter); one HC-SR04 looking along the passage
+#define FLOW_SENSOR_CHANNELS 1        // 2 once a second sensor covers the doorway
+#define FLOW_MIN_TRAVEL_CM 15.0f      // Less net travel per visit: direction unknown
+#define FLOW_APPROACH_IS_ENTRY 1      // Sensor faces the door from inside the room
+#define FLOW_PAIR_WINDOW_MS 1500      // Two sensors: max gap between their triggers
+
+// Presence fusion (PresenceFusion): per source weight (0 = off), P(detect |
+// present), P(detect | absent), smoothing of its readings and how long
+// its last reading stays relevant
+#define FUSION_PRIOR 0.3f
+#define FUSION_ENTER_P 0.7f
+#define FUSION_EXIT_P 0.3f
+#define FUSION_ULTRASONIC_WEIGHT 1.0f
+#define FUSION_ULTRASONIC_HIT 0.70f    // Misses soft clothing and oblique bodies
+#define FUSION_ULTRASONIC_FALSE 0.05f
+#define FUSION_ULTRASONIC_SMOOTH_MS 0  // Already filtered by MotionDetector
+#define FUSION_ULTRASONIC_STALE_MS 1000
+#define FUSION_RADAR_WEIGHT 1.0f
+#define FUSION_RADAR_HIT 0.95f         // Also sees people standing still
+#define FUSION_RADAR_FALSE 0.10f       // Fans, curtains, pets
+#define FUSION_RADAR_SMOOTH_MS 500     // One missed report must not end presence
+#define FUSION_RADAR_STALE_MS 1000
+#define FUSION_LIGHT_WEIGHT 0.0f       // Off: daylight changes look like shadows
+#define FUSION_LIGHT_HIT 0.30f
+#define FUSION_LIGHT_FALSE 0.05f
+#define FUSION_LIGHT_SMOOTH_MS 500
+#define FUSION_LIGHT_STALE_MS 2000
+#define FUSION_LIGHT_DELTA_PCT 8       // Jump from the baseline counted as a shadow
+#define FUSION_LIGHT_BASELINE_ALPHA 0.02f // Per sample, LEDs off only
+
+// Presence sampling rate (SamplingScheduler): a continuous curve between
+// the two intervals, capped so that first detection after idle stays
+// within SAMPLING_MAX_LATENCY_MS
+#define SAMPLING_MIN_INTERVAL_MS 50     // Someone there, LEDs on, first hit
+#define SAMPLING_MAX_INTERVAL_MS 2000   // Empty at a quiet hour (latency caps it)
+#define SAMPLING_MAX_LATENCY_MS 1000
+#define SAMPLING_ATTACK_MS 300          // Median + enter debounce at the fast rate
+#define SAMPLING_RECENCY_MS 5000        // Stay quick for a while after someone left
+#define SAMPLING_LED_URGENCY 0.5f       // LEDs on: halfway (~190 ms) to catch returns
+#define SAMPLING_HISTORY_GAIN 2.0f      // Hour occupied half the time: full rate
+#define SAMPLING_HISTORY_ALPHA 0.3f     // Per day
+// Energy per sample for the estimate: HC-SR04 ~15 mA at 5 V for ~20 ms,
+// plus the CPU wake-up (~40 mA at 3.3 V for ~2 ms)
+#define SAMPLING_PING_ENERGY_UJ 1500
+#define SAMPLING_WAKE_ENERGY_UJ 250
+
+// Presence trace (TraceRecorder): 8 bytes per sample, ~100 s with someone
+// around, ~25 min when quiet. Dumped over HTTP or MQTT for trace_replay
+#define TRACE_CAPACITY 2048
+#define TRACE_MQTT_CHUNK_BYTES 512    // Payload per message after the 4-byte offset
+
 // Photoresistor (Light Sensor) Configuration
 #define PHOTORESISTOR_GPIO                                                     \
   GPIO_NUM_34 // ADC1_CHANNEL_6, input-only, WiFi-compatible
@@ -0,0 +1,302 @@
+#include "device_shadow.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* TAG = "DeviceShadow";
+
+namespace {
+    enum Field : uint32_t {
+        FIELD_CONFIG = 1u << 0,
+        FIELD_FIRMWARE = 1u << 1,
+        FIELD_LED = 1u << 2,
+        FIELD_RSSI = 1u << 3,
+        FIELD_QUEUED = 1u << 4,
+        FIELD_SENSOR_0 = 1u << 5,  // One bit per ShadowSensor from here
+    };
+    constexpr uint32_t kAllFields = (FIELD_SENSOR_0 << SHADOW_SENSOR_COUNT) - 1;
+    constexpr uint32_t kSensorFields = kAllFields & ~(FIELD_SENSOR_0 - 1);
+
+    enum class SensorState : uint8_t { Unknown, Ok, Failing };
+
+    constexpr const char* kSensorNames[SHADOW_SENSOR_COUNT] = {"distance", "climate", "pressure"};
+
+    struct LedState {
+        bool on;
+        RGBColor color;
+        uint8_t brightness_pct;
+    };
+
+    struct State {
+        LEDConfig config;
+        char firmware[32];
+        LedState led;
+        int8_t rssi;
+        uint32_t queued;
+        SensorState sensors[SHADOW_SENSOR_COUNT];
+        uint8_t failures[SHADOW_SENSOR_COUNT];  // Consecutive failed reads
+    };
+
+    SemaphoreHandle_t s_mutex = nullptr;
+    void (*s_on_dirty)(void) = nullptr;
+
+    State s_current;
+    State s_reported;  // As of the last encode()
+    uint32_t s_dirty = 0;
+    bool s_full = false;
+    int64_t s_dirty_since_us = 0;
+    uint32_t s_seq = 0;
+
+    // Call with the mutex held; returns true on the clean -> dirty transition
+    bool mark_dirty(uint32_t fields) {
+        bool was_clean = s_dirty == 0;
+        s_dirty |= fields;
+        if (was_clean && s_dirty != 0) {
+            s_dirty_since_us = esp_timer_get_time();
+            return true;
+        }
+        return false;
+    }
+
+    bool lock() {
+        if (s_mutex == nullptr) {
+            ESP_LOGE(TAG, "DeviceShadow not initialized!");
+            return false;
+        }
+        return xSemaphoreTake(s_mutex, portMAX_DELAY) == pdTRUE;
+    }
+
+    void unlock(bool notify) {
+        xSemaphoreGive(s_mutex);
+        if (notify && s_on_dirty) {
+            s_on_dirty();
+        }
+    }
+
+    const char* sensor_state_name(SensorState state) {
+        return state == SensorState::Ok        ? "ok"
+               : state == SensorState::Failing ? "failing"
+                                               : "unknown";
+    }
+
+    // Bounded snprintf appender; remembers overflow
+    struct Writer {
+        char* p;
+        char* end;
+        bool overflow;
+
+        void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+            va_list args;
+            va_start(args, fmt);
+            size_t room = (size_t)(end - p);
+            int n = vsnprintf(p, room, fmt, args);
+            va_end(args);
+            if (n < 0 || (size_t)n >= room) {
+                overflow = true;
+                p = end;
+            } else {
+                p += n;
+            }
+        }
+    };
+}
+
+void DeviceShadow::init(void (*on_dirty)(void)) {
+    if (s_mutex != nullptr) {
+        return;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (s_mutex == nullptr) {
+        ESP_LOGE(TAG, "Failed to create mutex!");
+        return;
+    }
+    s_on_dirty = on_dirty;
+    memset(&s_current, 0, sizeof(s_current));
+    s_reported = s_current;
+    ESP_LOGI(TAG, "DeviceShadow initialized");
+}
+
+void DeviceShadow::setConfig(const LEDConfig& config) {
+    if (!lock()) {
+        return;
+    }
+    s_current.config = config;
+    // Compared field by field when encoding
+    bool notify = mark_dirty(FIELD_CONFIG);
+    unlock(notify);
+}
+
+void DeviceShadow::setFirmwareVersion(const char* version) {
+    if (!lock()) {
+        return;
+    }
+    bool notify = false;
+    if (strncmp(s_current.firmware, version, sizeof(s_current.firmware) - 1) != 0) {
+        strncpy(s_current.firmware, version, sizeof(s_current.firmware) - 1);
+        s_current.firmware[sizeof(s_current.firmware) - 1] = '\0';
+        notify = mark_dirty(FIELD_FIRMWARE);
+    }
+    unlock(notify);
+}
+
+void DeviceShadow::setLed(bool on, RGBColor color, uint8_t brightness_pct) {
+    if (!lock()) {
+        return;
+    }
+    LedState& led = s_current.led;
+    led.on = on;
+    if (on) {
+        // An off strip keeps reporting the colour it last showed
+        led.color = color;
+        led.brightness_pct = brightness_pct;
+    }
+    const LedState& prev = s_reported.led;
+    bool changed = led.on != prev.on || led.brightness_pct != prev.brightness_pct ||
+                   led.color.r != prev.color.r || led.color.g != prev.color.g ||
+                   led.color.b != prev.color.b;
+    bool notify = changed && mark_dirty(FIELD_LED);
+    unlock(notify);
+}
+
+void DeviceShadow::reportSensor(ShadowSensor sensor, bool ok) {
+    if (sensor >= SHADOW_SENSOR_COUNT || !lock()) {
+        return;
+    }
+    SensorState& state = s_current.sensors[sensor];
+    uint8_t& failures = s_current.failures[sensor];
+    if (ok) {
+        failures = 0;
+        state = SensorState::Ok;
+    } else if (failures < SENSOR_FAIL_THRESHOLD && ++failures == SENSOR_FAIL_THRESHOLD) {
+        state = SensorState::Failing;
+    }
+    bool notify = state != s_reported.sensors[sensor] && mark_dirty(FIELD_SENSOR_0 << sensor);
+    unlock(notify);
+}
+
+void DeviceShadow::setLink(int8_t rssi, uint32_t queued) {
+    if (!lock()) {
+        return;
+    }
+    s_current.rssi = rssi;
+    s_current.queued = queued;
+
+    uint32_t fields = 0;
+    const int8_t prev_rssi = s_reported.rssi;
+    // 0 means unknown (not associated), always worth reporting
+    if ((rssi == 0) != (prev_rssi == 0) || abs(rssi - prev_rssi) >= RSSI_DEADBAND_DBM) {
+        fields |= FIELD_RSSI;
+    }
+    const uint32_t prev_queued = s_reported.queued;
+    uint32_t delta = queued > prev_queued ? queued - prev_queued : prev_queued - queued;
+    if ((queued == 0) != (prev_queued == 0) || delta >= QUEUE_DEADBAND) {
+        fields |= FIELD_QUEUED;
+    }
+    bool notify = fields != 0 && mark_dirty(fields);
+    unlock(notify);
+}
+
+void DeviceShadow::requestFull() {
+    if (!lock()) {
+        return;
+    }
+    s_full = true;
+    bool notify = mark_dirty(kAllFields);
+    unlock(notify);
+}
+
+int64_t DeviceShadow::dirtySinceUs() {
+    if (!lock()) {
+        return 0;
+    }
+    int64_t since = s_dirty ? s_dirty_since_us : 0;
+    unlock(false);
+    return since;
+}
+
+size_t DeviceShadow::encode(char* out, size_t capacity) {
+    if (!lock()) {
+        return 0;
+    }
+    const uint32_t fields = s_full ? kAllFields : s_dirty;
+    if (fields == 0) {
+        unlock(false);
+        return 0;
+    }
+
+    Writer w = {out, out + capacity, false};
+    w.printf("{\"seq\":%lu,\"full\":%s", (unsigned long)(s_seq + 1), s_full ? "true" : "false");
+    const char* header_end = w.p;
+
+    if (fields & FIELD_CONFIG) {
+        size_t room = (size_t)(w.end - w.p);
+        static constexpr char kKey[] = ",\"config\":";
+        if (room > sizeof(kKey)) {
+            char* value = w.p + sizeof(kKey) - 1;
+            size_t len = s_full ? led_config_json_encode(value, room - (sizeof(kKey) - 1), s_current.config)
+                                : led_config_json_encode_delta(value, room - (sizeof(kKey) - 1),
+                                                               s_current.config, s_reported.config);
+            if (len == 0) {
+                w.overflow = true;
+            } else if (len > 2) {  // Not "{}"
+                memcpy(w.p, kKey, sizeof(kKey) - 1);
+                w.p = value + len;
+            }
+        } else {
+            w.overflow = true;
+        }
+    }
+    if (fields & FIELD_FIRMWARE) {
+        w.printf(",\"firmwareVersion\":\"%s\"", s_current.firmware);
+    }
+    if (fields & FIELD_LED) {
+        const LedState& led = s_current.led;
+        w.printf(",\"led\":{\"on\":%s,\"color\":\"%02X%02X%02X\",\"brightnessPct\":%u}",
+                 led.on ? "true" : "false", led.color.r, led.color.g, led.color.b,
+                 led.brightness_pct);
+    }
+    if (fields & kSensorFields) {
+        w.printf(",\"sensors\":{");
+        bool first = true;
+        for (int i = 0; i < SHADOW_SENSOR_COUNT; i++) {
+            if (fields & (FIELD_SENSOR_0 << i)) {
+                w.printf("%s\"%s\":\"%s\"", first ? "" : ",", kSensorNames[i],
+                         sensor_state_name(s_current.sensors[i]));
+                first = false;
+            }
+        }
+        w.printf("}");
+    }
+    if (fields & FIELD_RSSI) {
+        w.printf(",\"rssi\":%d", s_current.rssi);
+    }
+    if (fields & FIELD_QUEUED) {
+        w.printf(",\"queued\":%lu", (unsigned long)s_current.queued);
+    }
+    if (w.p == header_end && !w.overflow) {
+        // Only the config was dirty and it was set to what was reported
+        s_dirty = 0;
+        unlock(false);
+        return 0;
+    }
+    w.printf("}");
+
+    if (w.overflow) {
+        // Leave everything dirty; the caller's buffer is too small
+        ESP_LOGE(TAG, "Shadow does not fit in %d bytes", (int)capacity);
+        unlock(false);
+        return 0;
+    }
+
+    s_seq++;
+    s_reported = s_current;
+    s_dirty = 0;
+    s_full = false;
+    unlock(false);
+    return (size_t)(w.p - out);
+}
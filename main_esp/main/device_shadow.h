@@ -0,0 +1,83 @@
+#ifndef DEVICE_SHADOW_H
+#define DEVICE_SHADOW_H
+
+#include "led_config.h"
+#include "led_config_json.h"
+#include <cstddef>
+#include <cstdint>
+
+enum ShadowSensor : uint8_t {
+    SHADOW_SENSOR_DISTANCE,  // HC-SR04
+    SHADOW_SENSOR_CLIMATE,   // BLE temperature/humidity sensor
+    SHADOW_SENSOR_PRESSURE,  // BMP280
+    SHADOW_SENSOR_COUNT
+};
+
+/**
+ * @brief Reported device state, published as deltas on the /attributes topic
+ *
+ * Tasks push state in as it changes (config, firmware version, LED output,
+ * sensor health, RSSI, queue depth). Each setter compares against the value
+ * last published and only marks the field dirty if it really changed;
+ * RSSI and queue depth use a deadband so normal jitter is not reported.
+ *
+ * The publisher waits COALESCE_US after the first change so that bursts
+ * (e.g. LEDs switching on while the config is saved) share one message,
+ * then calls encode() which writes only the dirty fields:
+ *
+ *   {"seq":7,"full":false,"led":{"on":true,"color":"FF0000","brightnessPct":40},
+ *    "sensors":{"climate":"failing"},"rssi":-71}
+ *
+ * seq increases by one per message. A full snapshot ("full":true) is sent
+ * after (re)connecting, on request and after a failed publish, so a reader
+ * that sees a gap in seq only has to wait for, or ask for, the next one.
+ *
+ * Thread-safe (FreeRTOS mutex).
+ */
+class DeviceShadow {
+public:
+    static constexpr int64_t COALESCE_US = 1000 * 1000;
+    static constexpr int RSSI_DEADBAND_DBM = 4;
+    static constexpr uint32_t QUEUE_DEADBAND = 25;
+    static constexpr uint8_t SENSOR_FAIL_THRESHOLD = 3;  // Consecutive failures
+    static constexpr size_t MAX_JSON_LEN = LED_CONFIG_JSON_MAX_LEN + 256;
+
+    /**
+     * @brief Initialize the shadow (must be called before use)
+     * @param on_dirty Called when the shadow goes from clean to dirty, from
+     *                 the task that made the change; may be nullptr
+     */
+    static void init(void (*on_dirty)(void));
+
+    static void setConfig(const LEDConfig& config);
+    static void setFirmwareVersion(const char* version);
+    static void setLed(bool on, RGBColor color, uint8_t brightness_pct);
+
+    /**
+     * @brief Record the outcome of one sensor read
+     *
+     * A sensor is reported failing after SENSOR_FAIL_THRESHOLD consecutive
+     * failures and ok again after the first success.
+     */
+    static void reportSensor(ShadowSensor sensor, bool ok);
+
+    static void setLink(int8_t rssi, uint32_t queued);
+
+    /**
+     * @brief Send every field in the next message
+     */
+    static void requestFull();
+
+    /**
+     * @brief esp_timer time of the oldest unpublished change, 0 if none
+     */
+    static int64_t dirtySinceUs();
+
+    /**
+     * @brief Write the dirty fields as a JSON object and mark them published
+     * @return Bytes written (not NUL-terminated), 0 if nothing was dirty
+     */
+    static size_t encode(char* out, size_t capacity);
+};
+
+#endif // DEVICE_SHADOW_H
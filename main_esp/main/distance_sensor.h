@@ -0,0 +1,28 @@
+#ifndef DISTANCE_SENSOR_H
+#define DISTANCE_SENSOR_H
+
+/**
+ * @brief Common interface of the presence/distance sensors
+ *
+ * Lets distance_sensor_task (and the MotionDetector behind it) run on
+ * either the HC-SR04 or the Rd-01 radar, chosen in config.h.
+ */
+class DistanceSensor {
+public:
+    virtual ~DistanceSensor() = default;
+
+    /**
+     * @brief Initialize the sensor
+     * @return true if initialization successful, false otherwise
+     */
+    virtual bool init() = 0;
+
+    /**
+     * @brief Take (or wait for) one distance reading
+     * @return Distance to the nearest target in cm, or -1 if the
+     *         measurement failed or nothing is in range
+     */
+    virtual float measure_distance_cm() = 0;
+};
+
+#endif // DISTANCE_SENSOR_H
@@ -0,0 +1,59 @@
+#include "flow_counter.h"
+
+FlowCounter::FlowCounter(const FlowCounterConfig& config) : config_(config) {
+    reset();
+}
+
+void FlowCounter::reset() {
+    pending_ = false;
+    pending_channel_ = kOuter;
+    pending_ms_ = 0;
+    entries_ = 0;
+    exits_ = 0;
+    occupancy_ = 0;
+}
+
+FlowDirection FlowCounter::fromProfile(const MotionEvent& event) const {
+    if (event.type != MotionEvent::Exit) {
+        return FlowDirection::None;
+    }
+    const float travel = event.travel_cm;
+    if (travel > -config_.min_travel_cm && travel < config_.min_travel_cm) {
+        return FlowDirection::None;
+    }
+    const bool approached = travel < 0;
+    return approached == config_.approach_is_entry ? FlowDirection::Entry : FlowDirection::Exit;
+}
+
+FlowDirection FlowCounter::fromOrder(uint8_t channel, const MotionEvent& event) {
+    if (event.type != MotionEvent::Enter) {
+        return FlowDirection::None;
+    }
+    if (pending_ && pending_channel_ != channel &&
+        event.time_ms - pending_ms_ <= (int64_t)config_.pair_window_ms) {
+        pending_ = false;
+        return pending_channel_ == kOuter ? FlowDirection::Entry : FlowDirection::Exit;
+    }
+    // First half of a pass, or a repeat on the same sensor (restarts the window)
+    pending_ = true;
+    pending_channel_ = channel;
+    pending_ms_ = event.time_ms;
+    return FlowDirection::None;
+}
+
+FlowDirection FlowCounter::onMotion(uint8_t channel, const MotionEvent& event) {
+    if (channel > kInner || (channel == kInner && config_.channels < 2)) {
+        return FlowDirection::None;
+    }
+    FlowDirection direction = config_.channels < 2 ? fromProfile(event) : fromOrder(channel, event);
+    if (direction == FlowDirection::Entry) {
+        entries_++;
+        occupancy_++;
+    } else if (direction == FlowDirection::Exit) {
+        exits_++;
+        if (occupancy_ > 0) {
+            occupancy_--;
+        }
+    }
+    return direction;
+}
@@ -0,0 +1,80 @@
+#ifndef FLOW_COUNTER_H
+#define FLOW_COUNTER_H
+
+#include "motion_detector.h"
+#include <cstdint>
+
+enum class FlowDirection : uint8_t { None, Entry, Exit };
+
+struct FlowCounterConfig {
+    uint8_t channels;         // 1: direction from the distance profile, 2: from sensor order
+    float min_travel_cm;      // 1 channel: visits with less net travel have no direction
+    bool approach_is_entry;   // 1 channel: walking toward the sensor means entering
+    uint32_t pair_window_ms;  // 2 channels: longest gap between the two sensors' Enter
+};
+
+/**
+ * @brief Direction-aware entry/exit counter with a running occupancy estimate
+ *
+ * Consumes the Enter/Exit events of one or two MotionDetectors:
+ *
+ * - One sensor looking along the passage: a visit's direction is the sign
+ *   of its net travel along the beam (MotionEvent::travel_cm on Exit).
+ *   Visits that moved less than min_travel_cm (someone stopping in front
+ *   of the sensor, or crossing the beam sideways) are not counted either way.
+ * - Two sensors across the doorway, kOuter on the outside: an Enter on one
+ *   followed within pair_window_ms by an Enter on the other gives the
+ *   direction. An unpaired Enter (someone turning back) expires.
+ *
+ * Occupancy is entries minus exits, clamped at 0 since an exit from an
+ * empty room can only mean a missed entry.
+ *
+ * Pure logic, no ESP-IDF dependencies. Not thread-safe; owned by the task
+ * that runs the detectors.
+ */
+class FlowCounter {
+public:
+    static constexpr uint8_t kOuter = 0;
+    static constexpr uint8_t kInner = 1;
+
+    explicit FlowCounter(const FlowCounterConfig& config);
+
+    const FlowCounterConfig& config() const { return config_; }
+
+    /**
+     * @brief Feed one detector event
+     * @param channel kOuter for the only (or outside) sensor, kInner for the second
+     * @return Direction of the pass this event completed, None if none
+     */
+    FlowDirection onMotion(uint8_t channel, const MotionEvent& event);
+
+    /**
+     * @brief Override the occupancy estimate (e.g. known empty at night)
+     */
+    void setOccupancy(uint32_t occupancy) { occupancy_ = occupancy; }
+
+    /**
+     * @brief Zero all totals and forget a pending pair
+     */
+    void reset();
+
+    uint32_t entries() const { return entries_; }
+    uint32_t exits() const { return exits_; }
+    uint32_t occupancy() const { return occupancy_; }
+
+private:
+    FlowDirection fromProfile(const MotionEvent& event) const;
+    FlowDirection fromOrder(uint8_t channel, const MotionEvent& event);
+
+    FlowCounterConfig config_;
+
+    bool pending_;             // 2 channels: waiting for the other sensor
+    uint8_t pending_channel_;
+    int64_t pending_ms_;
+
+    uint32_t entries_;
+    uint32_t exits_;
+    uint32_t occupancy_;
+};
+
+#endif // FLOW_COUNTER_H
@@ -14,19 +14,24 @@ static const char *TAG = "HC_SR04";
 // Maximum measurement distance (400 cm for HC-SR04)
 #define MAX_DISTANCE_CM 400.0f
 
-// Timeout for echo pulse (in milliseconds)
-#define ECHO_TIMEOUT_MS 30
+// The sensor ends the echo after ~38 ms when nothing reflects, so the line
+// is idle again by then and the next trigger cannot overlap it
+#define MEASUREMENT_TIMEOUT_MS 40
 
 HCSR04::HCSR04(gpio_num_t trig_pin, gpio_num_t echo_pin) 
     : trig_pin(trig_pin), 
       echo_pin(echo_pin), 
       timer_handle(nullptr),
+      echo_queue(nullptr),
+      lock(portMUX_INITIALIZER_UNLOCKED),
       last_distance_cm(-1),
       last_distance_mm(-1),
       echo_start_time(0),
-      echo_pin_high(false) {
+      echo_pin_high(false),
+      armed(false),
+      measuring(false),
+      trigger_time_us(0) {
 }
-
 bool HCSR04::init() {
     ESP_LOGI(TAG, "Initializing HC-SR04 sensor on TRIG=%d, ECHO=%d", trig_pin, echo_pin);
     
@@ -44,19 +49,38 @@ bool HCSR04::init() {
         return false;
     }
     
-    // Configure ECHO pin as input (no interrupt - we'll poll it)
+    // Configure ECHO pin as input, interrupting on both edges
     gpio_config_t echo_cfg = {
         .pin_bit_mask = 1ULL << echo_pin,
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_DISABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE
+        .intr_type = GPIO_INTR_ANYEDGE
     };
     
     if (gpio_config(&echo_cfg) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to configure ECHO pin");
         return false;
     }
+
+    echo_queue = xQueueCreate(1, sizeof(uint32_t));
+    if (echo_queue == nullptr) {
+        ESP_LOGE(TAG, "Failed to create echo queue");
+        return false;
+    }
+
+    // IRAM ISR so edges are still timestamped while flash writes (NVS,
+    // telemetry spool) have the cache disabled. Another driver may have
+    // installed the shared service already.
+    esp_err_t err = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "Failed to install GPIO ISR service");
+        return false;
+    }
+    if (gpio_isr_handler_add(echo_pin, echo_isr, this) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add ECHO ISR handler");
+        return false;
+    }
     
     // Initialize general-purpose timer for measuring echo pulse duration
     gptimer_config_t timer_cfg = {
@@ -72,15 +96,7 @@ bool HCSR04::init() {
         return false;
     }
     
-    if (gptimer_enable(timer_handle) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to enable timer");
-        return false;
-    }
-    
-    if (gptimer_start(timer_handle) != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start timer");
-        return false;
-    }
+    // Enabled per measurement (see start_measurement)
     
     // Set initial trigger pin state to low
     gpio_set_level(trig_pin, 0);
@@ -92,51 +108,113 @@ bool HCSR04::init() {
 void HCSR04::deinit() {
     ESP_LOGI(TAG, "Deinitializing HC-SR04 sensor");
     
+    if (measuring) {
+        finish_measurement();
+    }
+    gpio_isr_handler_remove(echo_pin);
+
     if (timer_handle != nullptr) {
-        gptimer_stop(timer_handle);
-        gptimer_disable(timer_handle);
         gptimer_del_timer(timer_handle);
         timer_handle = nullptr;
     }
+    if (echo_queue != nullptr) {
+        vQueueDelete(echo_queue);
+        echo_queue = nullptr;
+    }
 }
 
-void IRAM_ATTR HCSR04::send_trigger_pulse() {
+void HCSR04::send_trigger_pulse() {
     // HC-SR04 requires a 10 microsecond pulse on TRIG pin
     gpio_set_level(trig_pin, 1);
     esp_rom_delay_us(10);  // 10 microsecond pulse
     gpio_set_level(trig_pin, 0);
 }
 
-uint32_t IRAM_ATTR HCSR04::wait_for_echo() {
-    // Wait for rising edge (timeout in milliseconds)
-    int64_t timeout_start = esp_timer_get_time() / 1000;  // Convert to ms
-    
-    while ((esp_timer_get_time() / 1000 - timeout_start) < ECHO_TIMEOUT_MS) {
-        if (gpio_get_level(echo_pin) == 1) {
-            // Rising edge detected - start measuring
-            break;
-        }
+// The edge direction follows from the state, so the ISR needs no GPIO read:
+// armed -> rising edge of our echo, high -> falling edge. Stray edges
+// outside a measurement are ignored.
+void IRAM_ATTR HCSR04::echo_isr(void* arg) {
+    HCSR04* self = static_cast<HCSR04*>(arg);
+    uint64_t now;
+    gptimer_get_raw_count(self->timer_handle, &now);
+
+    BaseType_t woken = pdFALSE;
+    portENTER_CRITICAL_ISR(&self->lock);
+    if (self->armed) {
+        self->armed = false;
+        self->echo_start_time = now;
+        self->echo_pin_high = true;
+    } else if (self->echo_pin_high) {
+        self->echo_pin_high = false;
+        uint32_t duration_us = (uint32_t)(now - self->echo_start_time);
+        xQueueOverwriteFromISR(self->echo_queue, &duration_us, &woken);
     }
-    
-    // Start timer measurement at rising edge
-    uint64_t pulse_start;
-    gptimer_get_raw_count(timer_handle, &pulse_start);
-    
-    // Wait for falling edge
-    timeout_start = esp_timer_get_time() / 1000;
-    while ((esp_timer_get_time() / 1000 - timeout_start) < ECHO_TIMEOUT_MS) {
-        if (gpio_get_level(echo_pin) == 0) {
-            // Falling edge detected
-            uint64_t pulse_end;
-            gptimer_get_raw_count(timer_handle, &pulse_end);
-            
-            uint32_t duration_us = (uint32_t)(pulse_end - pulse_start);
-            return duration_us;
+    portEXIT_CRITICAL_ISR(&self->lock);
+
+    if (woken) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+bool HCSR04::start_measurement() {
+    if (measuring || timer_handle == nullptr) {
+        return false;
+    }
+    // Holding the timer keeps APB at full speed for a stable 1 µs count
+    if (gptimer_enable(timer_handle) != ESP_OK || gptimer_start(timer_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start timer");
+        gptimer_disable(timer_handle);
+        return false;
+    }
+
+    xQueueReset(echo_queue);
+    portENTER_CRITICAL(&lock);
+    armed = true;
+    echo_pin_high = false;
+    portEXIT_CRITICAL(&lock);
+
+    measuring = true;
+    trigger_time_us = esp_timer_get_time();
+    send_trigger_pulse();
+    return true;
+}
+
+void HCSR04::finish_measurement() {
+    portENTER_CRITICAL(&lock);
+    armed = false;
+    echo_pin_high = false;
+    portEXIT_CRITICAL(&lock);
+
+    gptimer_stop(timer_handle);
+    gptimer_disable(timer_handle);
+    measuring = false;
+}
+
+bool HCSR04::get_result(float* distance_cm, TickType_t timeout) {
+    if (!measuring) {
+        return false;
+    }
+
+    int64_t elapsed_ms = (esp_timer_get_time() - trigger_time_us) / 1000;
+    TickType_t remaining = elapsed_ms < MEASUREMENT_TIMEOUT_MS
+                               ? pdMS_TO_TICKS(MEASUREMENT_TIMEOUT_MS - elapsed_ms) + 1
+                               : 0;
+    bool pending = timeout < remaining;
+
+    uint32_t echo_time_us = 0;
+    if (xQueueReceive(echo_queue, &echo_time_us, pending ? timeout : remaining) != pdTRUE) {
+        if (pending) {
+            return false;
         }
+        ESP_LOGW(TAG, "Echo timeout - no response from sensor");
+        echo_time_us = 0;
     }
-    
-    ESP_LOGW(TAG, "Echo timeout - no response from sensor");
-    return 0;
+    finish_measurement();
+
+    last_distance_cm = echo_time_to_distance_cm(echo_time_us);
+    last_distance_mm = last_distance_cm > 0 ? last_distance_cm * 10.0f : -1.0f;
+    *distance_cm = last_distance_cm;
+    return true;
 }
 
 float HCSR04::echo_time_to_distance_cm(uint32_t echo_time_us) {
@@ -157,30 +235,13 @@ float HCSR04::echo_time_to_distance_cm(uint32_t echo_time_us) {
     return distance;
 }
 
-float IRAM_ATTR HCSR04::measure_distance_cm() {
-    // Send trigger pulse
-    send_trigger_pulse();
-    
-    // Wait a bit for sensor to respond
-    vTaskDelay(pdMS_TO_TICKS(1));
-    
-    // Measure echo pulse
-    uint32_t echo_time_us = wait_for_echo();
-    
-    if (echo_time_us == 0) {
-        last_distance_cm = -1.0f;
-        last_distance_mm = -1.0f;
+float HCSR04::measure_distance_cm() {
+    if (!start_measurement()) {
         return -1.0f;
     }
-    
-    last_distance_cm = echo_time_to_distance_cm(echo_time_us);
-    if (last_distance_cm > 0) {
-        last_distance_mm = last_distance_cm * 10.0f;
-    } else {
-        last_distance_mm = -1.0f;
-    }
-    
-    return last_distance_cm;
+    float distance_cm = -1.0f;
+    get_result(&distance_cm, portMAX_DELAY);
+    return distance_cm;
 }
 
 float HCSR04::measure_distance_mm() {
@@ -1,17 +1,32 @@
 #ifndef HC_SR04_H
 #define HC_SR04_H
 
+#include "distance_sensor.h"
 #include "driver/gpio.h"
 #include "driver/gptimer.h"
 #include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 /**
  * @brief HC-SR04 Ultrasonic Distance Sensor Controller
- * 
- * Measures distance using ultrasonic pulses (polling-based, no ISR).
+ *
+ * Measures distance using ultrasonic pulses. Both edges of the ECHO pulse
+ * are timestamped from a GPIO interrupt with the gptimer (1 µs), and the
+ * pulse width is handed to the caller through a queue, so no task spins
+ * while the pulse is in flight.
  * Distance (cm) = (Echo Time in µs) / 58
+ *
+ * The gptimer (and with it the APB power-management lock) is only held
+ * between start_measurement() and the result, so the system can enter
+ * light sleep between measurements.
+ *
+ * Usage, blocking:  float cm = sensor.measure_distance_cm();
+ * Usage, async:     sensor.start_measurement();
+ *                   ... other work ...
+ *                   sensor.get_result(&cm, portMAX_DELAY);
  */
-class HCSR04 {
+class HCSR04 : public DistanceSensor {
 public:
     /**
      * @brief Constructor for HC-SR04 sensor
@@ -19,36 +34,55 @@ public:
      * @param echo_pin GPIO pin for ECHO (echo) signal
      */
     HCSR04(gpio_num_t trig_pin, gpio_num_t echo_pin);
-    
+
     /**
      * @brief Initialize the sensor
      * @return true if initialization successful, false otherwise
      */
-    bool init();
-    
+    bool init() override;
+
     /**
      * @brief Deinitialize the sensor and cleanup resources
      */
     void deinit();
-    
+
+    /**
+     * @brief Send a trigger pulse and return immediately
+     * @return false if a measurement is already in progress or the timer
+     *         could not be started
+     */
+    bool start_measurement();
+
     /**
-     * @brief Measure distance in centimeters
+     * @brief Collect the result of start_measurement()
+     *
+     * Waits at most timeout for the echo. A measurement with no complete
+     * echo after MEASUREMENT_TIMEOUT_MS counts as finished and failed.
+     *
+     * @param distance_cm Distance in cm, or -1 if the measurement failed
+     * @return true once the measurement has finished, false if it is still
+     *         in progress after timeout (or none was started)
+     */
+    bool get_result(float* distance_cm, TickType_t timeout);
+
+    /**
+     * @brief Measure distance in centimeters (blocks, without spinning)
      * @return Distance in cm, or -1 if measurement failed
      */
-    float measure_distance_cm() IRAM_ATTR;
-    
+    float measure_distance_cm() override;
+
     /**
      * @brief Measure distance in millimeters
      * @return Distance in mm, or -1 if measurement failed
      */
     float measure_distance_mm();
-    
+
     /**
      * @brief Get the last measured distance in cm
      * @return Last distance value in cm
      */
     float get_last_distance_cm() const { return last_distance_cm; }
-    
+
     /**
      * @brief Get the last measured distance in mm
      * @return Last distance value in mm
@@ -59,26 +93,37 @@ private:
     gpio_num_t trig_pin;
     gpio_num_t echo_pin;
     gptimer_handle_t timer_handle;
-    
+    QueueHandle_t echo_queue;  // Pulse width in µs, from the ISR (length 1)
+    portMUX_TYPE lock;         // Guards the ISR state below
+
     float last_distance_cm;
     float last_distance_mm;
-    
-    // Timer value at echo start (kept for future ISR support)
+
+    // Timer value at echo start (set in the ISR)
     uint64_t echo_start_time;
-    // Flag to indicate echo pulse is high (kept for future ISR support)
+    // Flag to indicate echo pulse is high (set in the ISR)
     volatile bool echo_pin_high;
-    
+    // Waiting for the rising edge of our own trigger
+    volatile bool armed;
+
+    bool measuring;             // Between start_measurement() and the result
+    int64_t trigger_time_us;    // esp_timer time of the trigger pulse
+
     /**
      * @brief Send trigger pulse to sensor
      */
-    void send_trigger_pulse() IRAM_ATTR;
-    
+    void send_trigger_pulse();
+
     /**
-     * @brief Wait for echo pulse with timeout (polling-based)
-     * @return Echo time in microseconds, or 0 if timeout
+     * @brief Disarm the ISR and release the timer
      */
-    uint32_t wait_for_echo() IRAM_ATTR;
-    
+    void finish_measurement();
+
+    /**
+     * @brief ECHO edge interrupt: timestamps the pulse and posts its width
+     */
+    static void echo_isr(void* arg) IRAM_ATTR;
+
     /**
      * @brief Convert echo time to distance in cm
      * @param echo_time_us Echo time in microseconds
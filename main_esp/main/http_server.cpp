@@ -12,7 +12,8 @@ static httpd_handle_t server = NULL;
 static http_server_callbacks_t callbacks = {
     .on_led_control = NULL,
     .on_config_update = NULL,
-    .get_status = NULL
+    .get_status = NULL,
+    .dump_trace = NULL
 };
 
 // Exported C functions
@@ -90,6 +91,32 @@ static esp_err_t device_status_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+static bool send_trace_chunk(const void* data, size_t len, void* ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, (const char*)data, len) == ESP_OK;
+}
+
+// GET /api/device/trace - Presence trace, binary (see trace_replay)
+static esp_err_t device_trace_handler(httpd_req_t *req)
+{
+    set_cors_headers(req);
+    
+    if (!callbacks.dump_trace) {
+        httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Trace not available");
+        return ESP_FAIL;
+    }
+    
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"presence.trace\"");
+    if (!callbacks.dump_trace(send_trace_chunk, req)) {
+        // No terminating chunk: the client sees a truncated transfer
+        ESP_LOGW(TAG, "Trace dump aborted");
+        return ESP_FAIL;
+    }
+    httpd_resp_send_chunk(req, NULL, 0);
+    return ESP_OK;
+}
+
 // POST /api/device/led - Control LEDs
 static esp_err_t led_control_handler(httpd_req_t *req)
 {
@@ -160,19 +187,12 @@ static esp_err_t config_update_handler(httpd_req_t *req)
     
     ESP_LOGI(TAG, "Config update request: %s", content);
     
-    // Validate JSON
-    cJSON *root = cJSON_Parse(content);
-    if (!root) {
+    // Callback decodes and validates in place
+    if (callbacks.on_config_update && !callbacks.on_config_update(content, ret)) {
         free(content);
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
         return ESP_FAIL;
     }
-    cJSON_Delete(root);
-    
-    // Call callback
-    if (callbacks.on_config_update) {
-        callbacks.on_config_update(content);
-    }
     
     free(content);
     httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
@@ -292,6 +312,14 @@ esp_err_t http_server_start(void)
     };
     httpd_register_uri_handler(server, &device_status);
     
+    httpd_uri_t device_trace = {
+        .uri = "/api/device/trace",
+        .method = HTTP_GET,
+        .handler = device_trace_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &device_trace);
+    
     httpd_uri_t led_control = {
         .uri = "/api/device/led",
         .method = HTTP_POST,
@@ -14,11 +14,15 @@ esp_err_t http_server_start(void);
 // Stop HTTP server
 void http_server_stop(void);
 
+// Streams one piece of a binary response; false aborts it
+typedef bool (*http_server_write_fn)(const void* data, size_t len, void* ctx);
+
 // Register device control callbacks
 typedef struct {
     void (*on_led_control)(uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness);
-    void (*on_config_update)(const char* json_config);
+    bool (*on_config_update)(const char* json_config, size_t len);  // false = invalid config
     const char* (*get_status)(void);  // Returns JSON string with device status
+    bool (*dump_trace)(http_server_write_fn write, void* ctx);  // Presence trace (trace_record.h)
 } http_server_callbacks_t;
 
 void http_server_register_callbacks(const http_server_callbacks_t* callbacks);
@@ -0,0 +1,278 @@
+#include "json_reader.h"
+#include <cstring>
+
+namespace {
+    // Mantissa digits beyond this only shift the exponent
+    constexpr int kMaxMantissaDigits = 18;
+    constexpr int kMaxExponent = 308;
+
+    bool is_digit(char c) {
+        return c >= '0' && c <= '9';
+    }
+}
+
+bool JsonSpan::equals(const char* s) const {
+    return strlen(s) == len && memcmp(data, s, len) == 0;
+}
+
+JsonReader::JsonReader(const char* json, size_t len)
+    : p_(json), end_(json + len), error_(false), depth_(0), first_(0) {}
+
+bool JsonReader::fail() {
+    error_ = true;
+    return false;
+}
+
+void JsonReader::skipWhitespace() {
+    while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\n' || *p_ == '\r')) {
+        p_++;
+    }
+}
+
+bool JsonReader::expect(char c) {
+    skipWhitespace();
+    if (error_ || p_ >= end_ || *p_ != c) {
+        return fail();
+    }
+    p_++;
+    return true;
+}
+
+bool JsonReader::literal(const char* word) {
+    size_t n = strlen(word);
+    if ((size_t)(end_ - p_) < n || memcmp(p_, word, n) != 0) {
+        return fail();
+    }
+    p_ += n;
+    return true;
+}
+
+bool JsonReader::push() {
+    if (depth_ >= kMaxDepth) {
+        return fail();
+    }
+    first_ |= 1u << depth_;
+    depth_++;
+    return true;
+}
+
+// Handles the closing bracket or the comma before the next element
+bool JsonReader::separator(char close) {
+    skipWhitespace();
+    if (error_ || depth_ == 0 || p_ >= end_) {
+        return fail();
+    }
+    const uint32_t bit = 1u << (depth_ - 1);
+    if (*p_ == close) {
+        p_++;
+        depth_--;
+        return false;
+    }
+    if (first_ & bit) {
+        first_ &= ~bit;
+        return true;
+    }
+    return expect(',');
+}
+
+char JsonReader::peekType() {
+    skipWhitespace();
+    if (error_ || p_ >= end_) {
+        return 0;
+    }
+    char c = *p_;
+    if (c == '-' || is_digit(c)) {
+        return '0';
+    }
+    return c;
+}
+
+bool JsonReader::atEnd() {
+    skipWhitespace();
+    return !error_ && p_ == end_;
+}
+
+bool JsonReader::beginObject() {
+    return expect('{') && push();
+}
+
+bool JsonReader::nextMember(JsonSpan* key) {
+    return separator('}') && readString(key) && expect(':');
+}
+
+bool JsonReader::beginArray() {
+    return expect('[') && push();
+}
+
+bool JsonReader::nextElement() {
+    return separator(']');
+}
+
+bool JsonReader::readString(JsonSpan* out) {
+    if (!expect('"')) {
+        return false;
+    }
+    const char* start = p_;
+    while (p_ < end_ && *p_ != '"') {
+        if ((unsigned char)*p_ < 0x20) {
+            return fail();
+        }
+        if (*p_ == '\\') {
+            p_++;  // Escaped character is kept verbatim
+        }
+        p_++;
+    }
+    if (p_ >= end_) {
+        return fail();
+    }
+    out->data = start;
+    out->len = (size_t)(p_ - start);
+    p_++;
+    return true;
+}
+
+bool JsonReader::readNumber(double* out) {
+    skipWhitespace();
+    if (error_) {
+        return false;
+    }
+
+    bool negative = false;
+    if (p_ < end_ && *p_ == '-') {
+        negative = true;
+        p_++;
+    }
+    if (p_ >= end_ || !is_digit(*p_)) {
+        return fail();
+    }
+
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    if (*p_ == '0') {
+        p_++;
+    } else {
+        while (p_ < end_ && is_digit(*p_)) {
+            if (digits < kMaxMantissaDigits) {
+                mantissa = mantissa * 10 + (uint64_t)(*p_ - '0');
+                digits++;
+            } else {
+                exponent++;
+            }
+            p_++;
+        }
+    }
+
+    if (p_ < end_ && *p_ == '.') {
+        p_++;
+        if (p_ >= end_ || !is_digit(*p_)) {
+            return fail();
+        }
+        while (p_ < end_ && is_digit(*p_)) {
+            if (digits < kMaxMantissaDigits) {
+                mantissa = mantissa * 10 + (uint64_t)(*p_ - '0');
+                if (mantissa != 0) {
+                    digits++;
+                }
+                exponent--;
+            }
+            p_++;
+        }
+    }
+
+    if (p_ < end_ && (*p_ == 'e' || *p_ == 'E')) {
+        p_++;
+        bool exp_negative = false;
+        if (p_ < end_ && (*p_ == '+' || *p_ == '-')) {
+            exp_negative = *p_ == '-';
+            p_++;
+        }
+        if (p_ >= end_ || !is_digit(*p_)) {
+            return fail();
+        }
+        int value = 0;
+        while (p_ < end_ && is_digit(*p_)) {
+            if (value < 10000) {
+                value = value * 10 + (*p_ - '0');
+            }
+            p_++;
+        }
+        exponent += exp_negative ? -value : value;
+    }
+
+    if (exponent > kMaxExponent || exponent < -kMaxExponent) {
+        return fail();
+    }
+
+    double result = (double)mantissa;
+    double scale = 1.0;
+    for (int i = exponent < 0 ? -exponent : exponent; i > 0; i--) {
+        scale *= 10.0;
+    }
+    result = exponent < 0 ? result / scale : result * scale;
+    *out = negative ? -result : result;
+    return true;
+}
+
+bool JsonReader::readBool(bool* out) {
+    char c = peekType();
+    if (c == 't') {
+        *out = true;
+        return literal("true");
+    }
+    if (c == 'f') {
+        *out = false;
+        return literal("false");
+    }
+    return fail();
+}
+
+bool JsonReader::skipValue() {
+    JsonSpan span;
+    double number;
+    bool flag;
+    switch (peekType()) {
+    case '{':
+        if (!beginObject()) {
+            return false;
+        }
+        while (nextMember(&span)) {
+            if (!skipValue()) {
+                return false;
+            }
+        }
+        return ok();
+    case '[':
+        if (!beginArray()) {
+            return false;
+        }
+        while (nextElement()) {
+            if (!skipValue()) {
+                return false;
+            }
+        }
+        return ok();
+    case '"':
+        return readString(&span);
+    case '0':
+        return readNumber(&number);
+    case 't':
+    case 'f':
+        return readBool(&flag);
+    case 'n':
+        return literal("null");
+    default:
+        return fail();
+    }
+}
+
+bool JsonReader::readRaw(JsonSpan* out) {
+    skipWhitespace();
+    const char* start = p_;
+    if (!skipValue()) {
+        return false;
+    }
+    out->data = start;
+    out->len = (size_t)(p_ - start);
+    return true;
+}
@@ -0,0 +1,89 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Slice of the input text
+ */
+struct JsonSpan {
+    const char* data;
+    size_t len;
+
+    bool equals(const char* s) const;
+};
+
+/**
+ * @brief Minimal in-situ JSON pull reader
+ *
+ * Walks JSON text in place without building a tree or allocating, so it
+ * can run on buffers owned by the caller (e.g. the MQTT command arena).
+ * Strings are returned as spans into the input with escape sequences left
+ * as-is, which is enough for keys, enum names and hex colours.
+ *
+ * Errors are sticky: once a call fails, every following call fails too
+ * and ok() returns false. Typical use:
+ *
+ *   JsonReader r(text, len);
+ *   JsonSpan key;
+ *   if (r.beginObject()) {
+ *       while (r.nextMember(&key)) {
+ *           if (key.equals("n")) r.readNumber(&n); else r.skipValue();
+ *       }
+ *   }
+ *   if (!r.ok() || !r.atEnd()) ...  // malformed
+ */
+class JsonReader {
+public:
+    static constexpr int kMaxDepth = 16;
+
+    JsonReader(const char* json, size_t len);
+
+    // Containers. next*() returns false at the closing bracket (consumed)
+    // or on error; they also take care of the separating commas.
+    bool beginObject();
+    bool nextMember(JsonSpan* key);
+    bool beginArray();
+    bool nextElement();
+
+    // Scalars
+    bool readString(JsonSpan* out);
+    bool readNumber(double* out);
+    bool readBool(bool* out);
+
+    /**
+     * @brief Skip the next value, including nested objects and arrays
+     */
+    bool skipValue();
+
+    /**
+     * @brief Skip the next value and return its raw text
+     */
+    bool readRaw(JsonSpan* out);
+
+    /**
+     * @brief Type of the next value without consuming it: one of { [ " t f n
+     *        or '0' for a number, 0 at end of input
+     */
+    char peekType();
+
+    bool ok() const { return !error_; }
+    bool atEnd();
+
+private:
+    void skipWhitespace();
+    bool fail();
+    bool expect(char c);
+    bool literal(const char* word);
+    bool push();
+    bool separator(char close);
+
+    const char* p_;
+    const char* end_;
+    bool error_;
+    int depth_;
+    uint32_t first_;  // Bit per nesting level: no element read yet
+};
+
+#endif // JSON_READER_H
@@ -56,6 +56,7 @@ static inline void led_show_mqtt_connected(WS2812BController& leds) {
  */
 static inline void led_turn_off(WS2812BController& leds) {
     leds.clear();
+    leds.refresh();
 }
 
 #endif // LED_ANIMATIONS_H
@@ -0,0 +1,84 @@
+#include "led_color.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#else
+#define DRAM_ATTR
+#endif
+
+namespace {
+    constexpr double kGammaExponent = 2.2;
+    constexpr double kLn2 = 0.69314718055994531;
+
+    // exp(x) for x <= 0: series on x / 32, then squared five times
+    constexpr double exp_c(double x) {
+        double y = x / 32;
+        double term = 1;
+        double sum = 1;
+        for (int n = 1; n < 12; n++) {
+            term *= y / n;
+            sum += term;
+        }
+        for (int i = 0; i < 5; i++) {
+            sum *= sum;
+        }
+        return sum;
+    }
+
+    // ln(x) for 0 < x <= 1: halve into [0.5, 1], then 2 atanh((x-1)/(x+1))
+    constexpr double log_c(double x) {
+        int k = 0;
+        while (x < 0.5) {
+            x *= 2;
+            k++;
+        }
+        double z = (x - 1) / (x + 1);
+        double term = z;
+        double sum = 0;
+        for (int n = 1; n < 40; n += 2) {
+            sum += term / n;
+            term *= z * z;
+        }
+        return 2 * sum - k * kLn2;
+    }
+
+    constexpr LedLut<uint8_t> make_gamma() {
+        LedLut<uint8_t> table = {};
+        for (int i = 1; i < 256; i++) {
+            int duty = (int)(255 * exp_c(kGammaExponent * log_c(i / 255.0)) + 0.5);
+            table.v[i] = (uint8_t)(duty < 1 ? 1 : duty);
+        }
+        return table;
+    }
+
+    constexpr LedLut<uint16_t> make_scale() {
+        LedLut<uint16_t> table = {};
+        for (int i = 0; i < 256; i++) {
+            table.v[i] = (uint16_t)((i * 256 + 127) / 255);
+        }
+        return table;
+    }
+
+    constexpr LedLut<uint8_t> kGammaTable = make_gamma();
+    constexpr LedLut<uint16_t> kScaleTable = make_scale();
+
+    static_assert(kGammaTable.v[0] == 0 && kGammaTable.v[1] == 1 && kGammaTable.v[255] == 255,
+                  "gamma table end points");
+    static_assert(kGammaTable.v[128] == 56, "gamma 2.2 at half scale");
+    static_assert(kScaleTable.v[255] == 256, "full brightness is exactly 1.0");
+}
+
+// Read on every pixel write: keep them in DRAM, out of the flash cache
+DRAM_ATTR const LedLut<uint8_t> LedColorPipeline::kGamma = kGammaTable;
+DRAM_ATTR const LedLut<uint16_t> LedColorPipeline::kScale = kScaleTable;
+
+LedColorPipeline::LedColorPipeline() {
+    setWhiteBalance({255, 255, 255});
+}
+
+void LedColorPipeline::setWhiteBalance(const LedWhiteBalance& white_balance) {
+    white_balance_ = white_balance;
+    gain_[0] = kScale.v[white_balance.red];
+    gain_[1] = kScale.v[white_balance.green];
+    gain_[2] = kScale.v[white_balance.blue];
+}
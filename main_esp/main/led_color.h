@@ -0,0 +1,80 @@
+#ifndef LED_COLOR_H
+#define LED_COLOR_H
+
+#include <cstdint>
+
+struct LedPixel {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+// Per-channel gain applied before gamma; 255 leaves a channel unchanged
+struct LedWhiteBalance {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+};
+
+// 256-entry lookup table (a struct so it can be built by a constexpr function)
+template <typename T>
+struct LedLut {
+    T v[256];
+};
+
+/**
+ * @brief Colour path from a requested colour and brightness to LED duty
+ *
+ * apply() scales each channel by brightness and white balance, then maps
+ * it through a gamma 2.2 table, so that brightness levels look evenly
+ * spaced instead of crowding at the top. Both tables are generated at
+ * compile time. Brightness and white balance are 8.8 fixed point factors
+ * from kScale, so a pixel costs three multiplies, shifts and lookups and
+ * no division.
+ *
+ * Gamma maps every non-zero input to at least 1: a dim colour keeps all
+ * of its channels lit rather than collapsing to black or to one hue.
+ *
+ * Pure logic with no ESP-IDF dependencies. apply() is const; the owner
+ * serialises setWhiteBalance() against it.
+ */
+class LedColorPipeline {
+public:
+    // Input 0..255 -> duty 0..255, gamma 2.2
+    static const LedLut<uint8_t> kGamma;
+    // Brightness 0..255 -> 8.8 fixed point factor 0..256 (0.0..1.0)
+    static const LedLut<uint16_t> kScale;
+
+    LedColorPipeline();
+
+    void setWhiteBalance(const LedWhiteBalance& white_balance);
+    const LedWhiteBalance& whiteBalance() const { return white_balance_; }
+
+    LedPixel apply(uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness) const {
+        LedPixel pixel;
+        applyTo(red, green, blue, brightness, &pixel.red, &pixel.green, &pixel.blue);
+        return pixel;
+    }
+
+    /**
+     * @brief apply() storing each duty straight into its destination
+     *
+     * For the per-pixel path into a frame buffer: at -Og, the firmware's
+     * optimisation level, a returned LedPixel is assembled on the stack
+     * and read back, which tripled the cost of a pixel.
+     */
+    void applyTo(uint8_t red, uint8_t green, uint8_t blue, uint8_t brightness,
+                 uint8_t* out_red, uint8_t* out_green, uint8_t* out_blue) const {
+        // 16.16 fixed point factors, at most 1.0
+        uint32_t scale = kScale.v[brightness];
+        *out_red = kGamma.v[(red * scale * gain_[0] + 0x8000) >> 16];
+        *out_green = kGamma.v[(green * scale * gain_[1] + 0x8000) >> 16];
+        *out_blue = kGamma.v[(blue * scale * gain_[2] + 0x8000) >> 16];
+    }
+
+private:
+    LedWhiteBalance white_balance_;
+    uint32_t gain_[3];  // kScale of the white balance, per channel
+};
+
+#endif // LED_COLOR_H
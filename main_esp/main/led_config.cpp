@@ -2,6 +2,7 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include <cstddef>
 #include <cstring>
 
 static const char* TAG = "led_config";
@@ -25,32 +26,68 @@ LEDConfigManager::LEDConfigManager() {
 }
 
 void LEDConfigManager::initDefaultConfig() {
+  setDefaults(config_);
+  ESP_LOGI(TAG, "Initialized default configuration");
+}
+
+void LEDConfigManager::setDefaults(LEDConfig& config) {
   // Default humidity thresholds: 0-30% (low), 30-70% (medium), 70-100% (high)
-  config_.humidity_thresholds[0] = 0.0f;
-  config_.humidity_thresholds[1] = 30.0f;
-  config_.humidity_thresholds[2] = 70.0f;
-  config_.humidity_thresholds[3] = 100.0f;
+  config.humidity_thresholds[0] = 0.0f;
+  config.humidity_thresholds[1] = 30.0f;
+  config.humidity_thresholds[2] = 70.0f;
+  config.humidity_thresholds[3] = 100.0f;
   
   // Default colors: Red (low humidity), Blue (medium), Green (high)
-  config_.colors[0] = {255, 0, 0};    // Red
-  config_.colors[1] = {0, 0, 255};    // Blue
-  config_.colors[2] = {0, 255, 0};    // Green
+  config.colors[0] = {255, 0, 0};    // Red
+  config.colors[1] = {0, 0, 255};    // Blue
+  config.colors[2] = {0, 255, 0};    // Green
   
   // Default brightness: 80%, auto-brightness enabled
-  config_.manual_brightness_pct = 80;
-  config_.auto_brightness = true;
+  config.manual_brightness_pct = 80;
+  config.auto_brightness = true;
   
   // Default: Use all 6 LEDs
-  config_.num_leds_active = 5;
+  config.num_leds_active = 5;
   
   // Default timeout settings
-  config_.no_motion_timeout_ms = 15000;   // 15 seconds
-  config_.max_on_duration_ms = 300000;    // 5 minutes
+  config.no_motion_timeout_ms = 15000;   // 15 seconds
+  config.max_on_duration_ms = 300000;    // 5 minutes
   
   // Default motion detection threshold
-  config_.distance_threshold_cm = 50.0f;  // 50 cm
+  config.distance_threshold_cm = 50.0f;  // 50 cm
   
-  ESP_LOGI(TAG, "Initialized default configuration");
+  // Default telemetry encoding understood by the current backend
+  config.telemetry_format = TELEMETRY_FORMAT_JSON;
+  config.telemetry_compression = TELEMETRY_COMPRESSION_NONE;
+  config.telemetry_max_latency_s = 120;  // Batch up to 2 minutes of records
+  
+  config.version = LED_CONFIG_VERSION;
+}
+
+void LEDConfigManager::upgrade(LEDConfig& config, size_t stored_size) {
+  LEDConfig defaults;
+  setDefaults(defaults);
+  
+  // Blobs from before the version field: the telemetry fields were appended
+  // one by one without it, and those past the first fell into the tail
+  // padding of the 44-byte struct, which reads back as 0 or garbage
+  if (stored_size < offsetof(LEDConfig, version) + sizeof(config.version)) {
+    config.version = 0;
+  }
+  if (config.version < 1) {
+    if (config.telemetry_format > TELEMETRY_FORMAT_CBOR) {
+      config.telemetry_format = defaults.telemetry_format;
+    }
+    if (config.telemetry_compression > TELEMETRY_COMPRESSION_LZ4) {
+      config.telemetry_compression = defaults.telemetry_compression;
+    }
+    if (config.telemetry_max_latency_s < TELEMETRY_MAX_LATENCY_MIN_S ||
+        config.telemetry_max_latency_s > TELEMETRY_MAX_LATENCY_MAX_S) {
+      config.telemetry_max_latency_s = defaults.telemetry_max_latency_s;
+    }
+  }
+  
+  config.version = LED_CONFIG_VERSION;
 }
 
 void LEDConfigManager::setConfig(const LEDConfig& new_config) {
@@ -88,8 +125,18 @@ bool LEDConfigManager::loadFromNVS() {
     return false;
   }
   
-  size_t required_size = sizeof(LEDConfig);
-  err = nvs_get_blob(handle, NVS_KEY, &config_, &required_size);
+  // Blobs saved by older firmware are shorter: load them as a prefix over
+  // the defaults, then upgrade() the fields appended since
+  size_t required_size = 0;
+  err = nvs_get_blob(handle, NVS_KEY, nullptr, &required_size);
+  if (err == ESP_OK && required_size > sizeof(LEDConfig)) {
+    err = ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  LEDConfig stored;
+  setDefaults(stored);
+  if (err == ESP_OK) {
+    err = nvs_get_blob(handle, NVS_KEY, &stored, &required_size);
+  }
   nvs_close(handle);
   
   if (err != ESP_OK) {
@@ -97,6 +144,13 @@ bool LEDConfigManager::loadFromNVS() {
     return false;
   }
   
+  config_ = stored;
+  if (required_size < sizeof(LEDConfig) || config_.version < LED_CONFIG_VERSION) {
+    upgrade(config_, required_size);
+    ESP_LOGI(TAG, "Upgraded configuration from older firmware");
+    saveToNVS();
+  }
+  
   ESP_LOGI(TAG, "Configuration loaded from NVS");
   return true;
 }
@@ -1,6 +1,7 @@
 #ifndef LED_CONFIG_H
 #define LED_CONFIG_H
 
+#include <cstddef>
 #include <cstdint>
 
 // LED Configuration Structure
@@ -10,6 +11,29 @@ struct RGBColor {
   uint8_t b;
 };
 
+// Encoding of batches on the telemetry topic
+enum TelemetryFormat : uint8_t {
+  TELEMETRY_FORMAT_JSON = 0,  // Array of objects (backend default)
+  TELEMETRY_FORMAT_CBOR = 1,  // Column-oriented CBOR, see telemetry_cbor.h
+};
+
+// Optional compression of telemetry batches
+enum TelemetryCompression : uint8_t {
+  TELEMETRY_COMPRESSION_NONE = 0,
+  TELEMETRY_COMPRESSION_LZ4 = 1,  // See telemetry_compress.h
+};
+
+// Accepted range of LEDConfig::telemetry_max_latency_s
+constexpr uint16_t TELEMETRY_MAX_LATENCY_MIN_S = 10;
+constexpr uint16_t TELEMETRY_MAX_LATENCY_MAX_S = 3600;
+
+// Stored in LEDConfig::version; bump it whenever a field is appended
+constexpr uint8_t LED_CONFIG_VERSION = 1;
+
+// New fields must be appended: older NVS blobs are loaded as a prefix.
+// Their length alone does not say which fields they hold, since a new
+// field may land in the tail padding of the old struct; fields newer than
+// the blob's version are reset to their defaults.
 struct LEDConfig {
   // Humidity thresholds (4 values: min, low-med boundary, med-high boundary, max)
   float humidity_thresholds[4];  // e.g., [0, 30, 70, 100]
@@ -30,6 +54,14 @@ struct LEDConfig {
   
   // Motion detection settings
   float distance_threshold_cm;    // Detection distance threshold in cm (e.g., 50.0)
+  
+  // Telemetry settings
+  uint8_t telemetry_format;       // TelemetryFormat
+  uint8_t telemetry_compression;  // TelemetryCompression
+  uint16_t telemetry_max_latency_s; // Upper bound on publish delay per record
+
+  // LED_CONFIG_VERSION of the firmware that saved it, 0 if older
+  uint8_t version;
 };
 
 // LED Configuration Manager
@@ -65,6 +97,8 @@ private:
   LEDConfigManager& operator=(const LEDConfigManager&) = delete;
   
   void initDefaultConfig();
+  static void setDefaults(LEDConfig& config);
+  static void upgrade(LEDConfig& config, size_t stored_size);
   
   LEDConfig config_;
   static const char* NVS_NAMESPACE;
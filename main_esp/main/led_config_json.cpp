@@ -0,0 +1,386 @@
+#include "led_config_json.h"
+#include "config.h"
+#include "json_reader.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+    enum class FieldType : uint8_t { Float, UInt8, UInt16, UInt32, Bool, Color, Enum };
+
+    struct FieldSpec {
+        const char* name;
+        FieldType type;
+        uint8_t count;             // Array length, 1 for a scalar
+        uint16_t offset;           // offsetof(LEDConfig, member)
+        float min;                 // Accepted range, in wire units
+        float max;
+        uint16_t scale;            // Stored value = wire value * scale
+        const char* const* names;  // Enum: wire name of each stored value
+        uint8_t num_names;
+    };
+
+    constexpr const char* kFormatNames[] = {"json", "cbor"};
+    constexpr const char* kCompressionNames[] = {"none", "lz4"};
+
+    constexpr FieldSpec kFields[] = {
+        {"humidityThresholds", FieldType::Float, 4, offsetof(LEDConfig, humidity_thresholds),
+         0, 100, 1, nullptr, 0},
+        {"colors", FieldType::Color, 3, offsetof(LEDConfig, colors), 0, 0, 1, nullptr, 0},
+        {"brightnessPct", FieldType::UInt8, 1, offsetof(LEDConfig, manual_brightness_pct),
+         0, 100, 1, nullptr, 0},
+        {"autobrightness", FieldType::Bool, 1, offsetof(LEDConfig, auto_brightness),
+         0, 0, 1, nullptr, 0},
+        {"numLeds", FieldType::UInt8, 1, offsetof(LEDConfig, num_leds_active),
+         1, WS2812B_NUM_LEDS, 1, nullptr, 0},
+        {"noMotionTimeoutSec", FieldType::UInt32, 1, offsetof(LEDConfig, no_motion_timeout_ms),
+         1, 300, 1000, nullptr, 0},
+        {"maxOnDurationSec", FieldType::UInt32, 1, offsetof(LEDConfig, max_on_duration_ms),
+         1, 600, 1000, nullptr, 0},
+        {"distanceThresholdCm", FieldType::Float, 1, offsetof(LEDConfig, distance_threshold_cm),
+         1, 400, 1, nullptr, 0},
+        {"telemetryFormat", FieldType::Enum, 1, offsetof(LEDConfig, telemetry_format),
+         0, 0, 1, kFormatNames, 2},
+        {"telemetryCompression", FieldType::Enum, 1, offsetof(LEDConfig, telemetry_compression),
+         0, 0, 1, kCompressionNames, 2},
+        {"telemetryMaxLatencySec", FieldType::UInt16, 1, offsetof(LEDConfig, telemetry_max_latency_s),
+         TELEMETRY_MAX_LATENCY_MIN_S, TELEMETRY_MAX_LATENCY_MAX_S, 1, nullptr, 0},
+    };
+
+    constexpr size_t element_size(FieldType type) {
+        return type == FieldType::Float    ? sizeof(float)
+               : type == FieldType::UInt8  ? sizeof(uint8_t)
+               : type == FieldType::UInt16 ? sizeof(uint16_t)
+               : type == FieldType::UInt32 ? sizeof(uint32_t)
+               : type == FieldType::Bool   ? sizeof(bool)
+               : type == FieldType::Color  ? sizeof(RGBColor)
+                                           : sizeof(uint8_t);
+    }
+
+    constexpr bool fields_fit_config() {
+        for (const FieldSpec& f : kFields) {
+            if (f.offset + f.count * element_size(f.type) > sizeof(LEDConfig)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(fields_fit_config(), "Field table does not match LEDConfig");
+
+    int hex_value(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    // Read one element into dst. Always consumes the value; returns false
+    // if it has the wrong type or is out of range.
+    bool decode_element(JsonReader& reader, const FieldSpec& f, uint8_t* dst) {
+        const char type = reader.peekType();
+        switch (f.type) {
+        case FieldType::Bool: {
+            if (type != 't' && type != 'f') {
+                break;
+            }
+            bool value;
+            if (!reader.readBool(&value)) {
+                return false;
+            }
+            memcpy(dst, &value, sizeof(value));
+            return true;
+        }
+
+        case FieldType::Color:
+        case FieldType::Enum: {
+            if (type != '"') {
+                break;
+            }
+            JsonSpan s;
+            if (!reader.readString(&s)) {
+                return false;
+            }
+            if (f.type == FieldType::Enum) {
+                for (uint8_t i = 0; i < f.num_names; i++) {
+                    if (s.equals(f.names[i])) {
+                        *dst = i;
+                        return true;
+                    }
+                }
+                return false;
+            }
+            // "RRGGBB"
+            if (s.len != 6) {
+                return false;
+            }
+            uint8_t rgb[3];
+            for (int i = 0; i < 3; i++) {
+                int hi = hex_value(s.data[2 * i]);
+                int lo = hex_value(s.data[2 * i + 1]);
+                if (hi < 0 || lo < 0) {
+                    return false;
+                }
+                rgb[i] = (uint8_t)(hi << 4 | lo);
+            }
+            RGBColor color = {rgb[0], rgb[1], rgb[2]};
+            memcpy(dst, &color, sizeof(color));
+            return true;
+        }
+
+        default: {
+            if (type != '0') {
+                break;
+            }
+            double value;
+            if (!reader.readNumber(&value)) {
+                return false;
+            }
+            if (!(value >= f.min && value <= f.max)) {
+                return false;
+            }
+            if (f.type == FieldType::Float) {
+                float v = (float)value;
+                memcpy(dst, &v, sizeof(v));
+            } else {
+                // Fractions are truncated, like cJSON's valueint
+                uint32_t v = (uint32_t)value * f.scale;
+                if (f.type == FieldType::UInt8) {
+                    *dst = (uint8_t)v;
+                } else if (f.type == FieldType::UInt16) {
+                    uint16_t v16 = (uint16_t)v;
+                    memcpy(dst, &v16, sizeof(v16));
+                } else {
+                    memcpy(dst, &v, sizeof(v));
+                }
+            }
+            return true;
+        }
+        }
+
+        reader.skipValue();
+        return false;
+    }
+
+    // Read a whole field (scalar or fixed-length array) into dst
+    bool decode_field(JsonReader& reader, const FieldSpec& f, uint8_t* dst) {
+        if (f.count == 1) {
+            return decode_element(reader, f, dst);
+        }
+        if (reader.peekType() != '[') {
+            reader.skipValue();
+            return false;
+        }
+
+        // Stage the elements so a bad one leaves the whole array unchanged
+        uint8_t staged[4 * sizeof(float)];
+        const size_t size = element_size(f.type);
+        bool valid = size * f.count <= sizeof(staged);
+        uint8_t n = 0;
+        reader.beginArray();
+        while (reader.nextElement()) {
+            if (n < f.count && valid) {
+                valid = decode_element(reader, f, staged + n * size);
+            } else {
+                reader.skipValue();
+            }
+            n++;
+        }
+        if (!valid || n != f.count) {
+            return false;
+        }
+        memcpy(dst, staged, size * f.count);
+        return true;
+    }
+
+    // Bounded output cursor; remembers overflow instead of checking each call
+    struct Writer {
+        char* p;
+        char* end;
+        bool overflow;
+
+        void put(char c) {
+            if (p < end) {
+                *p++ = c;
+            } else {
+                overflow = true;
+            }
+        }
+
+        void put(const char* s) {
+            while (*s) {
+                put(*s++);
+            }
+        }
+
+        void putUint(uint32_t v) {
+            char tmp[10];
+            int n = 0;
+            do {
+                tmp[n++] = (char)('0' + v % 10);
+                v /= 10;
+            } while (v != 0);
+            while (n > 0) {
+                put(tmp[--n]);
+            }
+        }
+
+        // One decimal, rounded half away from zero
+        void putTenths(float value) {
+            if (!std::isfinite(value)) {
+                value = 0;
+            }
+            double scaled = (double)value * 10.0;
+            if (scaled > 4e9) {
+                scaled = 4e9;
+            } else if (scaled < -4e9) {
+                scaled = -4e9;
+            }
+            if (scaled < 0) {
+                put('-');
+                scaled = -scaled;
+            }
+            uint32_t tenths = (uint32_t)(scaled + 0.5);
+            putUint(tenths / 10);
+            put('.');
+            put((char)('0' + tenths % 10));
+        }
+    };
+
+    void encode_element(Writer& w, const FieldSpec& f, const uint8_t* src) {
+        static const char kHex[] = "0123456789ABCDEF";
+        switch (f.type) {
+        case FieldType::Float: {
+            float v;
+            memcpy(&v, src, sizeof(v));
+            w.putTenths(v);
+            break;
+        }
+        case FieldType::UInt8:
+            w.putUint(*src / f.scale);
+            break;
+        case FieldType::UInt16: {
+            uint16_t v;
+            memcpy(&v, src, sizeof(v));
+            w.putUint(v / f.scale);
+            break;
+        }
+        case FieldType::UInt32: {
+            uint32_t v;
+            memcpy(&v, src, sizeof(v));
+            w.putUint(v / f.scale);
+            break;
+        }
+        case FieldType::Bool: {
+            bool v;
+            memcpy(&v, src, sizeof(v));
+            w.put(v ? "true" : "false");
+            break;
+        }
+        case FieldType::Color:
+            w.put('"');
+            for (int i = 0; i < 3; i++) {
+                w.put(kHex[src[i] >> 4]);
+                w.put(kHex[src[i] & 0x0F]);
+            }
+            w.put('"');
+            break;
+        case FieldType::Enum:
+            w.put('"');
+            w.put(f.names[*src < f.num_names ? *src : 0]);
+            w.put('"');
+            break;
+        }
+    }
+}
+
+LEDConfigDecodeResult led_config_json_decode(const char* json, size_t len, LEDConfig& config) {
+    LEDConfigDecodeResult result = {false, 0, 0};
+    LEDConfig staged = config;
+    uint8_t* base = reinterpret_cast<uint8_t*>(&staged);
+
+    JsonReader reader(json, len);
+    JsonSpan key;
+    if (!reader.beginObject()) {
+        return result;
+    }
+    while (reader.nextMember(&key)) {
+        const FieldSpec* spec = nullptr;
+        for (const FieldSpec& f : kFields) {
+            if (key.equals(f.name)) {
+                spec = &f;
+                break;
+            }
+        }
+        if (!spec) {
+            reader.skipValue();
+            continue;
+        }
+        if (decode_field(reader, *spec, base + spec->offset)) {
+            result.applied++;
+        } else {
+            result.rejected++;
+        }
+    }
+
+    if (!reader.ok() || !reader.atEnd()) {
+        result.applied = 0;
+        result.rejected = 0;
+        return result;
+    }
+
+    config = staged;
+    result.ok = true;
+    return result;
+}
+
+namespace {
+    // Encode every field, or only those that differ from baseline
+    size_t encode(char* out, size_t capacity, const LEDConfig& config, const LEDConfig* baseline) {
+        const uint8_t* base = reinterpret_cast<const uint8_t*>(&config);
+        const uint8_t* prev = reinterpret_cast<const uint8_t*>(baseline);
+        Writer w = {out, out + capacity, false};
+
+        w.put('{');
+        bool first = true;
+        for (const FieldSpec& f : kFields) {
+            const uint8_t* src = base + f.offset;
+            const size_t size = f.count * element_size(f.type);
+            if (prev && memcmp(src, prev + f.offset, size) == 0) {
+                continue;
+            }
+            if (!first) {
+                w.put(',');
+            }
+            first = false;
+            w.put('"');
+            w.put(f.name);
+            w.put("\":");
+
+            if (f.count == 1) {
+                encode_element(w, f, src);
+                continue;
+            }
+            w.put('[');
+            for (uint8_t i = 0; i < f.count; i++) {
+                if (i > 0) {
+                    w.put(',');
+                }
+                encode_element(w, f, src + i * element_size(f.type));
+            }
+            w.put(']');
+        }
+        w.put('}');
+
+        return w.overflow ? 0 : (size_t)(w.p - out);
+    }
+}
+
+size_t led_config_json_encode(char* out, size_t capacity, const LEDConfig& config) {
+    return encode(out, capacity, config, nullptr);
+}
+
+size_t led_config_json_encode_delta(char* out, size_t capacity, const LEDConfig& config,
+                                    const LEDConfig& baseline) {
+    return encode(out, capacity, config, &baseline);
+}
@@ -0,0 +1,63 @@
+#ifndef LED_CONFIG_JSON_H
+#define LED_CONFIG_JSON_H
+
+#include "led_config.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Table-driven JSON codec for LEDConfig
+ *
+ * A single constexpr table (led_config_json.cpp) lists every exposed field
+ * with its JSON name, type, position in LEDConfig, accepted range and
+ * scaling between wire and stored units (e.g. seconds on the wire,
+ * milliseconds in the struct). Both directions walk that table, so MQTT
+ * SET_CONFIG/GET_CONFIG and HTTP config updates always agree on the schema.
+ *
+ * Neither direction allocates: decoding reads the caller's buffer in place
+ * with JsonReader and encoding writes into a caller-provided buffer.
+ *
+ * Wire format (all members optional on decode):
+ *   {"humidityThresholds":[30.0,50.0,70.0,90.0],
+ *    "colors":["FF0000","00FF00","0000FF"],
+ *    "brightnessPct":80,"autobrightness":true,"numLeds":5,
+ *    "noMotionTimeoutSec":15,"maxOnDurationSec":300,
+ *    "distanceThresholdCm":50.0,"telemetryFormat":"json",
+ *    "telemetryCompression":"none","telemetryMaxLatencySec":120}
+ */
+
+// Upper bound for led_config_json_encode output
+constexpr size_t LED_CONFIG_JSON_MAX_LEN = 512;
+
+struct LEDConfigDecodeResult {
+    bool ok;             // false if the text is not a well-formed JSON object
+    uint8_t applied;     // Fields copied into the config
+    uint8_t rejected;    // Known fields with a wrong type or out of range
+};
+
+/**
+ * @brief Apply the members of a JSON object to config
+ *
+ * Unknown members are ignored; known members with an invalid value are
+ * skipped and counted. config is left untouched if the text is malformed.
+ */
+LEDConfigDecodeResult led_config_json_decode(const char* json, size_t len, LEDConfig& config);
+
+/**
+ * @brief Encode config as a JSON object (not NUL-terminated)
+ * @return Bytes written, or 0 if capacity is too small
+ */
+size_t led_config_json_encode(char* out, size_t capacity, const LEDConfig& config);
+
+/**
+ * @brief Encode only the fields of config that differ from baseline
+ *
+ * Produces "{}" when nothing changed. Fields compare by stored value, so
+ * a change that rounds away on the wire is still reported.
+ *
+ * @return Bytes written, or 0 if capacity is too small
+ */
+size_t led_config_json_encode_delta(char* out, size_t capacity, const LEDConfig& config,
+                                    const LEDConfig& baseline);
+
+#endif // LED_CONFIG_JSON_H
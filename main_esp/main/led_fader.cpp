@@ -0,0 +1,126 @@
+#include "led_fader.h"
+
+namespace {
+    constexpr uint32_t kOne = 1 << 16;
+
+    uint8_t lerp(uint8_t from, uint8_t to, uint32_t t) {
+        int32_t delta = (int32_t)to - (int32_t)from;
+        return (uint8_t)(from + ((delta * (int32_t)t + 0x8000) >> 16));
+    }
+
+    bool same(const LedState& a, const LedState& b) {
+        return a.red == b.red && a.green == b.green && a.blue == b.blue &&
+               a.brightness == b.brightness;
+    }
+}
+
+LedFader::LedFader(size_t num_leds)
+    : num_leds_(num_leds),
+      current_(new LedState[num_leds]()),
+      fades_(new Fade[num_leds]()) {
+}
+
+LedFader::~LedFader() {
+    delete[] current_;
+    delete[] fades_;
+}
+
+void LedFader::set(size_t index, const LedState& state) {
+    if (index >= num_leds_) {
+        return;
+    }
+    fades_[index].active = false;
+    current_[index] = state;
+}
+
+void LedFader::fadeTo(size_t index, const LedState& target, uint32_t duration_ms,
+                      LedEasing easing, int64_t now_ms, bool pulse) {
+    if (index >= num_leds_) {
+        return;
+    }
+    LedState from = current_[index];
+    LedState to = target;
+    if (from.brightness == 0) {
+        from.red = to.red;
+        from.green = to.green;
+        from.blue = to.blue;
+    } else if (to.brightness == 0) {
+        to.red = from.red;
+        to.green = from.green;
+        to.blue = from.blue;
+    }
+
+    Fade& fade = fades_[index];
+    fade.from = from;
+    fade.to = to;
+    fade.start_ms = now_ms;
+    fade.duration_ms = duration_ms;
+    fade.easing = easing;
+    fade.pulse = pulse;
+    fade.active = true;
+}
+
+bool LedFader::render(int64_t now_ms, LedFaderSink sink, void* arg) {
+    bool running = false;
+    for (size_t i = 0; i < num_leds_; i++) {
+        Fade& fade = fades_[i];
+        if (!fade.active) {
+            continue;
+        }
+
+        int64_t elapsed = now_ms - fade.start_ms;
+        if (elapsed < 0) {
+            elapsed = 0;
+        }
+        int64_t total = fade.pulse ? 2 * (int64_t)fade.duration_ms : fade.duration_ms;
+
+        LedState next;
+        if (elapsed >= total) {
+            next = fade.pulse ? fade.from : fade.to;
+            fade.active = false;
+        } else {
+            // A pulse runs the same curve backwards on the way home
+            int64_t t = elapsed < fade.duration_ms ? elapsed : total - elapsed;
+            uint32_t progress = (uint32_t)((t << 16) / fade.duration_ms);
+            uint32_t eased = ease(fade.easing, progress);
+            next.red = lerp(fade.from.red, fade.to.red, eased);
+            next.green = lerp(fade.from.green, fade.to.green, eased);
+            next.blue = lerp(fade.from.blue, fade.to.blue, eased);
+            next.brightness = lerp(fade.from.brightness, fade.to.brightness, eased);
+            running = true;
+        }
+
+        if (!same(next, current_[i])) {
+            current_[i] = next;
+            sink(i, next, arg);
+        }
+    }
+    return running;
+}
+
+bool LedFader::active() const {
+    for (size_t i = 0; i < num_leds_; i++) {
+        if (fades_[i].active) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t LedFader::ease(LedEasing easing, uint32_t progress) {
+    uint64_t p = progress > kOne ? kOne : progress;
+    switch (easing) {
+    case LedEasing::EaseIn:
+        return (uint32_t)((p * p) >> 16);
+    case LedEasing::EaseOut: {
+        uint64_t q = kOne - p;
+        return (uint32_t)(kOne - ((q * q) >> 16));
+    }
+    case LedEasing::EaseInOut:
+        // p^2 (3 - 2p), one shift at the end so the curve stays monotonic
+        return (uint32_t)((p * p * (3 * kOne - 2 * p)) >> 32);
+    case LedEasing::Linear:
+    default:
+        return (uint32_t)p;
+    }
+}
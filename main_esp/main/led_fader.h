@@ -0,0 +1,94 @@
+#ifndef LED_FADER_H
+#define LED_FADER_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Requested colour and brightness of one pixel, before LedColorPipeline
+struct LedState {
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    uint8_t brightness;
+};
+
+enum class LedEasing : uint8_t {
+    Linear,
+    EaseIn,     // Quadratic: slow start
+    EaseOut,    // Quadratic: slow finish
+    EaseInOut,  // Smoothstep: slow start and finish
+};
+
+// Called by LedFader::render() for each pixel whose state changed
+typedef void (*LedFaderSink)(size_t index, const LedState& state, void* arg);
+
+/**
+ * @brief Per-pixel colour and brightness transitions
+ *
+ * Each pixel has its own transition, so any number of them can be in
+ * flight, started at different times with different curves. fadeTo()
+ * starts from wherever the pixel is now, including the middle of another
+ * fade, so retargeting never jumps. A pulse goes to the target and back.
+ *
+ * Colour and brightness are interpolated separately in 16.16 fixed point.
+ * Fading in from off (brightness 0) or out to off keeps the lit colour
+ * and only moves brightness, so the colour does not pass through black.
+ *
+ * Nothing runs by itself: the owner calls render() on its frame tick.
+ *
+ * Pure logic with no ESP-IDF dependencies. Not thread-safe.
+ */
+class LedFader {
+public:
+    explicit LedFader(size_t num_leds);
+    ~LedFader();
+
+    LedFader(const LedFader&) = delete;
+    LedFader& operator=(const LedFader&) = delete;
+
+    size_t numLeds() const { return num_leds_; }
+
+    /**
+     * @brief Jump to a state, cancelling the pixel's transition
+     */
+    void set(size_t index, const LedState& state);
+
+    /**
+     * @brief Start a transition from the current state
+     * @param duration_ms Time to reach the target (each way for a pulse)
+     * @param pulse Return to the current state afterwards
+     */
+    void fadeTo(size_t index, const LedState& target, uint32_t duration_ms,
+                LedEasing easing, int64_t now_ms, bool pulse = false);
+
+    /**
+     * @brief Advance every transition to now_ms
+     * @return true while any transition is still in flight
+     */
+    bool render(int64_t now_ms, LedFaderSink sink, void* arg);
+
+    bool active() const;
+    const LedState& state(size_t index) const { return current_[index]; }
+
+    /**
+     * @brief Eased progress, 16.16 fixed point (0..65536 in and out)
+     */
+    static uint32_t ease(LedEasing easing, uint32_t progress);
+
+private:
+    struct Fade {
+        LedState from;
+        LedState to;
+        int64_t start_ms;
+        uint32_t duration_ms;
+        LedEasing easing;
+        bool pulse;
+        bool active;
+    };
+
+    size_t num_leds_;
+    LedState* current_;
+    Fade* fades_;
+};
+
+#endif // LED_FADER_H
@@ -0,0 +1,35 @@
+#include "led_frame_buffer.h"
+#include <cstring>
+
+LedFrameBuffer::LedFrameBuffer(size_t num_leds)
+    : num_leds_(num_leds), back_(nullptr), front_(nullptr) {
+    // One allocation for both; the strip starts dark, and so does the front
+    back_ = new uint8_t[2 * bytes()]();
+    front_ = back_ + bytes();
+}
+
+LedFrameBuffer::~LedFrameBuffer() {
+    delete[] back_;
+}
+
+void LedFrameBuffer::setPixel(size_t index, uint8_t red, uint8_t green, uint8_t blue) {
+    if (index >= num_leds_) {
+        return;
+    }
+    uint8_t* pixel = back_ + index * kBytesPerPixel;
+    pixel[kGreen] = green;
+    pixel[kRed] = red;
+    pixel[kBlue] = blue;
+}
+
+void LedFrameBuffer::clear() {
+    memset(back_, 0, bytes());
+}
+
+bool LedFrameBuffer::commit() {
+    if (memcmp(back_, front_, bytes()) == 0) {
+        return false;
+    }
+    memcpy(front_, back_, bytes());
+    return true;
+}
@@ -0,0 +1,69 @@
+#ifndef LED_FRAME_BUFFER_H
+#define LED_FRAME_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Front and back pixel buffers of an LED strip, in wire order (GRB)
+ *
+ * Callers draw into the back buffer. commit() makes it the next frame by
+ * copying it to the front buffer, which the transmitter reads, unless the
+ * two are identical: redrawing the same pixels (e.g. a periodic brightness
+ * update that did not change anything) then costs one compare and no
+ * transmission.
+ *
+ * Pure logic with no ESP-IDF dependencies. Not thread-safe: the owner
+ * serialises drawing against commit(), and must not commit while the
+ * front buffer is still being transmitted.
+ */
+class LedFrameBuffer {
+public:
+    static constexpr size_t kBytesPerPixel = 3;
+    // Offset of each channel within a pixel
+    static constexpr size_t kGreen = 0;
+    static constexpr size_t kRed = 1;
+    static constexpr size_t kBlue = 2;
+
+    explicit LedFrameBuffer(size_t num_leds);
+    ~LedFrameBuffer();
+
+    LedFrameBuffer(const LedFrameBuffer&) = delete;
+    LedFrameBuffer& operator=(const LedFrameBuffer&) = delete;
+
+    size_t numLeds() const { return num_leds_; }
+    size_t bytes() const { return num_leds_ * kBytesPerPixel; }
+
+    /**
+     * @brief Set one pixel of the back buffer (out of range is ignored)
+     */
+    void setPixel(size_t index, uint8_t red, uint8_t green, uint8_t blue);
+
+    /**
+     * @brief Bytes of one back buffer pixel, for writers that produce the
+     *        channels one at a time (see kRed etc.); nullptr if out of range
+     */
+    uint8_t* backPixel(size_t index) {
+        return index < num_leds_ ? back_ + index * kBytesPerPixel : nullptr;
+    }
+
+    /**
+     * @brief All pixels of the back buffer off
+     */
+    void clear();
+
+    /**
+     * @brief Promote the back buffer to the next frame
+     * @return false if it equals the frame already in front (nothing to send)
+     */
+    bool commit();
+
+    const uint8_t* front() const { return front_; }
+
+private:
+    size_t num_leds_;
+    uint8_t* back_;
+    uint8_t* front_;
+};
+
+#endif // LED_FRAME_BUFFER_H
@@ -0,0 +1,29 @@
+#include "led_session.h"
+
+LedSession::LedSession(const LedSessionConfig& config)
+    : config_(config), on_(false), session_start_ms_(0), last_present_ms_(0) {}
+
+LedAction LedSession::update(bool present, int64_t now_ms) {
+    LedAction action = LedAction::None;
+    if (present) {
+        last_present_ms_ = now_ms;
+        if (!on_) {
+            on_ = true;
+            session_start_ms_ = now_ms;
+            action = LedAction::On;
+        }
+    }
+    if (!on_) {
+        return action;
+    }
+
+    if (now_ms - session_start_ms_ >= (int64_t)config_.max_on_duration_ms) {
+        on_ = false;
+        return LedAction::OffMaxDuration;
+    }
+    if (now_ms - last_present_ms_ >= (int64_t)config_.no_motion_timeout_ms) {
+        on_ = false;
+        return LedAction::OffIdle;
+    }
+    return action;
+}
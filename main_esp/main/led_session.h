@@ -0,0 +1,52 @@
+#ifndef LED_SESSION_H
+#define LED_SESSION_H
+
+#include <cstdint>
+
+enum class LedAction : uint8_t {
+    None,
+    On,              // Presence started a session
+    OffIdle,         // no_motion_timeout_ms without presence
+    OffMaxDuration,  // Session reached max_on_duration_ms
+};
+
+struct LedSessionConfig {
+    uint32_t no_motion_timeout_ms;  // Off after this long without presence...
+    uint32_t max_on_duration_ms;    // ...or after this long on, whatever happens
+};
+
+/**
+ * @brief When the LEDs go on and off for presence
+ *
+ * Presence switches the LEDs on. They go off again once presence has been
+ * gone for no_motion_timeout_ms, or when the session reaches
+ * max_on_duration_ms even if someone is still there; in that case the
+ * next sample with presence starts a new session.
+ *
+ * Pure logic with caller-supplied timestamps, shared with the host-side
+ * trace replay. Not thread-safe.
+ */
+class LedSession {
+public:
+    explicit LedSession(const LedSessionConfig& config);
+
+    void setConfig(const LedSessionConfig& config) { config_ = config; }
+    const LedSessionConfig& config() const { return config_; }
+
+    /**
+     * @brief Account for one presence sample
+     * @return What the caller has to do with the LEDs now
+     */
+    LedAction update(bool present, int64_t now_ms);
+
+    bool on() const { return on_; }
+    int64_t sessionStartMs() const { return session_start_ms_; }
+
+private:
+    LedSessionConfig config_;
+    bool on_;
+    int64_t session_start_ms_;
+    int64_t last_present_ms_;
+};
+
+#endif // LED_SESSION_H
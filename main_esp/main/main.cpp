@@ -16,15 +16,25 @@
 #include "led_config.h"
 #include "ws2812b_controller.h"
 #include "hc_sr04.h"
+#include "rd01_radar.h"
+#include "presence_pipeline.h"
+#include "sampling_scheduler.h"
+#include "trace_recorder.h"
 #include "person_counter.h"  // Thread-safe person counter
 #include "latest_sensor_data.h"  // Thread-safe latest sensor readings
+#include "device_shadow.h"
 #include "wifi_config.h"
 #include "wifi_station.h"
 #include "bmp280.h"
 #include "driver/i2c_master.h"
 
+#include <cmath>
 #include <ctime>
 
+#if !PRESENCE_USE_HC_SR04 && !PRESENCE_USE_RD01
+#error "At least one presence sensor must be fitted (config.h)"
+#endif
+
 extern "C" {
 #include "app_common.h"
 #include "app_mqtt.h"
@@ -46,8 +56,16 @@ static const char *TAG = "main";
 // Global LED controller for WS2812B
 static WS2812BController* g_ws2812b = nullptr;
 
-// Global HC-SR04 distance sensor controller
-static HCSR04* g_hc_sr04 = nullptr;
+// Presence sensors fitted (see config.h); nullptr when absent
+struct PresenceSensors {
+  HCSR04* ultrasonic;
+  Rd01Radar* radar;
+};
+static PresenceSensors g_presence_sensors = {nullptr, nullptr};
+
+// Latest sampling statistics, published by distance_sensor_task
+static SamplingStats g_sampling_stats = {};
+static portMUX_TYPE g_sampling_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Global BMP280 handle
 static bmp280_handle_t g_bmp280 = NULL;
@@ -87,37 +105,46 @@ static void http_on_led_control(uint8_t red, uint8_t green, uint8_t blue, uint8_
     
     if (g_ws2812b != nullptr) {
         g_ws2812b->stop_animation();
-        vTaskDelay(pdMS_TO_TICKS(100));
-        g_ws2812b->clear();
         
-        // Set all LEDs to requested color
+        // Fade the active LEDs to the requested color, the rest off
         const LEDConfig& led_config = LEDConfigManager::getInstance().getConfig();
-        uint8_t num_leds = led_config.num_leds_active;
-        for (uint8_t i = 0; i < num_leds && i < WS2812B_NUM_LEDS; i++) {
-            g_ws2812b->set_pixel_brightness(i, red, green, blue, brightness);
-        }
-        g_ws2812b->refresh();
+        g_ws2812b->fade_to(led_config.num_leds_active, red, green, blue, brightness, WS2812B_FADE_MS);
+        DeviceShadow::setLed(brightness > 0, {red, green, blue}, (brightness * 100) / 255);
         
         ESP_LOGI(TAG, "LEDs updated via HTTP API");
     }
 }
 
-static void http_on_config_update(const char* json_config) {
-    ESP_LOGI(TAG, "HTTP Config Update: %s", json_config);
-    // Parse and apply configuration updates
-    // Could update LEDConfig, sensor thresholds, etc.
+static bool http_on_config_update(const char* json_config, size_t len) {
+    ESP_LOGI(TAG, "HTTP Config Update: %.*s", (int)len, json_config);
+    // Same schema and validation as MQTT SET_CONFIG
+    return app_mqtt_apply_config_json(json_config, len);
 }
 
 static const char* http_get_status(void) {
-    static char status_json[512];
+    static char status_json[1024];
     
     // Get latest sensor data
     float temperature = LatestSensorData::get_temperature();
     float humidity = LatestSensorData::get_humidity();
     int person_count = PersonCounter::get();
+    int occupancy = PersonCounter::get_occupancy();
     
     // Read photoresistor
     uint8_t ambient_light = read_photoresistor();
+
+    app_mqtt_publish_stats_t stats;
+    app_mqtt_get_publish_stats(&stats);
+    app_mqtt_connect_stats_t conn;
+    app_mqtt_get_connect_stats(&conn);
+    SamplingStats sampling;
+    portENTER_CRITICAL(&g_sampling_lock);
+    sampling = g_sampling_stats;
+    portEXIT_CRITICAL(&g_sampling_lock);
+    WS2812BStats leds = {};
+    if (g_ws2812b != nullptr) {
+        g_ws2812b->get_stats(&leds);
+    }
     
     // Build JSON status
     snprintf(status_json, sizeof(status_json),
@@ -125,16 +152,45 @@ static const char* http_get_status(void) {
         "\"temperature\":%.1f,"
         "\"humidity\":%.1f,"
         "\"personCount\":%d,"
+        "\"occupancy\":%d,"
         "\"ambientLight\":%d,"
         "\"wifiConnected\":%s,"
-        "\"firmwareVersion\":\"%s\""
+        "\"firmwareVersion\":\"%s\","
+        "\"publish\":{\"queued\":%lu,\"rssi\":%d,\"linkQuality\":%d,"
+        "\"ackLatencyMs\":%lu,\"holdSec\":%lu,\"window\":%d,"
+        "\"batches\":%lu,\"records\":%lu,\"maxAgeSec\":%lu},"
+        "\"connect\":{\"attempts\":%lu,\"connects\":%lu,\"resumed\":%lu,"
+        "\"lastMs\":%lu,\"minMs\":%lu,\"maxMs\":%lu,\"avgMs\":%lu,"
+        "\"offlineMs\":%lu},"
+        "\"sampling\":{\"intervalMs\":%lu,\"pingsPerHour\":%lu,\"energyMj\":%lu,"
+        "\"avgPowerUw\":%lu,\"detections\":%lu,\"latencyP50Ms\":%lu,"
+        "\"latencyP90Ms\":%lu,\"latencyP99Ms\":%lu,\"latencyMaxMs\":%lu},"
+        "\"leds\":{\"fps\":%lu,\"frames\":%lu,\"skipped\":%lu,\"coalesced\":%lu,"
+        "\"cpuUsAvg\":%lu,\"cpuUsMax\":%lu,\"txUs\":%lu}"
         "}",
         temperature,
         humidity,
         person_count,
+        occupancy,
         ambient_light,
         wifi_station_is_connected() ? "true" : "false",
-        ota_get_current_version()
+        ota_get_current_version(),
+        (unsigned long)stats.queued, stats.rssi, stats.link_quality,
+        (unsigned long)stats.ack_latency_ms, (unsigned long)stats.hold_s,
+        stats.window_size, (unsigned long)stats.batches_sent,
+        (unsigned long)stats.records_sent, (unsigned long)stats.max_age_s,
+        (unsigned long)conn.attempts, (unsigned long)conn.connects,
+        (unsigned long)conn.sessions_resumed, (unsigned long)conn.last_connect_ms,
+        (unsigned long)conn.min_connect_ms, (unsigned long)conn.max_connect_ms,
+        (unsigned long)conn.avg_connect_ms, (unsigned long)conn.last_offline_ms,
+        (unsigned long)sampling.interval_ms, (unsigned long)sampling.samples_per_hour,
+        (unsigned long)sampling.energy_mj, (unsigned long)sampling.avg_power_uw,
+        (unsigned long)sampling.detections, (unsigned long)sampling.latency_p50_ms,
+        (unsigned long)sampling.latency_p90_ms, (unsigned long)sampling.latency_p99_ms,
+        (unsigned long)sampling.latency_max_ms,
+        (unsigned long)leds.fps, (unsigned long)leds.frames, (unsigned long)leds.skipped,
+        (unsigned long)leds.coalesced, (unsigned long)leds.cpu_us_avg,
+        (unsigned long)leds.cpu_us_max, (unsigned long)leds.tx_us
     );
     
     return status_json;
@@ -179,195 +235,295 @@ static uint8_t read_photoresistor() {
   return percentage;
 }
 
-// Task reading HC-SR04 distance sensor
+static PresenceFusionConfig make_fusion_config(const PresenceSensors& sensors) {
+  PresenceFusionConfig config = {};
+  config.sources[PRESENCE_SOURCE_ULTRASONIC] = {
+    sensors.ultrasonic ? FUSION_ULTRASONIC_WEIGHT : 0.0f,
+    FUSION_ULTRASONIC_HIT, FUSION_ULTRASONIC_FALSE, FUSION_ULTRASONIC_SMOOTH_MS,
+    FUSION_ULTRASONIC_STALE_MS,
+  };
+  config.sources[PRESENCE_SOURCE_RADAR] = {
+    sensors.radar ? FUSION_RADAR_WEIGHT : 0.0f,
+    FUSION_RADAR_HIT, FUSION_RADAR_FALSE, FUSION_RADAR_SMOOTH_MS, FUSION_RADAR_STALE_MS,
+  };
+  config.sources[PRESENCE_SOURCE_LIGHT] = {
+    USE_REAL_PHOTORESISTOR ? FUSION_LIGHT_WEIGHT : 0.0f,
+    FUSION_LIGHT_HIT, FUSION_LIGHT_FALSE, FUSION_LIGHT_SMOOTH_MS, FUSION_LIGHT_STALE_MS,
+  };
+  // No RSSI producer yet: BLE links are to the sensor tag, not to people
+  config.sources[PRESENCE_SOURCE_BLE_RSSI] = {0.0f, 0.5f, 0.5f, 0, 0};
+  config.prior = FUSION_PRIOR;
+  config.enter_p = FUSION_ENTER_P;
+  config.exit_p = FUSION_EXIT_P;
+  return config;
+}
+
+static PresencePipelineConfig make_pipeline_config(const PresenceSensors& sensors) {
+  const LEDConfig& led_config = LEDConfigManager::getInstance().getConfig();
+  PresencePipelineConfig config = {};
+  config.motion = {
+    .enter_cm = led_config.distance_threshold_cm,
+    .exit_margin_cm = MOTION_EXIT_MARGIN_CM,
+    .median_window = MOTION_MEDIAN_WINDOW,
+    .enter_debounce_ms = MOTION_ENTER_DEBOUNCE_MS,
+    .exit_debounce_ms = MOTION_EXIT_DEBOUNCE_MS,
+    .min_dwell_ms = MOTION_MIN_DWELL_MS,
+  };
+  config.flow = {
+    .channels = FLOW_SENSOR_CHANNELS,
+    .min_travel_cm = FLOW_MIN_TRAVEL_CM,
+    .approach_is_entry = FLOW_APPROACH_IS_ENTRY != 0,
+    .pair_window_ms = FLOW_PAIR_WINDOW_MS,
+  };
+  config.fusion = make_fusion_config(sensors);
+  config.led = {
+    .no_motion_timeout_ms = led_config.no_motion_timeout_ms,
+    .max_on_duration_ms = led_config.max_on_duration_ms,
+  };
+  return config;
+}
+
+// Local hour of day for the occupancy history, or -1 until SNTP set the clock
+static int local_hour() {
+  time_t now = time(nullptr);
+  if (now < Telemetry::TELEMETRY_EPOCH) {
+    return -1;
+  }
+  struct tm local;
+  localtime_r(&now, &local);
+  return local.tm_hour;
+}
+
+// Task reading the presence sensors; the decisions are PresencePipeline's,
+// so a recorded trace replays to the same result on a host (trace_replay)
 static void distance_sensor_task(void *arg) {
-  HCSR04 *sensor = static_cast<HCSR04 *>(arg);
-  
-  // Person counting variables - track detection SESSIONS not individual detections
-  static bool in_detection_session = false;  // Track if we're in an active detection session
+  const PresenceSensors *sensors = static_cast<const PresenceSensors *>(arg);
   
-  // LED timer variables
-  static int64_t last_motion_time = 0;        // Last time motion was detected
-  static int64_t led_session_start_time = 0;  // When LED session started
-  static bool leds_on = false;
+  // Presence sessions (not individual readings) are what gets counted; the
+  // LEDs and the visit count follow the fused estimate
+  PresencePipeline pipeline(make_pipeline_config(*sensors));
+  TraceRecorder::set_config(pipeline.config());
+#if USE_REAL_PHOTORESISTOR
+  float light_baseline = -1;  // Ambient light with nobody there, in %
+#endif
+
+  SamplingSchedulerConfig sampling_config = {
+    .min_interval_ms = SAMPLING_MIN_INTERVAL_MS,
+    .max_interval_ms = SAMPLING_MAX_INTERVAL_MS,
+    .max_latency_ms = SAMPLING_MAX_LATENCY_MS,
+    .attack_ms = SAMPLING_ATTACK_MS,
+    .quiet_p = FUSION_EXIT_P,
+    .alert_p = FUSION_ENTER_P,
+    .recency_ms = SAMPLING_RECENCY_MS,
+    .led_urgency = SAMPLING_LED_URGENCY,
+    .history_gain = SAMPLING_HISTORY_GAIN,
+    .history_alpha = SAMPLING_HISTORY_ALPHA,
+    .sample_energy_uj = (uint32_t)((sensors->ultrasonic ? SAMPLING_PING_ENERGY_UJ : 0) +
+                                   SAMPLING_WAKE_ENERGY_UJ),
+  };
+  SamplingScheduler scheduler(sampling_config);
+  int64_t last_sampling_log = 0;
   
   // Store current LED color (set once when LEDs activate, don't change during session)
   static uint8_t current_led_red = 0;
   static uint8_t current_led_green = 0;
   static uint8_t current_led_blue = 0;
   
-  // Measure distance every 50ms for ultra-fast detection (20 times per second)
+  // Sample every 50 ms while someone is around, slower when it is quiet
   while (true) {
-    float distance_cm = sensor->measure_distance_cm();
+    // Follow threshold and timeout changes made through SET_CONFIG or the HTTP API
+    const LEDConfig& led_config_now = LEDConfigManager::getInstance().getConfig();
+    const PresencePipelineConfig& active_config = pipeline.config();
+    if (led_config_now.distance_threshold_cm != active_config.motion.enter_cm ||
+        led_config_now.no_motion_timeout_ms != active_config.led.no_motion_timeout_ms ||
+        led_config_now.max_on_duration_ms != active_config.led.max_on_duration_ms) {
+      PresencePipelineConfig pipeline_config = active_config;
+      pipeline_config.motion.enter_cm = led_config_now.distance_threshold_cm;
+      pipeline_config.led.no_motion_timeout_ms = led_config_now.no_motion_timeout_ms;
+      pipeline_config.led.max_on_duration_ms = led_config_now.max_on_duration_ms;
+      pipeline.setConfig(pipeline_config);
+      TraceRecorder::set_config(pipeline_config);
+    }
 
-    if (distance_cm > 0) {
-      // Distance measurement successful (logging disabled to reduce clutter)
+    // Ranging for MotionDetector: the HC-SR04 if fitted, else the radar
+    PresenceSample sample = {};
+    sample.distance_cm = -1;
+    bool sensor_ok = false;
+    if (sensors->ultrasonic != nullptr) {
+      sample.distance_cm = sensors->ultrasonic->measure_distance_cm();
+      sensor_ok = sample.distance_cm > 0;
+      if (!sensor_ok) {
+        ESP_LOGW(TAG, "Distance measurement failed");
+      }
+    }
+
+    if (sensors->radar != nullptr) {
+      // Only waits when the radar is the only sensor, to pace the loop
+      Rd01Report report;
+      TickType_t wait = sensors->ultrasonic ? 0 : pdMS_TO_TICKS(RD01_REPORT_WAIT_MS);
+      if (sensors->radar->get_report(&report, wait)) {
+        sample.radar_report = true;
+        sample.radar_target = report.present();
+        sample.radar_cm = report.distance_cm();
+        if (sensors->ultrasonic == nullptr) {
+          sample.distance_cm = report.present() ? (float)report.distance_cm() : -1;
+          sensor_ok = true;
+        }
+      } else if (sensors->ultrasonic == nullptr) {
+        ESP_LOGW(TAG, "No report from the radar");
+      }
+    }
+    DeviceShadow::reportSensor(SHADOW_SENSOR_DISTANCE, sensor_ok);
+
+#if USE_REAL_PHOTORESISTOR
+    // A shadow on the photoresistor; our own LEDs would look the same
+    if (pipeline.fusion().enabled(PRESENCE_SOURCE_LIGHT) && !pipeline.leds().on()) {
+      float light = read_photoresistor();
+      if (light_baseline < 0) {
+        light_baseline = light;
+      }
+      sample.light_observed = true;
+      sample.light_shadow = fabsf(light - light_baseline) >= FUSION_LIGHT_DELTA_PCT;
+      light_baseline += (light - light_baseline) * FUSION_LIGHT_BASELINE_ALPHA;
+    }
+#endif
+
+    int64_t current_time = esp_timer_get_time() / 1000;
+    sample.time_ms = current_time;
+    const PresenceStep& step = pipeline.step(sample);
+    TraceRecorder::record(sample, step);
+    const PresenceEstimate& presence = step.presence;
+
+    if (step.flow != FlowDirection::None) {
+      bool entry = step.flow == FlowDirection::Entry;
+      uint32_t occupancy = pipeline.flow().occupancy();
+      PersonCounter::record_flow(entry, (int)occupancy);
+      ESP_LOGI(TAG, "%s - occupancy now %lu", entry ? "Entry" : "Exit",
+               (unsigned long)occupancy);
+    }
+    if (step.onset) {
+      PersonCounter::increment();
+      ESP_LOGI(TAG, "New person detected (p=%.2f, confidence %.2f)! Total count: %d",
+               presence.probability, presence.confidence, PersonCounter::get());
+    } else if (step.ended) {
+      ESP_LOGI(TAG, "Person left after %lld ms",
+               (long long)(current_time - pipeline.fusion().presentSinceMs()));
+    }
+    PresenceSourceStats source_stats[PRESENCE_SOURCE_COUNT];
+    for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+      source_stats[i] = pipeline.fusion().stats((PresenceSource)i);
+    }
+    PersonCounter::set_presence_stats(source_stats);
+
+    if (step.led == LedAction::On && g_ws2812b != nullptr) {
+      // Get latest BLE sensor data for LED color selection
+      float temperature = LatestSensorData::get_temperature();
+      float humidity = LatestSensorData::get_humidity();
       
-      // Get configurable detection threshold
-      float detection_threshold = LEDConfigManager::getInstance().getConfig().distance_threshold_cm;
+      ESP_LOGD(TAG, "Presence p=%.2f, distance: %.1f cm", presence.probability,
+               pipeline.detector().filteredCm());
+      ESP_LOGD(TAG, "Environmental Data - Temp: %.1f°C, Humidity: %.1f%%", temperature, humidity);
       
-      // Check if someone is detected (distance < threshold)
-      if (distance_cm < detection_threshold) {
-        // Update last motion time (for LED timeout tracking)
-        int64_t current_time = esp_timer_get_time() / 1000;
-        last_motion_time = current_time;
-        
-        // Count person ONLY when starting a NEW detection session
-        if (!in_detection_session) {
-          PersonCounter::increment();
-          in_detection_session = true;
-          ESP_LOGI(TAG, "New person detected! Total count: %d", PersonCounter::get());
-          
-          // Start LED session if not already on
-          if (!leds_on) {
-            led_session_start_time = current_time;
-          }
-        }
-        
-        // Get latest BLE sensor data for LED color selection
-        float temperature = LatestSensorData::get_temperature();
-        float humidity = LatestSensorData::get_humidity();
-        
-        ESP_LOGD(TAG, "Motion detected! Distance: %.1f cm", distance_cm);
-        ESP_LOGD(TAG, "Environmental Data - Temp: %.1f°C, Humidity: %.1f%%", temperature, humidity);
-        
-        // Get LED configuration
-        LEDConfigManager& config_manager = LEDConfigManager::getInstance();
-        const LEDConfig& led_config = config_manager.getConfig();
-        
-        // Determine LED color based on CONFIGURABLE humidity thresholds
-        RGBColor color = config_manager.getColorForHumidity(humidity);
-        uint8_t red = color.r;
-        uint8_t green = color.g;
-        uint8_t blue = color.b;
-        
-        ESP_LOGD(TAG, "Humidity-based color: R:%d G:%d B:%d", red, green, blue);
-        
-        // Determine LED brightness based on photoresistor (or manual setting)
-        uint8_t ambient_light_pct;
-        
-        #if USE_REAL_PHOTORESISTOR
-          // Read real photoresistor on GPIO34
-          ambient_light_pct = read_photoresistor();
-        #else
-          // Simulate photoresistor reading (0-100% ambient light)
-          ambient_light_pct = esp_random() % 101;
-        #endif
-        
-        uint8_t brightness = config_manager.getBrightnessForAmbientLight(ambient_light_pct);
-        
-        if (led_config.auto_brightness) {
-          ESP_LOGD(TAG, "Ambient light: %d%% → Auto-brightness: %d%%", 
-                   ambient_light_pct, (brightness * 100) / 255);
-        } else {
-          ESP_LOGD(TAG, "Manual brightness: %d%%", (brightness * 100) / 255);
-        }
-        
-        // Activate LEDs if not already on
-        if (g_ws2812b != nullptr && !leds_on) {
-          ESP_LOGI(TAG, "Activating LEDs...");
-          g_ws2812b->stop_animation();
-          
-          // Give a moment for the animation task to fully stop and clear
-          vTaskDelay(pdMS_TO_TICKS(100));
-          
-          // Clear all LEDs first
-          g_ws2812b->clear();
-          
-          // Store the color for this session (won't change until LEDs turn off)
-          current_led_red = red;
-          current_led_green = green;
-          current_led_blue = blue;
-          
-          // Set only the configured number of LEDs
-          uint8_t num_leds = led_config.num_leds_active;
-          for (uint8_t i = 0; i < num_leds && i < WS2812B_NUM_LEDS; i++) {
-            g_ws2812b->set_pixel_brightness(i, red, green, blue, brightness);
-          }
-          g_ws2812b->refresh();
-          
-          ESP_LOGD(TAG, "%d LEDs set to R:%d G:%d B:%d at %d%% brightness", 
-                   num_leds, red, green, blue, (brightness * 100) / 255);
-          
-          ESP_LOGI(TAG, "LEDs activated (will stay on while motion detected, max 5min)");
-          leds_on = true;
-        }
+      // Get LED configuration
+      LEDConfigManager& config_manager = LEDConfigManager::getInstance();
+      const LEDConfig& led_config = config_manager.getConfig();
+      
+      // Determine LED color based on CONFIGURABLE humidity thresholds
+      RGBColor color = config_manager.getColorForHumidity(humidity);
+      uint8_t red = color.r;
+      uint8_t green = color.g;
+      uint8_t blue = color.b;
+      
+      ESP_LOGD(TAG, "Humidity-based color: R:%d G:%d B:%d", red, green, blue);
+      
+      // Determine LED brightness based on photoresistor (or manual setting)
+      uint8_t ambient_light_pct;
+      
+      #if USE_REAL_PHOTORESISTOR
+        // Read real photoresistor on GPIO34
+        ambient_light_pct = read_photoresistor();
+      #else
+        // Simulate photoresistor reading (0-100% ambient light)
+        ambient_light_pct = esp_random() % 101;
+      #endif
+      
+      uint8_t brightness = config_manager.getBrightnessForAmbientLight(ambient_light_pct);
+      
+      if (led_config.auto_brightness) {
+        ESP_LOGD(TAG, "Ambient light: %d%% → Auto-brightness: %d%%", 
+                 ambient_light_pct, (brightness * 100) / 255);
       } else {
-        // No motion detected - end detection session when no longer in range
-        in_detection_session = false;
+        ESP_LOGD(TAG, "Manual brightness: %d%%", (brightness * 100) / 255);
       }
-    } else {
-      ESP_LOGW(TAG, "Distance measurement failed");
-    }
-    
-    
-    // Smart LED auto-off logic
-    if (leds_on && g_ws2812b != nullptr) {
-      int64_t current_time = esp_timer_get_time() / 1000;
-      int64_t time_since_motion = current_time - last_motion_time;
-      int64_t session_duration = current_time - led_session_start_time;
       
-      // Get configurable timeout values
+      ESP_LOGI(TAG, "Activating LEDs...");
+      g_ws2812b->stop_animation();
+      
+      // Store the color for this session (won't change until LEDs turn off)
+      current_led_red = red;
+      current_led_green = green;
+      current_led_blue = blue;
+      
+      // Fade in only the configured number of LEDs, the rest off; the LED
+      // task renders it, this loop carries on sampling
+      uint8_t num_leds = led_config.num_leds_active;
+      g_ws2812b->fade_to(num_leds, red, green, blue, brightness, WS2812B_FADE_IN_MS, LedEasing::EaseOut);
+      
+      ESP_LOGD(TAG, "%d LEDs set to R:%d G:%d B:%d at %d%% brightness", 
+               num_leds, red, green, blue, (brightness * 100) / 255);
+      
+      ESP_LOGI(TAG, "LEDs activated (will stay on while motion detected, max %lus)",
+               (unsigned long)(led_config.max_on_duration_ms / 1000));
+      DeviceShadow::setLed(true, {red, green, blue}, (brightness * 100) / 255);
+    } else if ((step.led == LedAction::OffIdle || step.led == LedAction::OffMaxDuration) &&
+               g_ws2812b != nullptr) {
+      // Smart LED auto-off: LedSession decided the session is over
       const LEDConfig& timeout_config = LEDConfigManager::getInstance().getConfig();
+      if (step.led == LedAction::OffMaxDuration) {
+        ESP_LOGI(TAG, "Turning off LEDs (max duration %lus reached)", 
+                 (unsigned long)(timeout_config.max_on_duration_ms / 1000));
+      } else {
+        ESP_LOGI(TAG, "Turning off LEDs (%lus of no motion)", 
+                 (unsigned long)(timeout_config.no_motion_timeout_ms / 1000));
+      }
       
-      // Turn off LEDs if:
-      // 1. No motion for configured timeout, OR
-      // 2. Session exceeded configured maximum duration
-      if (time_since_motion >= timeout_config.no_motion_timeout_ms || 
-          session_duration >= timeout_config.max_on_duration_ms) {
-        
-        if (session_duration >= timeout_config.max_on_duration_ms) {
-          ESP_LOGI(TAG, "Turning off LEDs (max duration %lus reached)", 
-                   (unsigned long)(timeout_config.max_on_duration_ms / 1000));
-        } else {
-          ESP_LOGI(TAG, "Turning off LEDs (%lus of no motion)", 
-                   (unsigned long)(timeout_config.no_motion_timeout_ms / 1000));
-        }
+      g_ws2812b->fade_to(0, 0, 0, 0, 0, WS2812B_FADE_OUT_MS);  // All off
+      DeviceShadow::setLed(false, {0, 0, 0}, 0);
+    } else if (step.leds_on && g_ws2812b != nullptr) {
+      // LEDs are still on - update brightness dynamically based on ambient light
+      // Update every 1 second (the loop rate varies with SamplingScheduler)
+      static int64_t last_brightness_update = 0;
+      if (current_time - last_brightness_update >= 1000) {
+        last_brightness_update = current_time;
         
-        g_ws2812b->clear();
-        g_ws2812b->refresh();
-        leds_on = false;
+        LEDConfigManager& config_mgr = LEDConfigManager::getInstance();
+        const LEDConfig& current_config = config_mgr.getConfig();
         
-        // End detection session
-        in_detection_session = false;
-      } else {
-        // LEDs are still on - update brightness dynamically based on ambient light
-        // Update every 1 second (50ms * 20 cycles)
-        static int brightness_update_counter = 0;
-        if (++brightness_update_counter >= 20) {
-          brightness_update_counter = 0;
+        // Only update if auto-brightness is enabled
+        if (current_config.auto_brightness) {
+          // Read current ambient light
+          uint8_t ambient_light_pct;
           
-          LEDConfigManager& config_mgr = LEDConfigManager::getInstance();
-          const LEDConfig& current_config = config_mgr.getConfig();
+          #if USE_REAL_PHOTORESISTOR
+            // Read real photoresistor
+            ambient_light_pct = read_photoresistor();
+          #else
+            // Simulate
+            ambient_light_pct = esp_random() % 101;
+          #endif
           
-          // Only update if auto-brightness is enabled
-          if (current_config.auto_brightness) {
-            // Read current ambient light
-            uint8_t ambient_light_pct;
-            
-            #if USE_REAL_PHOTORESISTOR
-              // Read real photoresistor
-              ambient_light_pct = read_photoresistor();
-            #else
-              // Simulate
-              ambient_light_pct = esp_random() % 101;
-            #endif
-            
-            // Calculate new brightness based on ambient light
-            uint8_t new_brightness = config_mgr.getBrightnessForAmbientLight(ambient_light_pct);
-            
-            // Update LEDs with new brightness BUT KEEP THE SAME COLOR
-            uint8_t num_leds = current_config.num_leds_active;
-            g_ws2812b->clear();
-            for (uint8_t i = 0; i < num_leds && i < WS2812B_NUM_LEDS; i++) {
-              // Use stored color values (current_led_red/green/blue), only change brightness
-              g_ws2812b->set_pixel_brightness(i, current_led_red, current_led_green, current_led_blue, new_brightness);
-            }
-            g_ws2812b->refresh();
-            
-            ESP_LOGI(TAG, "Updated LED brightness: %d%% (ambient light: %d%%)", 
-                     (new_brightness * 100) / 255, ambient_light_pct);
-          }
+          // Calculate new brightness based on ambient light
+          uint8_t new_brightness = config_mgr.getBrightnessForAmbientLight(ambient_light_pct);
+          
+          // Update LEDs with new brightness BUT KEEP THE SAME COLOR
+          // Use stored color values (current_led_red/green/blue), only change brightness
+          g_ws2812b->fade_to(current_config.num_leds_active, current_led_red,
+                             current_led_green, current_led_blue, new_brightness, WS2812B_FADE_MS);
+          DeviceShadow::setLed(true, {current_led_red, current_led_green, current_led_blue},
+                               (new_brightness * 100) / 255);
+          
+          ESP_LOGI(TAG, "Updated LED brightness: %d%% (ambient light: %d%%)", 
+                   (new_brightness * 100) / 255, ambient_light_pct);
         }
       }
     }
@@ -375,32 +531,40 @@ static void distance_sensor_task(void *arg) {
     // Person count telemetry is now handled by sensor_task every 30 seconds
     // No duplicate telemetry needed here
 
-    // Check for idle timeout (5 seconds) to enter power saving mode
-    int64_t time_since_motion_ms = esp_timer_get_time() / 1000 - last_motion_time;
-    
-    // Default loop delay (Active mode)
-    int loop_delay_ms = 50; 
-    
-    // Dynamic Polling Logic (State Machine)
-    static bool in_idle_mode = false;
-
-    if (!leds_on && time_since_motion_ms > 5000) {
-        // Idle Mode (Condition met)
-        if (!in_idle_mode) {
-            ESP_LOGI(TAG, "No activity for 5s. Entering low-power idle mode (Polling: 500ms)");
-            in_idle_mode = true;
-        }
-        loop_delay_ms = 500; 
-    } else {
-        // Active Mode (Condition met)
-        if (in_idle_mode) {
-            ESP_LOGI(TAG, "Activity detected. Waking up to active mode (Polling: 50ms)");
-            in_idle_mode = false;
-        }
-        loop_delay_ms = 50;
+    // Next sample: a continuous rate from presence, recent activity, this
+    // hour's occupancy history and the LEDs, with a fast-attack path as
+    // soon as the raw readings show something in range
+    SamplingInput sampling_input = {
+      .now_ms = current_time,
+      .probability = presence.probability,
+      .present = presence.present,
+      .hint = step.hint,
+      .leds_on = step.leds_on,
+      .hour = local_hour(),
+    };
+    uint32_t loop_delay_ms = scheduler.next(sampling_input);
+
+    SamplingStats sampling = scheduler.stats(current_time);
+    portENTER_CRITICAL(&g_sampling_lock);
+    g_sampling_stats = sampling;
+    portEXIT_CRITICAL(&g_sampling_lock);
+    if (current_time - last_sampling_log >= 60000) {
+      last_sampling_log = current_time;
+      ESP_LOGI(TAG, "Sampling: every %lu ms, %lu pings/h, ~%lu uW, latency p50/p90/p99 %lu/%lu/%lu ms",
+               (unsigned long)sampling.interval_ms, (unsigned long)sampling.samples_per_hour,
+               (unsigned long)sampling.avg_power_uw, (unsigned long)sampling.latency_p50_ms,
+               (unsigned long)sampling.latency_p90_ms, (unsigned long)sampling.latency_p99_ms);
+      if (g_ws2812b != nullptr) {
+        WS2812BStats leds;
+        g_ws2812b->get_stats(&leds);
+        ESP_LOGI(TAG, "LEDs: %lu frames (%lu fps), %lu unchanged skipped, %lu coalesced, cpu avg/max %lu/%lu us, tx %lu us",
+                 (unsigned long)leds.frames, (unsigned long)leds.fps, (unsigned long)leds.skipped,
+                 (unsigned long)leds.coalesced, (unsigned long)leds.cpu_us_avg,
+                 (unsigned long)leds.cpu_us_max, (unsigned long)leds.tx_us);
+      }
     }
 
-    vTaskDelay(pdMS_TO_TICKS(loop_delay_ms));  // Dynamic delay
+    vTaskDelay(pdMS_TO_TICKS(loop_delay_ms));
   }
 }
 
@@ -516,9 +680,18 @@ extern "C" void app_main(void) {
     return;
   }
 
+  // Mount the flash telemetry spool (keeps backlog across reboots/outages)
+  if (!SensorManager::getInstance().initSpool()) {
+    ESP_LOGW(TAG, "Telemetry spool unavailable, using RAM queue only");
+  }
+  if (!SensorManager::getInstance().initSequence()) {
+    ESP_LOGW(TAG, "Telemetry sequence checkpoint not persisted");
+  }
+
   // Inicjalizacja MQTT client
   ESP_LOGI(TAG, "Initializing MQTT...");
   app_mqtt_init();
+  DeviceShadow::setFirmwareVersion(ota_get_current_version());
 
   // Inicjalizacja BLE Stack (NimBLE)
   ESP_LOGI(TAG, "Initializing BLE Stack...");
@@ -546,20 +719,31 @@ extern "C" void app_main(void) {
   LEDController led(LED_GPIO, LED_BLINK_PERIOD_MS);
 
   // Inicjalizacja WS2812B LED strip
-  WS2812BController ws2812b(WS2812B_GPIO, WS2812B_NUM_LEDS);
+  WS2812BController ws2812b(WS2812B_GPIO, WS2812B_NUM_LEDS, WS2812B_MAX_FPS);
   if (!ws2812b.init()) {
     ESP_LOGE(TAG, "Failed to initialize WS2812B LED strip!");
     return;
   }
+  ws2812b.set_white_balance(WS2812B_WHITE_BALANCE_R, WS2812B_WHITE_BALANCE_G, WS2812B_WHITE_BALANCE_B);
   g_ws2812b = &ws2812b;
   
-  // Inicjalizacja HC-SR04 distance sensor
+  // Inicjalizacja presence sensors (HC-SR04 and/or Rd-01 radar)
+#if PRESENCE_USE_HC_SR04
   HCSR04 hc_sr04(HC_SR04_TRIG_GPIO, HC_SR04_ECHO_GPIO);
   if (!hc_sr04.init()) {
     ESP_LOGE(TAG, "Failed to initialize HC-SR04 distance sensor!");
     return;
   }
-  g_hc_sr04 = &hc_sr04;
+  g_presence_sensors.ultrasonic = &hc_sr04;
+#endif
+#if PRESENCE_USE_RD01
+  Rd01Radar radar(RD01_UART_PORT, RD01_TX_GPIO, RD01_RX_GPIO, RD01_BAUD_RATE);
+  if (!radar.init()) {
+    ESP_LOGE(TAG, "Failed to initialize Rd-01 radar!");
+    return;
+  }
+  g_presence_sensors.radar = &radar;
+#endif
   
   // Initialize photoresistor ADC
   ESP_LOGI(TAG, "Initializing photoresistor...");
@@ -655,11 +839,14 @@ extern "C" void app_main(void) {
   // Initialize thread-safe person counter before starting tasks
   PersonCounter::init();
   
+  // Initialize the presence trace ring (dumped over HTTP and MQTT)
+  TraceRecorder::init();
+  
   // Initialize thread-safe latest sensor data cache
   LatestSensorData::init();
   
-  // Start HC-SR04 distance sensor reading task
-  xTaskCreatePinnedToCore(distance_sensor_task, "distance_sensor", 4096, &hc_sr04, 3, NULL, 1);
+  // Start presence sensor reading task
+  xTaskCreatePinnedToCore(distance_sensor_task, "distance_sensor", 5120, &g_presence_sensors, 3, NULL, 1);
   
   // Start BLE sensor reading task
   sensor_reading_task_start(g_bmp280);
@@ -672,7 +859,8 @@ extern "C" void app_main(void) {
   http_server_callbacks_t http_callbacks = {
     .on_led_control = http_on_led_control,
     .on_config_update = http_on_config_update,
-    .get_status = http_get_status
+    .get_status = http_get_status,
+    .dump_trace = TraceRecorder::dump
   };
   http_server_register_callbacks(&http_callbacks);
   
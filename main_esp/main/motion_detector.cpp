@@ -0,0 +1,152 @@
+#include "motion_detector.h"
+
+MotionDetector::MotionDetector(const MotionDetectorConfig& config)
+    : callback_(nullptr), callback_arg_(nullptr) {
+    reset();
+    setConfig(config);
+}
+
+void MotionDetector::setConfig(const MotionDetectorConfig& config) {
+    config_ = config;
+    // The median needs an odd window that fits the ring
+    if (config_.median_window < 1) {
+        config_.median_window = 1;
+    } else if (config_.median_window > kMaxWindow) {
+        config_.median_window = kMaxWindow;
+    }
+    if (config_.median_window % 2 == 0) {
+        config_.median_window--;
+    }
+}
+
+void MotionDetector::setCallback(MotionCallback callback, void* arg) {
+    callback_ = callback;
+    callback_arg_ = arg;
+}
+
+void MotionDetector::reset() {
+    count_ = 0;
+    next_ = 0;
+    state_ = State::Absent;
+    state_since_ms_ = 0;
+    present_since_ms_ = 0;
+    last_seen_ms_ = 0;
+    near_count_ = 0;
+    near_mean_s_ = 0;
+    near_mean_cm_ = 0;
+    near_cov_ = 0;
+    near_var_s_ = 0;
+    near_last_s_ = 0;
+    filtered_cm_ = kNoEchoCm;
+    last_raw_cm_ = kNoEchoCm;
+}
+
+// Insertion sort of at most kMaxWindow values beats anything clever here
+float MotionDetector::median() const {
+    float sorted[kMaxWindow];
+    const uint8_t window = config_.median_window;
+    const uint8_t n = count_ < window ? count_ : window;
+    for (uint8_t i = 0; i < n; i++) {
+        float v = samples_[(next_ + kMaxWindow - 1 - i) % kMaxWindow];
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1] > v) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = v;
+    }
+    return sorted[n / 2];
+}
+
+void MotionDetector::emit(MotionEvent::Type type, int64_t now_ms, uint32_t duration_ms,
+                          float travel_cm) {
+    if (callback_) {
+        MotionEvent event = {type, now_ms, filtered_cm_, duration_ms, travel_cm};
+        callback_(event, callback_arg_);
+    }
+}
+
+// Welford-style update: stays accurate in single precision for long visits
+void MotionDetector::addNear(int64_t now_ms) {
+    const float t = (float)(now_ms - present_since_ms_) / 1000.0f;
+    near_count_++;
+    const float dt = t - near_mean_s_;
+    near_mean_s_ += dt / near_count_;
+    near_mean_cm_ += (filtered_cm_ - near_mean_cm_) / near_count_;
+    near_cov_ += dt * (filtered_cm_ - near_mean_cm_);
+    near_var_s_ += dt * (t - near_mean_s_);
+    near_last_s_ = t;
+}
+
+float MotionDetector::travelCm() const {
+    if (near_count_ < 2 || near_var_s_ <= 0) {
+        return 0;
+    }
+    return near_cov_ / near_var_s_ * near_last_s_;
+}
+
+void MotionDetector::update(float distance_cm, int64_t now_ms) {
+    last_raw_cm_ = distance_cm > 0 ? distance_cm : kNoEchoCm;
+    samples_[next_] = last_raw_cm_;
+    next_ = (next_ + 1) % kMaxWindow;
+    if (count_ < kMaxWindow) {
+        count_++;
+    }
+    filtered_cm_ = median();
+
+    const bool near = filtered_cm_ < config_.enter_cm;
+    const bool away = filtered_cm_ > config_.enter_cm + config_.exit_margin_cm;
+
+    switch (state_) {
+    case State::Absent:
+        if (near) {
+            state_ = State::Entering;
+            state_since_ms_ = now_ms;
+        } else {
+            break;
+        }
+        // Fall through: a zero debounce enters on this sample
+        [[fallthrough]];
+
+    case State::Entering:
+        if (!near) {
+            state_ = State::Absent;
+        } else if (now_ms - state_since_ms_ >= (int64_t)config_.enter_debounce_ms) {
+            state_ = State::Present;
+            present_since_ms_ = state_since_ms_;
+            last_seen_ms_ = now_ms;
+            near_count_ = 0;
+            near_mean_s_ = 0;
+            near_mean_cm_ = 0;
+            near_cov_ = 0;
+            near_var_s_ = 0;
+            near_last_s_ = 0;
+            addNear(now_ms);
+            emit(MotionEvent::Enter, now_ms, 0, 0);
+        }
+        break;
+
+    case State::Present:
+        if (!away) {
+            last_seen_ms_ = now_ms;
+            addNear(now_ms);
+            break;
+        }
+        state_ = State::Exiting;
+        state_since_ms_ = now_ms;
+        [[fallthrough]];
+
+    case State::Exiting:
+        if (!away) {
+            state_ = State::Present;
+            last_seen_ms_ = now_ms;
+            addNear(now_ms);
+        } else if (now_ms - state_since_ms_ >= (int64_t)config_.exit_debounce_ms &&
+                   now_ms - present_since_ms_ >= (int64_t)config_.min_dwell_ms) {
+            state_ = State::Absent;
+            emit(MotionEvent::Exit, now_ms, (uint32_t)(state_since_ms_ - present_since_ms_),
+                 travelCm());
+        }
+        break;
+    }
+}
@@ -0,0 +1,129 @@
+#ifndef MOTION_DETECTOR_H
+#define MOTION_DETECTOR_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct MotionDetectorConfig {
+    float enter_cm;              // Presence starts below this distance
+    float exit_margin_cm;        // ...and ends above enter_cm + exit_margin_cm
+    uint8_t median_window;       // Samples in the median filter (odd, <= kMaxWindow)
+    uint32_t enter_debounce_ms;  // Filtered distance must stay near this long
+    uint32_t exit_debounce_ms;   // ...or away this long
+    uint32_t min_dwell_ms;       // Presence is never shorter than this
+};
+
+struct MotionEvent {
+    enum Type : uint8_t { Enter, Exit };
+
+    Type type;
+    int64_t time_ms;      // When the transition was confirmed
+    float distance_cm;    // Filtered distance at that moment
+    uint32_t duration_ms; // Exit only: how long the presence lasted
+    float travel_cm;      // Exit only: net movement along the beam while present
+                          // (negative: toward the sensor)
+};
+
+typedef void (*MotionCallback)(const MotionEvent& event, void* arg);
+
+/**
+ * @brief Presence detector for a stream of distance readings
+ *
+ * Each sample goes through a streaming median filter, so a single
+ * spurious echo (or a missed one) cannot move the filtered distance.
+ * Failed readings (<= 0) count as "nothing in range".
+ *
+ * The filtered distance then drives a hysteresis state machine:
+ *
+ *   Absent --(below enter_cm)--> Entering --(enter_debounce_ms)--> Present
+ *   Present --(above enter_cm + margin)--> Exiting --(exit_debounce_ms and
+ *   min_dwell_ms since Enter)--> Absent
+ *
+ * Falling back across the threshold during Entering/Exiting cancels the
+ * transition. Enter and Exit are reported through the callback, from
+ * inside update(). Exit also carries the net travel along the beam: the
+ * least-squares slope of the filtered distance over the visit times its
+ * length, so a stray sample at either end cannot flip it. FlowCounter uses
+ * it to tell the walking direction.
+ *
+ * Pure logic with caller-supplied timestamps: no FreeRTOS or ESP-IDF
+ * dependencies, so recorded traces can be replayed on a host.
+ * Not thread-safe; owned by the task that reads the sensor.
+ */
+class MotionDetector {
+public:
+    static constexpr size_t kMaxWindow = 9;
+    static constexpr float kNoEchoCm = 1000.0f;  // Stands in for failed readings
+
+    explicit MotionDetector(const MotionDetectorConfig& config);
+
+    /**
+     * @brief Replace the configuration, keeping the current state
+     */
+    void setConfig(const MotionDetectorConfig& config);
+    const MotionDetectorConfig& config() const { return config_; }
+
+    void setCallback(MotionCallback callback, void* arg);
+
+    /**
+     * @brief Feed one reading
+     * @param distance_cm Measured distance, <= 0 if the measurement failed
+     * @param now_ms Monotonic time of the reading
+     */
+    void update(float distance_cm, int64_t now_ms);
+
+    /**
+     * @brief Forget all samples and go back to Absent (no event)
+     */
+    void reset();
+
+    bool present() const { return state_ == State::Present || state_ == State::Exiting; }
+
+    /**
+     * @brief Something is close or a transition is pending, so the caller
+     *        should keep sampling fast
+     */
+    bool active() const { return state_ != State::Absent || last_raw_cm_ < config_.enter_cm; }
+
+    float filteredCm() const { return filtered_cm_; }
+
+    /**
+     * @brief Last time the filtered distance was inside the exit threshold
+     *        while present, or 0 if never
+     */
+    int64_t lastSeenMs() const { return last_seen_ms_; }
+
+private:
+    enum class State : uint8_t { Absent, Entering, Present, Exiting };
+
+    float median() const;
+    void emit(MotionEvent::Type type, int64_t now_ms, uint32_t duration_ms, float travel_cm);
+    void addNear(int64_t now_ms);
+    float travelCm() const;
+
+    MotionDetectorConfig config_;
+    MotionCallback callback_;
+    void* callback_arg_;
+
+    float samples_[kMaxWindow];  // Ring of the last window samples
+    uint8_t count_;
+    uint8_t next_;
+
+    State state_;
+    int64_t state_since_ms_;     // Start of Entering/Exiting
+    int64_t present_since_ms_;
+    int64_t last_seen_ms_;
+
+    // Running regression of filtered distance over time (s since Enter),
+    // over the samples inside the exit threshold while present
+    uint32_t near_count_;
+    float near_mean_s_;
+    float near_mean_cm_;
+    float near_cov_;             // Sum of (t - mean_t) * (d - mean_d)
+    float near_var_s_;           // Sum of (t - mean_t)^2
+    float near_last_s_;
+    float filtered_cm_;
+    float last_raw_cm_;
+};
+
+#endif // MOTION_DETECTOR_H
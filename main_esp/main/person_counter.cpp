@@ -2,12 +2,18 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include "esp_log.h"
+#include <cstring>
 
 static const char* TAG = "PersonCounter";
 
 // Static member initialization
 void* PersonCounter::mutex = nullptr;
 int PersonCounter::count = 0;
+int PersonCounter::entries = 0;
+int PersonCounter::exits = 0;
+int PersonCounter::occupancy = 0;
+PresenceSourceStats PersonCounter::presence_stats[PRESENCE_SOURCE_COUNT] = {};
+PresenceSourceStats PersonCounter::reported_stats[PRESENCE_SOURCE_COUNT] = {};
 
 void PersonCounter::init() {
     if (mutex == nullptr) {
@@ -63,3 +69,80 @@ int PersonCounter::get() {
     }
     return result;
 }
+
+void PersonCounter::record_flow(bool entry, int new_occupancy) {
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "PersonCounter not initialized!");
+        return;
+    }
+    
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) == pdTRUE) {
+        if (entry) {
+            entries++;
+        } else {
+            exits++;
+        }
+        occupancy = new_occupancy;
+        xSemaphoreGive(sem);
+    }
+}
+
+PersonFlow PersonCounter::get_flow_and_reset() {
+    PersonFlow result = {};
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "PersonCounter not initialized!");
+        return result;
+    }
+    
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) == pdTRUE) {
+        result.count = count;
+        result.entries = entries;
+        result.exits = exits;
+        result.occupancy = occupancy;
+        count = 0;
+        entries = 0;
+        exits = 0;
+        // Counters only grow, so unsigned differences are exact across wraps
+        for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+            const PresenceSourceStats& now = presence_stats[i];
+            const PresenceSourceStats& then = reported_stats[i];
+            result.sources[i] = {now.observations - then.observations,
+                                 now.agreements - then.agreements,
+                                 now.onsets - then.onsets,
+                                 now.onset_lag_ms - then.onset_lag_ms};
+        }
+        memcpy(reported_stats, presence_stats, sizeof(reported_stats));
+        xSemaphoreGive(sem);
+    }
+    return result;
+}
+
+int PersonCounter::get_occupancy() {
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "PersonCounter not initialized!");
+        return 0;
+    }
+    
+    int result = 0;
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) == pdTRUE) {
+        result = occupancy;
+        xSemaphoreGive(sem);
+    }
+    return result;
+}
+
+void PersonCounter::set_presence_stats(const PresenceSourceStats stats[PRESENCE_SOURCE_COUNT]) {
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "PersonCounter not initialized!");
+        return;
+    }
+    
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) == pdTRUE) {
+        memcpy(presence_stats, stats, sizeof(presence_stats));
+        xSemaphoreGive(sem);
+    }
+}
@@ -2,6 +2,18 @@
 #define PERSON_COUNTER_H
 
 #include <stdint.h>
+#include "presence_fusion.h"
+
+/**
+ * @brief Counts for one telemetry interval
+ */
+struct PersonFlow {
+    int count;      // Detection sessions (visits), directed or not
+    int entries;
+    int exits;
+    int occupancy;  // Running estimate, not reset with the interval
+    PresenceSourceStats sources[PRESENCE_SOURCE_COUNT];  // Fusion quality in the interval
+};
 
 /**
  * @brief Thread-safe person counter using FreeRTOS mutex
@@ -33,9 +45,36 @@ public:
      */
     static int get();
 
+    /**
+     * @brief Record a directed pass and the occupancy estimate after it (thread-safe)
+     * @param entry true for an entry, false for an exit
+     */
+    static void record_flow(bool entry, int occupancy);
+
+    /**
+     * @brief Get count, entries and exits and reset them to 0 atomically (thread-safe)
+     * @return Counts before reset, with the current occupancy
+     */
+    static PersonFlow get_flow_and_reset();
+
+    /**
+     * @brief Get the current occupancy estimate (thread-safe)
+     */
+    static int get_occupancy();
+
+    /**
+     * @brief Publish PresenceFusion's cumulative per-source counters (thread-safe)
+     */
+    static void set_presence_stats(const PresenceSourceStats stats[PRESENCE_SOURCE_COUNT]);
+
 private:
     static void* mutex;  // SemaphoreHandle_t (void* for header portability)
     static int count;
+    static int entries;
+    static int exits;
+    static int occupancy;
+    static PresenceSourceStats presence_stats[PRESENCE_SOURCE_COUNT];
+    static PresenceSourceStats reported_stats[PRESENCE_SOURCE_COUNT];  // At the last reset
 };
 
 #endif // PERSON_COUNTER_H
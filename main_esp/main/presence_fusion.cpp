@@ -0,0 +1,125 @@
+#include "presence_fusion.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // Keeps the log-likelihood ratios finite
+    constexpr float kMinRate = 0.01f;
+    constexpr float kMaxRate = 0.99f;
+
+    float clamp_rate(float rate) {
+        return rate < kMinRate ? kMinRate : rate > kMaxRate ? kMaxRate : rate;
+    }
+}
+
+PresenceFusion::PresenceFusion(const PresenceFusionConfig& config) {
+    memset(evidence_, 0, sizeof(evidence_));
+    memset(stats_, 0, sizeof(stats_));
+    estimate_ = {0, 0, false};
+    episode_start_ms_ = 0;
+    setConfig(config);
+    estimate_.probability = config_.prior;
+}
+
+void PresenceFusion::setConfig(const PresenceFusionConfig& config) {
+    config_ = config;
+    config_.prior = clamp_rate(config_.prior);
+    prior_logit_ = logf(config_.prior / (1.0f - config_.prior));
+    for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+        PresenceSourceModel& model = config_.sources[i];
+        model.hit_rate = clamp_rate(model.hit_rate);
+        model.false_rate = clamp_rate(model.false_rate);
+        llr_hit_[i] = logf(model.hit_rate / model.false_rate);
+        llr_miss_[i] = logf((1.0f - model.hit_rate) / (1.0f - model.false_rate));
+    }
+}
+
+void PresenceFusion::countOnset(PresenceSource source) {
+    Evidence& e = evidence_[source];
+    int64_t lag = e.detected_since_ms - episode_start_ms_;
+    stats_[source].onsets++;
+    stats_[source].onset_lag_ms += lag > 0 ? (uint32_t)lag : 0;
+    e.onset_counted = true;
+}
+
+void PresenceFusion::observe(PresenceSource source, bool detected, int64_t time_ms) {
+    if (source >= PRESENCE_SOURCE_COUNT || !enabled(source)) {
+        return;
+    }
+    Evidence& e = evidence_[source];
+    if (detected && !(e.valid && e.detected)) {
+        e.detected_since_ms = time_ms;
+    }
+    const uint32_t smooth_ms = config_.sources[source].smooth_ms;
+    const float reading = detected ? 1.0f : 0.0f;
+    if (!e.valid || smooth_ms == 0) {
+        e.rate = reading;
+    } else {
+        int64_t dt = time_ms - e.time_ms;
+        float alpha = dt <= 0 ? 0.0f : 1.0f - expf(-(float)dt / (float)smooth_ms);
+        e.rate += alpha * (reading - e.rate);
+    }
+    e.valid = true;
+    e.detected = detected;
+    e.time_ms = time_ms;
+
+    stats_[source].observations++;
+    if (detected == estimate_.present) {
+        stats_[source].agreements++;
+    }
+    // A source that catches up with an episode already in progress
+    if (estimate_.present && detected && !e.onset_counted) {
+        countOnset(source);
+    }
+}
+
+const PresenceEstimate& PresenceFusion::update(int64_t now_ms) {
+    float logit = prior_logit_;
+    float fresh[PRESENCE_SOURCE_COUNT] = {};
+    float enabled_weight = 0;
+
+    for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+        const PresenceSourceModel& model = config_.sources[i];
+        if (model.weight <= 0) {
+            continue;
+        }
+        enabled_weight += model.weight;
+        const Evidence& e = evidence_[i];
+        int64_t age = now_ms - e.time_ms;
+        if (!e.valid || age >= (int64_t)model.stale_ms) {
+            continue;
+        }
+        fresh[i] = age <= 0 ? 1.0f : 1.0f - (float)age / (float)model.stale_ms;
+        logit += model.weight * fresh[i] * (e.rate * llr_hit_[i] + (1.0f - e.rate) * llr_miss_[i]);
+    }
+    estimate_.probability = 1.0f / (1.0f + expf(-logit));
+
+    if (!estimate_.present && estimate_.probability >= config_.enter_p) {
+        estimate_.present = true;
+        // The episode began when the first source still detecting saw it
+        episode_start_ms_ = now_ms;
+        for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+            const Evidence& e = evidence_[i];
+            if (fresh[i] > 0 && e.detected && e.detected_since_ms < episode_start_ms_) {
+                episode_start_ms_ = e.detected_since_ms;
+            }
+        }
+        for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+            evidence_[i].onset_counted = false;
+            if (fresh[i] > 0 && evidence_[i].detected) {
+                countOnset((PresenceSource)i);
+            }
+        }
+    } else if (estimate_.present && estimate_.probability < config_.exit_p) {
+        estimate_.present = false;
+    }
+
+    float agreeing_weight = 0;
+    for (int i = 0; i < PRESENCE_SOURCE_COUNT; i++) {
+        if (fresh[i] > 0 && (evidence_[i].rate >= 0.5f) == estimate_.present) {
+            agreeing_weight += config_.sources[i].weight * fresh[i];
+        }
+    }
+    estimate_.confidence = enabled_weight > 0 ? agreeing_weight / enabled_weight : 0;
+    return estimate_;
+}
@@ -0,0 +1,127 @@
+#ifndef PRESENCE_FUSION_H
+#define PRESENCE_FUSION_H
+
+#include <cstdint>
+
+enum PresenceSource : uint8_t {
+    PRESENCE_SOURCE_ULTRASONIC,  // HC-SR04, after MotionDetector
+    PRESENCE_SOURCE_RADAR,       // Rd-01 target state
+    PRESENCE_SOURCE_LIGHT,       // Photoresistor jump (a shadow)
+    PRESENCE_SOURCE_BLE_RSSI,    // RSSI swing of a BLE link (no producer yet)
+    PRESENCE_SOURCE_COUNT
+};
+
+struct PresenceSourceModel {
+    float weight;        // Scales the source's evidence; 0 disables it
+    float hit_rate;      // P(source detects | someone present)
+    float false_rate;    // P(source detects | nobody present)
+    uint32_t smooth_ms;  // Time constant of the detection rate; 0 = latest reading only
+    uint32_t stale_ms;   // Evidence fades out linearly over this age
+};
+
+struct PresenceFusionConfig {
+    PresenceSourceModel sources[PRESENCE_SOURCE_COUNT];
+    float prior;         // P(present) with no evidence at all
+    float enter_p;       // Fused presence starts at or above this...
+    float exit_p;        // ...and ends below this
+};
+
+struct PresenceEstimate {
+    float probability;   // P(someone present | latest evidence)
+    float confidence;    // Share of the enabled source weight that is fresh and agrees
+    bool present;        // probability with enter_p/exit_p hysteresis
+};
+
+/**
+ * @brief Cumulative quality counters of one source
+ *
+ * There is no ground truth on the device, so a source is judged against
+ * the fused decision: how often its observations agree with it, and how
+ * far its detection trails the earliest source at the start of a presence
+ * episode. Callers take differences between two snapshots for an interval.
+ */
+struct PresenceSourceStats {
+    uint32_t observations;
+    uint32_t agreements;    // Observations matching the fused decision
+    uint32_t onsets;        // Presence episodes this source detected
+    uint32_t onset_lag_ms;  // Sum of its delays behind the earliest source
+};
+
+/**
+ * @brief Combines presence evidence from several sensors into one estimate
+ *
+ * Each source reports detected / not detected with a timestamp, at its own
+ * rate, and keeps an exponentially smoothed detection rate r_i (over
+ * smooth_ms, in time rather than samples). update() combines every enabled
+ * source as independent Bayesian evidence in log-odds:
+ *
+ *   logit(p) = logit(prior) + sum_i weight_i * fresh_i * LLR_i
+ *   LLR_i    = r_i * log(hit / false) + (1 - r_i) * log((1 - hit) / (1 - false))
+ *
+ * fresh_i falls from 1 to 0 as the evidence ages to stale_ms, so a silent
+ * sensor drops out instead of holding the estimate. Each source counts
+ * once whatever its sample rate, so a 20 Hz sensor does not outvote a
+ * 10 Hz one and p cannot saturate; the smoothing keeps one missed radar
+ * report from ending presence.
+ *
+ * Example with the defaults: the radar alone (fan) against a quiet
+ * HC-SR04 lands between exit_p and enter_p, so it neither starts nor ends
+ * presence; both detecting starts it.
+ *
+ * Pure logic with no ESP-IDF dependencies. Not thread-safe.
+ */
+class PresenceFusion {
+public:
+    explicit PresenceFusion(const PresenceFusionConfig& config);
+
+    /**
+     * @brief Replace the models, keeping evidence and state
+     */
+    void setConfig(const PresenceFusionConfig& config);
+    const PresenceFusionConfig& config() const { return config_; }
+
+    bool enabled(PresenceSource source) const { return config_.sources[source].weight > 0; }
+
+    /**
+     * @brief Record the latest reading of one source
+     */
+    void observe(PresenceSource source, bool detected, int64_t time_ms);
+
+    /**
+     * @brief Recombine the evidence as of now_ms
+     */
+    const PresenceEstimate& update(int64_t now_ms);
+
+    const PresenceEstimate& estimate() const { return estimate_; }
+
+    /**
+     * @brief Start of the current presence episode (earliest detecting source)
+     */
+    int64_t presentSinceMs() const { return episode_start_ms_; }
+
+    const PresenceSourceStats& stats(PresenceSource source) const { return stats_[source]; }
+
+private:
+    struct Evidence {
+        bool valid;
+        bool detected;
+        float rate;                 // Smoothed detections, 0..1
+        int64_t time_ms;
+        int64_t detected_since_ms;  // Start of the current run of detections
+        bool onset_counted;         // Already credited for this episode
+    };
+
+    void countOnset(PresenceSource source);
+
+    PresenceFusionConfig config_;
+    float prior_logit_;
+    float llr_hit_[PRESENCE_SOURCE_COUNT];
+    float llr_miss_[PRESENCE_SOURCE_COUNT];
+
+    Evidence evidence_[PRESENCE_SOURCE_COUNT];
+    PresenceEstimate estimate_;
+    int64_t episode_start_ms_;
+    PresenceSourceStats stats_[PRESENCE_SOURCE_COUNT];
+};
+
+#endif // PRESENCE_FUSION_H
@@ -0,0 +1,54 @@
+#include "presence_pipeline.h"
+
+PresencePipeline::PresencePipeline(const PresencePipelineConfig& config)
+    : config_(config),
+      detector_(config.motion),
+      flow_(config.flow),
+      fusion_(config.fusion),
+      leds_(config.led),
+      step_() {
+    step_.presence = fusion_.estimate();
+    detector_.setCallback(onMotion, this);
+}
+
+void PresencePipeline::setConfig(const PresencePipelineConfig& config) {
+    config_ = config;
+    config_.flow = flow_.config();
+    detector_.setConfig(config.motion);
+    fusion_.setConfig(config.fusion);
+    leds_.setConfig(config.led);
+}
+
+// Runs from inside detector_.update()
+void PresencePipeline::onMotion(const MotionEvent& event, void* arg) {
+    PresencePipeline* self = static_cast<PresencePipeline*>(arg);
+    FlowDirection direction = self->flow_.onMotion(FlowCounter::kOuter, event);
+    if (direction != FlowDirection::None) {
+        self->step_.flow = direction;
+    }
+}
+
+const PresenceStep& PresencePipeline::step(const PresenceSample& sample) {
+    const int64_t now = sample.time_ms;
+    const bool was_present = step_.presence.present;
+    step_.flow = FlowDirection::None;
+
+    if (sample.radar_report) {
+        fusion_.observe(PRESENCE_SOURCE_RADAR,
+                        sample.radar_target && sample.radar_cm <= config_.motion.enter_cm, now);
+    }
+    detector_.update(sample.distance_cm, now);
+    fusion_.observe(PRESENCE_SOURCE_ULTRASONIC, detector_.present(), now);
+    if (sample.light_observed) {
+        fusion_.observe(PRESENCE_SOURCE_LIGHT, sample.light_shadow, now);
+    }
+
+    step_.presence = fusion_.update(now);
+    step_.onset = step_.presence.present && !was_present;
+    step_.ended = !step_.presence.present && was_present;
+    step_.motion_present = detector_.present();
+    step_.hint = detector_.active();
+    step_.led = leds_.update(step_.presence.present, now);
+    step_.leds_on = leds_.on();
+    return step_;
+}
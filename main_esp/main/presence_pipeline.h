@@ -0,0 +1,82 @@
+#ifndef PRESENCE_PIPELINE_H
+#define PRESENCE_PIPELINE_H
+
+#include "flow_counter.h"
+#include "led_session.h"
+#include "motion_detector.h"
+#include "presence_fusion.h"
+#include <cstdint>
+
+struct PresencePipelineConfig {
+    MotionDetectorConfig motion;  // motion.enter_cm also gates radar targets
+    FlowCounterConfig flow;
+    PresenceFusionConfig fusion;  // A source with weight 0 is not fitted
+    LedSessionConfig led;
+};
+
+/**
+ * @brief Raw sensor readings of one sample, as the device took them
+ */
+struct PresenceSample {
+    int64_t time_ms;
+    float distance_cm;     // Ranging for MotionDetector, <= 0 if the reading failed
+    bool radar_report;     // The radar reported since the last sample...
+    bool radar_target;     // ...and saw a target...
+    uint16_t radar_cm;     // ...at this distance
+    bool light_observed;   // The photoresistor was read...
+    bool light_shadow;     // ...and jumped away from its ambient baseline
+};
+
+/**
+ * @brief Decisions taken on one sample
+ */
+struct PresenceStep {
+    PresenceEstimate presence;  // Fused estimate after the sample
+    bool onset;                 // Presence started on this sample (one visit)
+    bool ended;                 // Presence ended on this sample
+    bool motion_present;        // MotionDetector's own decision
+    bool hint;                  // Raw readings suggest someone (MotionDetector::active)
+    FlowDirection flow;         // Direction of a pass completed on this sample
+    LedAction led;
+    bool leds_on;               // After led
+};
+
+/**
+ * @brief The presence decisions of distance_sensor_task, without the I/O
+ *
+ * Runs one sample through MotionDetector (and FlowCounter on its events),
+ * PresenceFusion and LedSession, in the order the device always has. The
+ * device task feeds it live readings; the trace replay tool feeds it
+ * recorded ones, so both make exactly the same decisions.
+ *
+ * Pure logic with no ESP-IDF dependencies. Not thread-safe.
+ */
+class PresencePipeline {
+public:
+    explicit PresencePipeline(const PresencePipelineConfig& config);
+
+    /**
+     * @brief Replace the configuration, keeping all state (flow is fixed)
+     */
+    void setConfig(const PresencePipelineConfig& config);
+    const PresencePipelineConfig& config() const { return config_; }
+
+    const PresenceStep& step(const PresenceSample& sample);
+
+    const MotionDetector& detector() const { return detector_; }
+    const FlowCounter& flow() const { return flow_; }
+    const PresenceFusion& fusion() const { return fusion_; }
+    const LedSession& leds() const { return leds_; }
+
+private:
+    static void onMotion(const MotionEvent& event, void* arg);
+
+    PresencePipelineConfig config_;
+    MotionDetector detector_;
+    FlowCounter flow_;
+    PresenceFusion fusion_;
+    LedSession leds_;
+    PresenceStep step_;
+};
+
+#endif // PRESENCE_PIPELINE_H
@@ -0,0 +1,211 @@
+#include "publish_window.h"
+
+namespace {
+
+// Acks slower than this multiple of the best observed RTT mean the link or
+// broker is queueing, so stop growing the window
+constexpr int64_t kLatencyGrowthFactor = 2;
+constexpr int kMaxBackoffShift = 4;
+
+}  // namespace
+
+PublishWindow::PublishWindow()
+    : window_(1),
+      in_flight_(0),
+      srtt_us_(0),
+      rttvar_us_(0),
+      min_rtt_us_(0),
+      rto_us_(kInitialTimeoutUs),
+      next_order_(0),
+      retransmits_(0) {
+    for (Slot& slot : slots_) {
+        slot.count = 0;
+        slot.state = Slot::State::Free;
+        slot.msg_id = -1;
+        slot.prev_msg_id = -1;
+        slot.sent_us = 0;
+        slot.order = 0;
+        slot.retries = 0;
+    }
+}
+
+size_t PublishWindow::occupied() const {
+    size_t n = 0;
+    for (const Slot& slot : slots_) {
+        if (slot.state != Slot::State::Free) {
+            n++;
+        }
+    }
+    return n;
+}
+
+PublishWindow::Slot* PublishWindow::acquire() {
+    if (occupied() >= window_) {
+        return nullptr;
+    }
+    for (Slot& slot : slots_) {
+        if (slot.state == Slot::State::Free) {
+            slot.count = 0;
+            slot.state = Slot::State::Pending;
+            slot.msg_id = -1;
+            slot.prev_msg_id = -1;
+            slot.order = next_order_++;
+            slot.retries = 0;
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void PublishWindow::cancel(Slot* slot) {
+    slot->state = Slot::State::Free;
+    slot->count = 0;
+}
+
+PublishWindow::Slot* PublishWindow::nextPending() {
+    Slot* oldest = nullptr;
+    for (Slot& slot : slots_) {
+        if (slot.state == Slot::State::Pending &&
+            (oldest == nullptr || (int32_t)(slot.order - oldest->order) < 0)) {
+            oldest = &slot;
+        }
+    }
+    return oldest;
+}
+
+void PublishWindow::markSent(Slot* slot, int msg_id, int64_t now_us) {
+    if (slot->msg_id != -1) {
+        slot->prev_msg_id = slot->msg_id;
+        slot->retries++;
+        retransmits_++;
+    }
+    slot->msg_id = msg_id;
+    slot->sent_us = now_us;
+    slot->state = Slot::State::InFlight;
+    in_flight_++;
+}
+
+void PublishWindow::markFailed(Slot* slot) {
+    slot->state = Slot::State::Pending;
+}
+
+size_t PublishWindow::onAck(int msg_id, int64_t now_us) {
+    for (Slot& slot : slots_) {
+        if (slot.state == Slot::State::Free ||
+            (slot.msg_id != msg_id && slot.prev_msg_id != msg_id)) {
+            continue;
+        }
+
+        // Karn: an ack for a retransmitted batch is ambiguous, don't sample it
+        if (slot.retries == 0 && slot.state == Slot::State::InFlight) {
+            const int64_t sample = now_us - slot.sent_us;
+            updateRtt(sample);
+            if (sample <= min_rtt_us_ * kLatencyGrowthFactor) {
+                if (window_ < kMaxSlots) {
+                    window_++;
+                }
+            } else if (window_ > 1) {
+                window_--;
+            }
+        }
+
+        if (slot.state == Slot::State::InFlight) {
+            in_flight_--;
+        }
+        const size_t count = slot.count;
+        slot.state = Slot::State::Free;
+        slot.count = 0;
+        return count;
+    }
+    return 0;
+}
+
+bool PublishWindow::oldestUnacked(uint32_t* seq) const {
+    const Slot* oldest = nullptr;
+    for (const Slot& slot : slots_) {
+        if (slot.state != Slot::State::Free && slot.count > 0 &&
+            (oldest == nullptr || (int32_t)(slot.order - oldest->order) < 0)) {
+            oldest = &slot;
+        }
+    }
+    if (oldest == nullptr) {
+        return false;
+    }
+    *seq = oldest->records[0].seq;
+    return true;
+}
+
+size_t PublishWindow::checkTimeouts(int64_t now_us) {
+    size_t expired = 0;
+    for (Slot& slot : slots_) {
+        if (slot.state == Slot::State::InFlight &&
+            now_us - slot.sent_us >= slotTimeoutUs(slot)) {
+            slot.state = Slot::State::Pending;
+            in_flight_--;
+            expired++;
+        }
+    }
+    if (expired > 0) {
+        window_ = window_ > 1 ? window_ / 2 : 1;
+    }
+    return expired;
+}
+
+void PublishWindow::onDisconnect() {
+    for (Slot& slot : slots_) {
+        if (slot.state == Slot::State::InFlight) {
+            slot.state = Slot::State::Pending;
+        }
+    }
+    in_flight_ = 0;
+}
+
+int64_t PublishWindow::timeUntilNextTimeout(int64_t now_us) const {
+    int64_t earliest = -1;
+    for (const Slot& slot : slots_) {
+        if (slot.state != Slot::State::InFlight) {
+            continue;
+        }
+        int64_t remaining = slot.sent_us + slotTimeoutUs(slot) - now_us;
+        if (remaining < 0) {
+            remaining = 0;
+        }
+        if (earliest < 0 || remaining < earliest) {
+            earliest = remaining;
+        }
+    }
+    return earliest;
+}
+
+int64_t PublishWindow::slotTimeoutUs(const Slot& slot) const {
+    const int shift = slot.retries < kMaxBackoffShift ? slot.retries : kMaxBackoffShift;
+    const int64_t timeout = rto_us_ << shift;
+    return timeout > kMaxTimeoutUs ? kMaxTimeoutUs : timeout;
+}
+
+void PublishWindow::updateRtt(int64_t sample_us) {
+    if (sample_us < 0) {
+        sample_us = 0;
+    }
+    if (srtt_us_ == 0) {
+        srtt_us_ = sample_us;
+        rttvar_us_ = sample_us / 2;
+        min_rtt_us_ = sample_us;
+    } else {
+        // RFC 6298 with alpha = 1/8, beta = 1/4
+        const int64_t err = sample_us > srtt_us_ ? sample_us - srtt_us_ : srtt_us_ - sample_us;
+        rttvar_us_ += (err - rttvar_us_) / 4;
+        srtt_us_ += (sample_us - srtt_us_) / 8;
+        if (sample_us < min_rtt_us_) {
+            min_rtt_us_ = sample_us;
+        }
+    }
+
+    int64_t rto = srtt_us_ + 4 * rttvar_us_;
+    if (rto < kMinTimeoutUs) {
+        rto = kMinTimeoutUs;
+    } else if (rto > kMaxTimeoutUs) {
+        rto = kMaxTimeoutUs;
+    }
+    rto_us_ = rto;
+}
@@ -0,0 +1,133 @@
+#ifndef PUBLISH_WINDOW_H
+#define PUBLISH_WINDOW_H
+
+#include "telemetry_record.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Bounded window of telemetry batches awaiting PUBACK
+ *
+ * Each slot owns a copy of its records, so a batch can be re-encoded and
+ * retransmitted until the broker acknowledges it (at-least-once) while the
+ * queue only keeps the records, for a reboot, until oldestUnacked() says
+ * they were delivered.
+ * A slot is released only by the PUBACK for its msg_id; on timeout or
+ * disconnect it is marked for retransmission instead.
+ *
+ * The retransmission timeout follows the measured ack latency (smoothed
+ * RTT plus four deviations, as in TCP) and backs off exponentially per
+ * retry. The usable window grows by one slot per timely ack and shrinks
+ * when acks get slow or time out (AIMD), up to kMaxSlots.
+ *
+ * Not thread-safe: owned by the mqtt_pub task, which is fed MQTT events
+ * through a queue. Times are esp_timer microseconds.
+ */
+class PublishWindow {
+public:
+    static constexpr size_t kMaxSlots = 4;
+    static constexpr size_t kBatchSize = 50;
+
+    static constexpr int64_t kInitialTimeoutUs = 5 * 1000 * 1000;
+    static constexpr int64_t kMinTimeoutUs = 1 * 1000 * 1000;
+    static constexpr int64_t kMaxTimeoutUs = 60 * 1000 * 1000;
+
+    struct Slot {
+        enum class State : uint8_t { Free, InFlight, Pending };
+
+        Telemetry records[kBatchSize];
+        size_t count;
+        State state;
+        int msg_id;
+        int prev_msg_id;  // Ack of the previous transmission also counts
+        int64_t sent_us;
+        uint32_t order;   // Acquisition order, keeps retransmits in sequence
+        uint8_t retries;
+    };
+
+    PublishWindow();
+
+    /**
+     * @brief Free slot to fill with a new batch, or nullptr if the window is full
+     */
+    Slot* acquire();
+
+    /**
+     * @brief Give back an acquired slot that ended up with nothing to send
+     */
+    void cancel(Slot* slot);
+
+    /**
+     * @brief Slot due for (re)transmission after a timeout or disconnect, or nullptr
+     */
+    Slot* nextPending();
+
+    /**
+     * @brief Record a successful publish of a slot
+     */
+    void markSent(Slot* slot, int msg_id, int64_t now_us);
+
+    /**
+     * @brief Return a slot that could not be published to the pending set
+     *
+     * Used when esp_mqtt_client_publish fails synchronously; a freshly
+     * acquired slot keeps its records and is retried first next time.
+     */
+    void markFailed(Slot* slot);
+
+    /**
+     * @brief Release the slot acknowledged by msg_id
+     * @return Number of records released, 0 if msg_id is not ours
+     */
+    size_t onAck(int msg_id, int64_t now_us);
+
+    /**
+     * @brief Sequence number of the first record of the oldest unacked batch
+     *
+     * Acks can arrive out of order. Records before this one are delivered
+     * and can be released from the queue; later ones may not be yet.
+     * @return false if no batch is awaiting its ack
+     */
+    bool oldestUnacked(uint32_t* seq) const;
+
+    /**
+     * @brief Move in-flight slots whose timeout expired to pending
+     * @return Number of slots that timed out
+     */
+    size_t checkTimeouts(int64_t now_us);
+
+    /**
+     * @brief Connection lost: every in-flight slot must be sent again
+     */
+    void onDisconnect();
+
+    /**
+     * @brief Microseconds until the earliest in-flight timeout, -1 if none
+     */
+    int64_t timeUntilNextTimeout(int64_t now_us) const;
+
+    size_t inFlight() const { return in_flight_; }
+    size_t occupied() const;
+    size_t windowSize() const { return window_; }
+    int64_t smoothedRttUs() const { return srtt_us_; }
+    int64_t timeoutUs() const { return rto_us_; }
+    uint32_t retransmitCount() const { return retransmits_; }
+
+private:
+    int64_t slotTimeoutUs(const Slot& slot) const;
+    void updateRtt(int64_t sample_us);
+
+    Slot slots_[kMaxSlots];
+    size_t window_;     // Usable slots, 1 .. kMaxSlots
+    size_t in_flight_;
+
+    int64_t srtt_us_;   // 0 until the first sample
+    int64_t rttvar_us_;
+    int64_t min_rtt_us_;
+    int64_t rto_us_;
+
+    uint32_t next_order_;
+    uint32_t retransmits_;
+};
+
+#endif // PUBLISH_WINDOW_H
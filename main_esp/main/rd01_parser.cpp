@@ -0,0 +1,182 @@
+#include "rd01_parser.h"
+#include <cstring>
+
+namespace {
+    constexpr uint8_t kReportHeader[] = {0xF4, 0xF3, 0xF2, 0xF1};
+    constexpr uint8_t kReportFooter[] = {0xF8, 0xF7, 0xF6, 0xF5};
+    constexpr uint8_t kAckHeader[] = {0xFD, 0xFC, 0xFB, 0xFA};
+    constexpr uint8_t kAckFooter[] = {0x04, 0x03, 0x02, 0x01};
+
+    constexpr uint8_t kTypeEngineering = 0x01;
+    constexpr uint8_t kTypeBasic = 0x02;
+    constexpr uint8_t kDataHead = 0xAA;
+    constexpr uint8_t kDataTail = 0x55;
+    constexpr uint8_t kMaxEnergy = 100;
+
+    constexpr size_t kPrefixLen = Rd01Parser::kHeaderLen + Rd01Parser::kLengthLen;
+
+    uint16_t get_u16(const uint8_t* p) {
+        return (uint16_t)(p[0] | (p[1] << 8));
+    }
+
+    bool is_frame_start(uint8_t b) {
+        return b == kReportHeader[0] || b == kAckHeader[0];
+    }
+
+    // Distances stay far below 0xF2F3 cm and energies below 0xF4, so a
+    // report header can only appear inside a payload if a truncated frame
+    // ran into the next one (and happened to line up with its footer)
+    bool contains_report_header(const uint8_t* p, size_t len) {
+        for (size_t i = 0; i + sizeof(kReportHeader) <= len; i++) {
+            if (p[i] == kReportHeader[0] && memcmp(p + i, kReportHeader, sizeof(kReportHeader)) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+Rd01Parser::Rd01Parser() : callback_(nullptr), callback_arg_(nullptr) {
+    memset(&stats_, 0, sizeof(stats_));
+    reset();
+}
+
+void Rd01Parser::setCallback(Rd01ReportCallback callback, void* arg) {
+    callback_ = callback;
+    callback_arg_ = arg;
+}
+
+void Rd01Parser::reset() {
+    pending_len_ = 0;
+}
+
+// p[0] is a frame start byte
+Rd01Parser::Result Rd01Parser::check(const uint8_t* p, size_t avail, size_t* frame_len) const {
+    const bool report = p[0] == kReportHeader[0];
+    const size_t n = avail < kHeaderLen ? avail : kHeaderLen;
+    if (memcmp(p, report ? kReportHeader : kAckHeader, n) != 0) {
+        return Result::Noise;
+    }
+    if (avail < kPrefixLen) {
+        return Result::NeedMore;
+    }
+
+    const size_t payload = get_u16(p + kHeaderLen);
+    if (payload > kMaxPayload || (report && payload < kMinReportPayload)) {
+        return Result::Bad;
+    }
+    const size_t total = kPrefixLen + payload + kFooterLen;
+    if (avail < total) {
+        return Result::NeedMore;
+    }
+
+    const uint8_t* body = p + kPrefixLen;
+    if (memcmp(body + payload, report ? kReportFooter : kAckFooter, kFooterLen) != 0) {
+        return Result::Bad;
+    }
+    if (report && ((body[0] != kTypeBasic && body[0] != kTypeEngineering) ||
+                   body[1] != kDataHead || body[payload - 2] != kDataTail ||
+                   body[5] > kMaxEnergy || body[8] > kMaxEnergy ||
+                   contains_report_header(body, payload))) {
+        return Result::Bad;
+    }
+    *frame_len = total;
+    return Result::Frame;
+}
+
+void Rd01Parser::decode(const uint8_t* frame) {
+    if (frame[0] == kAckHeader[0]) {
+        stats_.acks++;
+        return;
+    }
+    const uint8_t* body = frame + kPrefixLen;
+    Rd01Report report;
+    report.engineering = body[0] == kTypeEngineering;
+    report.state = body[2] & Rd01Report::Both;
+    report.moving_cm = get_u16(body + 3);
+    report.moving_energy = body[5];
+    report.static_cm = get_u16(body + 6);
+    report.static_energy = body[8];
+    report.detection_cm = get_u16(body + 9);
+    stats_.reports++;
+    if (callback_) {
+        callback_(report, callback_arg_);
+    }
+}
+
+void Rd01Parser::scan(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+        size_t start = i;
+        while (start < len && !is_frame_start(data[start])) {
+            start++;
+        }
+        stats_.skipped_bytes += start - i;
+        if (start == len) {
+            return;
+        }
+
+        size_t frame_len;
+        switch (check(data + start, len - start, &frame_len)) {
+        case Result::Frame:
+            decode(data + start);
+            i = start + frame_len;
+            break;
+        case Result::NeedMore:
+            // Bounded by kMaxFrame: check() has validated the length if present
+            memcpy(pending_, data + start, len - start);
+            pending_len_ = len - start;
+            return;
+        case Result::Bad:
+            stats_.bad_frames++;
+            [[fallthrough]];
+        case Result::Noise:
+            stats_.skipped_bytes++;
+            i = start + 1;
+            break;
+        }
+    }
+}
+
+void Rd01Parser::feedPending(const uint8_t** data, size_t* len) {
+    while (pending_len_ > 0 && *len > 0) {
+        // Top up to the length field first, then to the end of the frame
+        size_t need = pending_len_ < kPrefixLen
+                          ? kPrefixLen - pending_len_
+                          : kPrefixLen + get_u16(pending_ + kHeaderLen) + kFooterLen - pending_len_;
+        size_t n = need < *len ? need : *len;
+        memcpy(pending_ + pending_len_, *data, n);
+        pending_len_ += n;
+        *data += n;
+        *len -= n;
+
+        size_t frame_len;
+        Result result = check(pending_, pending_len_, &frame_len);
+        if (result == Result::NeedMore) {
+            continue;
+        }
+        if (result == Result::Frame) {
+            decode(pending_);
+            pending_len_ = 0;
+            return;
+        }
+
+        // Not a frame after all: rescan what was held back, past its first byte
+        if (result == Result::Bad) {
+            stats_.bad_frames++;
+        }
+        stats_.skipped_bytes++;
+        uint8_t held[kMaxFrame];
+        size_t held_len = pending_len_ - 1;
+        memcpy(held, pending_ + 1, held_len);
+        pending_len_ = 0;
+        scan(held, held_len);
+    }
+}
+
+void Rd01Parser::feed(const uint8_t* data, size_t len) {
+    feedPending(&data, &len);
+    if (len > 0) {
+        scan(data, len);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef RD01_PARSER_H
+#define RD01_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief One decoded Rd-01 target report
+ */
+struct Rd01Report {
+    enum State : uint8_t { None = 0, Moving = 1, Static = 2, Both = 3 };
+
+    uint8_t state;           // State bits: Moving | Static
+    bool engineering;        // Came from an engineering-mode frame
+    uint16_t moving_cm;
+    uint8_t moving_energy;   // 0..100
+    uint16_t static_cm;
+    uint8_t static_energy;   // 0..100
+    uint16_t detection_cm;   // Distance the radar itself reports for the target
+
+    bool present() const { return state != None; }
+
+    /**
+     * @brief Distance of the moving target if there is one, else the static one
+     */
+    uint16_t distance_cm() const { return (state & Moving) ? moving_cm : static_cm; }
+};
+
+struct Rd01ParserStats {
+    uint32_t reports;        // Valid report frames decoded
+    uint32_t acks;           // Command ACK frames (validated and skipped)
+    uint32_t bad_frames;     // Headers whose frame failed validation
+    uint32_t skipped_bytes;  // Bytes discarded while resynchronising
+};
+
+typedef void (*Rd01ReportCallback)(const Rd01Report& report, void* arg);
+
+/**
+ * @brief Streaming parser for the Rd-01 (ICL1122) UART protocol
+ *
+ * Report frames, sent continuously in basic (type 0x02) or engineering
+ * (type 0x01) mode:
+ *
+ *   F4 F3 F2 F1 | len u16 LE | type | AA | state | moving cm u16 | moving energy |
+ *   static cm u16 | static energy | detection cm u16 | [engineering data] |
+ *   55 | 00 | F8 F7 F6 F5
+ *
+ * Command ACK frames (FD FC FB FA | len | ... | 04 03 02 01) are validated
+ * and skipped.
+ *
+ * feed() accepts the byte stream in chunks of any size. Frames that lie
+ * entirely inside a chunk are decoded in place; only a frame split across
+ * two chunks is copied (at most kMaxFrame bytes). A header whose length,
+ * markers, energies or footer do not check out is treated as noise and
+ * the scan resumes at the next byte, so a corrupted or truncated frame
+ * costs at most that frame. The protocol has no checksum, so a corrupted
+ * distance byte inside an otherwise intact frame goes through.
+ *
+ * Pure logic with no ESP-IDF dependencies. Not thread-safe.
+ */
+class Rd01Parser {
+public:
+    static constexpr size_t kHeaderLen = 4;
+    static constexpr size_t kLengthLen = 2;
+    static constexpr size_t kFooterLen = 4;
+    static constexpr size_t kMinReportPayload = 13;
+    static constexpr size_t kMaxPayload = 64;
+    static constexpr size_t kMaxFrame = kHeaderLen + kLengthLen + kMaxPayload + kFooterLen;
+
+    Rd01Parser();
+
+    void setCallback(Rd01ReportCallback callback, void* arg);
+
+    /**
+     * @brief Consume bytes; reports are delivered through the callback
+     */
+    void feed(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Drop a partially received frame (e.g. after a UART overflow)
+     */
+    void reset();
+
+    const Rd01ParserStats& stats() const { return stats_; }
+
+private:
+    enum class Result {
+        Frame,     // Complete, valid frame
+        NeedMore,  // Valid so far, truncated
+        Noise,     // Not a frame header
+        Bad,       // Header matched, frame did not validate
+    };
+
+    Result check(const uint8_t* p, size_t avail, size_t* frame_len) const;
+    void decode(const uint8_t* frame);
+    void scan(const uint8_t* data, size_t len);
+    void feedPending(const uint8_t** data, size_t* len);
+
+    Rd01ReportCallback callback_;
+    void* callback_arg_;
+    Rd01ParserStats stats_;
+
+    uint8_t pending_[kMaxFrame];  // Frame split across feed() calls
+    size_t pending_len_;
+};
+
+#endif // RD01_PARSER_H
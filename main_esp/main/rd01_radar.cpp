@@ -0,0 +1,198 @@
+#include "rd01_radar.h"
+#include "esp_log.h"
+#include <cstring>
+
+static const char *TAG = "Rd01Radar";
+
+// UART driver ring buffer and event queue depth
+#define RX_BUFFER_SIZE 2048
+#define EVENT_QUEUE_LEN 16
+
+// Wake the task once this many bytes sit in the 128-byte RX FIFO, or when
+// the line has been idle for RX_TIMEOUT_SYMBOLS character times (end of a
+// frame), so one event usually carries one or more whole frames
+#define RX_FULL_THRESHOLD 64
+#define RX_TIMEOUT_SYMBOLS 4
+
+// Chunk drained from the ring buffer per uart_read_bytes()
+#define RX_CHUNK_SIZE 256
+
+// The radar reports every ~50-100 ms; longer silence means it is not running
+#define REPORT_TIMEOUT_MS 250
+
+#define RX_TASK_STACK_SIZE 3072
+#define RX_TASK_PRIORITY 4
+
+Rd01Radar::Rd01Radar(uart_port_t port, gpio_num_t tx_pin, gpio_num_t rx_pin, int baud_rate)
+    : port(port),
+      tx_pin(tx_pin),
+      rx_pin(rx_pin),
+      baud_rate(baud_rate),
+      uart_queue(nullptr),
+      report_queue(nullptr),
+      rx_task_handle(nullptr),
+      lock(portMUX_INITIALIZER_UNLOCKED) {
+    memset(&stats, 0, sizeof(stats));
+    memset(&last_report, 0, sizeof(last_report));
+}
+
+Rd01Radar::~Rd01Radar() {
+    deinit();
+}
+
+bool Rd01Radar::init() {
+    ESP_LOGI(TAG, "Initializing Rd-01 radar on UART%d (TX=%d, RX=%d, %d baud)",
+             port, tx_pin, rx_pin, baud_rate);
+
+    uart_config_t uart_cfg = {
+        .baud_rate = baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh = 0,
+        .source_clk = UART_SCLK_DEFAULT,
+        .flags = {},
+    };
+
+    // IRAM ISR (CONFIG_UART_ISR_IN_IRAM): the 128-byte FIFO fills in 5 ms at
+    // 256000 baud, less than a flash sector erase keeps the cache disabled
+    if (uart_driver_install(port, RX_BUFFER_SIZE, 0, EVENT_QUEUE_LEN, &uart_queue,
+                            ESP_INTR_FLAG_IRAM) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to install UART driver");
+        return false;
+    }
+    if (uart_param_config(port, &uart_cfg) != ESP_OK ||
+        uart_set_pin(port, tx_pin, rx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to configure UART");
+        deinit();
+        return false;
+    }
+    uart_set_rx_full_threshold(port, RX_FULL_THRESHOLD);
+    uart_set_rx_timeout(port, RX_TIMEOUT_SYMBOLS);
+
+    report_queue = xQueueCreate(1, sizeof(Rd01Report));
+    if (report_queue == nullptr) {
+        ESP_LOGE(TAG, "Failed to create report queue");
+        deinit();
+        return false;
+    }
+
+    parser.setCallback(on_report, this);
+    if (xTaskCreate(rx_task, "rd01_rx", RX_TASK_STACK_SIZE, this, RX_TASK_PRIORITY,
+                    &rx_task_handle) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create receive task");
+        rx_task_handle = nullptr;
+        deinit();
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Rd-01 radar initialized successfully");
+    return true;
+}
+
+void Rd01Radar::deinit() {
+    if (rx_task_handle != nullptr) {
+        vTaskDelete(rx_task_handle);
+        rx_task_handle = nullptr;
+    }
+    if (uart_queue != nullptr) {
+        ESP_LOGI(TAG, "Deinitializing Rd-01 radar");
+        uart_driver_delete(port);  // Also deletes uart_queue
+        uart_queue = nullptr;
+    }
+    if (report_queue != nullptr) {
+        vQueueDelete(report_queue);
+        report_queue = nullptr;
+    }
+    parser.reset();
+}
+
+// Runs in the receive task, from inside parser.feed()
+void Rd01Radar::on_report(const Rd01Report& report, void* arg) {
+    Rd01Radar* self = static_cast<Rd01Radar*>(arg);
+    xQueueOverwrite(self->report_queue, &report);
+}
+
+void Rd01Radar::rx_task(void* arg) {
+    Rd01Radar* self = static_cast<Rd01Radar*>(arg);
+    uint8_t chunk[RX_CHUNK_SIZE];
+    uart_event_t event;
+
+    while (true) {
+        if (xQueueReceive(self->uart_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        switch (event.type) {
+        case UART_DATA: {
+            // Drain everything buffered, not just event.size: later events
+            // for the same bytes then find the buffer empty and cost nothing
+            size_t buffered = 0;
+            uart_get_buffered_data_len(self->port, &buffered);
+            while (buffered > 0) {
+                size_t want = buffered < sizeof(chunk) ? buffered : sizeof(chunk);
+                int len = uart_read_bytes(self->port, chunk, want, 0);
+                if (len <= 0) {
+                    break;
+                }
+                self->parser.feed(chunk, (size_t)len);
+                buffered -= (size_t)len;
+            }
+            break;
+        }
+
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            // Bytes were lost; whatever frame was in progress is garbage
+            ESP_LOGW(TAG, "UART overflow, flushing input");
+            uart_flush_input(self->port);
+            xQueueReset(self->uart_queue);
+            self->parser.reset();
+            portENTER_CRITICAL(&self->lock);
+            self->stats.overflows++;
+            portEXIT_CRITICAL(&self->lock);
+            continue;
+
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            // The parser resynchronises on its own
+            ESP_LOGD(TAG, "UART line error %d", event.type);
+            break;
+
+        default:
+            break;
+        }
+
+        const Rd01ParserStats& parser_stats = self->parser.stats();
+        portENTER_CRITICAL(&self->lock);
+        self->stats.parser = parser_stats;
+        portEXIT_CRITICAL(&self->lock);
+    }
+}
+
+bool Rd01Radar::get_report(Rd01Report* report, TickType_t timeout) {
+    if (report_queue == nullptr) {
+        return false;
+    }
+    if (xQueueReceive(report_queue, report, timeout) != pdTRUE) {
+        return false;
+    }
+    last_report = *report;
+    return true;
+}
+
+float Rd01Radar::measure_distance_cm() {
+    Rd01Report report;
+    if (!get_report(&report, pdMS_TO_TICKS(REPORT_TIMEOUT_MS))) {
+        ESP_LOGD(TAG, "No report within %d ms", REPORT_TIMEOUT_MS);
+        return -1;
+    }
+    return report.present() ? (float)report.distance_cm() : -1;
+}
+
+void Rd01Radar::get_stats(Rd01RadarStats* out) {
+    portENTER_CRITICAL(&lock);
+    *out = stats;
+    portEXIT_CRITICAL(&lock);
+}
@@ -0,0 +1,99 @@
+#ifndef RD01_RADAR_H
+#define RD01_RADAR_H
+
+#include "distance_sensor.h"
+#include "rd01_parser.h"
+#include "driver/gpio.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+struct Rd01RadarStats {
+    Rd01ParserStats parser;
+    uint32_t overflows;  // UART FIFO/ring buffer overruns (input flushed)
+};
+
+/**
+ * @brief Ai-Thinker Rd-01 24 GHz mmWave radar on a UART
+ *
+ * The radar streams target reports on its own (basic or engineering mode,
+ * 256000 baud by default). A receive task blocks on the UART driver's
+ * event queue, so it only wakes when the RX FIFO crosses its threshold or
+ * the line goes idle after a frame, then drains the ring buffer in
+ * chunks through Rd01Parser. The newest report is kept in a one-slot
+ * mailbox; readers always get the latest state, never a backlog.
+ *
+ * Unlike the HC-SR04 the radar also sees people standing still, and
+ * reports "no target" instead of a distance when nobody is there.
+ *
+ * Usage:  Rd01Radar radar(UART_NUM_2, GPIO_NUM_17, GPIO_NUM_16, 256000);
+ *         radar.init();
+ *         float cm = radar.measure_distance_cm();  // -1 if nobody present
+ */
+class Rd01Radar : public DistanceSensor {
+public:
+    /**
+     * @brief Constructor for the Rd-01 radar
+     * @param port UART connected to the radar
+     * @param tx_pin GPIO to the radar's RX
+     * @param rx_pin GPIO from the radar's TX
+     * @param baud_rate Radar baud rate
+     */
+    Rd01Radar(uart_port_t port, gpio_num_t tx_pin, gpio_num_t rx_pin, int baud_rate);
+    ~Rd01Radar() override;
+
+    /**
+     * @brief Install the UART driver and start the receive task
+     * @return true if initialization successful, false otherwise
+     */
+    bool init() override;
+
+    /**
+     * @brief Stop the receive task and release the UART
+     */
+    void deinit();
+
+    /**
+     * @brief Wait for a report newer than the last one returned
+     * @return false if none arrived within timeout
+     */
+    bool get_report(Rd01Report* report, TickType_t timeout);
+
+    /**
+     * @brief Distance of the nearest target from the next report
+     * @return Distance in cm, or -1 if no target or the radar is silent
+     */
+    float measure_distance_cm() override;
+
+    /**
+     * @brief Get the last returned report
+     */
+    Rd01Report get_last_report() const { return last_report; }
+
+    void get_stats(Rd01RadarStats* stats);
+
+private:
+    uart_port_t port;
+    gpio_num_t tx_pin;
+    gpio_num_t rx_pin;
+    int baud_rate;
+
+    QueueHandle_t uart_queue;    // Driver events
+    QueueHandle_t report_queue;  // Newest Rd01Report (length 1)
+    TaskHandle_t rx_task_handle;
+    portMUX_TYPE lock;           // Guards stats
+
+    Rd01Parser parser;           // Only touched by the receive task
+    Rd01RadarStats stats;
+    Rd01Report last_report;
+
+    /**
+     * @brief Receive task: UART events -> parser -> report mailbox
+     */
+    static void rx_task(void* arg);
+
+    static void on_report(const Rd01Report& report, void* arg);
+};
+
+#endif // RD01_RADAR_H
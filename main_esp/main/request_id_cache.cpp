@@ -0,0 +1,52 @@
+#include "request_id_cache.h"
+
+namespace {
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ULL;
+constexpr uint64_t kFnvPrime = 0x100000001b3ULL;
+
+uint64_t fnv1a(const char* data, size_t len) {
+    uint64_t hash = kFnvOffset;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)data[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+}  // namespace
+
+RequestIdCache::RequestIdCache() : clock_(0) {
+    for (Entry& entry : entries_) {
+        entry.hash = 0;
+        entry.last_used = 0;
+    }
+}
+
+bool RequestIdCache::checkAndInsert(const char* id, size_t len) {
+    const uint64_t hash = fnv1a(id, len);
+    if (++clock_ == 0) {
+        // Wrapped after 4G requests: restart the ages, keep the ids
+        for (Entry& entry : entries_) {
+            if (entry.last_used != 0) {
+                entry.last_used = 1;
+            }
+        }
+        clock_ = 2;
+    }
+
+    Entry* victim = &entries_[0];
+    for (Entry& entry : entries_) {
+        if (entry.last_used != 0 && entry.hash == hash) {
+            entry.last_used = clock_;
+            return true;
+        }
+        if (entry.last_used < victim->last_used) {
+            victim = &entry;
+        }
+    }
+
+    victim->hash = hash;
+    victim->last_used = clock_;
+    return false;
+}
@@ -0,0 +1,39 @@
+#ifndef REQUEST_ID_CACHE_H
+#define REQUEST_ID_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Recently seen RPC request ids, for duplicate rejection
+ *
+ * Keeps a 64-bit FNV-1a hash of the last kCapacity ids and evicts the
+ * least recently seen one when full. A redelivered QoS 1 command or a
+ * backend retry is then recognised with a hash and a short linear scan,
+ * without storing the ids themselves.
+ *
+ * Not thread-safe: owned by the MQTT command worker.
+ */
+class RequestIdCache {
+public:
+    static constexpr size_t kCapacity = 16;
+
+    RequestIdCache();
+
+    /**
+     * @brief Record id as seen
+     * @return true if it was already in the cache (a duplicate)
+     */
+    bool checkAndInsert(const char* id, size_t len);
+
+private:
+    struct Entry {
+        uint64_t hash;
+        uint32_t last_used;  // 0 marks an empty entry
+    };
+
+    Entry entries_[kCapacity];
+    uint32_t clock_;
+};
+
+#endif // REQUEST_ID_CACHE_H
@@ -0,0 +1,199 @@
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-capacity lock-free ring buffer (single producer, single consumer)
+ *
+ * Storage lives inside the object, so a RingBuffer embedded in a static
+ * singleton never touches the heap. When the buffer is full the producer
+ * evicts the oldest element instead of blocking, which makes the tail a
+ * shared index: both sides advance it with a CAS.
+ *
+ * Consumers read with peek() and release with consume(), so a record is
+ * only dropped from the buffer once the caller has finished with it.
+ * peek() validates its copy against concurrent eviction (seqlock style)
+ * and never returns a slot the producer may have overwritten.
+ *
+ * Head and tail are free-running 32-bit counters; with a capacity that is
+ * not a power of two the slot mapping breaks after 2^32 pushes (~4000
+ * years at one record per 30 s).
+ */
+template <typename T, size_t Capacity>
+class RingBuffer {
+public:
+    static constexpr size_t kCapacity = Capacity;
+
+    RingBuffer() : head_(0), tail_(0), peek_tail_(0), dropped_(0) {}
+
+    /**
+     * @brief Append an element (producer only)
+     * @return true if the oldest element had to be evicted to make room
+     */
+    bool push(const T& item) {
+        const uint32_t head = head_.load(std::memory_order_relaxed);
+        bool evicted = false;
+
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        while (head - tail >= Capacity) {
+            // Full: drop the oldest. Losing the CAS means the consumer
+            // released space in the meantime, so re-check.
+            if (tail_.compare_exchange_weak(tail, tail + 1,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                evicted = true;
+                break;
+            }
+        }
+
+        slots_[head % Capacity] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return evicted;
+    }
+
+    /**
+     * @brief Copy up to max_count oldest elements without removing them (consumer only)
+     * @param out Caller-provided destination, at least max_count elements
+     * @param max_count Maximum number of elements to copy
+     * @return Number of elements copied
+     */
+    size_t peek(T* out, size_t max_count) {
+        while (true) {
+            const uint32_t tail = tail_.load(std::memory_order_acquire);
+            const uint32_t head = head_.load(std::memory_order_acquire);
+            size_t count = head - tail;
+            if (count > max_count) {
+                count = max_count;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                out[i] = slots_[(tail + i) % Capacity];
+            }
+
+            // Any slot below the current tail may have been overwritten
+            // while we were copying; discard those and keep the rest.
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const uint32_t evicted = tail_.load(std::memory_order_relaxed) - tail;
+            if (evicted == 0) {
+                peek_tail_ = tail;
+                return count;
+            }
+            if (evicted >= count) {
+                continue;
+            }
+            for (size_t i = evicted; i < count; i++) {
+                out[i - evicted] = out[i];
+            }
+            peek_tail_ = tail + evicted;
+            return count - evicted;
+        }
+    }
+
+    /**
+     * @brief Like peek(), but from position *from instead of the oldest element (consumer only)
+     *
+     * Positions count pushes since construction, so a consumer can read
+     * ahead of elements it has not released yet. Positions the producer
+     * already evicted are skipped: *from is moved up to the first element
+     * copied. Does not change what consume() releases.
+     *
+     * @return Number of elements copied, the first one at position *from
+     */
+    size_t peekFrom(uint32_t* from, T* out, size_t max_count) {
+        while (true) {
+            const uint32_t tail = tail_.load(std::memory_order_acquire);
+            const uint32_t head = head_.load(std::memory_order_acquire);
+            const uint32_t start = (int32_t)(*from - tail) > 0 ? *from : tail;
+            size_t count = (int32_t)(head - start) > 0 ? head - start : 0;
+            if (count > max_count) {
+                count = max_count;
+            }
+
+            for (size_t i = 0; i < count; i++) {
+                out[i] = slots_[(start + i) % Capacity];
+            }
+
+            // Same eviction check as peek()
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const int32_t evicted = (int32_t)(tail_.load(std::memory_order_relaxed) - start);
+            if (evicted <= 0) {
+                *from = start;
+                return count;
+            }
+            if ((size_t)evicted >= count) {
+                continue;
+            }
+            for (size_t i = evicted; i < count; i++) {
+                out[i - evicted] = out[i];
+            }
+            *from = start + evicted;
+            return count - evicted;
+        }
+    }
+
+    /**
+     * @brief Release every element before position end (consumer only)
+     */
+    void consumeTo(uint32_t end) {
+        uint32_t tail = tail_.load(std::memory_order_acquire);
+        while ((int32_t)(end - tail) > 0) {
+            if (tail_.compare_exchange_weak(tail, end,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                break;
+            }
+        }
+    }
+
+    /**
+     * @brief Release count elements returned by the last peek() (consumer only)
+     *
+     * Elements the producer evicted in the meantime are already gone, so the
+     * tail is only ever moved forward.
+     */
+    void consume(size_t count) {
+        const uint32_t target = peek_tail_ + (uint32_t)count;
+        consumeTo(target);
+        peek_tail_ = target;
+    }
+
+    /**
+     * @brief peek() followed by consume() (consumer only)
+     */
+    size_t pop(T* out, size_t max_count) {
+        size_t count = peek(out, max_count);
+        consume(count);
+        return count;
+    }
+
+    size_t size() const {
+        const uint32_t tail = tail_.load(std::memory_order_acquire);
+        const uint32_t head = head_.load(std::memory_order_acquire);
+        const uint32_t count = head - tail;
+        // A racing eviction can briefly make head - tail read as N + 1
+        return count > Capacity ? Capacity : count;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    /**
+     * @brief Total number of elements evicted because the buffer was full
+     */
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    // ESP32 cache lines are 32 bytes; keep producer and consumer indices apart
+    static constexpr size_t kCacheLine = 32;
+
+    alignas(kCacheLine) std::atomic<uint32_t> head_;
+    alignas(kCacheLine) std::atomic<uint32_t> tail_;
+    uint32_t peek_tail_;  // Consumer-private: tail observed by the last peek()
+    std::atomic<uint32_t> dropped_;
+    alignas(kCacheLine) T slots_[Capacity];
+};
+
+#endif // RING_BUFFER_H
@@ -0,0 +1,176 @@
+#include "sampling_scheduler.h"
+#include <cmath>
+#include <cstring>
+
+namespace {
+    // An hour only updates its average if the device saw most of it
+    constexpr int64_t kMinHourCoverageMs = 30 * 60 * 1000;
+    // Longer gaps between samples (task stalled) are not attributed to an hour
+    constexpr int64_t kMaxSampleGapMs = 10 * 1000;
+
+    float clamp01(float v) {
+        return v < 0 ? 0 : v > 1 ? 1 : v;
+    }
+}
+
+SamplingScheduler::SamplingScheduler(const SamplingSchedulerConfig& config)
+    : config_(config),
+      start_ms_(-1),
+      last_ms_(0),
+      last_quiet_ms_(-1),
+      last_present_ms_(-1),
+      last_hint_ms_(-1),
+      was_present_(false),
+      interval_ms_(config.min_interval_ms),
+      samples_(0),
+      hour_(-1),
+      hour_total_ms_(0),
+      hour_present_ms_(0),
+      detections_(0),
+      latency_max_ms_(0) {
+    // The curve spans only the range the latency budget allows
+    uint32_t cap = config_.max_latency_ms > config_.attack_ms
+                       ? config_.max_latency_ms - config_.attack_ms
+                       : config_.min_interval_ms;
+    if (config_.max_interval_ms > cap) {
+        config_.max_interval_ms = cap;
+    }
+    if (config_.max_interval_ms < config_.min_interval_ms) {
+        config_.max_interval_ms = config_.min_interval_ms;
+    }
+    log_ratio_ = logf((float)config_.min_interval_ms / (float)config_.max_interval_ms);
+    for (int i = 0; i < kHours; i++) {
+        history_[i] = 0;
+    }
+    memset(latency_bins_, 0, sizeof(latency_bins_));
+}
+
+void SamplingScheduler::learn(const SamplingInput& in, int64_t dt_ms) {
+    if (in.hour != hour_) {
+        if (hour_ >= 0 && hour_total_ms_ >= kMinHourCoverageMs) {
+            float occupied = (float)hour_present_ms_ / (float)hour_total_ms_;
+            history_[hour_] += config_.history_alpha * (occupied - history_[hour_]);
+        }
+        hour_ = in.hour >= 0 && in.hour < kHours ? in.hour : -1;
+        hour_total_ms_ = 0;
+        hour_present_ms_ = 0;
+    }
+    if (hour_ >= 0 && dt_ms > 0 && dt_ms <= kMaxSampleGapMs) {
+        hour_total_ms_ += dt_ms;
+        if (was_present_) {
+            hour_present_ms_ += dt_ms;
+        }
+    }
+}
+
+float SamplingScheduler::urgency(const SamplingInput& in) const {
+    // Fast attack: one dropped echo must not fall back to the slow rate
+    // before the detector had its chance to confirm
+    if (in.present || (last_hint_ms_ >= 0 && in.now_ms - last_hint_ms_ < (int64_t)config_.attack_ms)) {
+        return 1.0f;
+    }
+    float u = 0;
+    if (config_.alert_p > config_.quiet_p) {
+        u = clamp01((in.probability - config_.quiet_p) / (config_.alert_p - config_.quiet_p));
+    }
+    if (last_present_ms_ >= 0 && config_.recency_ms > 0) {
+        float recent = expf(-(float)(in.now_ms - last_present_ms_) / (float)config_.recency_ms);
+        u = recent > u ? recent : u;
+    }
+    if (in.hour >= 0 && in.hour < kHours) {
+        float busy = clamp01(config_.history_gain * history_[in.hour]);
+        u = busy > u ? busy : u;
+    }
+    if (in.leds_on && config_.led_urgency > u) {
+        u = clamp01(config_.led_urgency);
+    }
+    return u;
+}
+
+uint32_t SamplingScheduler::next(const SamplingInput& in) {
+    if (start_ms_ < 0) {
+        start_ms_ = in.now_ms;
+        last_ms_ = in.now_ms;
+    }
+    int64_t dt = in.now_ms - last_ms_;
+    last_ms_ = in.now_ms;
+    samples_++;
+    learn(in, dt);
+
+    if (in.present) {
+        if (!was_present_ && last_quiet_ms_ >= 0) {
+            uint32_t latency = (uint32_t)(in.now_ms - last_quiet_ms_);
+            int bin = latency / kLatencyBinMs;
+            if (bin >= kLatencyBins) {
+                bin = kLatencyBins - 1;
+            }
+            if (latency_bins_[bin] == UINT16_MAX) {
+                // Keep the shape, forget half the past
+                for (int i = 0; i < kLatencyBins; i++) {
+                    latency_bins_[i] /= 2;
+                }
+            }
+            latency_bins_[bin]++;
+            if (latency > latency_max_ms_) {
+                latency_max_ms_ = latency;
+            }
+            detections_++;
+        }
+        last_quiet_ms_ = -1;
+        last_present_ms_ = in.now_ms;
+    } else if (!in.hint) {
+        last_quiet_ms_ = in.now_ms;
+    }
+    if (in.hint) {
+        last_hint_ms_ = in.now_ms;
+    }
+    was_present_ = in.present;
+
+    float interval = (float)config_.max_interval_ms * expf(urgency(in) * log_ratio_);
+    interval_ms_ = (uint32_t)(interval + 0.5f);
+    if (interval_ms_ > config_.max_interval_ms) {
+        interval_ms_ = config_.max_interval_ms;
+    }
+    if (interval_ms_ < config_.min_interval_ms) {
+        interval_ms_ = config_.min_interval_ms;
+    }
+    return interval_ms_;
+}
+
+uint32_t SamplingScheduler::percentile(uint32_t permille) const {
+    uint32_t total = 0;
+    for (int i = 0; i < kLatencyBins; i++) {
+        total += latency_bins_[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint32_t rank = (total * permille + 999) / 1000;
+    uint32_t seen = 0;
+    for (int i = 0; i < kLatencyBins - 1; i++) {
+        seen += latency_bins_[i];
+        if (seen >= rank) {
+            return (uint32_t)(i + 1) * kLatencyBinMs;  // Upper edge of the bin
+        }
+    }
+    return latency_max_ms_;
+}
+
+SamplingStats SamplingScheduler::stats(int64_t now_ms) const {
+    SamplingStats s = {};
+    s.interval_ms = interval_ms_;
+    s.samples = samples_;
+    int64_t elapsed = start_ms_ >= 0 ? now_ms - start_ms_ : 0;
+    uint64_t energy_uj = (uint64_t)samples_ * config_.sample_energy_uj;
+    s.energy_mj = (uint32_t)(energy_uj / 1000);
+    if (elapsed > 0) {
+        s.samples_per_hour = (uint32_t)((uint64_t)samples_ * 3600000 / (uint64_t)elapsed);
+        s.avg_power_uw = (uint32_t)(energy_uj * 1000 / (uint64_t)elapsed);  // uJ/ms is mW, x1000 for uW
+    }
+    s.detections = detections_;
+    s.latency_p50_ms = percentile(500);
+    s.latency_p90_ms = percentile(900);
+    s.latency_p99_ms = percentile(990);
+    s.latency_max_ms = latency_max_ms_;
+    return s;
+}
@@ -0,0 +1,119 @@
+#ifndef SAMPLING_SCHEDULER_H
+#define SAMPLING_SCHEDULER_H
+
+#include <cstdint>
+
+struct SamplingSchedulerConfig {
+    uint32_t min_interval_ms;   // Fastest rate: someone there, or a first hit
+    uint32_t max_interval_ms;   // Slowest rate: empty at a quiet hour
+    uint32_t max_latency_ms;    // Worst-case first detection after idle
+    uint32_t attack_ms;         // Time to confirm a first hit at the fastest rate
+    float quiet_p;              // Presence probability treated as "nobody"...
+    float alert_p;              // ...and as certainly someone
+    uint32_t recency_ms;        // Urgency fades over this after presence ends
+    float led_urgency;          // Urgency floor while the LEDs are on
+    float history_gain;         // Urgency per occupied fraction of the hour
+    float history_alpha;        // Weight of today in the per-hour average
+    uint32_t sample_energy_uj;  // Estimated energy of one sample (ping + wake)
+};
+
+struct SamplingInput {
+    int64_t now_ms;
+    float probability;  // Fused presence probability
+    bool present;       // Fused presence decision
+    bool hint;          // Raw readings suggest someone: start a fast-attack burst
+    bool leds_on;
+    int hour;           // Local hour 0..23, or -1 while the clock is not set
+};
+
+struct SamplingStats {
+    uint32_t interval_ms;      // Delay chosen after the last sample
+    uint32_t samples;          // Since boot
+    uint32_t samples_per_hour; // Average since boot
+    uint32_t energy_mj;        // Estimated sampling energy since boot
+    uint32_t avg_power_uw;     // energy / uptime
+    uint32_t detections;       // Presence onsets after a quiet sample
+    uint32_t latency_p50_ms;   // Onset latency bounds (see below), 0 if none
+    uint32_t latency_p90_ms;
+    uint32_t latency_p99_ms;
+    uint32_t latency_max_ms;
+};
+
+/**
+ * @brief Chooses the delay before the next presence sample
+ *
+ * Each sample is taken as "urgency" u in [0, 1]: the highest of
+ *   - 1 while someone is present, and for attack_ms after any hint
+ *     (fast attack),
+ *   - the fused probability between quiet_p and alert_p,
+ *   - exp(-t / recency_ms) since presence last ended,
+ *   - history_gain * the learned occupied fraction of this hour of the day,
+ *   - led_urgency while the LEDs are on.
+ * The delay follows a log-scale curve between the two rates,
+ *
+ *   interval = max_interval * (min_interval / max_interval)^u
+ *
+ * where max_interval is first capped at max_latency_ms - attack_ms:
+ * someone arriving just after a sample is seen on the next one, and the
+ * fast-attack burst confirms them within attack_ms.
+ *
+ * Detection latency is measured as an upper bound, from the last sample
+ * that saw nobody to the presence onset, into 20 ms bins for percentiles.
+ *
+ * Pure logic with no ESP-IDF dependencies. Not thread-safe.
+ */
+class SamplingScheduler {
+public:
+    static constexpr int kHours = 24;
+
+    explicit SamplingScheduler(const SamplingSchedulerConfig& config);
+
+    /**
+     * @brief Account for the sample just taken
+     * @return Delay in ms until the next sample
+     */
+    uint32_t next(const SamplingInput& in);
+
+    /**
+     * @brief Statistics as of now_ms
+     */
+    SamplingStats stats(int64_t now_ms) const;
+
+    /**
+     * @brief Learned occupied fraction of an hour of the day (0..1)
+     */
+    float history(int hour) const { return hour >= 0 && hour < kHours ? history_[hour] : 0; }
+
+    const SamplingSchedulerConfig& config() const { return config_; }
+
+private:
+    static constexpr uint32_t kLatencyBinMs = 20;
+    static constexpr int kLatencyBins = 128;  // Last bin collects everything above
+
+    float urgency(const SamplingInput& in) const;
+    void learn(const SamplingInput& in, int64_t dt_ms);
+    uint32_t percentile(uint32_t permille) const;
+
+    SamplingSchedulerConfig config_;
+    float log_ratio_;            // ln(min_interval / max_interval)
+
+    int64_t start_ms_;
+    int64_t last_ms_;
+    int64_t last_quiet_ms_;      // Last sample with nobody and no hint, -1 if none
+    int64_t last_present_ms_;    // -1 if never
+    int64_t last_hint_ms_;       // -1 if never
+    bool was_present_;
+    uint32_t interval_ms_;
+    uint32_t samples_;
+
+    float history_[kHours];
+    int hour_;                   // Hour being accumulated, -1 if none
+    int64_t hour_total_ms_;
+    int64_t hour_present_ms_;
+
+    uint32_t detections_;
+    uint16_t latency_bins_[kLatencyBins];
+    uint32_t latency_max_ms_;
+};
+
+#endif // SAMPLING_SCHEDULER_H
@@ -1,50 +1,156 @@
 #include "sensor_manager.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+static const char* TAG = "sensor_manager";
+static const char* SPOOL_PARTITION_LABEL = "spool";
+static const char* NVS_NAMESPACE = "telemetry";
+static const char* NVS_KEY_SEQ = "seq_ckpt";
 
 SensorManager& SensorManager::getInstance() {
     static SensorManager instance;
     return instance;
 }
 
-void SensorManager::enqueue(const Telemetry& data) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    if (queue_.size() >= MAX_QUEUE_SIZE) {
-        // Drop oldest if full to prevent OOM
-        queue_.pop_front();
+bool SensorManager::initSpool() {
+    return spool_.mount(SPOOL_PARTITION_LABEL);
+}
+
+bool SensorManager::initSequence() {
+    uint32_t checkpoint = 0;
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_u32(handle, NVS_KEY_SEQ, &checkpoint);
+        nvs_close(handle);
     }
-    queue_.push_back(data);
+    if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_LOGW(TAG, "Failed to read sequence checkpoint: %s", esp_err_to_name(err));
+    }
+
+    next_seq_ = checkpoint;
+    boot_seq_ = checkpoint;
+    ESP_LOGI(TAG, "Telemetry sequence resumes at %lu", (unsigned long)checkpoint);
+    return saveSeqCheckpoint(checkpoint + SEQ_CHECKPOINT_INTERVAL);
 }
 
-void SensorManager::requeueBatch(const std::vector<Telemetry>& batch) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    for (auto it = batch.rbegin(); it != batch.rend(); ++it) {
-        if (queue_.size() < MAX_QUEUE_SIZE) {
-            queue_.push_front(*it);
+bool SensorManager::saveSeqCheckpoint(uint32_t checkpoint) {
+    // Advance even if the write fails: telemetry must not stall on NVS,
+    // at worst numbers repeat after the next reboot
+    seq_checkpoint_ = checkpoint;
+
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK) {
+        err = nvs_set_u32(handle, NVS_KEY_SEQ, checkpoint);
+        if (err == ESP_OK) {
+            err = nvs_commit(handle);
         }
-        else {
-            queue_.push_front(*it);
-            queue_.pop_back(); 
+        nvs_close(handle);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save sequence checkpoint: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+void SensorManager::enqueue(const Telemetry& record) {
+    Telemetry data = record;
+    if (next_seq_ >= seq_checkpoint_) {
+        saveSeqCheckpoint(next_seq_ + SEQ_CHECKPOINT_INTERVAL);
+    }
+    data.seq = next_seq_++;
+
+    // Keep spooling until the spool is drained so records stay in order
+    if (spool_.isMounted() &&
+        (!spool_.empty() || queue_.size() >= SPOOL_HIGH_WATER)) {
+        if (spool_.append(&data, sizeof(data))) {
+            return;
         }
+        ESP_LOGW(TAG, "Spool append failed, falling back to RAM queue");
+    }
+
+    // Drop oldest if full to prevent unbounded growth
+    if (queue_.push(data)) {
+        ESP_LOGW(TAG, "Queue full, dropped oldest record (total dropped: %lu)",
+                 (unsigned long)queue_.dropped());
     }
 }
 
-std::vector<Telemetry> SensorManager::popBatch(size_t max_count) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    std::vector<Telemetry> batch;
-    batch.reserve(max_count);
+size_t SensorManager::peekBatch(Telemetry* out, size_t max_count) {
+    // RAM holds the oldest records; only read the spool once it is empty
+    uint32_t from = ram_cursor_;
+    size_t count = queue_.peekFrom(&from, out, max_count);
+    peeked_.from_spool = false;
+    peeked_.ram_end = from + (uint32_t)count;
+    if (count == 0 && spool_.isMounted()) {
+        peeked_.spool_end = spool_cursor_;
+        count = spool_.peekAfter(&peeked_.spool_end, out, sizeof(Telemetry), max_count);
+        peeked_.from_spool = true;
+    }
+    if (count > 0) {
+        peeked_.last_seq = out[count - 1].seq;
+    }
+    peeked_count_ = count;
+    return count;
+}
 
-    while (!queue_.empty() && batch.size() < max_count) {
-        batch.push_back(queue_.front());
-        queue_.pop_front();
+bool SensorManager::takeBatch() {
+    if (peeked_count_ == 0 || taken_count_ == MAX_BATCHES_TAKEN) {
+        return false;
+    }
+    taken_[(taken_first_ + taken_count_) % MAX_BATCHES_TAKEN] = peeked_;
+    taken_count_++;
+    if (peeked_.from_spool) {
+        spool_cursor_ = peeked_.spool_end;
+    } else {
+        ram_cursor_ = peeked_.ram_end;
+    }
+    peeked_count_ = 0;
+    return true;
+}
+
+void SensorManager::release(const TakenBatch& batch) {
+    if (batch.from_spool) {
+        spool_.commitTo(batch.spool_end);
+    } else {
+        queue_.consumeTo(batch.ram_end);
+    }
+}
+
+void SensorManager::commitBefore(uint32_t seq) {
+    while (taken_count_ > 0 && (int32_t)(taken_[taken_first_].last_seq - seq) < 0) {
+        release(taken_[taken_first_]);
+        taken_first_ = (taken_first_ + 1) % MAX_BATCHES_TAKEN;
+        taken_count_--;
+    }
+}
+
+void SensorManager::commitAll() {
+    while (taken_count_ > 0) {
+        release(taken_[taken_first_]);
+        taken_first_ = (taken_first_ + 1) % MAX_BATCHES_TAKEN;
+        taken_count_--;
     }
-    return batch;
 }
 
 size_t SensorManager::size() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.size();
+    return queue_.size() + spool_.pendingCount();
 }
 
 bool SensorManager::empty() const {
-    std::lock_guard<std::mutex> lock(mutex_);
-    return queue_.empty();
+    return queue_.empty() && spool_.empty();
+}
+
+uint32_t SensorManager::droppedCount() const {
+    return queue_.dropped() + spool_.droppedCount();
+}
+
+size_t SensorManager::spooledCount() const {
+    return spool_.pendingCount();
+}
+
+TelemetryBatchInfo SensorManager::batchInfo() const {
+    return {boot_seq_, droppedCount()};
 }
@@ -1,38 +1,104 @@
 #ifndef SENSOR_MANAGER_H
 #define SENSOR_MANAGER_H
 
-#include <deque>
-#include <mutex>
-#include <vector>
+#include "ring_buffer.h"
+#include "telemetry_record.h"
+#include "telemetry_spool.h"
+#include <cstddef>
 #include <cstdint>
 
-struct Telemetry {
-  int64_t timestamp;
-  double temperature;
-  double humidity;
-  double pressure;
-  int person_count;
-};
-
+/**
+ * @brief Telemetry queue between sensor_read (producer) and mqtt_pub (consumer)
+ *
+ * Backed by a statically allocated lock-free ring buffer: enqueue never
+ * blocks or allocates, and the oldest record is dropped when full.
+ * The publisher peeks a batch into its own buffer and takes it, which only
+ * moves a read cursor: taken records stay queued (in RAM or on flash) until
+ * the broker has acked them and the publisher commits them, in order. A
+ * reboot before that replays them instead of losing them, and nothing has
+ * to be pushed back on failure.
+ *
+ * Once the RAM queue passes SPOOL_HIGH_WATER, new records go to the flash
+ * spool instead, and keep going there until the spool has been drained.
+ * RAM therefore always holds older records than flash, and the publisher
+ * drains RAM first, then the spool, preserving order.
+ *
+ * enqueue() stamps every record with the next sequence number. The counter
+ * is checkpointed to NVS once per SEQ_CHECKPOINT_INTERVAL records: the
+ * stored value is always ahead of every number issued, so after a reboot
+ * numbering resumes from it and never repeats (skipping the rest of the
+ * block).
+ */
 class SensorManager {
 public:
+  static constexpr size_t MAX_QUEUE_SIZE = 1000; // Limit memory usage
+  static constexpr size_t SPOOL_HIGH_WATER = 800; // Spill to flash above this
+  static constexpr uint32_t SEQ_CHECKPOINT_INTERVAL = 256; // ~2 h at 30 s
+  static constexpr size_t MAX_BATCHES_TAKEN = 4; // Awaiting commit at once
+
   static SensorManager &getInstance();
 
+  // Mount the flash spool; without it the RAM queue drops oldest when full
+  bool initSpool();
+
+  // Restore the sequence counter from NVS; call before the first enqueue
+  bool initSequence();
+
   void enqueue(const Telemetry &data);
-  void requeueBatch(const std::vector<Telemetry>& batch);
-  std::vector<Telemetry> popBatch(size_t max_count);
+
+  // Consumer side (mqtt_pub task only)
+  // Next records after those already taken, without taking them
+  size_t peekBatch(Telemetry *out, size_t max_count);
+  // Take the records of the last peekBatch; false if MAX_BATCHES_TAKEN are out
+  bool takeBatch();
+  // Release the taken batches whose records all come before seq, in order
+  void commitBefore(uint32_t seq);
+  // Release every taken batch
+  void commitAll();
+
+  // Records queued, including taken ones not committed yet
   size_t size() const;
   bool empty() const;
+  uint32_t droppedCount() const;
+  size_t spooledCount() const;
+
+  // Header for batches published now (boot sequence, eviction count)
+  TelemetryBatchInfo batchInfo() const;
 
 private:
   SensorManager() = default;
+  bool saveSeqCheckpoint(uint32_t checkpoint);
+
   ~SensorManager() = default;
   SensorManager(const SensorManager &) = delete;
   SensorManager &operator=(const SensorManager &) = delete;
 
-  std::deque<Telemetry> queue_;
-  mutable std::mutex mutex_;
-  const size_t MAX_QUEUE_SIZE = 1000; // Limit memory usage
+  // A batch handed to the publisher and not committed yet
+  struct TakenBatch {
+    uint32_t last_seq;
+    bool from_spool;
+    uint32_t ram_end;               // Queue position after the batch
+    TelemetrySpool::Mark spool_end; // Last record of the batch
+  };
+
+  void release(const TakenBatch &batch);
+
+  RingBuffer<Telemetry, MAX_QUEUE_SIZE> queue_;
+  TelemetrySpool spool_;
+
+  // Consumer-private
+  uint32_t ram_cursor_ = 0;             // Queue position after the last taken record
+  TelemetrySpool::Mark spool_cursor_ = {}; // Last taken spool record
+  TakenBatch peeked_ = {};              // What takeBatch() would take
+  size_t peeked_count_ = 0;
+  TakenBatch taken_[MAX_BATCHES_TAKEN] = {};
+  size_t taken_first_ = 0;
+  size_t taken_count_ = 0;
+
+  // Producer-private, except boot_seq_ which is fixed after initSequence()
+  uint32_t next_seq_ = 0;
+  uint32_t seq_checkpoint_ = 0;
+  uint32_t boot_seq_ = 0;
 };
 
 #endif // SENSOR_MANAGER_H
@@ -20,6 +20,7 @@ static const int MOTION_CHECK_INTERVAL_MS = 5000; // Check for motion every 5s
 #include "bmp280.h"  // For pressure sensor
 #include "person_counter.h"  // Thread-safe person counter
 #include "latest_sensor_data.h"  // Thread-safe latest sensor readings
+#include "device_shadow.h"
 
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
@@ -297,6 +298,15 @@ namespace {
     }
 }
 
+// One source's half of Telemetry::fusion from its interval counters
+static uint32_t fusion_quality(const PresenceSourceStats& s) {
+    int32_t accuracy = s.observations > 0
+                           ? (int32_t)((uint64_t)s.agreements * 100 / s.observations)
+                           : -1;
+    int32_t latency = s.onsets > 0 ? (int32_t)(s.onset_lag_ms / s.onsets) : -1;
+    return Telemetry::fusionQuality(accuracy, latency);
+}
+
 static void sensor_reading_task(void* arg) {
     ESP_LOGI(TAG, "Sensor reading task started");
     
@@ -322,6 +332,7 @@ static void sensor_reading_task(void* arg) {
         // Wait for completion (timeout 30s to handle slow BLE connections)
         if (xSemaphoreTake(s_ble_sem, pdMS_TO_TICKS(30000)) == pdTRUE) {
             // Check if we got valid data
+            DeviceShadow::reportSensor(SHADOW_SENSOR_CLIMATE, g_ctx.current_data.valid);
             if (g_ctx.current_data.valid) {
                  // Update the latest sensor data cache (always available for LED colors)
                  LatestSensorData::update(g_ctx.current_data.temperature, 
@@ -335,6 +346,7 @@ static void sensor_reading_task(void* arg) {
             }
         } else {
             ESP_LOGW(TAG, "BLE timeout - cancelling");
+            DeviceShadow::reportSensor(SHADOW_SENSOR_CLIMATE, false);
             ble_gap_disc_cancel();
             if (g_ctx.conn_handle != BLE_HS_CONN_HANDLE_NONE) {
                 ble_gap_terminate(g_ctx.conn_handle, BLE_ERR_REM_USER_CONN_TERM);
@@ -345,6 +357,7 @@ static void sensor_reading_task(void* arg) {
         float pressure = 1013.25f;
         if (g_bmp_handle != NULL) {
             esp_err_t err = bmp280_read_pressure(g_bmp_handle, &pressure);
+            DeviceShadow::reportSensor(SHADOW_SENSOR_PRESSURE, err == ESP_OK);
             if (err == ESP_OK) {
                 ESP_LOGI(TAG, "Read Pressure: %.2f hPa", pressure);
             } else {
@@ -374,16 +387,28 @@ static void sensor_reading_task(void* arg) {
         // For consistency, let's always send telemetry every cycle, using latest available data
         time_t now;
         time(&now);
-        Telemetry data;
-        data.timestamp = (int64_t)now;
-        data.humidity = LatestSensorData::get_humidity();
-        data.temperature = LatestSensorData::get_temperature();
-        data.pressure = pressure;
-        data.person_count = PersonCounter::get_and_reset();
+        float temperature = LatestSensorData::get_temperature();
+        float humidity = LatestSensorData::get_humidity();
+        PersonFlow flow = PersonCounter::get_flow_and_reset();
+        uint32_t fusion = (fusion_quality(flow.sources[PRESENCE_SOURCE_ULTRASONIC]) << 16) |
+                          fusion_quality(flow.sources[PRESENCE_SOURCE_RADAR]);
+        Telemetry data = Telemetry::make((int64_t)now,
+                                         celsius_to_centi(temperature),
+                                         percent_to_centi(humidity),
+                                         hpa_to_deci_pa(pressure),
+                                         (uint32_t)flow.count,
+                                         (uint32_t)flow.entries,
+                                         (uint32_t)flow.exits,
+                                         (uint32_t)flow.occupancy,
+                                         fusion);
 
         SensorManager::getInstance().enqueue(data);
-        ESP_LOGI(TAG, "Telemetry enqueued: T=%.2f H=%.2f P=%.2f PersonCount=%d", 
-                 data.temperature, data.humidity, data.pressure, data.person_count);
+        ESP_LOGI(TAG, "Telemetry enqueued: T=%.2f H=%.2f P=%.2f PersonCount=%d In=%d Out=%d Occupancy=%d", 
+                 temperature, humidity, pressure, flow.count, flow.entries, flow.exits,
+                 flow.occupancy);
+        ESP_LOGI(TAG, "Presence sources: ultrasonic %ld%% / %ld ms, radar %ld%% / %ld ms",
+                 (long)data.ultrasonicAccuracy(), (long)data.ultrasonicLatencyMs(),
+                 (long)data.radarAccuracy(), (long)data.radarLatencyMs());
         vTaskDelay(pdMS_TO_TICKS(SENSOR_READ_INTERVAL_MS));
     }
 }
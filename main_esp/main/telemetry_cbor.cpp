@@ -0,0 +1,189 @@
+#include "telemetry_cbor.h"
+#include <cstring>
+
+namespace {
+    constexpr uint8_t kMajorUnsigned = 0;
+    constexpr uint8_t kMajorNegative = 1;
+    constexpr uint8_t kMajorText = 3;
+    constexpr uint8_t kMajorArray = 4;
+    constexpr uint8_t kMajorMap = 5;
+
+    constexpr size_t kMapEntries = 18;
+
+    // Encoder that only counts bytes when out is null, so measure and
+    // write share one code path and can never disagree
+    struct Encoder {
+        uint8_t* out;
+        size_t len;
+
+        void head(uint8_t major, uint64_t value) {
+            uint8_t buf[9];
+            size_t n;
+            buf[0] = (uint8_t)(major << 5);
+            if (value < 24) {
+                buf[0] |= (uint8_t)value;
+                n = 1;
+            } else if (value <= 0xFF) {
+                buf[0] |= 24;
+                buf[1] = (uint8_t)value;
+                n = 2;
+            } else if (value <= 0xFFFF) {
+                buf[0] |= 25;
+                buf[1] = (uint8_t)(value >> 8);
+                buf[2] = (uint8_t)value;
+                n = 3;
+            } else if (value <= 0xFFFFFFFF) {
+                buf[0] |= 26;
+                for (int i = 0; i < 4; i++) {
+                    buf[1 + i] = (uint8_t)(value >> (24 - 8 * i));
+                }
+                n = 5;
+            } else {
+                buf[0] |= 27;
+                for (int i = 0; i < 8; i++) {
+                    buf[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+                }
+                n = 9;
+            }
+            if (out) {
+                memcpy(out + len, buf, n);
+            }
+            len += n;
+        }
+
+        void integer(int64_t value) {
+            if (value < 0) {
+                head(kMajorNegative, (uint64_t)(-1 - value));
+            } else {
+                head(kMajorUnsigned, (uint64_t)value);
+            }
+        }
+
+        void key(const char* name) {
+            size_t n = strlen(name);
+            head(kMajorText, n);
+            if (out) {
+                memcpy(out + len, name, n);
+            }
+            len += n;
+        }
+    };
+
+    void encode(Encoder& enc, const Telemetry* records, size_t count,
+                const TelemetryBatchInfo& info) {
+        const int64_t t0 = count > 0 ? records[0].timestamp() : 0;
+        const uint32_t s0 = count > 0 ? records[0].seq : 0;
+
+        enc.head(kMajorMap, kMapEntries);
+        enc.key("v");
+        enc.integer(TELEMETRY_CBOR_VERSION);
+        enc.key("t0");
+        enc.integer(t0);
+        enc.key("s0");
+        enc.integer(s0);
+        enc.key("bs");
+        enc.integer(info.boot_seq);
+        enc.key("ev");
+        enc.integer(info.dropped);
+
+        enc.key("ds");
+        enc.head(kMajorArray, count);
+        uint32_t prev_seq = s0;
+        for (size_t i = 0; i < count; i++) {
+            enc.integer((int64_t)records[i].seq - prev_seq);
+            prev_seq = records[i].seq;
+        }
+
+        enc.key("dt");
+        enc.head(kMajorArray, count);
+        int64_t prev = t0;
+        for (size_t i = 0; i < count; i++) {
+            int64_t ts = records[i].timestamp();
+            enc.integer(ts - prev);
+            prev = ts;
+        }
+
+        enc.key("t");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].temperatureCenti());
+        }
+
+        enc.key("h");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].humidityCenti());
+        }
+
+        enc.key("p");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].pressureDeciPa());
+        }
+
+        enc.key("c");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].personCount());
+        }
+
+        enc.key("en");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].entries());
+        }
+
+        enc.key("ex");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].exits());
+        }
+
+        enc.key("oc");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].occupancy());
+        }
+
+        enc.key("ua");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].ultrasonicAccuracy());
+        }
+
+        enc.key("ul");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].ultrasonicLatencyMs());
+        }
+
+        enc.key("ra");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].radarAccuracy());
+        }
+
+        enc.key("rl");
+        enc.head(kMajorArray, count);
+        for (size_t i = 0; i < count; i++) {
+            enc.integer(records[i].radarLatencyMs());
+        }
+    }
+}
+
+size_t telemetry_cbor_measure(const Telemetry* records, size_t count,
+                              const TelemetryBatchInfo& info) {
+    Encoder enc = {nullptr, 0};
+    encode(enc, records, count, info);
+    return enc.len;
+}
+
+size_t telemetry_cbor_write(uint8_t* out, size_t capacity, const Telemetry* records, size_t count,
+                            const TelemetryBatchInfo& info) {
+    if (telemetry_cbor_measure(records, count, info) > capacity) {
+        return 0;
+    }
+    Encoder enc = {out, 0};
+    encode(enc, records, count, info);
+    return enc.len;
+}
@@ -0,0 +1,63 @@
+#ifndef TELEMETRY_CBOR_H
+#define TELEMETRY_CBOR_H
+
+#include "telemetry_record.h"
+#include <cstddef>
+
+/**
+ * @brief Column-oriented CBOR (RFC 8949) encoder for telemetry batches
+ *
+ * Key names appear once per batch instead of once per record, values stay
+ * in their fixed-point units and CBOR's variable-length integers keep small
+ * numbers to one or two bytes:
+ *
+ *   {"v": 4,
+ *    "t0": <unix time of first record>,
+ *    "s0": <sequence number of first record>,
+ *    "bs": <first sequence number since boot>,
+ *    "ev": <records evicted on the device since boot>,
+ *    "ds": [0, <sequence delta to previous record>, ...],
+ *    "dt": [0, <seconds since previous record>, ...],
+ *    "t":  [<centi-°C>, ...],
+ *    "h":  [<centi-%>, ...],
+ *    "p":  [<deci-Pa>, ...],
+ *    "c":  [<person count>, ...],
+ *    "en": [<entries>, ...],
+ *    "ex": [<exits>, ...],
+ *    "oc": [<occupancy>, ...],
+ *    "ua": [<ultrasonic accuracy %>, ...],
+ *    "ul": [<ultrasonic onset latency ms>, ...],
+ *    "ra": [<radar accuracy %>, ...],
+ *    "rl": [<radar onset latency ms>, ...]}
+ *
+ * The fusion quality columns hold -1 where a source reported nothing.
+ */
+
+constexpr int TELEMETRY_CBOR_VERSION = 4;
+
+// Map header, keys, version, t0, s0, bs, ev and thirteen array headers
+constexpr size_t TELEMETRY_CBOR_MAX_HEADER_LEN = 128;
+// dt (up to 2^33 apart) + ds + t + h + p + c + en + ex + oc + ua + ul + ra + rl,
+// each with its CBOR head
+constexpr size_t TELEMETRY_CBOR_MAX_RECORD_LEN =
+    9 + 5 + 3 + 3 + 5 + 3 + 3 + 3 + 3 + 2 + 3 + 2 + 3;
+
+// Buffer size that fits any batch of count records
+constexpr size_t telemetry_cbor_max_len(size_t count) {
+    return TELEMETRY_CBOR_MAX_HEADER_LEN + count * TELEMETRY_CBOR_MAX_RECORD_LEN;
+}
+
+/**
+ * @brief Exact encoded length of a batch, without writing anything
+ */
+size_t telemetry_cbor_measure(const Telemetry* records, size_t count,
+                              const TelemetryBatchInfo& info);
+
+/**
+ * @brief Encode a batch into out
+ * @return Bytes written, or 0 if the batch does not fit in capacity
+ */
+size_t telemetry_cbor_write(uint8_t* out, size_t capacity, const Telemetry* records, size_t count,
+                            const TelemetryBatchInfo& info);
+
+#endif // TELEMETRY_CBOR_H
@@ -0,0 +1,130 @@
+#include "telemetry_compress.h"
+#include <cstring>
+
+namespace {
+    constexpr size_t kMinMatch = 4;
+    constexpr size_t kLastLiterals = 5;   // LZ4: block must end with literals
+    constexpr size_t kMatchFindLimit = 12; // LZ4: no match may start later than this from the end
+    constexpr unsigned kHashBits = 11;    // 2048 entries * 2 bytes = 4 KB
+
+    uint16_t s_hash_table[1u << kHashBits];
+
+    uint32_t read32(const uint8_t* p) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    uint32_t hash(uint32_t v) {
+        return (v * 2654435761u) >> (32 - kHashBits);
+    }
+
+    // Bounds-checked output cursor
+    struct Output {
+        uint8_t* p;
+        uint8_t* end;
+        bool overflow;
+
+        void byte(uint8_t b) {
+            if (p < end) {
+                *p++ = b;
+            } else {
+                overflow = true;
+            }
+        }
+
+        void bytes(const uint8_t* src, size_t n) {
+            if ((size_t)(end - p) >= n) {
+                memcpy(p, src, n);
+                p += n;
+            } else {
+                overflow = true;
+            }
+        }
+
+        void length(size_t extra) {
+            while (extra >= 255) {
+                byte(255);
+                extra -= 255;
+            }
+            byte((uint8_t)extra);
+        }
+    };
+
+    void emit_sequence(Output& out, const uint8_t* literals, size_t literal_len,
+                       size_t offset, size_t match_len) {
+        const size_t ml = match_len - kMinMatch;
+        uint8_t token = (uint8_t)((literal_len >= 15 ? 15 : literal_len) << 4);
+        token |= (uint8_t)(ml >= 15 ? 15 : ml);
+        out.byte(token);
+        if (literal_len >= 15) {
+            out.length(literal_len - 15);
+        }
+        out.bytes(literals, literal_len);
+        out.byte((uint8_t)offset);
+        out.byte((uint8_t)(offset >> 8));
+        if (ml >= 15) {
+            out.length(ml - 15);
+        }
+    }
+
+    void emit_last_literals(Output& out, const uint8_t* literals, size_t literal_len) {
+        out.byte((uint8_t)((literal_len >= 15 ? 15 : literal_len) << 4));
+        if (literal_len >= 15) {
+            out.length(literal_len - 15);
+        }
+        out.bytes(literals, literal_len);
+    }
+}
+
+size_t telemetry_compress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity) {
+    if (len == 0 || len > TELEMETRY_COMPRESS_MAX_INPUT ||
+        capacity < TELEMETRY_COMPRESS_HEADER_LEN) {
+        return 0;
+    }
+
+    dst[0] = TELEMETRY_COMPRESS_MARKER;
+    dst[1] = TELEMETRY_COMPRESS_CODEC_LZ4;
+    for (int i = 0; i < 4; i++) {
+        dst[2 + i] = (uint8_t)(len >> (8 * i));
+    }
+
+    Output out = {dst + TELEMETRY_COMPRESS_HEADER_LEN, dst + capacity, false};
+    memset(s_hash_table, 0, sizeof(s_hash_table));
+
+    size_t anchor = 0;
+    size_t ip = 0;
+    if (len > kMatchFindLimit) {
+        const size_t match_limit = len - kMatchFindLimit;
+        const size_t extend_limit = len - kLastLiterals;
+
+        while (ip < match_limit) {
+            const uint32_t seq = read32(src + ip);
+            const uint32_t h = hash(seq);
+            const size_t ref = s_hash_table[h];
+            s_hash_table[h] = (uint16_t)ip;
+
+            // Table starts zeroed, so also require a real match at ref
+            if (ref >= ip || read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            size_t match_len = kMinMatch;
+            while (ip + match_len < extend_limit && src[ref + match_len] == src[ip + match_len]) {
+                match_len++;
+            }
+
+            emit_sequence(out, src + anchor, ip - anchor, ip - ref, match_len);
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+    emit_last_literals(out, src + anchor, len - anchor);
+
+    const size_t written = (size_t)(out.p - dst);
+    if (out.overflow || written >= len) {
+        return 0;
+    }
+    return written;
+}
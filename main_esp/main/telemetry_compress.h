@@ -0,0 +1,39 @@
+#ifndef TELEMETRY_COMPRESS_H
+#define TELEMETRY_COMPRESS_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Optional compression stage for telemetry payloads
+ *
+ * Compressed payloads carry a 6-byte header so consumers can tell them
+ * apart from plain JSON ('[') or CBOR batches, which start with a map
+ * head (major type 5, 0xA0..0xBF):
+ *
+ *   ['Z'][codec][uncompressed length, u32 little endian][codec data]
+ *
+ * The only codec is a raw LZ4 block (codec 0x01), which any stock LZ4
+ * decoder can expand given the length from the header. The compressor is
+ * greedy with a single-probe hash table held in static DRAM, and inputs are
+ * limited to 64 KB so positions and match offsets fit in 16 bits.
+ */
+
+constexpr uint8_t TELEMETRY_COMPRESS_MARKER = 'Z';
+constexpr uint8_t TELEMETRY_COMPRESS_CODEC_LZ4 = 0x01;
+constexpr size_t TELEMETRY_COMPRESS_HEADER_LEN = 6;
+constexpr size_t TELEMETRY_COMPRESS_MAX_INPUT = 0xFFFF;
+
+// Worst-case output for an input of len bytes (incompressible data)
+constexpr size_t telemetry_compress_bound(size_t len) {
+    return TELEMETRY_COMPRESS_HEADER_LEN + len + len / 255 + 16;
+}
+
+/**
+ * @brief Compress src into dst with the header above (not thread-safe)
+ * @return Bytes written, or 0 if the input is too large, the output does
+ *         not fit, or compression would not make the payload smaller
+ */
+size_t telemetry_compress(const uint8_t* src, size_t len, uint8_t* dst, size_t capacity);
+
+#endif // TELEMETRY_COMPRESS_H
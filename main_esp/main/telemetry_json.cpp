@@ -0,0 +1,203 @@
+#include "telemetry_json.h"
+#include <cstring>
+
+namespace {
+    constexpr char kTimestampKey[] = "{\"timestamp\":";
+    constexpr char kTemperatureKey[] = ",\"temperature\":";
+    constexpr char kHumidityKey[] = ",\"humidity\":";
+    constexpr char kPressureKey[] = ",\"pressure\":";
+    constexpr char kPersonCountKey[] = ",\"personCount\":";
+    constexpr char kEntriesKey[] = ",\"entries\":";
+    constexpr char kExitsKey[] = ",\"exits\":";
+    constexpr char kOccupancyKey[] = ",\"occupancy\":";
+    constexpr char kUltrasonicAccuracyKey[] = ",\"ultrasonicAccuracy\":";
+    constexpr char kUltrasonicLatencyKey[] = ",\"ultrasonicLatencyMs\":";
+    constexpr char kRadarAccuracyKey[] = ",\"radarAccuracy\":";
+    constexpr char kRadarLatencyKey[] = ",\"radarLatencyMs\":";
+    constexpr char kSeqKey[] = ",\"seq\":";
+    constexpr char kBootSeqKey[] = ",\"bootSeq\":";
+    constexpr char kDroppedKey[] = ",\"dropped\":";
+
+    constexpr size_t kKeysLen = sizeof(kTimestampKey) - 1 + sizeof(kTemperatureKey) - 1 +
+                                sizeof(kHumidityKey) - 1 + sizeof(kPressureKey) - 1 +
+                                sizeof(kPersonCountKey) - 1 + sizeof(kEntriesKey) - 1 +
+                                sizeof(kExitsKey) - 1 + sizeof(kOccupancyKey) - 1 +
+                                sizeof(kSeqKey) - 1 +
+                                1;  // closing brace
+    constexpr size_t kHeaderKeysLen = sizeof(kBootSeqKey) - 1 + sizeof(kDroppedKey) - 1;
+
+    // Values rounded to tenths, as printed
+    struct Tenths {
+        int64_t timestamp;
+        int32_t temperature;
+        uint32_t humidity;
+        uint32_t pressure;  // hPa
+        uint32_t person_count;
+        uint32_t entries;
+        uint32_t exits;
+        uint32_t occupancy;
+        int32_t ultrasonic_accuracy;  // -1: no data, key omitted
+        int32_t ultrasonic_latency_ms;
+        int32_t radar_accuracy;
+        int32_t radar_latency_ms;
+        uint32_t seq;
+    };
+
+    Tenths to_tenths(const Telemetry& t) {
+        int32_t temp = t.temperatureCenti();
+        return {
+            t.timestamp(),
+            (temp + (temp < 0 ? -5 : 5)) / 10,
+            (t.humidityCenti() + 5) / 10,
+            (t.pressureDeciPa() + 50) / 100,
+            t.personCount(),
+            t.entries(),
+            t.exits(),
+            t.occupancy(),
+            t.ultrasonicAccuracy(),
+            t.ultrasonicLatencyMs(),
+            t.radarAccuracy(),
+            t.radarLatencyMs(),
+            t.seq,
+        };
+    }
+
+    size_t digits(uint64_t v) {
+        size_t n = 1;
+        while (v >= 10) {
+            v /= 10;
+            n++;
+        }
+        return n;
+    }
+
+    char* put_uint(char* p, uint64_t v) {
+        char tmp[20];
+        size_t n = 0;
+        do {
+            tmp[n++] = (char)('0' + v % 10);
+            v /= 10;
+        } while (v != 0);
+        while (n > 0) {
+            *p++ = tmp[--n];
+        }
+        return p;
+    }
+
+    char* put_int(char* p, int64_t v) {
+        if (v < 0) {
+            *p++ = '-';
+            return put_uint(p, (uint64_t)(-v));
+        }
+        return put_uint(p, (uint64_t)v);
+    }
+
+    // Tenths as "<int>.<digit>"
+    char* put_tenths(char* p, int64_t tenths) {
+        if (tenths < 0) {
+            *p++ = '-';
+            tenths = -tenths;
+        }
+        p = put_uint(p, (uint64_t)tenths / 10);
+        *p++ = '.';
+        *p++ = (char)('0' + tenths % 10);
+        return p;
+    }
+
+    size_t int_len(int64_t v) {
+        return v < 0 ? 1 + digits((uint64_t)(-v)) : digits((uint64_t)v);
+    }
+
+    size_t tenths_len(int64_t tenths) {
+        return (tenths < 0 ? 1 : 0) + digits((uint64_t)(tenths < 0 ? -tenths : tenths) / 10) + 2;
+    }
+
+    size_t optional_len(size_t key_size, int32_t v) {
+        return v < 0 ? 0 : key_size - 1 + digits((uint32_t)v);
+    }
+
+    size_t record_len(const Tenths& v) {
+        return kKeysLen + int_len(v.timestamp) + tenths_len(v.temperature) +
+               tenths_len(v.humidity) + tenths_len(v.pressure) + digits(v.person_count) +
+               digits(v.entries) + digits(v.exits) + digits(v.occupancy) +
+               optional_len(sizeof(kUltrasonicAccuracyKey), v.ultrasonic_accuracy) +
+               optional_len(sizeof(kUltrasonicLatencyKey), v.ultrasonic_latency_ms) +
+               optional_len(sizeof(kRadarAccuracyKey), v.radar_accuracy) +
+               optional_len(sizeof(kRadarLatencyKey), v.radar_latency_ms) + digits(v.seq);
+    }
+
+    char* put_literal(char* p, const char* s, size_t len) {
+        memcpy(p, s, len);
+        return p + len;
+    }
+
+    // Key and value, or nothing if v < 0
+    char* put_optional(char* p, const char* key, size_t key_size, int32_t v) {
+        if (v < 0) {
+            return p;
+        }
+        p = put_literal(p, key, key_size - 1);
+        return put_uint(p, (uint32_t)v);
+    }
+}
+
+size_t telemetry_json_measure(const Telemetry* records, size_t count,
+                              const TelemetryBatchInfo& info) {
+    size_t len = 2 + (count > 0 ? count - 1 : 0);  // brackets and commas
+    if (count > 0) {
+        len += kHeaderKeysLen + digits(info.boot_seq) + digits(info.dropped);
+    }
+    for (size_t i = 0; i < count; i++) {
+        len += record_len(to_tenths(records[i]));
+    }
+    return len;
+}
+
+size_t telemetry_json_write(char* out, size_t capacity, const Telemetry* records, size_t count,
+                            const TelemetryBatchInfo& info) {
+    if (telemetry_json_measure(records, count, info) > capacity) {
+        return 0;
+    }
+
+    char* p = out;
+    *p++ = '[';
+    for (size_t i = 0; i < count; i++) {
+        const Tenths v = to_tenths(records[i]);
+        if (i > 0) {
+            *p++ = ',';
+        }
+        p = put_literal(p, kTimestampKey, sizeof(kTimestampKey) - 1);
+        p = put_int(p, v.timestamp);
+        p = put_literal(p, kTemperatureKey, sizeof(kTemperatureKey) - 1);
+        p = put_tenths(p, v.temperature);
+        p = put_literal(p, kHumidityKey, sizeof(kHumidityKey) - 1);
+        p = put_tenths(p, v.humidity);
+        p = put_literal(p, kPressureKey, sizeof(kPressureKey) - 1);
+        p = put_tenths(p, v.pressure);
+        p = put_literal(p, kPersonCountKey, sizeof(kPersonCountKey) - 1);
+        p = put_uint(p, v.person_count);
+        p = put_literal(p, kEntriesKey, sizeof(kEntriesKey) - 1);
+        p = put_uint(p, v.entries);
+        p = put_literal(p, kExitsKey, sizeof(kExitsKey) - 1);
+        p = put_uint(p, v.exits);
+        p = put_literal(p, kOccupancyKey, sizeof(kOccupancyKey) - 1);
+        p = put_uint(p, v.occupancy);
+        p = put_optional(p, kUltrasonicAccuracyKey, sizeof(kUltrasonicAccuracyKey),
+                         v.ultrasonic_accuracy);
+        p = put_optional(p, kUltrasonicLatencyKey, sizeof(kUltrasonicLatencyKey),
+                         v.ultrasonic_latency_ms);
+        p = put_optional(p, kRadarAccuracyKey, sizeof(kRadarAccuracyKey), v.radar_accuracy);
+        p = put_optional(p, kRadarLatencyKey, sizeof(kRadarLatencyKey), v.radar_latency_ms);
+        p = put_literal(p, kSeqKey, sizeof(kSeqKey) - 1);
+        p = put_uint(p, v.seq);
+        if (i == 0) {
+            p = put_literal(p, kBootSeqKey, sizeof(kBootSeqKey) - 1);
+            p = put_uint(p, info.boot_seq);
+            p = put_literal(p, kDroppedKey, sizeof(kDroppedKey) - 1);
+            p = put_uint(p, info.dropped);
+        }
+        *p++ = '}';
+    }
+    *p++ = ']';
+    return (size_t)(p - out);
+}
@@ -0,0 +1,62 @@
+#ifndef TELEMETRY_JSON_H
+#define TELEMETRY_JSON_H
+
+#include "telemetry_record.h"
+#include <cstddef>
+
+/**
+ * @brief Allocation-free JSON encoder for telemetry batches
+ *
+ * Produces the array format consumed by the backend's MqttIngestionService:
+ *   [{"timestamp":...,"temperature":21.5,"humidity":40.2,"pressure":1013.3,"personCount":2,
+ *     "entries":1,"exits":0,"occupancy":3,"ultrasonicAccuracy":91,"ultrasonicLatencyMs":240,
+ *     "radarAccuracy":97,"radarLatencyMs":0,"seq":1200,"bootSeq":1024,"dropped":0},
+ *    {"timestamp":...,"seq":1201},...]
+ * The backend expects a bare array, so the batch header (bootSeq, dropped)
+ * rides on the first record only. The fusion quality keys are left out for
+ * a source that reported nothing in the interval.
+ * Numbers are formatted from the fixed-point fields with integer math only
+ * (one decimal, rounded half away from zero).
+ */
+
+// Longest possible encoding of a single record
+constexpr size_t TELEMETRY_JSON_MAX_RECORD_LEN =
+    sizeof("{\"timestamp\":") - 1 + 11 +       // int32 delta + epoch fits 11 chars
+    sizeof(",\"temperature\":") - 1 + 6 +      // -327.7
+    sizeof(",\"humidity\":") - 1 + 5 +         // 655.4
+    sizeof(",\"pressure\":") - 1 + 6 +         // 1348.6
+    sizeof(",\"personCount\":") - 1 + 4 +      // 4095
+    sizeof(",\"entries\":") - 1 + 4 +          // 1023
+    sizeof(",\"exits\":") - 1 + 4 +            // 1023
+    sizeof(",\"occupancy\":") - 1 + 4 +        // 4095
+    sizeof(",\"ultrasonicAccuracy\":") - 1 + 3 + // 100
+    sizeof(",\"ultrasonicLatencyMs\":") - 1 + 5 + // 10200
+    sizeof(",\"radarAccuracy\":") - 1 + 3 +
+    sizeof(",\"radarLatencyMs\":") - 1 + 5 +
+    sizeof(",\"seq\":") - 1 + 10 +             // uint32
+    1;
+
+// Batch header fields added to the first record
+constexpr size_t TELEMETRY_JSON_MAX_HEADER_LEN =
+    sizeof(",\"bootSeq\":") - 1 + 10 +
+    sizeof(",\"dropped\":") - 1 + 10;
+
+// Buffer size that fits any batch of count records
+constexpr size_t telemetry_json_max_len(size_t count) {
+    return 2 + TELEMETRY_JSON_MAX_HEADER_LEN + count * (TELEMETRY_JSON_MAX_RECORD_LEN + 1);
+}
+
+/**
+ * @brief Exact encoded length of a batch, without writing anything
+ */
+size_t telemetry_json_measure(const Telemetry* records, size_t count,
+                              const TelemetryBatchInfo& info);
+
+/**
+ * @brief Encode a batch into out (not NUL-terminated)
+ * @return Bytes written, or 0 if the batch does not fit in capacity
+ */
+size_t telemetry_json_write(char* out, size_t capacity, const Telemetry* records, size_t count,
+                            const TelemetryBatchInfo& info);
+
+#endif // TELEMETRY_JSON_H
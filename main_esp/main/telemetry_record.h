@@ -0,0 +1,140 @@
+#ifndef TELEMETRY_RECORD_H
+#define TELEMETRY_RECORD_H
+
+#include <cstdint>
+
+/**
+ * @brief Compact fixed-point telemetry record (24 bytes)
+ *
+ * Stored as-is in the RAM queue and the flash spool. All values are
+ * integers so nothing on the queue/publish path needs soft-float double
+ * math (the ESP32 FPU is single precision only).
+ *
+ * - time_delta_s:   seconds since TELEMETRY_EPOCH (2024-01-01 UTC);
+ *                   negative before SNTP sync, valid until 2092
+ * - temperature_cc: centi-°C (-327.68 .. 327.67)
+ * - humidity_cpct:  centi-% (0 .. 655.35)
+ * - pressure_count: bits 31..12 pressure in deci-Pa above 300 hPa
+ *                   (300 .. 1348 hPa), bits 11..0 person count
+ *                   (visits; saturates at 4095 per interval)
+ * - flow:           bits 31..22 entries, bits 21..12 exits (saturate at
+ *                   1023 per interval), bits 11..0 occupancy estimate at
+ *                   the end of the interval (saturates at 4095)
+ * - fusion:         presence fusion quality per ranging source over the
+ *                   interval, ultrasonic in bits 31..16, radar in bits
+ *                   15..0; each half holds accuracy in % (bits 15..9) and
+ *                   mean onset latency in 20 ms steps (bits 8..0, up to
+ *                   10.2 s), all ones meaning no data
+ * - seq:            per-device sequence number, assigned by
+ *                   SensorManager::enqueue and monotonic across reboots
+ */
+struct Telemetry {
+  int32_t time_delta_s;
+  int16_t temperature_cc;
+  uint16_t humidity_cpct;
+  uint32_t pressure_count;
+  uint32_t flow;
+  uint32_t fusion;
+  uint32_t seq;
+
+  static constexpr int64_t TELEMETRY_EPOCH = 1704067200; // 2024-01-01T00:00:00Z
+  static constexpr uint32_t PRESSURE_BASE_DPA = 300000;   // 300 hPa
+  static constexpr uint32_t PRESSURE_MAX_DPA = PRESSURE_BASE_DPA + 0xFFFFF;
+  static constexpr uint32_t PERSON_COUNT_MAX = 0xFFF;
+  static constexpr uint32_t FLOW_COUNT_MAX = 0x3FF;
+  static constexpr uint32_t OCCUPANCY_MAX = 0xFFF;
+  static constexpr uint32_t ACCURACY_NONE = 0x7F;
+  static constexpr uint32_t LATENCY_NONE = 0x1FF;
+  static constexpr uint32_t LATENCY_STEP_MS = 20;
+  static constexpr uint32_t FUSION_NONE = 0xFFFFFFFF;
+
+  // One half of the fusion word; negative arguments mean no data
+  static uint32_t fusionQuality(int32_t accuracy_pct, int32_t latency_ms) {
+    uint32_t accuracy = accuracy_pct < 0    ? ACCURACY_NONE
+                        : accuracy_pct > 100 ? 100
+                                             : (uint32_t)accuracy_pct;
+    uint32_t latency = LATENCY_NONE;
+    if (latency_ms >= 0) {
+      latency = ((uint32_t)latency_ms + LATENCY_STEP_MS / 2) / LATENCY_STEP_MS;
+      if (latency > LATENCY_NONE - 1) latency = LATENCY_NONE - 1;
+    }
+    return (accuracy << 9) | latency;
+  }
+
+  static Telemetry make(int64_t unix_time, int32_t temperature_centi,
+                        uint32_t humidity_centi, uint32_t pressure_dpa,
+                        uint32_t person_count, uint32_t entries = 0,
+                        uint32_t exits = 0, uint32_t occupancy = 0,
+                        uint32_t fusion = FUSION_NONE) {
+    Telemetry t;
+    t.time_delta_s = (int32_t)(unix_time - TELEMETRY_EPOCH);
+    t.temperature_cc = (int16_t)(temperature_centi < INT16_MIN   ? INT16_MIN
+                                 : temperature_centi > INT16_MAX ? INT16_MAX
+                                                                 : temperature_centi);
+    t.humidity_cpct = (uint16_t)(humidity_centi > UINT16_MAX ? UINT16_MAX : humidity_centi);
+    if (pressure_dpa < PRESSURE_BASE_DPA) pressure_dpa = PRESSURE_BASE_DPA;
+    if (pressure_dpa > PRESSURE_MAX_DPA) pressure_dpa = PRESSURE_MAX_DPA;
+    if (person_count > PERSON_COUNT_MAX) person_count = PERSON_COUNT_MAX;
+    t.pressure_count = ((pressure_dpa - PRESSURE_BASE_DPA) << 12) | person_count;
+    if (entries > FLOW_COUNT_MAX) entries = FLOW_COUNT_MAX;
+    if (exits > FLOW_COUNT_MAX) exits = FLOW_COUNT_MAX;
+    if (occupancy > OCCUPANCY_MAX) occupancy = OCCUPANCY_MAX;
+    t.flow = (entries << 22) | (exits << 12) | occupancy;
+    t.fusion = fusion;
+    t.seq = 0;
+    return t;
+  }
+
+  int64_t timestamp() const { return TELEMETRY_EPOCH + time_delta_s; }
+  int32_t temperatureCenti() const { return temperature_cc; }
+  uint32_t humidityCenti() const { return humidity_cpct; }
+  uint32_t pressureDeciPa() const { return (pressure_count >> 12) + PRESSURE_BASE_DPA; }
+  uint32_t personCount() const { return pressure_count & PERSON_COUNT_MAX; }
+  uint32_t entries() const { return flow >> 22; }
+  uint32_t exits() const { return (flow >> 12) & FLOW_COUNT_MAX; }
+  uint32_t occupancy() const { return flow & OCCUPANCY_MAX; }
+  // -1 when the source reported nothing in the interval
+  int32_t ultrasonicAccuracy() const { return fusionAccuracy(fusion >> 16); }
+  int32_t ultrasonicLatencyMs() const { return fusionLatencyMs(fusion >> 16); }
+  int32_t radarAccuracy() const { return fusionAccuracy(fusion & 0xFFFF); }
+  int32_t radarLatencyMs() const { return fusionLatencyMs(fusion & 0xFFFF); }
+
+  static int32_t fusionAccuracy(uint32_t half) {
+    uint32_t v = half >> 9;
+    return v == ACCURACY_NONE ? -1 : (int32_t)v;
+  }
+  static int32_t fusionLatencyMs(uint32_t half) {
+    uint32_t v = half & LATENCY_NONE;
+    return v == LATENCY_NONE ? -1 : (int32_t)(v * LATENCY_STEP_MS);
+  }
+};
+
+static_assert(sizeof(Telemetry) == 24, "Telemetry record must stay 24 bytes");
+
+/**
+ * @brief Per-batch header sent alongside the records
+ *
+ * Lets the backend tell sequence gaps caused by reboots (numbers skipped
+ * up to the next NVS checkpoint, ending at boot_seq) from records evicted
+ * on the device (dropped grows by the same amount).
+ */
+struct TelemetryBatchInfo {
+  uint32_t boot_seq;  // First sequence number issued since boot
+  uint32_t dropped;   // Records evicted from the queue or spool since boot
+};
+
+// Conversion helpers from sensor units (single-precision, hardware FPU)
+
+static inline int32_t celsius_to_centi(float celsius) {
+  return (int32_t)(celsius * 100.0f + (celsius < 0 ? -0.5f : 0.5f));
+}
+
+static inline uint32_t percent_to_centi(float percent) {
+  return percent <= 0 ? 0 : (uint32_t)(percent * 100.0f + 0.5f);
+}
+
+static inline uint32_t hpa_to_deci_pa(float hpa) {
+  return hpa <= 0 ? 0 : (uint32_t)(hpa * 1000.0f + 0.5f);
+}
+
+#endif // TELEMETRY_RECORD_H
@@ -0,0 +1,461 @@
+#include "telemetry_spool.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <cstddef>
+#include <cstring>
+
+static const char* TAG = "telemetry_spool";
+
+namespace {
+    constexpr uint32_t kSectorSize = 4096;
+    constexpr uint32_t kMaxSectors = 64;  // One bit each in valid_sectors_
+    constexpr uint32_t kSectorMagic = 0x4C505354;  // "TSPL"
+
+    struct SectorHeader {
+        uint32_t magic;
+        uint32_t seq;
+    };
+    constexpr uint32_t kSectorHeaderSize = sizeof(SectorHeader);
+
+    constexpr uint8_t kRecordMagic = 0xA5;
+    constexpr uint8_t kStatePending = 0xFF;  // Erased flash value
+    constexpr uint8_t kStateConsumed = 0x00; // Cleared in place on commit
+    constexpr uint8_t kErased = 0xFF;
+
+    struct RecordHeader {
+        uint8_t magic;
+        uint8_t state;
+        uint16_t length;
+    };
+    constexpr uint32_t kRecordHeaderSize = sizeof(RecordHeader);
+    constexpr uint32_t kCrcSize = sizeof(uint32_t);
+    constexpr uint32_t kMaxFrameSize =
+        (kRecordHeaderSize + TelemetrySpool::kMaxRecordSize + kCrcSize + 3) & ~3u;
+
+    uint32_t frame_size(uint32_t length) {
+        return (kRecordHeaderSize + length + kCrcSize + 3) & ~3u;
+    }
+
+    uint32_t record_crc(uint16_t length, const uint8_t* payload) {
+        uint32_t crc = esp_rom_crc32_le(0, (const uint8_t*)&length, sizeof(length));
+        return esp_rom_crc32_le(crc, payload, length);
+    }
+}
+
+TelemetrySpool::TelemetrySpool()
+    : partition_(nullptr),
+      mutex_(nullptr),
+      sector_count_(0),
+      valid_sectors_(0),
+      sector_seq_{},
+      write_seq_(0),
+      write_{0, 0},
+      read_{0, 0},
+      peek_valid_(false),
+      peek_end_{0, 0},
+      peek_last_{0, 0},
+      peek_records_(0),
+      pending_(0),
+      dropped_(0) {
+}
+
+bool TelemetrySpool::mount(const char* partition_label) {
+    const esp_partition_t* part = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (part == nullptr) {
+        ESP_LOGW(TAG, "Partition '%s' not found, spool disabled", partition_label);
+        return false;
+    }
+
+    sector_count_ = part->size / kSectorSize;
+    if (sector_count_ > kMaxSectors) {
+        sector_count_ = kMaxSectors;
+    }
+    if (sector_count_ < 2) {
+        ESP_LOGE(TAG, "Partition '%s' too small for a spool", partition_label);
+        return false;
+    }
+
+    mutex_ = xSemaphoreCreateMutex();
+    if (mutex_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create mutex!");
+        return false;
+    }
+    partition_ = part;
+
+    // Find the sector written last (highest sequence number)
+    bool found = false;
+    uint32_t head_sector = 0;
+    for (uint32_t s = 0; s < sector_count_; s++) {
+        SectorHeader hdr;
+        if (esp_partition_read(partition_, s * kSectorSize, &hdr, sizeof(hdr)) != ESP_OK ||
+            hdr.magic != kSectorMagic) {
+            continue;
+        }
+        valid_sectors_ |= (uint64_t)1 << s;
+        sector_seq_[s] = hdr.seq;
+        if (!found || hdr.seq > write_seq_) {
+            write_seq_ = hdr.seq;
+            head_sector = s;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        ESP_LOGI(TAG, "Empty spool, formatting %lu sectors", (unsigned long)sector_count_);
+        write_ = {sector_count_ - 1, kSectorSize};  // Next sector opened is 0
+        read_ = write_;
+        if (!openNextSector()) {
+            partition_ = nullptr;
+            return false;
+        }
+        read_ = write_;
+        return true;
+    }
+
+    // Recover the write offset; a torn frame seals the sector
+    Position pos = {head_sector, kSectorHeaderSize};
+    Position next;
+    uint8_t state;
+    uint16_t length;
+    uint8_t payload[kMaxRecordSize];
+    while (readRecord(pos, &state, &length, payload, &next) == ReadResult::Ok) {
+        pos = next;
+    }
+    write_ = pos;
+    if (pos.offset + kRecordHeaderSize <= kSectorSize) {
+        uint8_t magic;
+        esp_partition_read(partition_, pos.sector * kSectorSize + pos.offset, &magic, 1);
+        if (magic != kErased) {
+            ESP_LOGW(TAG, "Torn record in sector %lu, sealing it", (unsigned long)pos.sector);
+            write_.offset = kSectorSize;
+        }
+    }
+
+    // Oldest valid sector follows the head in ring order
+    uint32_t oldest = head_sector;
+    for (uint32_t k = 1; k < sector_count_; k++) {
+        uint32_t s = (head_sector + k) % sector_count_;
+        if (sectorValid(s)) {
+            oldest = s;
+            break;
+        }
+    }
+
+    // Everything up to the last consumed marker has been published
+    read_ = {oldest, kSectorHeaderSize};
+    pos = read_;
+    Position record_pos;
+    uint32_t pending = 0;
+    while (advanceReader(pos, &record_pos, &state, payload, &length)) {
+        if (state == kStateConsumed) {
+            read_ = pos;
+            pending = 0;
+        } else {
+            pending++;
+        }
+    }
+    pending_ = pending;
+
+    ESP_LOGI(TAG, "Mounted '%s': %lu sectors, head=%lu, %lu records pending",
+             partition_label, (unsigned long)sector_count_, (unsigned long)write_.sector,
+             (unsigned long)pending_);
+    return true;
+}
+
+TelemetrySpool::ReadResult TelemetrySpool::readRecord(const Position& pos, uint8_t* state,
+                                                      uint16_t* length, uint8_t* payload,
+                                                      Position* next) const {
+    if (pos.offset + kRecordHeaderSize > kSectorSize) {
+        return ReadResult::End;
+    }
+
+    const uint32_t base = pos.sector * kSectorSize + pos.offset;
+    RecordHeader hdr;
+    if (esp_partition_read(partition_, base, &hdr, sizeof(hdr)) != ESP_OK ||
+        hdr.magic != kRecordMagic || hdr.length == 0 || hdr.length > kMaxRecordSize) {
+        return ReadResult::End;
+    }
+
+    const uint32_t frame = frame_size(hdr.length);
+    if (pos.offset + frame > kSectorSize) {
+        return ReadResult::End;
+    }
+
+    uint32_t crc;
+    if (esp_partition_read(partition_, base + kRecordHeaderSize, payload, hdr.length) != ESP_OK ||
+        esp_partition_read(partition_, base + kRecordHeaderSize + hdr.length, &crc,
+                           sizeof(crc)) != ESP_OK ||
+        crc != record_crc(hdr.length, payload)) {
+        return ReadResult::End;
+    }
+
+    *state = hdr.state;
+    *length = hdr.length;
+    *next = {pos.sector, pos.offset + frame};
+    return ReadResult::Ok;
+}
+
+bool TelemetrySpool::advanceReader(Position& pos, Position* record_pos, uint8_t* state,
+                                   uint8_t* payload, uint16_t* length) const {
+    while (true) {
+        if (pos.sector == write_.sector && pos.offset >= write_.offset) {
+            return false;
+        }
+
+        Position next;
+        if (readRecord(pos, state, length, payload, &next) == ReadResult::Ok) {
+            *record_pos = pos;
+            pos = next;
+            return true;
+        }
+
+        if (pos.sector == write_.sector) {
+            return false;
+        }
+
+        // End of this sector, continue with the next written one
+        do {
+            pos.sector = (pos.sector + 1) % sector_count_;
+        } while (!sectorValid(pos.sector) && pos.sector != write_.sector);
+        pos.offset = kSectorHeaderSize;
+    }
+}
+
+uint32_t TelemetrySpool::countPendingInSector(Position from) const {
+    uint32_t count = 0;
+    Position next;
+    uint8_t state;
+    uint16_t length;
+    uint8_t payload[kMaxRecordSize];
+    while (readRecord(from, &state, &length, payload, &next) == ReadResult::Ok) {
+        count++;
+        from = next;
+    }
+    return count;
+}
+
+bool TelemetrySpool::openNextSector() {
+    const uint32_t next = (write_.sector + 1) % sector_count_;
+
+    if (read_.sector == next) {
+        // Writer caught up with the reader: drop what is left of the oldest sector
+        uint32_t lost = countPendingInSector(read_);
+        read_ = {(next + 1) % sector_count_, kSectorHeaderSize};
+        peek_valid_ = false;
+        if (lost > 0) {
+            pending_ = (pending_ > lost) ? pending_ - lost : 0;
+            dropped_ = dropped_ + lost;
+            ESP_LOGW(TAG, "Spool full, dropped %lu oldest records (total dropped: %lu)",
+                     (unsigned long)lost, (unsigned long)dropped_);
+        }
+    }
+
+    valid_sectors_ &= ~((uint64_t)1 << next);
+    if (esp_partition_erase_range(partition_, next * kSectorSize, kSectorSize) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to erase sector %lu", (unsigned long)next);
+        return false;
+    }
+
+    // Sequence number first, magic last: a power cut in between leaves no
+    // magic, so a header that has one is never torn
+    SectorHeader hdr = {kSectorMagic, write_seq_ + 1};
+    const uint32_t base = next * kSectorSize;
+    if (esp_partition_write(partition_, base + offsetof(SectorHeader, seq), &hdr.seq,
+                            sizeof(hdr.seq)) != ESP_OK ||
+        esp_partition_write(partition_, base + offsetof(SectorHeader, magic), &hdr.magic,
+                            sizeof(hdr.magic)) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to write header of sector %lu", (unsigned long)next);
+        return false;
+    }
+
+    write_seq_++;
+    sector_seq_[next] = write_seq_;
+    valid_sectors_ |= (uint64_t)1 << next;
+    write_ = {next, kSectorHeaderSize};
+    return true;
+}
+
+bool TelemetrySpool::append(const void* data, size_t len) {
+    if (!isMounted() || len == 0 || len > kMaxRecordSize) {
+        return false;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex_);
+    xSemaphoreTake(sem, portMAX_DELAY);
+
+    const uint32_t frame = frame_size(len);
+    bool ok = true;
+    if (write_.offset + frame > kSectorSize) {
+        ok = openNextSector();
+    }
+
+    if (ok) {
+        uint8_t buf[kMaxFrameSize];
+        memset(buf, kErased, frame);
+        RecordHeader hdr = {kRecordMagic, kStatePending, (uint16_t)len};
+        memcpy(buf, &hdr, sizeof(hdr));
+        memcpy(buf + kRecordHeaderSize, data, len);
+        uint32_t crc = record_crc((uint16_t)len, buf + kRecordHeaderSize);
+        memcpy(buf + kRecordHeaderSize + len, &crc, sizeof(crc));
+
+        if (esp_partition_write(partition_, write_.sector * kSectorSize + write_.offset,
+                                buf, frame) == ESP_OK) {
+            write_.offset += frame;
+            pending_ = pending_ + 1;
+        } else {
+            // Never append behind a possibly half-written frame
+            ESP_LOGE(TAG, "Flash write failed, sealing sector %lu", (unsigned long)write_.sector);
+            write_.offset = kSectorSize;
+            ok = false;
+        }
+    }
+
+    xSemaphoreGive(sem);
+    return ok;
+}
+
+size_t TelemetrySpool::peek(void* out, size_t record_size, size_t max_records) {
+    if (!isMounted()) {
+        return 0;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex_);
+    xSemaphoreTake(sem, portMAX_DELAY);
+
+    Position pos = read_;
+    Position record_pos;
+    uint8_t state;
+    uint8_t payload[kMaxRecordSize];
+    uint16_t length;
+    size_t copied = 0;
+    uint32_t records = 0;
+
+    while (copied < max_records && advanceReader(pos, &record_pos, &state, payload, &length)) {
+        if (length != record_size) {
+            if (copied == 0) {
+                // Foreign record at the front: consume it right away
+                read_ = pos;
+                pending_ = pending_ ? pending_ - 1 : 0;
+                continue;
+            }
+        } else {
+            memcpy((uint8_t*)out + copied * record_size, payload, record_size);
+            copied++;
+        }
+        records++;
+        peek_last_ = record_pos;
+    }
+
+    peek_end_ = pos;
+    peek_records_ = records;
+    peek_valid_ = records > 0;
+
+    xSemaphoreGive(sem);
+    return copied;
+}
+
+void TelemetrySpool::commit() {
+    if (!isMounted()) {
+        return;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex_);
+    xSemaphoreTake(sem, portMAX_DELAY);
+
+    if (peek_valid_) {
+        const uint8_t consumed = kStateConsumed;
+        esp_partition_write(partition_, peek_last_.sector * kSectorSize + peek_last_.offset + 1,
+                            &consumed, 1);
+        read_ = peek_end_;
+        pending_ = (pending_ > peek_records_) ? pending_ - peek_records_ : 0;
+        peek_valid_ = false;
+    }
+
+    xSemaphoreGive(sem);
+}
+
+bool TelemetrySpool::markCurrent(const Mark& mark) const {
+    return mark.valid && mark.sector < sector_count_ && sectorValid(mark.sector) &&
+           sector_seq_[mark.sector] == mark.sector_seq;
+}
+
+uint64_t TelemetrySpool::ordinal(const Position& pos) const {
+    return ((uint64_t)sector_seq_[pos.sector] << 16) | pos.offset;
+}
+
+size_t TelemetrySpool::peekAfter(Mark* after, void* out, size_t record_size,
+                                 size_t max_records) {
+    if (!isMounted()) {
+        return 0;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex_);
+    xSemaphoreTake(sem, portMAX_DELAY);
+
+    Position pos = read_;
+    Position record_pos;
+    uint8_t state;
+    uint8_t payload[kMaxRecordSize];
+    uint16_t length;
+
+    // Resume after the marked record unless it has been consumed already
+    Position marked = {after->sector, after->offset};
+    if (markCurrent(*after) && ordinal(marked) >= ordinal(read_)) {
+        Position next;
+        if (readRecord(marked, &state, &length, payload, &next) == ReadResult::Ok) {
+            pos = next;
+        }
+    }
+
+    size_t copied = 0;
+    while (copied < max_records && advanceReader(pos, &record_pos, &state, payload, &length)) {
+        // Records of another size are skipped here and consumed with the batch
+        if (length == record_size) {
+            memcpy((uint8_t*)out + copied * record_size, payload, record_size);
+            copied++;
+            *after = {true, (uint16_t)record_pos.sector, (uint16_t)record_pos.offset,
+                      sector_seq_[record_pos.sector]};
+        }
+    }
+
+    xSemaphoreGive(sem);
+    return copied;
+}
+
+void TelemetrySpool::commitTo(const Mark& mark) {
+    if (!isMounted()) {
+        return;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex_);
+    xSemaphoreTake(sem, portMAX_DELAY);
+
+    const Position marked = {mark.sector, mark.offset};
+    if (markCurrent(mark) && ordinal(marked) >= ordinal(read_)) {
+        // Walk to the marked record to count what is consumed with it
+        Position pos = read_;
+        Position record_pos;
+        uint8_t state;
+        uint8_t payload[kMaxRecordSize];
+        uint16_t length;
+        uint32_t records = 0;
+        while (advanceReader(pos, &record_pos, &state, payload, &length)) {
+            records++;
+            if (record_pos.sector == marked.sector && record_pos.offset == marked.offset) {
+                const uint8_t consumed = kStateConsumed;
+                esp_partition_write(partition_,
+                                    marked.sector * kSectorSize + marked.offset + 1,
+                                    &consumed, 1);
+                read_ = pos;
+                pending_ = (pending_ > records) ? pending_ - records : 0;
+                peek_valid_ = false;
+                break;
+            }
+        }
+    }
+
+    xSemaphoreGive(sem);
+}
@@ -0,0 +1,138 @@
+#ifndef TELEMETRY_SPOOL_H
+#define TELEMETRY_SPOOL_H
+
+#include "esp_partition.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Append-only telemetry log on a dedicated flash partition
+ *
+ * Survives reboots and outages longer than the RAM queue can cover.
+ * The partition is used as a ring of 4 KB sectors, written strictly in
+ * order, so every sector is erased equally often (wear levelling falls out
+ * of the log structure). Each sector starts with a header carrying a
+ * monotonically increasing sequence number used to find the head on mount.
+ *
+ * Record frame (padded to 4 bytes):
+ *   [magic u8][state u8][length u16][payload ...][crc32 of length+payload]
+ *
+ * Reading is peek/commit like the RAM queue. Committing clears the state
+ * byte of the last record of the batch in place; since records are
+ * consumed in order, everything before that record is consumed too.
+ * Fully consumed sectors are erased lazily when the writer wraps to them.
+ * If the writer catches up with unread data, the oldest sector is dropped.
+ *
+ * All methods are thread-safe.
+ */
+class TelemetrySpool {
+public:
+    static constexpr size_t kMaxRecordSize = 64;
+
+    TelemetrySpool();
+
+    /**
+     * @brief Find the partition, recover the read/write positions and pending count
+     * @param partition_label Label of the data partition in partitions.csv
+     * @return true if the spool is usable
+     */
+    bool mount(const char* partition_label);
+
+    bool isMounted() const { return partition_ != nullptr; }
+
+    /**
+     * @brief Append one record at the end of the log
+     * @return true if written
+     */
+    bool append(const void* data, size_t len);
+
+    /**
+     * @brief Read up to max_records pending records without consuming them
+     *
+     * Records whose length differs from record_size (e.g. written by a
+     * different firmware version) are skipped and consumed with the batch.
+     *
+     * @param out Destination, at least record_size * max_records bytes
+     * @return Number of records copied to out
+     */
+    size_t peek(void* out, size_t record_size, size_t max_records);
+
+    /**
+     * @brief Consume the records returned by the last peek()
+     */
+    void commit();
+
+    /**
+     * @brief Place of a record returned by peekAfter(), to read past it or commit up to it
+     *
+     * A mark whose sector has since been recycled (the writer caught up)
+     * refers to records that are gone: reading starts at the oldest pending
+     * record again and committing does nothing.
+     */
+    struct Mark {
+        bool valid;
+        uint16_t sector;
+        uint16_t offset;
+        uint32_t sector_seq;  // Sequence number of the sector when marked
+    };
+
+    /**
+     * @brief peek() that starts after the record at *after instead of at the oldest one
+     *
+     * Lets a reader have several batches out at once and commit them in
+     * order with commitTo(). An invalid *after starts at the oldest pending
+     * record. Does not affect peek()/commit().
+     *
+     * @param after In: last record of the previous batch; out: last record returned
+     */
+    size_t peekAfter(Mark* after, void* out, size_t record_size, size_t max_records);
+
+    /**
+     * @brief Consume every record up to and including the one at mark
+     */
+    void commitTo(const Mark& mark);
+
+    bool empty() const { return pending_ == 0; }
+    uint32_t pendingCount() const { return pending_; }
+    uint32_t droppedCount() const { return dropped_; }
+
+private:
+    struct Position {
+        uint32_t sector;
+        uint32_t offset;
+    };
+
+    enum class ReadResult { Ok, End };
+
+    ReadResult readRecord(const Position& pos, uint8_t* state, uint16_t* length,
+                          uint8_t* payload, Position* next) const;
+    bool sectorValid(uint32_t sector) const { return (valid_sectors_ >> sector) & 1; }
+    bool markCurrent(const Mark& mark) const;
+    // Log order of a position in a valid sector
+    uint64_t ordinal(const Position& pos) const;
+    bool openNextSector();
+    uint32_t countPendingInSector(Position from) const;
+    bool advanceReader(Position& pos, Position* record_pos, uint8_t* state,
+                       uint8_t* payload, uint16_t* length) const;
+
+    const esp_partition_t* partition_;
+    void* mutex_;  // SemaphoreHandle_t (void* for header portability)
+
+    uint32_t sector_count_;
+    uint64_t valid_sectors_;  // Bit per sector with a valid header
+    uint32_t sector_seq_[64]; // Header sequence number per valid sector
+    uint32_t write_seq_;
+
+    Position write_;
+    Position read_;
+
+    bool peek_valid_;
+    Position peek_end_;
+    Position peek_last_;  // Last record returned by peek(), marked on commit
+    uint32_t peek_records_;
+
+    volatile uint32_t pending_;
+    volatile uint32_t dropped_;
+};
+
+#endif // TELEMETRY_SPOOL_H
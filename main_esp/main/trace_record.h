@@ -0,0 +1,118 @@
+#ifndef TRACE_RECORD_H
+#define TRACE_RECORD_H
+
+#include "presence_pipeline.h"
+#include <cstdint>
+
+/**
+ * @brief One presence sample in a trace (8 bytes)
+ *
+ * Holds the raw readings PresencePipeline needs to replay the sample, and
+ * the decisions the device took on it, for comparison:
+ *
+ * - dt_ms:       since the previous record, saturating (FLAG_GAP)
+ * - distance_mm: ranging input, 0 if the reading failed
+ * - radar_cm:    RADAR_NONE without a report, RADAR_NO_TARGET for a
+ *                report without a target, else the target distance
+ * - flags:       light reading (bits 1..0), decisions (bits 4..2),
+ *                LED action (bits 6..5), FLAG_GAP
+ * - probability: fused presence probability * 255
+ *
+ * Little-endian like both the ESP32 and the host tool.
+ */
+struct TraceRecord {
+    uint16_t dt_ms;
+    uint16_t distance_mm;
+    uint16_t radar_cm;
+    uint8_t flags;
+    uint8_t probability;
+
+    static constexpr uint16_t DT_MAX_MS = 0xFFFF;
+    static constexpr uint16_t DISTANCE_MAX_MM = 0xFFFF;
+    static constexpr uint16_t RADAR_NONE = 0xFFFF;
+    static constexpr uint16_t RADAR_NO_TARGET = 0xFFFE;
+
+    static constexpr uint8_t LIGHT_MASK = 0x03;
+    static constexpr uint8_t LIGHT_QUIET = 0x01;
+    static constexpr uint8_t LIGHT_SHADOW = 0x02;
+    static constexpr uint8_t FLAG_MOTION = 0x04;   // MotionDetector present
+    static constexpr uint8_t FLAG_PRESENT = 0x08;  // Fused presence
+    static constexpr uint8_t FLAG_LEDS_ON = 0x10;
+    static constexpr uint8_t LED_ACTION_SHIFT = 5;  // LedAction, 2 bits
+    static constexpr uint8_t FLAG_GAP = 0x80;       // dt_ms saturated
+
+    static TraceRecord make(uint32_t dt_ms, const PresenceSample& sample, const PresenceStep& step) {
+        TraceRecord r;
+        r.dt_ms = dt_ms > DT_MAX_MS ? DT_MAX_MS : (uint16_t)dt_ms;
+        float mm = sample.distance_cm * 10.0f + 0.5f;
+        r.distance_mm = sample.distance_cm <= 0 ? 0
+                        : mm >= DISTANCE_MAX_MM ? DISTANCE_MAX_MM
+                        : mm < 1.0f             ? 1
+                                                : (uint16_t)mm;
+        r.radar_cm = !sample.radar_report ? RADAR_NONE
+                     : !sample.radar_target ? RADAR_NO_TARGET
+                     : sample.radar_cm >= RADAR_NO_TARGET ? (uint16_t)(RADAR_NO_TARGET - 1)
+                                                          : sample.radar_cm;
+        r.flags = (uint8_t)((uint8_t)step.led << LED_ACTION_SHIFT);
+        if (sample.light_observed) {
+            r.flags |= sample.light_shadow ? LIGHT_SHADOW : LIGHT_QUIET;
+        }
+        if (step.motion_present) r.flags |= FLAG_MOTION;
+        if (step.presence.present) r.flags |= FLAG_PRESENT;
+        if (step.leds_on) r.flags |= FLAG_LEDS_ON;
+        if (dt_ms > DT_MAX_MS) r.flags |= FLAG_GAP;
+        float p = step.presence.probability * 255.0f + 0.5f;
+        r.probability = p <= 0 ? 0 : p >= 255 ? 255 : (uint8_t)p;
+        return r;
+    }
+
+    /**
+     * @brief The readings to replay, at time_ms (previous record time + dt_ms)
+     */
+    PresenceSample sample(int64_t time_ms) const {
+        PresenceSample s = {};
+        s.time_ms = time_ms;
+        s.distance_cm = distance_mm == 0 ? -1.0f : distance_mm / 10.0f;
+        s.radar_report = radar_cm != RADAR_NONE;
+        s.radar_target = s.radar_report && radar_cm != RADAR_NO_TARGET;
+        s.radar_cm = s.radar_target ? radar_cm : 0;
+        s.light_observed = (flags & LIGHT_MASK) != 0;
+        s.light_shadow = (flags & LIGHT_MASK) == LIGHT_SHADOW;
+        return s;
+    }
+
+    bool motion() const { return flags & FLAG_MOTION; }
+    bool present() const { return flags & FLAG_PRESENT; }
+    bool ledsOn() const { return flags & FLAG_LEDS_ON; }
+    LedAction ledAction() const { return (LedAction)((flags >> LED_ACTION_SHIFT) & 0x03); }
+};
+
+static_assert(sizeof(TraceRecord) == 8, "Trace record must stay 8 bytes");
+
+/**
+ * @brief Start of a trace dump, followed by `count` TraceRecords, oldest first
+ *
+ * config is PresencePipelineConfig as it was at dump time, copied as-is:
+ * the ESP32 and x86-64/ARM64 hosts lay it out the same way. Bump VERSION
+ * whenever this header, TraceRecord or PresencePipelineConfig change.
+ */
+struct TraceHeader {
+    uint32_t magic;          // MAGIC
+    uint16_t version;        // VERSION
+    uint16_t record_size;    // sizeof(TraceRecord)
+    uint32_t count;          // Records that follow
+    uint32_t dropped;        // Older records overwritten since boot
+    int64_t start_ms;        // Uptime of the first record
+    int64_t dumped_ms;       // Uptime when the dump started
+    int64_t dumped_unix_s;   // Wall clock then, 0 before SNTP sync
+    uint32_t header_size;    // sizeof(TraceHeader), records start here
+    uint32_t config_size;    // sizeof(PresencePipelineConfig)
+    PresencePipelineConfig config;
+
+    static constexpr uint32_t MAGIC = 0x43525450;  // "PTRC"
+    static constexpr uint16_t VERSION = 1;
+};
+
+static_assert(sizeof(TraceHeader) == 192, "Trace header layout changed: bump VERSION");
+
+#endif // TRACE_RECORD_H
@@ -0,0 +1,132 @@
+#include "trace_recorder.h"
+#include "config.h"
+#include "telemetry_record.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <cstring>
+#include <ctime>
+
+static const char* TAG = "TraceRecorder";
+
+// Records copied per lock during a dump
+#define DUMP_CHUNK_RECORDS 32
+
+static TraceRecord s_records[TRACE_CAPACITY];
+
+// Static member initialization
+void* TraceRecorder::mutex = nullptr;
+PresencePipelineConfig TraceRecorder::config = {};
+uint32_t TraceRecorder::total = 0;
+int64_t TraceRecorder::last_ms = 0;
+int64_t TraceRecorder::oldest_ms = 0;
+
+void TraceRecorder::init() {
+    if (mutex == nullptr) {
+        mutex = xSemaphoreCreateMutex();
+        if (mutex == nullptr) {
+            ESP_LOGE(TAG, "Failed to create mutex!");
+        } else {
+            ESP_LOGI(TAG, "TraceRecorder initialized (%d samples, %u bytes)",
+                     TRACE_CAPACITY, (unsigned)sizeof(s_records));
+        }
+    }
+}
+
+void TraceRecorder::set_config(const PresencePipelineConfig& new_config) {
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "TraceRecorder not initialized!");
+        return;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) == pdTRUE) {
+        config = new_config;
+        xSemaphoreGive(sem);
+    }
+}
+
+void TraceRecorder::record(const PresenceSample& sample, const PresenceStep& step) {
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "TraceRecorder not initialized!");
+        return;
+    }
+
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) == pdTRUE) {
+        int64_t dt = total == 0 ? 0 : sample.time_ms - last_ms;
+        TraceRecord record = TraceRecord::make(dt > 0 ? (uint32_t)dt : 0, sample, step);
+        if (total == 0) {
+            oldest_ms = sample.time_ms;
+        } else if (total >= TRACE_CAPACITY) {
+            // The second oldest record becomes the oldest
+            oldest_ms += s_records[(total + 1) % TRACE_CAPACITY].dt_ms;
+        }
+        s_records[total % TRACE_CAPACITY] = record;
+        total++;
+        last_ms = sample.time_ms;
+        xSemaphoreGive(sem);
+    }
+}
+
+bool TraceRecorder::dump(WriteFn write, void* arg) {
+    if (mutex == nullptr) {
+        ESP_LOGE(TAG, "TraceRecorder not initialized!");
+        return false;
+    }
+
+    TraceHeader header = {};
+    header.magic = TraceHeader::MAGIC;
+    header.version = TraceHeader::VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.header_size = sizeof(TraceHeader);
+    header.config_size = sizeof(PresencePipelineConfig);
+    header.dumped_ms = esp_timer_get_time() / 1000;
+    time_t now = time(nullptr);
+    header.dumped_unix_s = now >= Telemetry::TELEMETRY_EPOCH ? (int64_t)now : 0;
+
+    uint32_t first = 0;
+    SemaphoreHandle_t sem = static_cast<SemaphoreHandle_t>(mutex);
+    if (xSemaphoreTake(sem, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    first = total > TRACE_CAPACITY ? total - TRACE_CAPACITY : 0;
+    header.count = total - first;
+    header.dropped = first;
+    header.start_ms = oldest_ms;
+    header.config = config;
+    xSemaphoreGive(sem);
+
+    if (!write(&header, sizeof(header), arg)) {
+        return false;
+    }
+
+    TraceRecord chunk[DUMP_CHUNK_RECORDS];
+    uint32_t end = first + header.count;
+    for (uint32_t seq = first; seq < end; ) {
+        uint32_t n = end - seq < DUMP_CHUNK_RECORDS ? end - seq : DUMP_CHUNK_RECORDS;
+        bool overwritten = false;
+        if (xSemaphoreTake(sem, portMAX_DELAY) != pdTRUE) {
+            return false;
+        }
+        // The recording kept going; the chunk is gone if it wrapped past seq
+        overwritten = total - seq > TRACE_CAPACITY;
+        for (uint32_t i = 0; i < n && !overwritten; i++) {
+            chunk[i] = s_records[(seq + i) % TRACE_CAPACITY];
+        }
+        xSemaphoreGive(sem);
+
+        if (overwritten) {
+            ESP_LOGW(TAG, "Dump fell behind the recording at record %lu",
+                     (unsigned long)(seq - first));
+            return false;
+        }
+        if (!write(chunk, n * sizeof(TraceRecord), arg)) {
+            return false;
+        }
+        seq += n;
+    }
+    ESP_LOGI(TAG, "Dumped %lu samples", (unsigned long)header.count);
+    return true;
+}
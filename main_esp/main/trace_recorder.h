@@ -0,0 +1,54 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "trace_record.h"
+
+/**
+ * @brief Thread-safe ring of the latest presence samples (see trace_record.h)
+ *
+ * distance_sensor_task records every sample it takes; the oldest records
+ * are overwritten once TRACE_CAPACITY is reached. A dump (HTTP GET
+ * /api/device/trace or the MQTT DUMP_TRACE command) streams a TraceHeader
+ * followed by the records, oldest first, for the trace_replay tool.
+ *
+ * Dumps copy the ring in small chunks, so recording carries on meanwhile.
+ */
+class TraceRecorder {
+public:
+    /**
+     * @brief Receives the dump; returns false to abort it
+     */
+    typedef bool (*WriteFn)(const void* data, size_t len, void* arg);
+
+    /**
+     * @brief Initialize the recorder (must be called before use)
+     */
+    static void init();
+
+    /**
+     * @brief Remember the pipeline configuration for the dump header (thread-safe)
+     */
+    static void set_config(const PresencePipelineConfig& config);
+
+    /**
+     * @brief Append one sample and the decisions taken on it (thread-safe)
+     */
+    static void record(const PresenceSample& sample, const PresenceStep& step);
+
+    /**
+     * @brief Stream header and records through write (thread-safe)
+     * @return false if write failed or the dump fell behind the recording
+     */
+    static bool dump(WriteFn write, void* arg);
+
+private:
+    static void* mutex;  // SemaphoreHandle_t (void* for header portability)
+    static PresencePipelineConfig config;
+    static uint32_t total;        // Records since boot; the newest is total - 1
+    static int64_t last_ms;       // Time of the newest record
+    static int64_t oldest_ms;     // Time of the oldest record still held
+};
+
+#endif // TRACE_RECORDER_H
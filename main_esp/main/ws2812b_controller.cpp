@@ -1,171 +1,402 @@
 #include "ws2812b_controller.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include <cstring>
 
 static const char *TAG = "WS2812B";
 
-WS2812BController::WS2812BController(gpio_num_t pin, uint32_t num_leds)
-    : pin_(pin), num_leds_(num_leds), led_strip_(nullptr), animation_task_(nullptr), stop_animation_(false) {
+// 10 MHz RMT clock: 0.1 us per tick
+#define RMT_RESOLUTION_HZ (10 * 1000 * 1000)
+
+// WS2812 bit timings in ticks (0: 0.3 us high, 0.9 us low; 1: the reverse)
+#define T0H_TICKS 3
+#define T0L_TICKS 9
+#define T1H_TICKS 9
+#define T1L_TICKS 3
+
+// Two memory blocks: a 5-LED frame (120 symbols) goes out without refills
+#define RMT_MEM_BLOCK_SYMBOLS 128
+
+// A frame of a few LEDs takes well under 1 ms on the wire
+#define TX_TIMEOUT_MS 100
+
+#define FLUSH_TASK_STACK_SIZE 2560
+#define FLUSH_TASK_PRIORITY 6
+
+// Colour cycle: a step every ~3.3 s (10 s per colour), eased over 500 ms
+#define CYCLE_STEP_MS 3333
+#define CYCLE_FADE_MS 500
+
+// Red, blue, green, each at roughly 1/3, 2/3 and full brightness
+static const LedState kCycleSteps[] = {
+    {255, 0, 0, 85}, {255, 0, 0, 170}, {255, 0, 0, 255},
+    {0, 0, 255, 85}, {0, 0, 255, 170}, {0, 0, 255, 255},
+    {0, 255, 0, 85}, {0, 255, 0, 170}, {0, 255, 0, 255},
+};
+#define CYCLE_STEPS (int)(sizeof(kCycleSteps) / sizeof(kCycleSteps[0]))
+
+WS2812BController::WS2812BController(gpio_num_t pin, uint32_t num_leds, uint32_t max_fps)
+    : pin_(pin),
+      num_leds_(num_leds),
+      min_frame_us_(1000000 / (max_fps > 0 ? max_fps : 1)),
+      frame_(num_leds),
+      fader_(num_leds),
+      tx_chan_(nullptr),
+      encoder_(nullptr),
+      tx_done_(nullptr),
+      flush_task_(nullptr),
+      lock_(portMUX_INITIALIZER_UNLOCKED),
+      cycle_running_(false),
+      cycle_step_(0),
+      cycle_next_ms_(0),
+      cpu_us_total_(0),
+      last_frame_us_(0) {
+    memset(&stats_, 0, sizeof(stats_));
+    memset(frame_times_ms_, 0, sizeof(frame_times_ms_));
 }
 
 WS2812BController::~WS2812BController() {
-    if (led_strip_ != nullptr) {
-        led_strip_del(led_strip_);
+    if (flush_task_ != nullptr) {
+        vTaskDelete(flush_task_);
+    }
+    if (tx_chan_ != nullptr) {
+        rmt_tx_wait_all_done(tx_chan_, TX_TIMEOUT_MS);
+        rmt_disable(tx_chan_);
+        rmt_del_channel(tx_chan_);
+    }
+    if (encoder_ != nullptr) {
+        rmt_del_encoder(encoder_);
+    }
+    if (tx_done_ != nullptr) {
+        vSemaphoreDelete(tx_done_);
     }
 }
 
 bool WS2812BController::init() {
-    led_strip_config_t strip_config = {
-        .strip_gpio_num = pin_,
-        .max_leds = num_leds_,
-        .led_model = LED_MODEL_WS2812,
+    rmt_tx_channel_config_t chan_config = {
+        .gpio_num = pin_,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = RMT_RESOLUTION_HZ,
+        .mem_block_symbols = RMT_MEM_BLOCK_SYMBOLS,
+        .trans_queue_depth = 1,  // The flush task sends one frame at a time
     };
+    esp_err_t err = rmt_new_tx_channel(&chan_config, &tx_chan_);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LED init failed: %d", err);
+        tx_chan_ = nullptr;
+        return false;
+    }
 
-    led_strip_rmt_config_t rmt_config = {
-        .clk_src = RMT_CLK_SRC_DEFAULT,
-        .resolution_hz = 10 * 1000 * 1000,
-        .mem_block_symbols = 128,
+    rmt_bytes_encoder_config_t encoder_config = {};
+    encoder_config.bit0.level0 = 1;
+    encoder_config.bit0.duration0 = T0H_TICKS;
+    encoder_config.bit0.level1 = 0;
+    encoder_config.bit0.duration1 = T0L_TICKS;
+    encoder_config.bit1.level0 = 1;
+    encoder_config.bit1.duration0 = T1H_TICKS;
+    encoder_config.bit1.level1 = 0;
+    encoder_config.bit1.duration1 = T1L_TICKS;
+    encoder_config.flags.msb_first = 1;
+    err = rmt_new_bytes_encoder(&encoder_config, &encoder_);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LED encoder init failed: %d", err);
+        encoder_ = nullptr;
+        return false;
+    }
+
+    tx_done_ = xSemaphoreCreateBinary();
+    if (tx_done_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create TX semaphore");
+        return false;
+    }
+    rmt_tx_event_callbacks_t callbacks = {
+        .on_trans_done = on_tx_done,
     };
+    if (rmt_tx_register_event_callbacks(tx_chan_, &callbacks, this) != ESP_OK ||
+        rmt_enable(tx_chan_) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to enable RMT channel");
+        return false;
+    }
 
-    esp_err_t err = led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip_);
-    if (err != ESP_OK || !led_strip_) {
-        ESP_LOGE(TAG, "LED init failed: %d", err);
+    // Blank the strip once, synchronously: after a soft reset the LEDs still
+    // show the old frame, and an all-off back buffer would be skipped as
+    // unchanged
+    rmt_transmit_config_t tx_config = {};
+    if (rmt_transmit(tx_chan_, encoder_, frame_.front(), frame_.bytes(), &tx_config) == ESP_OK) {
+        xSemaphoreTake(tx_done_, pdMS_TO_TICKS(TX_TIMEOUT_MS));
+    }
+    last_frame_us_ = esp_timer_get_time();
+
+    if (xTaskCreatePinnedToCore(flush_task_entry, "ws2812b_flush", FLUSH_TASK_STACK_SIZE, this,
+                                FLUSH_TASK_PRIORITY, &flush_task_, 1) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create flush task");
+        flush_task_ = nullptr;
         return false;
     }
 
-    ESP_LOGI(TAG, "LED strip initialized on GPIO%d with %lu LEDs", pin_, num_leds_);
-    clear();
-    led_strip_refresh(led_strip_);
+    ESP_LOGI(TAG, "LED strip initialized on GPIO%d with %lu LEDs, max %lu fps",
+             pin_, num_leds_, (unsigned long)(1000000 / min_frame_us_));
     return true;
 }
 
+static uint8_t clamp_channel(uint32_t value) {
+    return value > 255 ? 255 : (uint8_t)value;
+}
+
 void WS2812BController::set_pixel(uint32_t index, uint32_t red, uint32_t green, uint32_t blue) {
-    if (index < num_leds_ && led_strip_) {
-        led_strip_set_pixel(led_strip_, index, red, green, blue);
-    }
+    set_pixel_brightness(index, red, green, blue, 255);
 }
 
 void WS2812BController::set_pixel_brightness(uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness) {
-    if (index < num_leds_ && led_strip_) {
-        uint32_t r = (red * brightness) / 255;
-        uint32_t g = (green * brightness) / 255;
-        uint32_t b = (blue * brightness) / 255;
-        led_strip_set_pixel(led_strip_, index, r, g, b);
+    if (index < num_leds_) {
+        LedState state = {clamp_channel(red), clamp_channel(green), clamp_channel(blue), brightness};
+        portENTER_CRITICAL(&lock_);
+        fader_.set(index, state);
+        write_pixel(index, state, this);
+        portEXIT_CRITICAL(&lock_);
+    }
+}
+
+void WS2812BController::fill_brightness(uint32_t count, uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness) {
+    LedState on = {clamp_channel(red), clamp_channel(green), clamp_channel(blue), brightness};
+    LedState off = {0, 0, 0, 0};
+    portENTER_CRITICAL(&lock_);
+    LedPixel pixel = color_.apply(on.red, on.green, on.blue, on.brightness);
+    for (uint32_t i = 0; i < num_leds_; i++) {
+        if (i < count) {
+            fader_.set(i, on);
+            frame_.setPixel(i, pixel.red, pixel.green, pixel.blue);
+        } else {
+            fader_.set(i, off);
+            frame_.setPixel(i, 0, 0, 0);
+        }
+    }
+    portEXIT_CRITICAL(&lock_);
+}
+
+void WS2812BController::fade_to(uint32_t count, uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness,
+                                uint32_t duration_ms, LedEasing easing) {
+    LedState on = {clamp_channel(red), clamp_channel(green), clamp_channel(blue), brightness};
+    LedState off = {0, 0, 0, 0};
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    portENTER_CRITICAL(&lock_);
+    for (uint32_t i = 0; i < num_leds_; i++) {
+        fader_.fadeTo(i, i < count ? on : off, duration_ms, easing, now_ms);
     }
+    portEXIT_CRITICAL(&lock_);
+    refresh();
+}
+
+void WS2812BController::set_white_balance(uint8_t red, uint8_t green, uint8_t blue) {
+    portENTER_CRITICAL(&lock_);
+    color_.setWhiteBalance({red, green, blue});
+    portEXIT_CRITICAL(&lock_);
+    ESP_LOGI(TAG, "White balance R:%d G:%d B:%d", red, green, blue);
 }
 
 void WS2812BController::clear() {
-    if (led_strip_) {
-        led_strip_clear(led_strip_);
+    LedState off = {0, 0, 0, 0};
+    portENTER_CRITICAL(&lock_);
+    for (uint32_t i = 0; i < num_leds_; i++) {
+        fader_.set(i, off);
     }
+    frame_.clear();
+    portEXIT_CRITICAL(&lock_);
 }
 
 void WS2812BController::refresh() {
-    if (led_strip_) {
-        led_strip_refresh(led_strip_);
+    if (flush_task_ != nullptr) {
+        xTaskNotifyGive(flush_task_);
     }
 }
 
-void WS2812BController::power_up_animation(uint32_t duration_ms) {
-    if (animation_task_ == nullptr) {
-        stop_animation_ = false;
-        xTaskCreatePinnedToCore(animation_task_entry, "ws2812b_anim", 2048, this, 5, &animation_task_, 1);
+void WS2812BController::get_stats(WS2812BStats* out) {
+    uint32_t now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    portENTER_CRITICAL(&lock_);
+    *out = stats_;
+    uint32_t recorded = stats_.frames < kFrameHistory ? stats_.frames : kFrameHistory;
+    uint32_t recent = 0;
+    for (uint32_t i = 0; i < recorded; i++) {
+        if (now_ms - frame_times_ms_[i] < 1000) {
+            recent++;
+        }
     }
+    portEXIT_CRITICAL(&lock_);
+    out->fps = recent;
+}
+
+// RMT interrupt: the front buffer has been sent and may be replaced
+bool WS2812BController::on_tx_done(rmt_channel_handle_t chan, const rmt_tx_done_event_data_t* event, void* arg) {
+    WS2812BController* self = static_cast<WS2812BController*>(arg);
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(self->tx_done_, &woken);
+    return woken == pdTRUE;
+}
+
+void WS2812BController::flush_task_entry(void* arg) {
+    static_cast<WS2812BController*>(arg)->run_flush();
+}
+
+// Sink for fader_.render(), and for direct writes; lock_ is held
+void WS2812BController::write_pixel(size_t index, const LedState& state, void* arg) {
+    WS2812BController* self = static_cast<WS2812BController*>(arg);
+    uint8_t* pixel = self->frame_.backPixel(index);
+    if (pixel != nullptr) {
+        self->color_.applyTo(state.red, state.green, state.blue, state.brightness,
+                             &pixel[LedFrameBuffer::kRed], &pixel[LedFrameBuffer::kGreen],
+                             &pixel[LedFrameBuffer::kBlue]);
+    }
+}
+
+bool WS2812BController::advance(int64_t now_ms) {
+    if (cycle_running_ && now_ms >= cycle_next_ms_) {
+        const LedState& step = kCycleSteps[cycle_step_];
+        for (uint32_t i = 0; i < num_leds_; i++) {
+            fader_.fadeTo(i, step, CYCLE_FADE_MS, LedEasing::EaseInOut, now_ms);
+        }
+        cycle_step_ = (cycle_step_ + 1) % CYCLE_STEPS;
+        cycle_next_ms_ = now_ms + CYCLE_STEP_MS;
+    }
+    return fader_.render(now_ms, write_pixel, this);
+}
+
+void WS2812BController::run_flush() {
+    TickType_t frame_ticks = (TickType_t)(((uint64_t)min_frame_us_ * configTICK_RATE_HZ + 999999) / 1000000);
+    if (frame_ticks == 0) {
+        frame_ticks = 1;
+    }
+    TickType_t wait = portMAX_DELAY;
+
+    while (true) {
+        // Woken by refresh(), or by the frame tick while something animates
+        uint32_t requests = ulTaskNotifyTake(pdTRUE, wait);
+
+        // Frame-rate cap: refreshes arriving meanwhile go out in this frame
+        int64_t wait_us = last_frame_us_ + min_frame_us_ - esp_timer_get_time();
+        if (wait_us > 0) {
+            TickType_t ticks = (TickType_t)((wait_us * configTICK_RATE_HZ + 999999) / 1000000);
+            vTaskDelay(ticks);
+            requests += ulTaskNotifyTake(pdTRUE, 0);
+        }
+
+        int64_t start_us = esp_timer_get_time();
+        portENTER_CRITICAL(&lock_);
+        bool animating = advance(start_us / 1000);
+        bool changed = frame_.commit();
+        int64_t cycle_next_ms = cycle_running_ ? cycle_next_ms_ : -1;
+        portEXIT_CRITICAL(&lock_);
+
+        bool sent = false;
+        int64_t tx_start_us = 0;
+        if (changed) {
+            tx_start_us = esp_timer_get_time();
+            rmt_transmit_config_t tx_config = {};
+            esp_err_t err = rmt_transmit(tx_chan_, encoder_, frame_.front(), frame_.bytes(), &tx_config);
+            if (err == ESP_OK) {
+                sent = true;
+            } else {
+                ESP_LOGW(TAG, "RMT transmit failed: %d", err);
+            }
+        }
+        int64_t end_us = esp_timer_get_time();
+        uint32_t cpu_us = (uint32_t)(end_us - start_us);
+
+        // The RMT reads the front buffer until done; nothing commits meanwhile
+        uint32_t tx_us = 0;
+        if (sent) {
+            if (xSemaphoreTake(tx_done_, pdMS_TO_TICKS(TX_TIMEOUT_MS)) != pdTRUE) {
+                ESP_LOGW(TAG, "RMT transmit timed out");
+            }
+            last_frame_us_ = esp_timer_get_time();
+            tx_us = (uint32_t)(last_frame_us_ - tx_start_us);
+        }
+
+        // Sleep until the next request unless a transition or cycle step is due
+        if (animating) {
+            wait = frame_ticks;
+        } else if (cycle_next_ms >= 0) {
+            int64_t until_ms = cycle_next_ms - esp_timer_get_time() / 1000;
+            wait = until_ms > 0 ? pdMS_TO_TICKS(until_ms) + 1 : 1;
+        } else {
+            wait = portMAX_DELAY;
+        }
+
+        portENTER_CRITICAL(&lock_);
+        if (requests > 0) {
+            stats_.requests += requests;
+            stats_.coalesced += requests - 1;
+        }
+        if (sent) {
+            frame_times_ms_[stats_.frames % kFrameHistory] = (uint32_t)(last_frame_us_ / 1000);
+            stats_.frames++;
+            stats_.tx_us = tx_us;
+        } else if (!changed) {
+            stats_.skipped++;
+        }
+        cpu_us_total_ += cpu_us;
+        if (cpu_us > stats_.cpu_us_max) {
+            stats_.cpu_us_max = cpu_us;
+        }
+        uint32_t flushes = stats_.frames + stats_.skipped;
+        stats_.cpu_us_avg = flushes > 0 ? (uint32_t)(cpu_us_total_ / flushes) : cpu_us;
+        portEXIT_CRITICAL(&lock_);
+    }
+}
+
+void WS2812BController::power_up_animation(uint32_t duration_ms) {
+    color_brightness_cycle();
 }
 
 void WS2812BController::stop_animation() {
-    stop_animation_ = true;
-    while (animation_task_ != nullptr) {
-        vTaskDelay(pdMS_TO_TICKS(10));
+    portENTER_CRITICAL(&lock_);
+    bool was_running = cycle_running_;
+    cycle_running_ = false;
+    portEXIT_CRITICAL(&lock_);
+    if (was_running) {
+        clear();
+        refresh();
     }
 }
 
 void WS2812BController::restart_animation() {
-    if (animation_task_ == nullptr) {
-        stop_animation_ = false;
-        xTaskCreatePinnedToCore(animation_task_entry, "ws2812b_anim", 2048, this, 5, &animation_task_, 1);
-    }
+    color_brightness_cycle();
 }
 
 void WS2812BController::set_all_pixels(uint32_t red, uint32_t green, uint32_t blue) {
-    if (!led_strip_) {
+    if (flush_task_ == nullptr) {
         ESP_LOGW(TAG, "LED strip not initialized!");
         return;
     }
     ESP_LOGI(TAG, "Setting all LEDs to R:%lu G:%lu B:%lu", red, green, blue);
-    for (uint32_t i = 0; i < num_leds_; i++) {
-        set_pixel(i, red, green, blue);
-    }
+    fill_brightness(num_leds_, red, green, blue, 255);
     refresh();
 }
 
 void WS2812BController::set_all_pixels_brightness(uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness) {
-    for (uint32_t i = 0; i < num_leds_; i++) {
-        set_pixel_brightness(i, red, green, blue, brightness);
-    }
+    fill_brightness(num_leds_, red, green, blue, brightness);
     refresh();
 }
 
 void WS2812BController::pulse_animation(uint32_t red, uint32_t green, uint32_t blue, uint32_t duration_ms) {
-    int steps = 5;
-    int delay = duration_ms / (2 * steps);
-    for (int s = 0; s <= steps; s++) {
-        uint8_t br = (s * 255) / steps;
-        set_all_pixels_brightness(red, green, blue, br);
-        vTaskDelay(pdMS_TO_TICKS(delay));
-    }
-    for (int s = steps; s > 0; s--) {
-        uint8_t br = (s * 255) / steps;
-        set_all_pixels_brightness(red, green, blue, br);
-        vTaskDelay(pdMS_TO_TICKS(delay));
+    LedState peak = {clamp_channel(red), clamp_channel(green), clamp_channel(blue), 255};
+    LedState off = {peak.red, peak.green, peak.blue, 0};
+    int64_t now_ms = esp_timer_get_time() / 1000;
+    portENTER_CRITICAL(&lock_);
+    for (uint32_t i = 0; i < num_leds_; i++) {
+        fader_.set(i, off);
+        fader_.fadeTo(i, peak, duration_ms / 2, LedEasing::EaseInOut, now_ms, true);
     }
-    clear();
+    portEXIT_CRITICAL(&lock_);
+    refresh();
 }
 
 void WS2812BController::color_brightness_cycle() {
-    // Color sequence: Red, Blue, Green
-    const struct {
-        uint8_t r, g, b;
-    } colors[] = {
-        {255, 0, 0},    // Red
-        {0, 0, 255},    // Blue
-        {0, 255, 0},    // Green
-    };
-    
-    const uint8_t brightness_levels[] = {85, 170, 255};  // 3 different brightness levels (roughly 1/3, 2/3, full)
-    const int num_colors = 3;
-    const int num_brightness = 3;
-    const int brightness_delay_ms = 3333;  // ~3.3 seconds per brightness level (10 seconds / 3 levels)
-    const int check_interval_ms = 50;  // Check stop flag every 50ms for quick response
-    
-    while (!stop_animation_) {
-        // Cycle through each color
-        for (int c = 0; c < num_colors && !stop_animation_; c++) {
-            // For each color, show 3 different brightness levels
-            for (int b = 0; b < num_brightness && !stop_animation_; b++) {
-                set_all_pixels_brightness(colors[c].r, colors[c].g, colors[c].b, brightness_levels[b]);
-                
-                // Break delay into smaller chunks to check stop flag frequently
-                int remaining_ms = brightness_delay_ms;
-                while (remaining_ms > 0 && !stop_animation_) {
-                    int delay = (remaining_ms > check_interval_ms) ? check_interval_ms : remaining_ms;
-                    vTaskDelay(pdMS_TO_TICKS(delay));
-                    remaining_ms -= delay;
-                }
-            }
-        }
+    portENTER_CRITICAL(&lock_);
+    if (!cycle_running_) {
+        cycle_running_ = true;
+        cycle_step_ = 0;
+        cycle_next_ms_ = 0;  // First step on the next flush
     }
-    
-    clear();
+    portEXIT_CRITICAL(&lock_);
     refresh();
 }
-
-void WS2812BController::animation_task_entry(void* arg) {
-    static_cast<WS2812BController*>(arg)->run_animation();
-}
-
-void WS2812BController::run_animation() {
-    // Use the color brightness cycle animation
-    color_brightness_cycle();
-    animation_task_ = nullptr;
-    vTaskDelete(nullptr);
-}
@@ -2,43 +2,134 @@
 #define WS2812B_CONTROLLER_H
 
 #include "driver/gpio.h"
-#include "led_strip.h"
+#include "driver/rmt_tx.h"
+#include "led_color.h"
+#include "led_fader.h"
+#include "led_frame_buffer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 
+struct WS2812BStats {
+    uint32_t requests;    // refresh() calls
+    uint32_t frames;      // Frames transmitted
+    uint32_t skipped;     // Identical to the frame already shown, not sent
+    uint32_t coalesced;   // Requests merged into one frame by the frame-rate cap
+    uint32_t fps;         // Frames transmitted in the last second
+    uint32_t cpu_us_avg;  // Per flush: transitions, compare/copy, RMT setup
+    uint32_t cpu_us_max;
+    uint32_t tx_us;       // Last frame on the wire, transmit to done interrupt
+};
+
+/**
+ * @brief WS2812B strip on an RMT TX channel, drawn through a frame buffer
+ *
+ * set_pixel() and friends draw into the back buffer of a LedFrameBuffer.
+ * refresh() only wakes a flush task and returns, so callers never wait for
+ * the strip. The flush task holds frames to max_fps (several tasks
+ * refreshing at once share one frame), commits the back buffer, skips the
+ * transmission if the frame did not change, and otherwise sends the front
+ * buffer with an asynchronous rmt_transmit(), waking on the done interrupt.
+ *
+ * The frame gap is also the WS2812 latch (reset) time: at most 1/max_fps
+ * between frames is far longer than the 280 us the LEDs need.
+ *
+ * Every colour goes through LedColorPipeline: brightness and white balance
+ * scaling, then gamma correction, so set_pixel() values are perceptual.
+ *
+ * Transitions (fade_to(), pulse_animation(), the colour cycle) return at
+ * once. A LedFader holds one transition per pixel, and the flush task
+ * renders them on its frame tick, waking every frame only while one is in
+ * flight. Writing a pixel directly cancels its transition.
+ */
 class WS2812BController {
 public:
-    WS2812BController(gpio_num_t pin, uint32_t num_leds);
+    WS2812BController(gpio_num_t pin, uint32_t num_leds, uint32_t max_fps = 50);
     ~WS2812BController();
-    
+
     bool init();
     void set_pixel(uint32_t index, uint32_t red, uint32_t green, uint32_t blue);
     void set_pixel_brightness(uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness);
+
+    /**
+     * @brief First count pixels to one colour, the rest off (back buffer)
+     */
+    void fill_brightness(uint32_t count, uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness);
+
+    /**
+     * @brief Per-channel gain before gamma (255 = unchanged), e.g. to warm
+     *        up the strip's bluish white; applies to later pixel writes
+     */
+    void set_white_balance(uint8_t red, uint8_t green, uint8_t blue);
+
+    /**
+     * @brief Fade the first count pixels to one colour and the rest to off
+     *
+     * Each pixel starts from what it shows now (also mid-fade). Returns at
+     * once; the flush task renders the transition.
+     */
+    void fade_to(uint32_t count, uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness,
+                 uint32_t duration_ms, LedEasing easing = LedEasing::EaseInOut);
+
+    /**
+     * @brief All pixels off in the back buffer (shown on the next refresh)
+     */
     void clear();
+
+    /**
+     * @brief Show the back buffer; returns at once, the flush task sends it
+     */
     void refresh();
-    
+
     // Power up animation - cycles through colors and brightness levels
     void power_up_animation(uint32_t duration_ms = 2000);
+    // Ends the colour cycle with all pixels off; returns at once
     void stop_animation();
     void restart_animation();
-    
+
     // Helper methods for common patterns
     void set_all_pixels(uint32_t red, uint32_t green, uint32_t blue);
     void set_all_pixels_brightness(uint32_t red, uint32_t green, uint32_t blue, uint8_t brightness);
+    // Off -> colour -> off over duration_ms; returns at once
     void pulse_animation(uint32_t red, uint32_t green, uint32_t blue, uint32_t duration_ms);
-    
-    // Color cycling animation with different brightness levels
+
+    // Start cycling colours and brightness levels until stop_animation()
     void color_brightness_cycle();
-    
+
+    void get_stats(WS2812BStats* stats);
+
 private:
+    // Transmit times of the last frames, for the frames-per-second figure
+    static constexpr int kFrameHistory = 64;
+
     gpio_num_t pin_;
     uint32_t num_leds_;
-    led_strip_handle_t led_strip_;
-    TaskHandle_t animation_task_;
-    volatile bool stop_animation_;
-    
-    static void animation_task_entry(void* arg);
-    void run_animation();
+    uint32_t min_frame_us_;
+    LedFrameBuffer frame_;         // Guarded by lock_
+    LedColorPipeline color_;       // Guarded by lock_
+    LedFader fader_;               // Guarded by lock_; requested state per pixel
+    rmt_channel_handle_t tx_chan_;
+    rmt_encoder_handle_t encoder_;
+    SemaphoreHandle_t tx_done_;    // Given by the RMT done interrupt
+    TaskHandle_t flush_task_;
+    portMUX_TYPE lock_;            // Guards frame_, color_, fader_, the cycle and stats
+
+    bool cycle_running_;
+    int cycle_step_;
+    int64_t cycle_next_ms_;
+
+    WS2812BStats stats_;
+    uint64_t cpu_us_total_;
+    int64_t last_frame_us_;
+    uint32_t frame_times_ms_[kFrameHistory];
+
+    static void flush_task_entry(void* arg);
+    void run_flush();
+
+    // Under lock_: next colour cycle step and transitions into the back buffer
+    bool advance(int64_t now_ms);
+    static void write_pixel(size_t index, const LedState& state, void* arg);
+    static bool on_tx_done(rmt_channel_handle_t chan, const rmt_tx_done_event_data_t* event, void* arg);
 };
 
 #endif // WS2812B_CONTROLLER_H
@@ -0,0 +1,537 @@
+/*
+ * Replays a presence trace dumped by the firmware (GET /api/device/trace,
+ * or the MQTT DUMP_TRACE command) through PresencePipeline, the same
+ * detection and LED-timeout code distance_sensor_task runs, as fast as the
+ * host allows. Reports visits, false triggers and detection latency for
+ * the recorded configuration or a sweep of alternatives.
+ *
+ * See README.md for the options and the label file format.
+ */
+#include "trace_record.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+    // Raw readings in range closer together than this belong to one approach
+    constexpr int64_t kNearGapMs = 500;
+
+    struct Trace {
+        TraceHeader header;
+        std::vector<TraceRecord> records;
+        std::vector<int64_t> times_ms;  // Device uptime of each record
+        uint32_t gaps;                  // Records whose dt_ms saturated
+    };
+
+    struct Interval {
+        int64_t start_ms;
+        int64_t end_ms;
+    };
+
+    struct Options {
+        std::vector<float> thresholds_cm;   // Empty: as recorded
+        std::vector<uint32_t> timeouts_ms;
+        std::vector<uint32_t> max_on_ms;
+        float exit_margin_cm = -1;          // Negative: as recorded
+        int64_t enter_debounce_ms = -1;
+        int64_t exit_debounce_ms = -1;
+        int64_t min_dwell_ms = -1;
+        float enter_p = -1;
+        float exit_p = -1;
+        const char* labels_path = nullptr;
+        uint32_t short_ms = 1000;
+        uint32_t slack_ms = 1000;
+        bool list = false;
+        const char* trace_path = nullptr;
+    };
+
+    struct Result {
+        PresencePipelineConfig config;
+        uint32_t visits;
+        uint32_t entries;
+        uint32_t exits;
+        uint32_t led_sessions;
+        uint32_t off_idle;
+        uint32_t off_max;
+        int64_t led_on_ms;
+        uint32_t false_triggers;
+        uint32_t hits;           // With labels only
+        uint32_t missed;         // With labels only
+        std::vector<int64_t> latencies_ms;
+        uint32_t agree;          // Samples where fused presence matches the recording
+        uint32_t led_agree;      // ...and the LED state does
+    };
+
+    void usage(const char* argv0) {
+        fprintf(stderr,
+                "Usage: %s [options] TRACE\n"
+                "  --threshold CM[,CM...]    presence distance (LEDConfig distance_threshold_cm)\n"
+                "  --timeout MS[,MS...]      LEDs off after this long without presence\n"
+                "  --max-on MS[,MS...]       longest LED session\n"
+                "  --exit-margin CM          MotionDetector exit hysteresis\n"
+                "  --enter-debounce MS\n"
+                "  --exit-debounce MS\n"
+                "  --min-dwell MS\n"
+                "  --enter-p P, --exit-p P   PresenceFusion hysteresis\n"
+                "  --labels FILE             true visits, \"start_ms end_ms\" per line from trace start\n"
+                "  --short MS                no labels: visits shorter than this are false (1000)\n"
+                "  --slack MS                labels: allowed offset of a matching visit (1000)\n"
+                "  --list                    print every sample, recorded vs replayed\n"
+                "Lists sweep every combination; unset values keep the recorded configuration.\n",
+                argv0);
+    }
+
+    template <typename T>
+    bool parse_list(const char* text, std::vector<T>* out) {
+        std::string s(text);
+        size_t pos = 0;
+        while (pos <= s.size()) {
+            size_t comma = s.find(',', pos);
+            std::string item = s.substr(pos, comma == std::string::npos ? std::string::npos : comma - pos);
+            char* end = nullptr;
+            double v = strtod(item.c_str(), &end);
+            if (item.empty() || *end != '\0' || v < 0) {
+                return false;
+            }
+            out->push_back((T)v);
+            if (comma == std::string::npos) {
+                break;
+            }
+            pos = comma + 1;
+        }
+        return true;
+    }
+
+    bool parse_number(const char* text, double* out) {
+        char* end = nullptr;
+        *out = strtod(text, &end);
+        return *text != '\0' && *end == '\0' && *out >= 0;
+    }
+
+    bool parse_options(int argc, char** argv, Options* opt) {
+        for (int i = 1; i < argc; i++) {
+            const char* arg = argv[i];
+            const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+            double number = 0;
+            bool ok = true;
+            if (strcmp(arg, "--list") == 0) {
+                opt->list = true;
+                continue;
+            }
+            if (arg[0] != '-') {
+                if (opt->trace_path != nullptr) {
+                    return false;
+                }
+                opt->trace_path = arg;
+                continue;
+            }
+            if (value == nullptr) {
+                return false;
+            }
+            i++;
+            if (strcmp(arg, "--threshold") == 0) {
+                ok = parse_list(value, &opt->thresholds_cm);
+            } else if (strcmp(arg, "--timeout") == 0) {
+                ok = parse_list(value, &opt->timeouts_ms);
+            } else if (strcmp(arg, "--max-on") == 0) {
+                ok = parse_list(value, &opt->max_on_ms);
+            } else if (strcmp(arg, "--labels") == 0) {
+                opt->labels_path = value;
+            } else if ((ok = parse_number(value, &number))) {
+                if (strcmp(arg, "--exit-margin") == 0) {
+                    opt->exit_margin_cm = (float)number;
+                } else if (strcmp(arg, "--enter-debounce") == 0) {
+                    opt->enter_debounce_ms = (int64_t)number;
+                } else if (strcmp(arg, "--exit-debounce") == 0) {
+                    opt->exit_debounce_ms = (int64_t)number;
+                } else if (strcmp(arg, "--min-dwell") == 0) {
+                    opt->min_dwell_ms = (int64_t)number;
+                } else if (strcmp(arg, "--enter-p") == 0) {
+                    opt->enter_p = (float)number;
+                } else if (strcmp(arg, "--exit-p") == 0) {
+                    opt->exit_p = (float)number;
+                } else if (strcmp(arg, "--short") == 0) {
+                    opt->short_ms = (uint32_t)number;
+                } else if (strcmp(arg, "--slack") == 0) {
+                    opt->slack_ms = (uint32_t)number;
+                } else {
+                    ok = false;
+                }
+            }
+            if (!ok) {
+                fprintf(stderr, "Bad option %s %s\n", arg, value);
+                return false;
+            }
+        }
+        return opt->trace_path != nullptr;
+    }
+
+    bool load_trace(const char* path, Trace* trace) {
+        FILE* f = fopen(path, "rb");
+        if (f == nullptr) {
+            perror(path);
+            return false;
+        }
+        std::vector<uint8_t> data;
+        uint8_t buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            data.insert(data.end(), buf, buf + n);
+        }
+        fclose(f);
+
+        if (data.size() < sizeof(TraceHeader)) {
+            fprintf(stderr, "%s: too short for a trace header\n", path);
+            return false;
+        }
+        TraceHeader& h = trace->header;
+        memcpy(&h, data.data(), sizeof(h));
+        if (h.magic != TraceHeader::MAGIC) {
+            fprintf(stderr, "%s: not a presence trace\n", path);
+            return false;
+        }
+        if (h.version != TraceHeader::VERSION || h.record_size != sizeof(TraceRecord) ||
+            h.config_size != sizeof(PresencePipelineConfig) || h.header_size < sizeof(TraceHeader)) {
+            fprintf(stderr, "%s: trace version %u, this tool reads version %u\n", path,
+                    (unsigned)h.version, (unsigned)TraceHeader::VERSION);
+            return false;
+        }
+        size_t available = (data.size() - h.header_size) / sizeof(TraceRecord);
+        if (available < h.count) {
+            fprintf(stderr, "%s: truncated, %zu of %lu samples\n", path, available,
+                    (unsigned long)h.count);
+            h.count = (uint32_t)available;
+        }
+
+        trace->records.resize(h.count);
+        memcpy(trace->records.data(), data.data() + h.header_size, h.count * sizeof(TraceRecord));
+        trace->times_ms.resize(h.count);
+        trace->gaps = 0;
+        int64_t t = h.start_ms;
+        for (uint32_t i = 0; i < h.count; i++) {
+            if (i > 0) {
+                t += trace->records[i].dt_ms;
+            }
+            trace->times_ms[i] = t;
+            if (trace->records[i].flags & TraceRecord::FLAG_GAP) {
+                trace->gaps++;
+            }
+        }
+        return true;
+    }
+
+    bool load_labels(const char* path, int64_t origin_ms, std::vector<Interval>* labels) {
+        FILE* f = fopen(path, "r");
+        if (f == nullptr) {
+            perror(path);
+            return false;
+        }
+        char line[256];
+        int line_no = 0;
+        while (fgets(line, sizeof(line), f) != nullptr) {
+            line_no++;
+            char* p = line;
+            while (*p == ' ' || *p == '\t') {
+                p++;
+            }
+            if (*p == '#' || *p == '\n' || *p == '\0') {
+                continue;
+            }
+            long long start = 0;
+            long long end = 0;
+            if (sscanf(p, "%lld %lld", &start, &end) != 2 || end < start) {
+                fprintf(stderr, "%s:%d: expected \"start_ms end_ms\"\n", path, line_no);
+                fclose(f);
+                return false;
+            }
+            labels->push_back({origin_ms + start, origin_ms + end});
+        }
+        fclose(f);
+        return true;
+    }
+
+    const char* led_action_name(LedAction action) {
+        switch (action) {
+        case LedAction::On:
+            return "on";
+        case LedAction::OffIdle:
+            return "off-idle";
+        case LedAction::OffMaxDuration:
+            return "off-max";
+        default:
+            return "";
+        }
+    }
+
+    void print_sample(const Trace& trace, size_t i, const PresenceStep& step) {
+        const TraceRecord& rec = trace.records[i];
+        char radar[16] = "-";
+        if (rec.radar_cm == TraceRecord::RADAR_NO_TARGET) {
+            snprintf(radar, sizeof(radar), "none");
+        } else if (rec.radar_cm != TraceRecord::RADAR_NONE) {
+            snprintf(radar, sizeof(radar), "%u", (unsigned)rec.radar_cm);
+        }
+        const char* light = (rec.flags & TraceRecord::LIGHT_MASK) == TraceRecord::LIGHT_SHADOW ? "shadow"
+                            : (rec.flags & TraceRecord::LIGHT_MASK) ? "quiet"
+                                                                    : "-";
+        printf("%9lld %7.1f %6s %6s | %c%c%c %.2f %-8s | %c%c%c %.2f %-8s%s\n",
+               (long long)(trace.times_ms[i] - trace.header.start_ms),
+               rec.distance_mm / 10.0, radar, light,
+               rec.motion() ? 'M' : '.', rec.present() ? 'P' : '.', rec.ledsOn() ? 'L' : '.',
+               rec.probability / 255.0, led_action_name(rec.ledAction()),
+               step.motion_present ? 'M' : '.', step.presence.present ? 'P' : '.',
+               step.leds_on ? 'L' : '.', step.presence.probability, led_action_name(step.led),
+               rec.present() != step.presence.present ? "  <-" : "");
+    }
+
+    Result replay(const Trace& trace, const PresencePipelineConfig& config,
+                  const std::vector<Interval>& labels, const Options& opt, bool list) {
+        PresencePipeline pipeline(config);
+        Result r = {};
+        r.config = config;
+        std::vector<Interval> episodes;
+        std::vector<int64_t> raw_latencies;
+        int64_t near_since = -1;
+        int64_t last_near = -1;
+        int64_t episode_start = 0;
+        int64_t led_start = 0;
+
+        if (list) {
+            printf("%9s %7s %6s %6s | %-17s | %-17s\n", "t_ms", "dist_cm", "radar", "light",
+                   "recorded", "replayed");
+        }
+        const size_t count = trace.records.size();
+        for (size_t i = 0; i < count; i++) {
+            const TraceRecord& rec = trace.records[i];
+            const int64_t t = trace.times_ms[i];
+            const PresenceSample sample = rec.sample(t);
+
+            bool near = (sample.distance_cm > 0 && sample.distance_cm < config.motion.enter_cm) ||
+                        (sample.radar_target && sample.radar_cm <= config.motion.enter_cm);
+            if (near) {
+                if (near_since < 0 || t - last_near > kNearGapMs) {
+                    near_since = t;
+                }
+                last_near = t;
+            }
+
+            const PresenceStep& step = pipeline.step(sample);
+            if (step.onset) {
+                r.visits++;
+                episode_start = t;
+                if (near_since >= 0 && t - last_near <= kNearGapMs) {
+                    raw_latencies.push_back(t - near_since);
+                }
+            } else if (step.ended) {
+                episodes.push_back({episode_start, t});
+            }
+            if (step.flow == FlowDirection::Entry) {
+                r.entries++;
+            } else if (step.flow == FlowDirection::Exit) {
+                r.exits++;
+            }
+            switch (step.led) {
+            case LedAction::On:
+                r.led_sessions++;
+                led_start = t;
+                break;
+            case LedAction::OffIdle:
+                r.off_idle++;
+                r.led_on_ms += t - led_start;
+                break;
+            case LedAction::OffMaxDuration:
+                r.off_max++;
+                r.led_on_ms += t - led_start;
+                break;
+            default:
+                break;
+            }
+            if (step.presence.present == rec.present()) {
+                r.agree++;
+            }
+            if (step.leds_on == rec.ledsOn()) {
+                r.led_agree++;
+            }
+            if (list) {
+                print_sample(trace, i, step);
+            }
+        }
+        if (count > 0) {
+            int64_t end = trace.times_ms[count - 1];
+            if (pipeline.fusion().estimate().present) {
+                episodes.push_back({episode_start, end});
+            }
+            if (pipeline.leds().on()) {
+                r.led_on_ms += end - led_start;
+            }
+        }
+
+        if (labels.empty()) {
+            // No ground truth: raw-to-decision latency, and the visits too
+            // short to be someone walking by
+            r.latencies_ms = raw_latencies;
+            for (const Interval& e : episodes) {
+                if (e.end_ms - e.start_ms < (int64_t)opt.short_ms) {
+                    r.false_triggers++;
+                }
+            }
+            return r;
+        }
+        for (const Interval& label : labels) {
+            const Interval* match = nullptr;
+            for (const Interval& e : episodes) {
+                if (e.start_ms <= label.end_ms + (int64_t)opt.slack_ms && e.end_ms >= label.start_ms) {
+                    match = &e;
+                    break;
+                }
+            }
+            if (match == nullptr) {
+                r.missed++;
+                continue;
+            }
+            r.hits++;
+            r.latencies_ms.push_back(std::max<int64_t>(0, match->start_ms - label.start_ms));
+        }
+        for (const Interval& e : episodes) {
+            bool labelled = false;
+            for (const Interval& label : labels) {
+                if (label.start_ms <= e.end_ms && label.end_ms + (int64_t)opt.slack_ms >= e.start_ms) {
+                    labelled = true;
+                    break;
+                }
+            }
+            if (!labelled) {
+                r.false_triggers++;
+            }
+        }
+        return r;
+    }
+
+    int64_t percentile(std::vector<int64_t> values, int permille) {
+        if (values.empty()) {
+            return -1;
+        }
+        std::sort(values.begin(), values.end());
+        size_t rank = (values.size() * permille + 999) / 1000;
+        return values[rank > 0 ? rank - 1 : 0];
+    }
+
+    void print_header(const Trace& trace, const std::vector<Interval>& labels) {
+        const TraceHeader& h = trace.header;
+        const PresencePipelineConfig& c = h.config;
+        int64_t span = trace.records.empty() ? 0 : trace.times_ms.back() - h.start_ms;
+        uint32_t visits = 0;
+        uint32_t sessions = 0;
+        bool present = false;
+        for (const TraceRecord& rec : trace.records) {
+            visits += rec.present() && !present;
+            present = rec.present();
+            sessions += rec.ledAction() == LedAction::On;
+        }
+        printf("Trace: %zu samples over %.1f s from uptime %.1f s", trace.records.size(),
+               span / 1000.0, h.start_ms / 1000.0);
+        if (h.dropped > 0) {
+            printf(", %lu older ones overwritten", (unsigned long)h.dropped);
+        }
+        if (trace.gaps > 0) {
+            printf(", %lu gaps over 65 s", (unsigned long)trace.gaps);
+        }
+        printf("\nRecorded: %lu visits, %lu LED sessions\n", (unsigned long)visits,
+               (unsigned long)sessions);
+        printf("Recorded config: threshold %.0f cm (+%.0f), debounce %lu/%lu ms, dwell %lu ms, "
+               "timeout %lu ms, max on %lu ms, p %.2f/%.2f\n",
+               c.motion.enter_cm, c.motion.exit_margin_cm,
+               (unsigned long)c.motion.enter_debounce_ms, (unsigned long)c.motion.exit_debounce_ms,
+               (unsigned long)c.motion.min_dwell_ms, (unsigned long)c.led.no_motion_timeout_ms,
+               (unsigned long)c.led.max_on_duration_ms, c.fusion.enter_p, c.fusion.exit_p);
+        if (!labels.empty()) {
+            printf("Labels: %zu visits\n", labels.size());
+        }
+    }
+
+    void print_result(const Result& r, size_t samples, bool labelled) {
+        double agree = samples ? 100.0 * r.agree / samples : 100.0;
+        double led_agree = samples ? 100.0 * r.led_agree / samples : 100.0;
+        printf("%5.0f %8lu %8lu | %6lu %3lu/%-3lu | %4lu %8.1f %4lu/%-3lu | %5lu",
+               r.config.motion.enter_cm, (unsigned long)r.config.led.no_motion_timeout_ms,
+               (unsigned long)r.config.led.max_on_duration_ms, (unsigned long)r.visits,
+               (unsigned long)r.entries, (unsigned long)r.exits, (unsigned long)r.led_sessions,
+               r.led_on_ms / 1000.0, (unsigned long)r.off_idle, (unsigned long)r.off_max,
+               (unsigned long)r.false_triggers);
+        if (labelled) {
+            printf(" %3lu/%-3lu", (unsigned long)r.hits, (unsigned long)r.missed);
+        }
+        printf(" | %5lld %5lld %5lld | %5.1f%% %5.1f%%\n",
+               (long long)percentile(r.latencies_ms, 500), (long long)percentile(r.latencies_ms, 900),
+               (long long)percentile(r.latencies_ms, 1000), agree, led_agree);
+    }
+}
+
+int main(int argc, char** argv) {
+    Options opt;
+    if (!parse_options(argc, argv, &opt)) {
+        usage(argv[0]);
+        return 2;
+    }
+    Trace trace;
+    if (!load_trace(opt.trace_path, &trace)) {
+        return 1;
+    }
+    std::vector<Interval> labels;
+    if (opt.labels_path != nullptr && !load_labels(opt.labels_path, trace.header.start_ms, &labels)) {
+        return 1;
+    }
+
+    PresencePipelineConfig base = trace.header.config;
+    if (opt.exit_margin_cm >= 0) base.motion.exit_margin_cm = opt.exit_margin_cm;
+    if (opt.enter_debounce_ms >= 0) base.motion.enter_debounce_ms = (uint32_t)opt.enter_debounce_ms;
+    if (opt.exit_debounce_ms >= 0) base.motion.exit_debounce_ms = (uint32_t)opt.exit_debounce_ms;
+    if (opt.min_dwell_ms >= 0) base.motion.min_dwell_ms = (uint32_t)opt.min_dwell_ms;
+    if (opt.enter_p >= 0) base.fusion.enter_p = opt.enter_p;
+    if (opt.exit_p >= 0) base.fusion.exit_p = opt.exit_p;
+    if (opt.thresholds_cm.empty()) opt.thresholds_cm.push_back(base.motion.enter_cm);
+    if (opt.timeouts_ms.empty()) opt.timeouts_ms.push_back(base.led.no_motion_timeout_ms);
+    if (opt.max_on_ms.empty()) opt.max_on_ms.push_back(base.led.max_on_duration_ms);
+
+    print_header(trace, labels);
+    printf("\n");
+
+    const bool labelled = !labels.empty();
+    std::vector<Result> results;
+    auto started = std::chrono::steady_clock::now();
+    for (float threshold : opt.thresholds_cm) {
+        for (uint32_t timeout : opt.timeouts_ms) {
+            for (uint32_t max_on : opt.max_on_ms) {
+                PresencePipelineConfig config = base;
+                config.motion.enter_cm = threshold;
+                config.led.no_motion_timeout_ms = timeout;
+                config.led.max_on_duration_ms = max_on;
+                results.push_back(replay(trace, config, labels, opt, opt.list && results.empty()));
+            }
+        }
+    }
+    double elapsed_ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - started).count();
+
+    if (opt.list) {
+        printf("\n");
+    }
+    printf("%5s %8s %8s | %6s %7s | %4s %8s %8s | %5s%s | %17s | %13s\n",
+           "cm", "idle_ms", "max_ms", "visits", "in/out", "LED", "on_s", "idle/max",
+           "false", labelled ? " hit/miss" : "",
+           labelled ? "latency p50/90/max" : "raw lag p50/90/max", "agree p/LED");
+    for (const Result& r : results) {
+        print_result(r, trace.records.size(), labelled);
+    }
+
+    int64_t span_ms = trace.records.empty() ? 0 : trace.times_ms.back() - trace.header.start_ms;
+    double replayed_ms = (double)span_ms * results.size();
+    printf("\nReplayed %zu x %.1f s of trace in %.1f ms (%.0fx real time)\n", results.size(),
+           span_ms / 1000.0, elapsed_ms, elapsed_ms > 0 ? replayed_ms / elapsed_ms : 0.0);
+    return 0;
+}